@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace plasma::bench
+{
+    // Runs function several times and returns the nanoseconds per operation of the fastest run, so that a run the
+    // scheduler interrupted does not skew the result.
+    template<typename TFunction>
+    double measure(std::size_t operations, TFunction&& function, std::size_t runs = 5)
+    {
+        auto best{ std::numeric_limits<double>::max() };
+        for (std::size_t i{}; i < runs; ++i)
+        {
+            auto started{ std::chrono::steady_clock::now() };
+            function();
+            best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()
+                - started).count());
+        }
+        return best / static_cast<double>(std::max<std::size_t>(operations, 1));
+    }
+
+    // Stores a result where the optimizer cannot prove nobody reads it.
+    inline void keep(std::uint64_t value) noexcept
+    {
+        static volatile std::uint64_t sink{};
+        sink = sink + value;
+    }
+
+    // One per file in bench/, run by name from plasma-bench.
+    void run_varint_benchmark();
+
+    void run_light_benchmark();
+
+    void run_entity_benchmark();
+
+    void run_event_bus_benchmark();
+
+    void run_chunk_packet_benchmark();
+
+    void run_region_benchmark();
+
+    void run_nbt_benchmark();
+
+    void run_log_benchmark();
+}
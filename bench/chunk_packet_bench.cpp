@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/config/plasma_config.h>
+#include <plasma/job/job_system.h>
+#include <plasma/network/chunk_packet_cache.h>
+#include <plasma/network/compression.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/light_engine.h>
+#include <plasma/world/terrain_generator.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    void run_chunk_packet_benchmark()
+    {
+        constexpr std::int32_t side{ 9 };
+        constexpr std::size_t count{ side * side };
+        constexpr std::size_t players{ 20 };
+        job::job_system jobs{ 0, false };
+        world::terrain_generator generator{ 1 };
+        std::vector<std::shared_ptr<world::chunk>> area(count);
+        jobs.parallel_for(0, count, 8, [&generator, &area](std::size_t i)
+        {
+            auto index{ static_cast<std::int32_t>(i) };
+            area[i] = generator.generate(index % side, index / side);
+        });
+        world::light_engine engine{ jobs, [&area](std::int32_t x, std::int32_t z)
+        {
+            auto inside{ x >= 0 && z >= 0 && x < side && z < side };
+            return inside ? area[static_cast<std::size_t>(z * side + x)] : nullptr;
+        } };
+        for (const auto& generated : area)
+        {
+            engine.queue_relight(generated->get_x(), generated->get_z());
+        }
+        engine.process(count);
+
+        // The same spawn area sent to every player joining, once encoded per player and once through the cache.
+        const config::plasma_config defaults{};
+        const auto& network{ defaults.network };
+        network::compression_statistics compression{};
+        network::chunk_packet_cache cache{ network.compression.threshold, network.compression.level,
+            network.chunk_packet_cache_size, compression };
+        std::size_t bytes{};
+        auto encoded{ measure(players * count, [&area, &cache, &bytes]
+        {
+            bytes = 0;
+            for (std::size_t player{}; player < players; ++player)
+            {
+                for (const auto& generated : area)
+                {
+                    bytes += cache.encode(*generated)->size();
+                }
+            }
+        }) };
+        auto shared{ measure(players * count, [&area, &cache]
+        {
+            for (std::size_t player{}; player < players; ++player)
+            {
+                for (const auto& generated : area)
+                {
+                    keep(cache.get(*generated)->size());
+                }
+            }
+        }) };
+        auto statistics{ cache.get_statistics() };
+        fmt::print("chunk-packets: {} chunks for {} players ({} KiB per player), {:.1f} us per chunk encoding per player, "
+            "{:.3f} us shared, {:.0f}x, hit ratio {:.1f}%\n", count, players, bytes / players / 1024, encoded / 1e3,
+            shared / 1e3, encoded / shared, 100.0 * static_cast<double>(statistics.hits)
+                / static_cast<double>(statistics.hits + statistics.misses));
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/entity/entity_store.h>
+#include <plasma/job/job_system.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    void run_entity_benchmark()
+    {
+        static constexpr std::size_t count{ 50000 };
+        constexpr double side{ 512.0 };
+        constexpr double radius{ 4.0 };
+        constexpr std::size_t ticks{ 100 };
+        static constexpr std::size_t grain{ 1024 };
+        constexpr std::size_t runs{ 3 };
+        job::job_system jobs{ 0, false };
+        entity::entity_store store{};
+        std::mt19937_64 random{ 1 };
+        std::uniform_real_distribution<double> position{ 0.0, side };
+        std::uniform_real_distribution<double> speed{ -0.25, 0.25 };
+        for (std::size_t i{}; i < count; ++i)
+        {
+            auto id{ store.create(0, position(random), 64.0, position(random), 0.6f, 1.8f) };
+            auto index{ store.get_index(id) };
+            store.get_velocity_x()[index] = speed(random);
+            store.get_velocity_z()[index] = speed(random);
+        }
+
+        // Entities bounce off the edges of the area, so that the grid keeps the same density throughout.
+        auto movement{ measure(ticks, [&store]
+        {
+            for (std::size_t tick{}; tick < ticks; ++tick)
+            {
+                auto x{ store.get_x() };
+                auto z{ store.get_z() };
+                auto velocity_x{ store.get_velocity_x() };
+                auto velocity_z{ store.get_velocity_z() };
+                for (std::size_t i{}; i < count; ++i)
+                {
+                    if (x[i] + velocity_x[i] < 0.0 || x[i] + velocity_x[i] >= side)
+                    {
+                        velocity_x[i] = -velocity_x[i];
+                    }
+                    if (z[i] + velocity_z[i] < 0.0 || z[i] + velocity_z[i] >= side)
+                    {
+                        velocity_z[i] = -velocity_z[i];
+                    }
+                }
+                store.integrate();
+            }
+        }, runs) };
+
+        std::atomic<std::uint64_t> neighbours{};
+        const auto& queried{ store };
+        auto queries{ measure(1, [&jobs, &queried, &neighbours, x = store.get_x(), z = store.get_z()]
+        {
+            neighbours.store(0, std::memory_order_relaxed);
+            jobs.parallel_for(0, (count + grain - 1) / grain, 1, [&queried, &neighbours, x, z](std::size_t chunk)
+            {
+                thread_local std::vector<std::uint32_t> result{};
+                std::uint64_t found{};
+                for (auto i{ chunk * grain }; i < std::min((chunk + 1) * grain, count); ++i)
+                {
+                    found += queried.query_radius(x[i], 64.0, z[i], radius, result).size() - 1;
+                }
+                neighbours.fetch_add(found, std::memory_order_relaxed);
+            });
+        }) };
+        keep(neighbours.load());
+        fmt::print("entities: {} entities, movement {:.2f} ms per tick ({} cell changes per tick), {} radius-{} "
+            "queries {:.2f} ms on {} threads, {:.1f} neighbours each\n", count, movement / 1e6,
+            store.get_statistics().cell_moves / (ticks * runs), count, radius, queries / 1e6,
+            jobs.get_worker_count() + 1, static_cast<double>(neighbours.load()) / static_cast<double>(count));
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/event/event_bus.h>
+#include <plasma/event/events.h>
+#include <plasma/job/job_system.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    void run_event_bus_benchmark()
+    {
+        constexpr std::size_t handlers{ 4 };
+        constexpr std::size_t iterations{ 10000000 };
+        static constexpr std::size_t batch{ 250 };
+        constexpr std::size_t posters{ 4 };
+        constexpr std::size_t rounds{ 1000 };
+        event::event_bus bus{};
+        std::vector<std::function<void(event::player_move_event&)>> functions{};
+        double total{};
+        for (std::size_t i{}; i < handlers; ++i)
+        {
+            auto handler{ [&total](event::player_move_event& event)
+            {
+                total += event.x;
+            } };
+            bus.subscribe<event::player_move_event>(nullptr, static_cast<event::event_priority>(i), handler);
+            functions.emplace_back(handler);
+        }
+        bus.apply_changes();
+
+        event::player_move_event moved{};
+        auto published{ measure(iterations, [&bus, &moved]
+        {
+            for (std::size_t i{}; i < iterations; ++i)
+            {
+                moved.x = static_cast<double>(i);
+                bus.publish(moved);
+            }
+        }) };
+        auto called{ measure(iterations, [&functions, &moved]
+        {
+            for (std::size_t i{}; i < iterations; ++i)
+            {
+                moved.x = static_cast<double>(i);
+                for (const auto& function : functions)
+                {
+                    function(moved);
+                }
+            }
+        }) };
+        event::player_join_event joined{};
+        auto unheard{ measure(iterations, [&bus, &joined]
+        {
+            for (std::size_t i{}; i < iterations; ++i)
+            {
+                joined.connection = i;
+                bus.publish(joined);
+            }
+        }) };
+        keep(static_cast<std::uint64_t>(total));
+        fmt::print("events: {} handlers, event bus {:.2f} ns per event, std::function vector {:.2f} ns, no listeners "
+            "{:.2f} ns\n", handlers, published, called, unheard);
+
+        // Job workers post into their own rings, drained once per round as the tick thread would.
+        job::job_system jobs{ 0, false };
+        auto posted{ measure(rounds * posters * batch, [&jobs, &bus]
+        {
+            for (std::size_t round{}; round < rounds; ++round)
+            {
+                jobs.parallel_for(0, posters, 1, [&bus](std::size_t)
+                {
+                    event::player_move_event posted{};
+                    for (std::size_t i{}; i < batch; ++i)
+                    {
+                        posted.x = static_cast<double>(i);
+                        bus.post(posted);
+                    }
+                });
+                bus.dispatch_posted();
+            }
+        }) };
+        auto statistics{ bus.get_statistics() };
+        fmt::print("events: posted {} events from {} threads, {} delivered, {} dropped, {:.2f} ns per event\n",
+            statistics.posted, statistics.queues, statistics.delivered, statistics.dropped, posted);
+    }
+}
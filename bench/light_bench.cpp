@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/job/job_system.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/light_engine.h>
+#include <plasma/world/terrain_generator.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    void run_light_benchmark()
+    {
+        constexpr std::int32_t side{ 32 };
+        constexpr std::size_t count{ side * side };
+        job::job_system jobs{ 0, false };
+        world::terrain_generator generator{ 1 };
+        std::vector<std::shared_ptr<world::chunk>> area(count);
+        jobs.parallel_for(0, count, 8, [&generator, &area](std::size_t i)
+        {
+            auto index{ static_cast<std::int32_t>(i) };
+            area[i] = generator.generate(index % side, index / side);
+        });
+        world::light_engine engine{ jobs, [&area](std::int32_t x, std::int32_t z)
+        {
+            auto inside{ x >= 0 && z >= 0 && x < side && z < side };
+            return inside ? area[static_cast<std::size_t>(z * side + x)] : nullptr;
+        } };
+        auto relight{ [&engine](bool parallel)
+        {
+            for (std::int32_t z{}; z < side; ++z)
+            {
+                for (std::int32_t x{}; x < side; ++x)
+                {
+                    engine.queue_relight(x, z);
+                }
+            }
+            keep(engine.process(count, parallel));
+        } };
+
+        // Light the area once, so that every measured run relights chunks whose neighbours are all lit, as a block
+        // change in a loaded world would.
+        relight(true);
+        auto single{ measure(count, [&relight] { relight(false); }, 3) };
+        auto multi{ measure(count, [&relight] { relight(true); }, 3) };
+        fmt::print("light: relit {} chunks, {:.1f} us each on 1 thread, {:.1f} us on {} threads, {:.2f}x\n", count,
+            single / 1e3, multi / 1e3, jobs.get_worker_count() + 1, single / multi);
+    }
+}
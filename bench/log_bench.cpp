@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
+#include <boost/smart_ptr/make_shared_object.hpp>
+#include <fmt/format.h>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/log/logging_system.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    namespace
+    {
+        // Takes every record and drops it, so that only the cost of the log statement itself is measured.
+        class null_backend : public boost::log::sinks::basic_sink_backend<boost::log::sinks::concurrent_feeding>
+        {
+        public:
+            void consume(const boost::log::record_view&)
+            {
+            }
+        };
+
+        // The per-statement cost of the stream and the format-string macros at the current minimum severity.
+        std::pair<double, double> measure_trace(std::size_t count)
+        {
+            logger lg{};
+            auto stream{ measure(count, [&lg, count]
+            {
+                for (std::size_t i{}; i < count; ++i)
+                {
+                    TRC(lg) << "Benchmark record " << i;
+                }
+            }) };
+            auto format{ measure(count, [&lg, count]
+            {
+                for (std::size_t i{}; i < count; ++i)
+                {
+                    TRCF(lg, "Benchmark record {}", i);
+                }
+            }) };
+            return { stream, format };
+        }
+    }
+
+    void run_log_benchmark()
+    {
+        constexpr std::size_t disabled_count{ 10000000 };
+        constexpr std::size_t enabled_count{ 200000 };
+        auto core{ boost::log::core::get() };
+        auto sink{ boost::make_shared<boost::log::sinks::unlocked_sink<null_backend>>() };
+        core->add_sink(sink);
+        auto previous{ log::minimum_severity.load(std::memory_order_relaxed) };
+
+        log::set_minimum_severity(severity_level::info);
+        auto [disabled_stream, disabled_format]{ measure_trace(disabled_count) };
+        log::set_minimum_severity(severity_level::trace);
+        auto [enabled_stream, enabled_format]{ measure_trace(enabled_count) };
+
+        log::set_minimum_severity(previous);
+        core->remove_sink(sink);
+        // Debug builds attach the source location to every enabled record, release builds leave it out.
+#if !defined(NDEBUG) || defined(_DEBUG)
+        constexpr auto build{ "debug" };
+#else
+        constexpr auto build{ "release" };
+#endif
+        fmt::print("log: {} build, filtered out TRC {:.2f} ns per statement, TRCF {:.2f} ns, enabled to a null sink "
+            "TRC {:.0f} ns, TRCF {:.0f} ns\n", build, disabled_stream, disabled_format, enabled_stream,
+            enabled_format);
+    }
+}
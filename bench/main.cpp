@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+
+std::atomic<bool> g_color_enabled{ true };
+
+namespace
+{
+    class benchmark
+    {
+    public:
+        std::string_view name;
+        void (*run)();
+    };
+
+    const std::vector<benchmark> benchmarks{
+        { "varint", &plasma::bench::run_varint_benchmark },
+        { "light", &plasma::bench::run_light_benchmark },
+        { "entities", &plasma::bench::run_entity_benchmark },
+        { "events", &plasma::bench::run_event_bus_benchmark },
+        { "chunk-packets", &plasma::bench::run_chunk_packet_benchmark },
+        { "region", &plasma::bench::run_region_benchmark },
+        { "nbt", &plasma::bench::run_nbt_benchmark },
+        { "log", &plasma::bench::run_log_benchmark }
+    };
+}
+
+// Runs the named benchmarks, or all of them, and prints their results. Build in release mode before trusting them.
+int main(const int argc, const char* argv[])
+{
+    std::vector<std::string_view> selected(argv + 1, argv + argc);
+    for (auto name : selected)
+    {
+        if (std::ranges::find(benchmarks, name, &benchmark::name) == benchmarks.end())
+        {
+            std::cerr << "Unknown benchmark " << name << ", pick from:";
+            for (const auto& known : benchmarks)
+            {
+                std::cerr << " " << known.name;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+    }
+    int result{};
+    for (const auto& [name, run] : benchmarks)
+    {
+        if (!selected.empty() && std::ranges::find(selected, name) == selected.end())
+        {
+            continue;
+        }
+        try
+        {
+            run();
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << name << " failed: " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
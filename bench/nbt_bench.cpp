@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/job/job_system.h>
+#include <plasma/nbt/document.h>
+#include <plasma/nbt/reader.hpp>
+#include <plasma/nbt/view.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/terrain_generator.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    namespace
+    {
+        // Visits every tag and reads every array, as a full load of the chunk would.
+        std::uint64_t walk(const nbt::view& tag)
+        {
+            switch (tag.get_type())
+            {
+            case nbt::tag_type::tag_compound:
+            case nbt::tag_type::tag_list:
+            {
+                std::uint64_t visited{ 1 };
+                tag.for_each([&visited](const nbt::view& child)
+                {
+                    visited += walk(child);
+                });
+                return visited;
+            }
+            case nbt::tag_type::tag_long_array:
+                return 1 + tag.as_long_array().to_vector().size();
+            default:
+                return 1;
+            }
+        }
+    }
+
+    void run_nbt_benchmark()
+    {
+        // The NBT of a 16x16 area of generated chunks, as stored in region files before compression.
+        constexpr std::size_t count{ 256 };
+        job::job_system jobs{ 0, false };
+        world::terrain_generator generator{ 1 };
+        std::vector<std::vector<std::byte>> corpus(count);
+        jobs.parallel_for(0, count, 8, [&generator, &corpus](std::size_t i)
+        {
+            generator.generate(static_cast<std::int32_t>(i % 16), static_cast<std::int32_t>(i / 16))
+                ->serialize(corpus[i]);
+        });
+        std::size_t bytes{};
+        for (const auto& nbt : corpus)
+        {
+            bytes += nbt.size();
+        }
+
+        nbt::document parsed{};
+        auto document{ measure(count, [&corpus, &parsed]
+        {
+            for (const auto& nbt : corpus)
+            {
+                keep(parsed.parse(nbt));
+            }
+        }) };
+        auto view{ measure(count, [&corpus]
+        {
+            for (const auto& nbt : corpus)
+            {
+                keep(walk(nbt::view{ nbt }));
+            }
+        }) };
+        auto streaming{ measure(count, [&corpus]
+        {
+            for (const auto& nbt : corpus)
+            {
+                nbt::null_handler ignore{};
+                keep(nbt::parse(nbt, ignore));
+            }
+        }) };
+        auto chunks{ measure(count, [&corpus]
+        {
+            for (std::size_t i{}; i < count; ++i)
+            {
+                keep(world::chunk::deserialize(static_cast<std::int32_t>(i % 16), static_cast<std::int32_t>(i / 16),
+                    corpus[i])->get_memory_usage());
+            }
+        }) };
+        auto per_second{ [average = static_cast<double>(bytes) / count](double nanoseconds)
+        {
+            return average / nanoseconds * 1e3;
+        } };
+        fmt::print("nbt: {} chunks ({} KiB each), document {:.1f} us per chunk ({:.0f} MB/s), view walk {:.1f} us "
+            "({:.0f} MB/s), bare parse {:.1f} us ({:.0f} MB/s), chunk::deserialize {:.1f} us\n", count,
+            bytes / count / 1024, document / 1e3, per_second(document), view / 1e3, per_second(view),
+            streaming / 1e3, per_second(streaming), chunks / 1e3);
+    }
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/job/job_system.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/region_file.h>
+#include <plasma/world/terrain_generator.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    namespace
+    {
+        constexpr std::size_t sector_size{ world::region_file::sector_size };
+        constexpr std::size_t chunk_count{ world::region_file::chunk_count };
+
+        std::uint32_t read_big_endian(const char* data) noexcept
+        {
+            return static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[0])) << 24
+                | static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[1])) << 16
+                | static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[2])) << 8
+                | static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[3]));
+        }
+
+        // Fills a whole region with generated chunks, compressed as vanilla does and written in one batch.
+        void write_region(const std::filesystem::path& path)
+        {
+            job::job_system jobs{ 0, false };
+            world::terrain_generator generator{ 1 };
+            std::vector<std::vector<std::byte>> compressed(chunk_count);
+            jobs.parallel_for(0, chunk_count, 8, [&generator, &compressed](std::size_t i)
+            {
+                std::vector<std::byte> nbt{};
+                generator.generate(static_cast<std::int32_t>(i % 32), static_cast<std::int32_t>(i / 32))
+                    ->serialize(nbt);
+                world::compress_chunk(nbt, compressed[i]);
+            });
+            std::vector<world::chunk_write> writes{};
+            for (std::size_t i{}; i < chunk_count; ++i)
+            {
+                writes.push_back({ .x = static_cast<std::int32_t>(i % 32), .z = static_cast<std::int32_t>(i / 32),
+                    .data = compressed[i], .compression = world::chunk_compression::zlib, .timestamp = 1 });
+            }
+            world::region_file region{ path, true };
+            region.write_batch(writes);
+        }
+
+        // The stream-based reader the memory mapping replaced: one seek and one copy into a buffer per chunk.
+        template<typename TConsumer>
+        void read_with_stream(const std::filesystem::path& path, TConsumer consume)
+        {
+            std::ifstream stream{ path, std::ios::binary };
+            std::array<char, sector_size> header{};
+            if (!stream.read(header.data(), header.size()))
+            {
+                throw std::runtime_error{ fmt::format("Failed to read {}", path.string()) };
+            }
+            std::vector<char> buffer{};
+            for (std::size_t i{}; i < chunk_count; ++i)
+            {
+                auto location{ read_big_endian(header.data() + i * 4) };
+                if (!location)
+                {
+                    continue;
+                }
+                buffer.resize((location & 0xff) * sector_size);
+                stream.seekg(static_cast<std::streamoff>(location >> 8) * static_cast<std::streamoff>(sector_size));
+                if (!stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size())))
+                {
+                    throw std::runtime_error{ fmt::format("Failed to read chunk {} of {}", i, path.string()) };
+                }
+                auto length{ read_big_endian(buffer.data()) };
+                consume(std::span{ reinterpret_cast<const std::byte*>(buffer.data()) + 5, length - 1 },
+                    static_cast<world::chunk_compression>(buffer[4]));
+            }
+        }
+    }
+
+    void run_region_benchmark()
+    {
+        auto path{ std::filesystem::temp_directory_path() / "plasma-region-bench" / "r.0.0.mca" };
+        std::uint64_t mapped_bytes{};
+        std::uint64_t stream_bytes{};
+        std::vector<std::byte> nbt{};
+        try
+        {
+            write_region(path);
+            // Both read a file the page cache already holds, so this compares the read paths, not the disk.
+            world::region_file region{ path, false };
+            auto mapped_raw{ measure(chunk_count, [&region, &mapped_bytes]
+            {
+                mapped_bytes = 0;
+                for (std::size_t i{}; i < chunk_count; ++i)
+                {
+                    auto raw{ region.read_raw(static_cast<std::int32_t>(i % 32), static_cast<std::int32_t>(i / 32)) };
+                    mapped_bytes += raw->data.size();
+                }
+            }) };
+            auto stream_raw{ measure(chunk_count, [&path, &stream_bytes]
+            {
+                stream_bytes = 0;
+                read_with_stream(path, [&stream_bytes](std::span<const std::byte> data, world::chunk_compression)
+                {
+                    stream_bytes += data.size();
+                });
+            }) };
+            if (mapped_bytes != stream_bytes)
+            {
+                throw std::runtime_error{ "The readers disagree" };
+            }
+            auto mapped_inflated{ measure(chunk_count, [&region, &nbt]
+            {
+                for (std::size_t i{}; i < chunk_count; ++i)
+                {
+                    region.read(static_cast<std::int32_t>(i % 32), static_cast<std::int32_t>(i / 32), nbt);
+                    keep(nbt.size());
+                }
+            }) };
+            auto stream_inflated{ measure(chunk_count, [&path, &nbt]
+            {
+                read_with_stream(path, [&nbt](std::span<const std::byte> data, world::chunk_compression compression)
+                {
+                    world::decompress_chunk(data, compression, nbt);
+                    keep(nbt.size());
+                });
+            }) };
+            fmt::print("region: {} chunks ({} KiB compressed), memory mapping {:.2f} us per chunk, ifstream {:.2f} us, "
+                "{:.1f}x; with inflating {:.1f} us and {:.1f} us\n", chunk_count, mapped_bytes / 1024,
+                mapped_raw / 1e3, stream_raw / 1e3, stream_raw / mapped_raw, mapped_inflated / 1e3,
+                stream_inflated / 1e3);
+        }
+        catch (...)
+        {
+            std::filesystem::remove_all(path.parent_path());
+            throw;
+        }
+        std::filesystem::remove_all(path.parent_path());
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <plasma/network/varint.h>
+
+#include "bench.h"
+
+namespace plasma::bench
+{
+    namespace
+    {
+        // The textbook loop, one byte and one bounds check at a time.
+        std::optional<network::varint_result> read_varint_naive(std::span<const std::byte> data)
+        {
+            std::uint32_t value{};
+            for (std::size_t i{}; i < 5; ++i)
+            {
+                if (i == data.size())
+                {
+                    return std::nullopt;
+                }
+                auto byte{ std::to_integer<std::uint32_t>(data[i]) };
+                value |= (byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80))
+                {
+                    return network::varint_result{ .value = static_cast<std::int32_t>(value), .size = i + 1 };
+                }
+            }
+            throw std::runtime_error{ "VarInt is too big" };
+        }
+
+        template<typename TRead>
+        std::uint64_t decode_all(std::span<const std::byte> data, std::size_t count, TRead read)
+        {
+            std::uint64_t sum{};
+            std::size_t offset{};
+            for (std::size_t i{}; i < count; ++i)
+            {
+                auto decoded{ *read(data.subspan(offset)) };
+                sum += static_cast<std::uint32_t>(decoded.value);
+                offset += decoded.size;
+            }
+            return sum;
+        }
+    }
+
+    void run_varint_benchmark()
+    {
+        // Mostly lengths, ids and small counts as in real packets, with some negative numbers taking five bytes.
+        constexpr std::size_t count{ 1000000 };
+        std::mt19937 random{ 1 };
+        std::discrete_distribution<int> length{ 60, 25, 10, 0, 5 };
+        std::vector<std::byte> data(count * 5 + 8);
+        std::size_t size{};
+        for (std::size_t i{}; i < count; ++i)
+        {
+            auto bytes{ length(random) + 1 };
+            auto value{ bytes == 5 ? static_cast<std::uint32_t>(-static_cast<std::int32_t>(random() % 1000 + 1))
+                : static_cast<std::uint32_t>(random() % (1u << (7 * bytes))) };
+            size += network::write_varint(data.data() + size, value);
+        }
+        std::span<const std::byte> encoded{ data.data(), size + 8 };
+
+        std::uint64_t selected{};
+        std::uint64_t naive{};
+        auto codec{ measure(count, [&] { selected = decode_all(encoded, count, &network::read_varint); }) };
+        auto byte_loop{ measure(count, [&] { naive = decode_all(encoded, count, &read_varint_naive); }) };
+        if (selected != naive)
+        {
+            throw std::runtime_error{ "The decoders disagree" };
+        }
+        keep(selected);
+        fmt::print("varint: {} VarInts ({:.2f} bytes each), {} codec {:.2f} ns each, naive byte loop {:.2f} ns, "
+            "{:.2f}x\n", count, static_cast<double>(size) / count, network::get_varint_codec_name(), codec, byte_loop,
+            byte_loop / codec);
+    }
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <plasma/config/plasma_config.h>
+
+namespace plasma::config
+{
+    // Watches plasma.info and publishes every successful parse as an immutable snapshot. Reading the current snapshot
+    // is a single atomic load, so any thread can do it on its hot path. Listeners run on the tick thread in poll()
+    // with the snapshots from before and after the change.
+    class config_watcher
+    {
+    public:
+        using listener = std::function<void(const plasma_config& previous, const plasma_config& current)>;
+    private:
+        std::mutex mutex_;
+        // Reloads are rare and snapshots small, so superseded snapshots are kept until shutdown instead of tracking
+        // when their last reader let go of them.
+        std::vector<std::unique_ptr<const plasma_config>> snapshots_;
+        std::atomic<const plasma_config*> current_;
+        const plasma_config* notified_;
+        std::vector<listener> listeners_;
+        std::atomic<bool> running_;
+        int descriptor_;
+        std::thread watcher_;
+        std::atomic<std::uint64_t> reloads_;
+
+        void run();
+    public:
+        explicit config_watcher(const plasma_config& initial);
+
+        config_watcher(const config_watcher&) = delete;
+
+        config_watcher& operator=(const config_watcher&) = delete;
+
+        ~config_watcher();
+
+        // Starts watching the directory of the file, so editors that replace it are noticed too. Only supported on
+        // Linux; elsewhere changes are picked up by reload() alone.
+        void start();
+
+        void stop();
+
+        [[nodiscard]] const plasma_config& get() const noexcept
+        {
+            return *current_.load(std::memory_order_acquire);
+        }
+
+        // Reads the file again and publishes it if it parses and differs from the current snapshot. Any thread.
+        bool reload();
+
+        // Tick thread only.
+        void add_listener(listener function);
+
+        // Tick thread only. Changes published since the last call are reported to the listeners as one.
+        void poll();
+
+        [[nodiscard]] std::uint64_t get_reloads() const noexcept
+        {
+            return reloads_.load(std::memory_order_relaxed);
+        }
+    };
+}
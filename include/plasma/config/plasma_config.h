@@ -22,7 +22,12 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <string>
+
+#include <boost/property_tree/ptree_fwd.hpp>
 
 #include <plasma/config/config.h>
 
@@ -32,13 +37,85 @@ namespace plasma::config
     {
     private:
         std::filesystem::path file_path_;
+
+        void read(const boost::property_tree::ptree& tree);
+
+        [[nodiscard]] boost::property_tree::ptree write() const;
     public:
         class
         {
         public:
             bool color_enabled;
+
+            class
+            {
+            public:
+                bool enabled;
+                std::size_t queue_capacity;
+                std::string overflow_policy;
+                std::uint32_t flush_interval_ms;
+            } async;
+
+            class
+            {
+            public:
+                bool enabled;
+                std::size_t queue_bytes;
+                std::uintmax_t rotation_size;
+                std::string console_severity;
+            } binary;
         } logging;
 
+        class
+        {
+        public:
+            std::string bind_address;
+            std::uint16_t port;
+            std::size_t reactor_threads;
+            std::size_t inbound_queue_capacity;
+            std::string motd;
+            std::uint32_t max_players;
+            std::size_t chunk_packet_cache_size;
+
+            class
+            {
+            public:
+                std::filesystem::path favicon;
+                double requests_per_second;
+                double burst;
+            } status;
+
+            class
+            {
+            public:
+                std::int32_t threshold;
+                std::int32_t level;
+                std::size_t offload_size;
+            } compression;
+        } network;
+
+        class
+        {
+        public:
+            std::uint32_t rate;
+            std::string overrun_policy;
+            std::uint64_t max_catch_up;
+        } tick;
+
+        class
+        {
+        public:
+            std::size_t workers;
+            bool affinity;
+        } jobs;
+
+        class
+        {
+        public:
+            bool enabled;
+            std::string segment;
+        } metrics;
+
         class
         {
         public:
@@ -47,14 +124,44 @@ namespace plasma::config
             public:
                 std::filesystem::path base_dir;
                 std::filesystem::path backup_dir;
+                std::size_t max_in_flight;
+                std::uint64_t backup_rate;
             } storage;
+            class
+            {
+            public:
+                std::size_t memory_budget;
+                double prefetch_seconds;
+                std::size_t max_prefetch_per_tick;
+            } cache;
+            class
+            {
+            public:
+                std::size_t max_chunks_per_tick;
+            } light;
+            class
+            {
+            public:
+                double view_distance;
+            } entities;
             std::string name;
+            std::int64_t seed;
+            std::int32_t spawn_radius;
         } world;
 
         plasma_config() noexcept;
 
         void load() override;
 
+        // Reads the file again without writing it back. Settings missing from the file keep their current values.
+        // Returns whether any setting changed.
+        bool reload();
+
         void save() override;
+
+        [[nodiscard]] const std::filesystem::path& get_file_path() const noexcept
+        {
+            return file_path_;
+        }
     };
 }
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace plasma::console
+{
+    using command_handler = std::function<void(std::span<const std::string_view>)>;
+
+    // Reads commands from standard input on a background thread and runs them on whichever thread polls.
+    class console
+    {
+    private:
+        class command
+        {
+        public:
+            std::string description;
+            command_handler handler;
+        };
+
+        class input
+        {
+        public:
+            std::mutex mutex;
+            std::deque<std::string> lines;
+        };
+
+        std::map<std::string, command, std::less<>> commands_;
+        std::shared_ptr<input> input_;
+    public:
+        console();
+
+        console(const console&) = delete;
+
+        console& operator=(const console&) = delete;
+
+        void register_command(std::string name, std::string description, command_handler handler);
+
+        void start();
+
+        std::size_t poll();
+
+        void execute(std::string_view line);
+    };
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace plasma::entity
+{
+    // Type-erased column the entity store keeps in step with its dense arrays.
+    class component_column
+    {
+    public:
+        virtual ~component_column() = default;
+
+        [[nodiscard]] virtual const std::type_info& get_type() const noexcept = 0;
+
+        virtual void push() = 0;
+
+        // Moves the last element into index and drops the last element, mirroring the store's swap-remove.
+        virtual void remove(std::size_t index) = 0;
+    };
+
+    // Extra per-entity data attached by plugins, indexed like the store's hot arrays. Every entity has a slot,
+    // but only attached slots are reported by find().
+    template<typename TComponent>
+    class component final : public component_column
+    {
+    private:
+        std::vector<TComponent> values_;
+        std::vector<std::uint8_t> attached_;
+    public:
+        explicit component(std::size_t size) :
+            values_(size), attached_(size)
+        {
+        }
+
+        [[nodiscard]] const std::type_info& get_type() const noexcept override
+        {
+            return typeid(TComponent);
+        }
+
+        void push() override
+        {
+            values_.emplace_back();
+            attached_.push_back(0);
+        }
+
+        void remove(std::size_t index) override
+        {
+            if (index + 1 != values_.size())
+            {
+                values_[index] = std::move(values_.back());
+                attached_[index] = attached_.back();
+            }
+            values_.pop_back();
+            attached_.pop_back();
+        }
+
+        TComponent& attach(std::size_t index, TComponent value)
+        {
+            values_[index] = std::move(value);
+            attached_[index] = 1;
+            return values_[index];
+        }
+
+        void detach(std::size_t index)
+        {
+            values_[index] = TComponent{};
+            attached_[index] = 0;
+        }
+
+        [[nodiscard]] TComponent* find(std::size_t index) noexcept
+        {
+            return attached_[index] ? &values_[index] : nullptr;
+        }
+
+        [[nodiscard]] const TComponent* find(std::size_t index) const noexcept
+        {
+            return attached_[index] ? &values_[index] : nullptr;
+        }
+
+        [[nodiscard]] std::span<TComponent> get_values() noexcept
+        {
+            return values_;
+        }
+    };
+}
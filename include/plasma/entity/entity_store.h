@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include <plasma/entity/component.hpp>
+
+namespace plasma::entity
+{
+    class entity_id
+    {
+    public:
+        std::uint32_t index;
+        std::uint32_t generation;
+
+        [[nodiscard]] bool operator==(const entity_id& other) const noexcept = default;
+    };
+
+    class bounding_box
+    {
+    public:
+        double min_x;
+        double min_y;
+        double min_z;
+        double max_x;
+        double max_y;
+        double max_z;
+    };
+
+    enum class entity_flag : std::uint32_t
+    {
+        on_ground = 1 << 0,
+        no_gravity = 1 << 1,
+        sneaking = 1 << 2,
+        sprinting = 1 << 3,
+        invisible = 1 << 4,
+        // Spawned with the generic object packet (items, projectiles, vehicles) rather than as a living entity.
+        object = 1 << 5
+    };
+
+    class entity_statistics
+    {
+    public:
+        std::size_t entities;
+        std::size_t cells;
+        std::size_t components;
+        std::uint64_t created;
+        std::uint64_t destroyed;
+        std::uint64_t cell_moves;
+    };
+
+    // Entities live in dense structure-of-arrays columns that are swap-removed on destroy, so a dense index is only
+    // valid until the next create or destroy; entity_id stays valid until its entity is destroyed. Positions are
+    // bucketed into a uniform grid of vertical columns, which is updated whenever an entity crosses a cell border.
+    // Not thread-safe; the const queries taking a caller-owned buffer may run concurrently with each other.
+    class entity_store
+    {
+    private:
+        class slot
+        {
+        public:
+            std::uint32_t dense;
+            std::uint32_t generation;
+        };
+
+        std::int32_t cell_shift_;
+        std::vector<slot> slots_;
+        std::vector<std::uint32_t> free_slots_;
+        std::vector<std::uint32_t> slot_of_;
+        std::vector<double> x_;
+        std::vector<double> y_;
+        std::vector<double> z_;
+        std::vector<double> velocity_x_;
+        std::vector<double> velocity_y_;
+        std::vector<double> velocity_z_;
+        std::vector<float> half_width_;
+        std::vector<float> height_;
+        std::vector<std::uint32_t> flags_;
+        std::vector<std::int32_t> type_;
+        std::vector<std::int32_t> network_id_;
+        std::vector<float> yaw_;
+        std::vector<float> pitch_;
+        std::vector<std::array<std::uint8_t, 16>> uuid_;
+        std::vector<std::uint64_t> cell_key_;
+        std::vector<std::uint32_t> cell_slot_;
+        std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells_;
+        std::unordered_map<std::string, std::unique_ptr<component_column>> components_;
+        std::vector<std::uint32_t> scratch_;
+        float max_half_width_;
+        std::int32_t next_network_id_;
+        std::mt19937_64 random_;
+        std::uint64_t created_;
+        std::uint64_t destroyed_;
+        std::uint64_t cell_moves_;
+
+        [[nodiscard]] std::int32_t get_cell(double coordinate) const noexcept;
+
+        [[nodiscard]] static std::uint64_t get_cell_key(std::int32_t x, std::int32_t z) noexcept;
+
+        void insert_into_cell(std::uint32_t index, std::uint64_t key);
+
+        void remove_from_cell(std::uint32_t index);
+
+        template<typename TVisitor>
+        void visit_cells(double min_x, double min_z, double max_x, double max_z, TVisitor&& visitor) const;
+    public:
+        static constexpr std::uint32_t invalid_index{ std::numeric_limits<std::uint32_t>::max() };
+
+        // cell_size must be a power of two; 16 keeps one cell per chunk column.
+        explicit entity_store(std::int32_t cell_size = 16);
+
+        entity_store(const entity_store&) = delete;
+
+        entity_store& operator=(const entity_store&) = delete;
+
+        entity_id create(std::int32_t type, double x, double y, double z, float width, float height);
+
+        bool destroy(entity_id id);
+
+        [[nodiscard]] bool contains(entity_id id) const noexcept;
+
+        // Returns invalid_index for destroyed entities.
+        [[nodiscard]] std::uint32_t get_index(entity_id id) const noexcept;
+
+        [[nodiscard]] entity_id get_id(std::uint32_t index) const noexcept
+        {
+            auto slot{ slot_of_[index] };
+            return { slot, slots_[slot].generation };
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return x_.size();
+        }
+
+        // Moves one entity and updates its grid cell straight away.
+        void set_position(std::uint32_t index, double x, double y, double z);
+
+        // Adds each velocity to its position, then refreshes the grid.
+        void integrate();
+
+        // Rebuckets entities whose positions were written through the spans below.
+        void update_grid();
+
+        [[nodiscard]] bounding_box get_bounding_box(std::uint32_t index) const noexcept;
+
+        [[nodiscard]] bool has_flag(std::uint32_t index, entity_flag flag) const noexcept
+        {
+            return flags_[index] & static_cast<std::uint32_t>(flag);
+        }
+
+        void set_flag(std::uint32_t index, entity_flag flag, bool value) noexcept;
+
+        // Entities whose position lies within radius of the point. The result lives in a buffer owned by the store
+        // and is overwritten by the next query.
+        std::span<const std::uint32_t> query_radius(double x, double y, double z, double radius);
+
+        std::span<const std::uint32_t> query_radius(double x, double y, double z, double radius,
+            std::vector<std::uint32_t>& result) const;
+
+        // Entities whose bounding box intersects the box.
+        std::span<const std::uint32_t> query_box(const bounding_box& box);
+
+        std::span<const std::uint32_t> query_box(const bounding_box& box, std::vector<std::uint32_t>& result) const;
+
+        [[nodiscard]] std::span<double> get_x() noexcept
+        {
+            return x_;
+        }
+
+        [[nodiscard]] std::span<double> get_y() noexcept
+        {
+            return y_;
+        }
+
+        [[nodiscard]] std::span<double> get_z() noexcept
+        {
+            return z_;
+        }
+
+        [[nodiscard]] std::span<double> get_velocity_x() noexcept
+        {
+            return velocity_x_;
+        }
+
+        [[nodiscard]] std::span<double> get_velocity_y() noexcept
+        {
+            return velocity_y_;
+        }
+
+        [[nodiscard]] std::span<double> get_velocity_z() noexcept
+        {
+            return velocity_z_;
+        }
+
+        [[nodiscard]] std::span<std::uint32_t> get_flags() noexcept
+        {
+            return flags_;
+        }
+
+        [[nodiscard]] std::span<float> get_yaw() noexcept
+        {
+            return yaw_;
+        }
+
+        [[nodiscard]] std::span<float> get_pitch() noexcept
+        {
+            return pitch_;
+        }
+
+        [[nodiscard]] std::span<const std::int32_t> get_types() const noexcept
+        {
+            return type_;
+        }
+
+        [[nodiscard]] std::span<const std::int32_t> get_network_ids() const noexcept
+        {
+            return network_id_;
+        }
+
+        [[nodiscard]] const std::array<std::uint8_t, 16>& get_uuid(std::uint32_t index) const noexcept
+        {
+            return uuid_[index];
+        }
+
+        template<typename TComponent>
+        component<TComponent>& register_component(const std::string& name)
+        {
+            if (auto existing{ find_component<TComponent>(name) })
+            {
+                return *existing;
+            }
+            auto created{ std::make_unique<component<TComponent>>(size()) };
+            auto& result{ *created };
+            components_.emplace(name, std::move(created));
+            return result;
+        }
+
+        template<typename TComponent>
+        [[nodiscard]] component<TComponent>* find_component(const std::string& name)
+        {
+            auto found{ components_.find(name) };
+            if (found == components_.end())
+            {
+                return nullptr;
+            }
+            if (found->second->get_type() != typeid(TComponent))
+            {
+                throw std::invalid_argument{ "Component " + name + " was registered with a different type" };
+            }
+            return static_cast<component<TComponent>*>(found->second.get());
+        }
+
+        [[nodiscard]] entity_statistics get_statistics() const noexcept;
+    };
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <plasma/entity/entity_store.h>
+#include <plasma/network/connection.h>
+#include <plasma/util/histogram.h>
+
+namespace plasma::entity
+{
+    // Entity type id of players in the 1.16.5 registry, which are spawned with their own packet.
+    inline constexpr std::int32_t player_type{ 106 };
+
+    class tracker_statistics
+    {
+    public:
+        std::size_t viewers;
+        std::size_t tracked_pairs;
+        std::uint64_t spawns;
+        std::uint64_t despawns;
+        std::uint64_t relative_moves;
+        std::uint64_t teleports;
+        std::uint64_t bytes_sent;
+        std::uint64_t tick_p50;
+        std::uint64_t tick_p99;
+    };
+
+    // Keeps, for every viewing connection, the set of entities within view distance of its own entity and sends
+    // only what changed since the previous tick: spawns, despawns and movement. Movement is encoded once per
+    // entity and tick, relative to the position last sent, and shared by every viewer; all of a viewer's packets go
+    // out in a single batch. Tick thread only.
+    class entity_tracker
+    {
+    private:
+        class tracked_entity
+        {
+        public:
+            entity_id id;
+            std::int32_t network_id;
+        };
+
+        class viewer
+        {
+        public:
+            std::shared_ptr<plasma::network::connection> connection;
+            entity_id self;
+            std::vector<tracked_entity> tracked;
+            std::vector<tracked_entity> visible;
+        };
+
+        // What clients were last told about the entity in a slot, in the protocol's 1/4096 block units.
+        class sent_state
+        {
+        public:
+            std::uint32_t generation;
+            bool valid;
+            bool on_ground;
+            std::uint8_t yaw;
+            std::uint8_t pitch;
+            std::int64_t x;
+            std::int64_t y;
+            std::int64_t z;
+            std::uint32_t watchers;
+            std::uint32_t frame_offset;
+            std::uint32_t frame_size;
+            bool teleported;
+        };
+
+        entity_store& store_;
+        double view_distance_;
+        std::unordered_map<std::uint64_t, viewer> viewers_;
+        std::vector<sent_state> sent_;
+        std::vector<std::byte> moves_;
+        std::vector<std::uint32_t> query_;
+        std::vector<std::int32_t> despawned_;
+        std::size_t tracked_pairs_;
+        std::uint64_t spawns_;
+        std::uint64_t despawns_;
+        std::uint64_t relative_moves_;
+        std::uint64_t teleports_;
+        std::uint64_t bytes_sent_;
+        util::histogram durations_;
+
+        void encode_movement();
+
+        std::vector<std::byte> write_spawn(std::vector<std::byte> batch, std::uint32_t index);
+
+        void update_viewer(viewer& viewer);
+    public:
+        entity_tracker(entity_store& store, double view_distance);
+
+        entity_tracker(const entity_tracker&) = delete;
+
+        entity_tracker& operator=(const entity_tracker&) = delete;
+
+        // The viewer sees everything around its own entity, which it is never sent itself.
+        void add_viewer(std::shared_ptr<plasma::network::connection> connection, entity_id self);
+
+        // Returns the entity the viewer was attached to.
+        std::optional<entity_id> remove_viewer(std::uint64_t connection_id);
+
+        [[nodiscard]] std::optional<entity_id> find_viewer(std::uint64_t connection_id) const;
+
+        void set_view_distance(double view_distance) noexcept
+        {
+            view_distance_ = view_distance;
+        }
+
+        void tick();
+
+        [[nodiscard]] tracker_statistics get_statistics() const;
+    };
+}
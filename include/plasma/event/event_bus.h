@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <plasma/event/events.h>
+#include <plasma/util/thread_queue_registry.hpp>
+
+namespace plasma::plugin
+{
+    class plugin;
+}
+
+namespace plasma::event
+{
+    // Handlers run from lowest to monitor. Monitor handlers should only observe the outcome.
+    enum class event_priority : std::uint8_t
+    {
+        lowest,
+        low,
+        normal,
+        high,
+        highest,
+        monitor
+    };
+
+    using subscription = std::uint64_t;
+
+    template<typename TEvent>
+    concept bus_event = requires
+    {
+        { TEvent::type } -> std::convertible_to<event_type>;
+    };
+
+    class event_statistics
+    {
+    public:
+        std::size_t handlers;
+        std::uint64_t posted;
+        std::uint64_t delivered;
+        std::uint64_t dropped;
+        std::size_t max_depth;
+        std::size_t queues;
+    };
+
+    // Handlers live in one contiguous array per event type, sorted by priority and then by subscription order.
+    // Subscriptions can change on any thread but only reach those arrays in apply_changes(), which the server calls
+    // on the tick thread before each tick, so publish() never locks or allocates. Other threads post() copies of
+    // their events into per-thread rings that dispatch_posted() drains on the tick thread.
+    class event_bus
+    {
+    public:
+        static constexpr std::size_t max_posted_size{ 64 };
+    private:
+        using invoker = void (*)(void* target, void* event);
+
+        class handler
+        {
+        public:
+            invoker invoke;
+            void* target;
+        };
+
+        class registration
+        {
+        public:
+            subscription id;
+            const plugin::plugin* owner;
+            event_priority priority;
+            invoker invoke;
+            std::shared_ptr<void> target;
+            bool applied;
+        };
+
+        // Tagged by type rather than carrying a function, which would live in the library of the plugin that
+        // posted it and could be unloaded before the event is dispatched.
+        class posted_event
+        {
+        public:
+            event_type type;
+            alignas(std::max_align_t) std::array<std::byte, max_posted_size> storage;
+        };
+
+        using queue_type = boost::lockfree::spsc_queue<posted_event>;
+
+        std::array<std::vector<handler>, event_type_count> handlers_;
+        std::mutex mutex_;
+        std::array<std::vector<registration>, event_type_count> registrations_;
+        // Targets of unsubscribed handlers that are still in the arrays, freed by the next apply_changes().
+        std::vector<std::shared_ptr<void>> retired_;
+        std::atomic<bool> changed_;
+        subscription next_id_;
+        util::thread_queue_registry<queue_type> queues_;
+        std::atomic<std::uint64_t> posted_;
+        std::atomic<std::uint64_t> dropped_;
+        std::uint64_t delivered_;
+        std::size_t max_depth_;
+
+        subscription add(event_type type, const plugin::plugin* owner, event_priority priority, invoker invoke,
+            std::shared_ptr<void> target);
+
+        void retire(registration& removed);
+
+        template<bus_event TEvent>
+        void publish_posted(const posted_event& posted)
+        {
+            TEvent event;
+            std::memcpy(&event, posted.storage.data(), sizeof(TEvent));
+            publish(event);
+        }
+    public:
+        explicit event_bus(std::size_t queue_capacity = 1024);
+
+        event_bus(const event_bus&) = delete;
+
+        event_bus& operator=(const event_bus&) = delete;
+
+        // The handler takes the event by reference and may change it, for example to cancel it. The subscription
+        // takes effect from the next tick. The owner is used to drop the handlers of an unloaded plugin.
+        template<bus_event TEvent, typename TFunction>
+        subscription subscribe(const plugin::plugin* owner, event_priority priority, TFunction function)
+        {
+            return add(TEvent::type, owner, priority, [](void* target, void* event)
+            {
+                (*static_cast<TFunction*>(target))(*static_cast<TEvent*>(event));
+            }, std::make_shared<TFunction>(std::move(function)));
+        }
+
+        bool unsubscribe(subscription id);
+
+        // Returns how many handlers the owner had.
+        std::size_t unsubscribe_owner(const plugin::plugin* owner);
+
+        // Tick thread only, while nothing is being published.
+        void apply_changes();
+
+        // Tick thread only.
+        template<bus_event TEvent>
+        void publish(TEvent& event)
+        {
+            const auto& handlers{ handlers_[static_cast<std::size_t>(TEvent::type)] };
+            if (handlers.empty()) [[likely]]
+            {
+                return;
+            }
+            for (const auto& current : handlers)
+            {
+                current.invoke(current.target, &event);
+            }
+        }
+
+        // Tick thread only. Lets callers skip building an event nobody listens to.
+        [[nodiscard]] bool has_handlers(event_type type) const noexcept
+        {
+            return !handlers_[static_cast<std::size_t>(type)].empty();
+        }
+
+        // Any thread. The event is published on the tick thread by the next dispatch_posted(). Returns false if the
+        // ring of the calling thread was full and the event was dropped.
+        template<bus_event TEvent>
+        bool post(const TEvent& event)
+        {
+            static_assert(std::is_trivially_copyable_v<TEvent>, "Posted events are copied bytewise");
+            static_assert(sizeof(TEvent) <= max_posted_size && alignof(TEvent) <= alignof(std::max_align_t),
+                "The event does not fit a posted event");
+            posted_event posted{};
+            posted.type = TEvent::type;
+            std::memcpy(posted.storage.data(), &event, sizeof(TEvent));
+            if (!queues_.local().push(posted)) [[unlikely]]
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            posted_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Tick thread only. Publishes everything posted so far and returns how many events that was.
+        std::size_t dispatch_posted();
+
+        [[nodiscard]] event_statistics get_statistics();
+    };
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <plasma/entity/entity_store.h>
+
+namespace plasma::world
+{
+    class chunk;
+}
+
+namespace plasma::event
+{
+    // Every event type names its slot here, so dispatch indexes an array instead of hashing a type. New types also
+    // need a case in event_bus::dispatch_posted().
+    enum class event_type : std::uint8_t
+    {
+        player_join,
+        player_leave,
+        player_move,
+        chunk_load
+    };
+
+    inline constexpr std::size_t event_type_count{ 4 };
+
+    class player_join_event
+    {
+    public:
+        static constexpr event_type type{ event_type::player_join };
+
+        std::uint64_t connection;
+        entity::entity_id entity;
+    };
+
+    class player_leave_event
+    {
+    public:
+        static constexpr event_type type{ event_type::player_leave };
+
+        std::uint64_t connection;
+        entity::entity_id entity;
+    };
+
+    // Positions and rotations the client sent, including the fields it left unchanged. Cancelled moves are not
+    // applied to the entity.
+    class player_move_event
+    {
+    public:
+        static constexpr event_type type{ event_type::player_move };
+
+        std::uint64_t connection;
+        entity::entity_id entity;
+        double x;
+        double y;
+        double z;
+        float yaw;
+        float pitch;
+        bool on_ground;
+        bool cancelled;
+    };
+
+    // The chunk is only guaranteed to stay alive while the event is dispatched.
+    class chunk_load_event
+    {
+    public:
+        static constexpr event_type type{ event_type::chunk_load };
+
+        std::int32_t x;
+        std::int32_t z;
+        const world::chunk* loaded;
+    };
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace plasma::job
+{
+    class job;
+
+    using job_handle = std::shared_ptr<job>;
+
+    class job
+    {
+    private:
+        friend class job_system;
+
+        std::function<void()> function_;
+        bool main_thread_;
+        std::atomic<std::uint32_t> unresolved_;
+        std::mutex mutex_;
+        std::atomic<bool> finished_;
+        std::vector<job_handle> dependents_;
+    public:
+        job(std::function<void()> function, bool main_thread);
+
+        job(const job&) = delete;
+
+        job& operator=(const job&) = delete;
+
+        [[nodiscard]] bool is_done() noexcept;
+    };
+
+    class worker_statistics
+    {
+    public:
+        std::uint64_t executed;
+        std::uint64_t stolen;
+        std::uint64_t steal_attempts;
+        std::uint64_t busy_nanoseconds;
+        std::uint64_t uptime_nanoseconds;
+    };
+
+    // Workers pop their own deque from the back and steal from the front of the others. Jobs run once all of their
+    // dependencies have finished; main thread jobs are then queued for run_main_jobs() instead.
+    class job_system
+    {
+    private:
+        class worker
+        {
+        public:
+            std::mutex mutex;
+            std::deque<job_handle> jobs;
+            std::thread thread;
+            std::atomic<std::uint64_t> executed;
+            std::atomic<std::uint64_t> stolen;
+            std::atomic<std::uint64_t> steal_attempts;
+            std::atomic<std::uint64_t> busy_nanoseconds;
+        };
+
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::mutex main_mutex_;
+        std::vector<job_handle> main_jobs_;
+        std::atomic<std::size_t> queued_;
+        std::atomic<std::size_t> next_worker_;
+        std::mutex sleep_mutex_;
+        std::condition_variable sleep_condition_;
+        std::atomic<std::size_t> sleeping_;
+        std::atomic<bool> running_;
+        // Jobs being pushed by schedule(), which stop() waits for before it drains the deques.
+        std::atomic<std::size_t> scheduling_;
+        std::chrono::steady_clock::time_point started_;
+
+        job_handle create(std::function<void()> function, bool main_thread, std::span<const job_handle> dependencies);
+
+        void schedule(job_handle job);
+
+        void execute(job& job);
+
+        bool run_one();
+
+        void run(std::size_t index, bool affinity);
+    public:
+        // Zero workers means one per hardware thread, leaving one for the tick thread.
+        job_system(std::size_t workers, bool affinity);
+
+        job_system(const job_system&) = delete;
+
+        job_system& operator=(const job_system&) = delete;
+
+        ~job_system();
+
+        // Once stopped, jobs run on the thread that submits them or finishes their last dependency.
+        job_handle submit(std::function<void()> function, std::span<const job_handle> dependencies = {});
+
+        // Runs on the tick thread, during run_main_jobs(), once the dependencies have finished.
+        job_handle submit_main(std::function<void()> function, std::span<const job_handle> dependencies = {});
+
+        // Runs other jobs while waiting. Never wait for a main thread job from the tick thread.
+        void wait(const job_handle& job);
+
+        // Runs one queued job on the calling thread, if there is any, so that a thread polling for results can help.
+        bool help();
+
+        // Calls function for every index in [begin, end), in chunks of grain indices, and returns once all are done.
+        // If any call throws, the first exception is rethrown after every chunk has finished, since queued chunks
+        // still refer to function.
+        template<typename TFunction>
+        void parallel_for(std::size_t begin, std::size_t end, std::size_t grain, TFunction&& function)
+        {
+            grain = std::max<std::size_t>(grain, 1);
+            std::mutex failure_mutex{};
+            std::exception_ptr failure{};
+            auto run_chunk{ [&function, &failure_mutex, &failure](std::size_t start, std::size_t stop) noexcept
+            {
+                try
+                {
+                    for (auto i{ start }; i < stop; ++i)
+                    {
+                        function(i);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard lock{ failure_mutex };
+                    if (!failure)
+                    {
+                        failure = std::current_exception();
+                    }
+                }
+            } };
+            std::vector<job_handle> chunks{};
+            for (auto start{ begin + grain }; start < end; start += grain)
+            {
+                chunks.push_back(submit([&run_chunk, start, stop = std::min(start + grain, end)]
+                {
+                    run_chunk(start, stop);
+                }));
+            }
+            run_chunk(begin, std::min(begin + grain, end));
+            for (auto& chunk : chunks)
+            {
+                wait(chunk);
+            }
+            if (failure)
+            {
+                std::rethrow_exception(failure);
+            }
+        }
+
+        // Tick thread only.
+        std::size_t run_main_jobs();
+
+        // Joins the workers after they have run every queued job.
+        void stop();
+
+        [[nodiscard]] std::size_t get_worker_count() const noexcept
+        {
+            return workers_.size();
+        }
+
+        [[nodiscard]] std::vector<worker_statistics> get_statistics() const;
+    };
+}
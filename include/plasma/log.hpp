@@ -22,41 +22,86 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <source_location>
 #include <boost/smart_ptr.hpp>
 #include <boost/core/null_deleter.hpp>
 #include <boost/log/attributes.hpp>
+#include <boost/log/attributes/attribute_value_impl.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/log/sources/record_ostream.hpp>
 #include <boost/log/sources/severity_logger.hpp>
 
 namespace plasma::log
 {
     using logger = boost::log::sources::severity_logger<boost::log::trivial::severity_level>;
 
+    using severity_level = boost::log::trivial::severity_level;
+
     inline const boost::shared_ptr<std::ostream> clog_stream_ptr{ &std::clog, boost::null_deleter{} };
 
-    template<typename TValue>
-    TValue set_get_attr(const char* name, TValue value)
+    // Mirrors the core filter so that disabled records are rejected before the logger is touched.
+#if !defined(NDEBUG) || defined(_DEBUG)
+    inline std::atomic<severity_level> minimum_severity{ severity_level::trace };
+#else
+    inline std::atomic<severity_level> minimum_severity{ severity_level::info };
+#endif
+
+    inline bool is_enabled(severity_level severity) noexcept
+    {
+        return severity >= minimum_severity.load(std::memory_order_relaxed);
+    }
+
+    class source_location
+    {
+    public:
+        const char* file;
+        std::uint_least32_t line;
+    };
+
+    template<typename TChar, typename TTraits>
+    std::basic_ostream<TChar, TTraits>& operator<<(std::basic_ostream<TChar, TTraits>& stream, const source_location& location)
     {
-        auto attr{ boost::log::attribute_cast<boost::log::attributes::mutable_constant<TValue>>(boost::log::core::get()->get_thread_attributes()[name]) };
-        attr.set(value);
-        return attr.get();
+        return stream << location.file << ':' << location.line;
+    }
+
+    inline const boost::log::attribute_name location_attribute_name{ "Location" };
+
+    inline boost::log::record open_record(logger& lg, severity_level severity)
+    {
+        return lg.open_record(boost::log::keywords::severity = severity);
+    }
+
+    inline boost::log::record open_record(logger& lg, severity_level severity, const std::source_location& location)
+    {
+        auto rec{ lg.open_record(boost::log::keywords::severity = severity) };
+        if (rec)
+        {
+            rec.attribute_values().insert(location_attribute_name, boost::log::attributes::make_attribute_value(
+                source_location{ .file = location.file_name(), .line = location.line() }));
+        }
+        return rec;
     }
 }
+
 #if !defined(NDEBUG) || defined(_DEBUG)
-#define TRC(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::trace))
-#define DBG(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::debug))
-#define INF(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::info))
-#define WRN(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::warning))
-#define ERR(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::error))
-#define FTL(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::plasma::log::set_get_attr("File", __FILE__))(::plasma::log::set_get_attr("Line", __LINE__))(::boost::log::keywords::severity = ::boost::log::trivial::severity_level::fatal))
+#define PLASMA_LOG_OPEN_RECORD(lg, sev) ::plasma::log::open_record((lg), (sev), ::std::source_location::current())
 #else
-#define TRC(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::trace))
-#define DBG(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::debug))
-#define INF(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::info))
-#define WRN(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::warning))
-#define ERR(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::error))
-#define FTL(lg) BOOST_LOG_STREAM_WITH_PARAMS((lg), (::boost::log::keywords::severity = ::boost::log::trivial::severity_level::fatal))
+#define PLASMA_LOG_OPEN_RECORD(lg, sev) ::plasma::log::open_record((lg), (sev))
 #endif
 
+#define PLASMA_LOG(lg, sev) \
+    if (!::plasma::log::is_enabled(sev)) {} else \
+        for (::boost::log::record plasma_log_record_{ PLASMA_LOG_OPEN_RECORD(lg, sev) }; !!plasma_log_record_;) \
+            ::boost::log::aux::make_record_pump((lg), plasma_log_record_).stream()
+
+#define TRC(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::trace)
+#define DBG(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::debug)
+#define INF(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::info)
+#define WRN(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::warning)
+#define ERR(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::error)
+#define FTL(lg) PLASMA_LOG(lg, ::plasma::log::severity_level::fatal)
+
 using namespace plasma::log;
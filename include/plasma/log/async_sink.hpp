@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <boost/smart_ptr.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/log/core/record_view.hpp>
+#include <boost/log/sinks/basic_sink_frontend.hpp>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/log/overflow_policy.h>
+#include <plasma/util/thread_queue_registry.hpp>
+
+namespace plasma::log
+{
+    class async_statistics
+    {
+    public:
+        std::uint64_t dropped;
+        std::size_t max_depth;
+        std::size_t capacity;
+        std::size_t queues;
+    };
+
+    // Sink frontend that hands records to a dedicated writer thread through per-thread lock-free rings.
+    // The writer formats and batches records into the backend and flushes once per batch.
+    template<typename TBackend>
+    class async_sink : public boost::log::sinks::basic_formatting_sink_frontend<char>
+    {
+    private:
+        using base_type = boost::log::sinks::basic_formatting_sink_frontend<char>;
+        using queue_type = boost::lockfree::spsc_queue<boost::log::record_view>;
+
+        boost::shared_ptr<TBackend> backend_;
+        std::mutex backend_mutex_;
+        util::thread_queue_registry<queue_type> queues_;
+        overflow_policy policy_;
+        std::chrono::milliseconds flush_interval_;
+        std::atomic<std::uint64_t> dropped_;
+        std::atomic<std::size_t> max_depth_;
+        std::atomic<bool> running_;
+        std::mutex flush_mutex_;
+        std::condition_variable flush_condition_;
+        std::uint64_t flush_requested_;
+        std::uint64_t flush_completed_;
+        std::thread writer_;
+        std::atomic<std::thread::id> writer_id_;
+
+        bool bypass_queue() const noexcept
+        {
+            return std::this_thread::get_id() == writer_id_.load(std::memory_order_relaxed)
+                || !running_.load(std::memory_order_acquire);
+        }
+
+        void feed(const boost::log::record_view& rec)
+        {
+            base_type::feed_record(rec, backend_mutex_, *backend_);
+        }
+
+        std::size_t drain()
+        {
+            std::size_t consumed{};
+            queues_.for_each([this, &consumed](queue_type& queue)
+            {
+                auto depth{ queue.read_available() };
+                if (depth > max_depth_.load(std::memory_order_relaxed))
+                {
+                    max_depth_.store(depth, std::memory_order_relaxed);
+                }
+                consumed += queue.consume_all([this](const boost::log::record_view& rec)
+                {
+                    feed(rec);
+                });
+            });
+            if (consumed)
+            {
+                base_type::flush_backend(backend_mutex_, *backend_);
+            }
+            return consumed;
+        }
+
+        void complete_flush_requests()
+        {
+            std::unique_lock lock{ flush_mutex_ };
+            if (flush_completed_ == flush_requested_)
+            {
+                return;
+            }
+            auto requested{ flush_requested_ };
+            lock.unlock();
+            drain();
+            base_type::flush_backend(backend_mutex_, *backend_);
+            lock.lock();
+            flush_completed_ = requested;
+            flush_condition_.notify_all();
+        }
+
+        void run()
+        {
+            writer_id_.store(std::this_thread::get_id(), std::memory_order_release);
+            auto last_report{ std::chrono::steady_clock::now() };
+            std::uint64_t reported{};
+            while (running_.load(std::memory_order_acquire))
+            {
+                auto consumed{ drain() };
+                complete_flush_requests();
+                if (policy_ == overflow_policy::count)
+                {
+                    auto now{ std::chrono::steady_clock::now() };
+                    auto dropped{ dropped_.load(std::memory_order_relaxed) };
+                    if (dropped != reported && now - last_report >= std::chrono::seconds{ 1 })
+                    {
+                        logger lg{};
+                        WRNF(lg, "Asynchronous logging dropped {} records, {} in total", dropped - reported, dropped);
+                        reported = dropped;
+                        last_report = now;
+                    }
+                }
+                if (!consumed)
+                {
+                    std::this_thread::sleep_for(flush_interval_);
+                }
+            }
+            drain();
+            complete_flush_requests();
+        }
+    public:
+        async_sink(boost::shared_ptr<TBackend> backend, std::size_t capacity, overflow_policy policy,
+            std::chrono::milliseconds flush_interval) :
+            base_type{ true }, backend_{ std::move(backend) }, queues_{ capacity }, policy_{ policy },
+            flush_interval_{ flush_interval }, dropped_{}, max_depth_{}, running_{ true }, flush_requested_{},
+            flush_completed_{}
+        {
+            writer_ = std::thread{ &async_sink::run, this };
+            writer_id_.store(writer_.get_id(), std::memory_order_release);
+        }
+
+        async_sink(const async_sink&) = delete;
+
+        async_sink& operator=(const async_sink&) = delete;
+
+        void consume(const boost::log::record_view& rec) override
+        {
+            if (bypass_queue()) [[unlikely]]
+            {
+                feed(rec);
+                return;
+            }
+            auto& queue{ queues_.local() };
+            if (queue.push(rec)) [[likely]]
+            {
+                return;
+            }
+            if (policy_ == overflow_policy::block)
+            {
+                while (!queue.push(rec))
+                {
+                    if (!running_.load(std::memory_order_acquire))
+                    {
+                        feed(rec);
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+                return;
+            }
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool try_consume(const boost::log::record_view& rec) override
+        {
+            if (bypass_queue()) [[unlikely]]
+            {
+                feed(rec);
+                return true;
+            }
+            return queues_.local().push(rec);
+        }
+
+        // Blocks until everything queued before the call has reached the backend.
+        void flush() override
+        {
+            std::unique_lock lock{ flush_mutex_ };
+            if (bypass_queue())
+            {
+                lock.unlock();
+                base_type::flush_backend(backend_mutex_, *backend_);
+                return;
+            }
+            auto ticket{ ++flush_requested_ };
+            flush_condition_.wait(lock, [this, ticket]
+            {
+                return flush_completed_ >= ticket;
+            });
+        }
+
+        void stop()
+        {
+            if (!running_.exchange(false, std::memory_order_acq_rel))
+            {
+                return;
+            }
+            writer_.join();
+            std::lock_guard lock{ flush_mutex_ };
+            flush_completed_ = flush_requested_;
+            flush_condition_.notify_all();
+        }
+
+        [[nodiscard]] async_statistics get_statistics()
+        {
+            return {
+                .dropped = dropped_.load(std::memory_order_relaxed),
+                .max_depth = max_depth_.load(std::memory_order_relaxed),
+                .capacity = queues_.capacity(),
+                .queues = queues_.size()
+            };
+        }
+
+        ~async_sink() override
+        {
+            stop();
+        }
+    };
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+
+namespace plasma::log::binary
+{
+    // A binary log file is the magic, the format version and a sequence of records, each of them prefixed by its
+    // payload size. All integers are little-endian. Payloads start with a record_kind:
+    //   site:  u32 id, u8 severity, u32 line, str file, str format
+    //   event: u32 site id, u64 timestamp (ns since epoch), then one tagged argument after another
+    //   text:  u64 timestamp, u8 severity, u32 line, str file, str message
+    // where str is a u32 length followed by the bytes.
+    inline constexpr std::array<char, 4> file_magic{ 'P', 'L', 'O', 'G' };
+
+    inline constexpr std::uint16_t format_version{ 1 };
+
+    enum class record_kind : std::uint8_t
+    {
+        site = 1,
+        event = 2,
+        text = 3
+    };
+
+    enum class argument_type : std::uint8_t
+    {
+        boolean = 1,
+        character = 2,
+        signed_integer = 3,
+        unsigned_integer = 4,
+        floating_point = 5,
+        string = 6
+    };
+
+    // Expands binary log files into the text layout of the regular file sink.
+    class decoder
+    {
+    private:
+        class site_info
+        {
+        public:
+            std::uint8_t severity;
+            std::uint32_t line;
+            std::string file;
+            std::string format;
+        };
+
+        std::istream& stream_;
+        bool with_location_;
+        std::unordered_map<std::uint32_t, site_info> sites_;
+        std::string payload_;
+    public:
+        decoder(std::istream& stream, bool with_location);
+
+        bool next(std::string& line);
+    };
+}
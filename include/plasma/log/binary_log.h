@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <source_location>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/log/sinks/basic_sink_frontend.hpp>
+#include <boost/log/sources/record_ostream.hpp>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_format.h>
+#include <plasma/log/overflow_policy.h>
+#include <plasma/util/thread_queue_registry.hpp>
+
+namespace plasma::log::binary
+{
+    class site
+    {
+    public:
+        std::uint32_t id;
+        severity_level severity;
+        const char* file;
+        std::uint32_t line;
+        const char* format;
+    };
+
+    // Registered once per log statement, the returned site lives until the process exits.
+    const site& register_site(severity_level severity, const char* format, const std::source_location& location);
+
+    // Marks records that already went to the binary file so that the capture sink skips them.
+    inline const boost::log::attribute_name binary_attribute_name{ "Binary" };
+
+    class writer
+    {
+    private:
+        using queue_type = boost::lockfree::spsc_queue<char>;
+
+        std::filesystem::path directory_;
+        std::uintmax_t rotation_size_;
+        overflow_policy policy_;
+        std::chrono::milliseconds flush_interval_;
+        severity_level console_severity_;
+        util::thread_queue_registry<queue_type> queues_;
+        std::atomic<std::uint64_t> dropped_;
+        std::atomic<std::uint64_t> written_;
+        std::atomic<bool> running_;
+        std::mutex flush_mutex_;
+        std::condition_variable flush_condition_;
+        std::uint64_t flush_requested_;
+        std::uint64_t flush_completed_;
+        std::FILE* file_;
+        std::uintmax_t file_size_;
+        std::vector<bool> emitted_sites_;
+        std::vector<char> batch_;
+        std::string output_;
+        std::thread thread_;
+
+        static std::atomic<writer*> active_;
+
+        void open_next_file();
+
+        void emit_site(std::uint32_t id);
+
+        void process(std::string_view record);
+
+        std::size_t drain();
+
+        void complete_flush_requests();
+
+        void run();
+    public:
+        writer(std::filesystem::path directory, std::uintmax_t rotation_size, std::size_t queue_bytes,
+            overflow_policy policy, std::chrono::milliseconds flush_interval, severity_level console_severity);
+
+        writer(const writer&) = delete;
+
+        writer& operator=(const writer&) = delete;
+
+        ~writer();
+
+        static writer* active() noexcept
+        {
+            return active_.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] bool mirrors(severity_level severity) const noexcept
+        {
+            return severity >= console_severity_;
+        }
+
+        void push(std::string_view record);
+
+        void flush();
+
+        void stop();
+
+        [[nodiscard]] std::uint64_t dropped() const noexcept
+        {
+            return dropped_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] std::uint64_t written() const noexcept
+        {
+            return written_.load(std::memory_order_relaxed);
+        }
+    };
+
+    // Captures records of the stream-style macros into the binary file as preformatted text.
+    class record_sink : public boost::log::sinks::basic_sink_frontend
+    {
+    private:
+        writer& writer_;
+    public:
+        explicit record_sink(writer& writer);
+
+        void consume(const boost::log::record_view& rec) override;
+
+        void flush() override;
+    };
+
+    inline std::uint64_t now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    template<typename TValue>
+    void append(std::string& buffer, const TValue& value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    inline void append_string(std::string& buffer, std::string_view value)
+    {
+        append(buffer, static_cast<std::uint32_t>(value.size()));
+        buffer.append(value);
+    }
+
+    template<typename TValue>
+    void append_argument(std::string& buffer, const TValue& value)
+    {
+        using value_type = std::remove_cvref_t<TValue>;
+        if constexpr (std::same_as<value_type, bool>)
+        {
+            append(buffer, argument_type::boolean);
+            append(buffer, static_cast<std::uint8_t>(value));
+        }
+        else if constexpr (std::same_as<value_type, char>)
+        {
+            append(buffer, argument_type::character);
+            append(buffer, value);
+        }
+        else if constexpr (std::is_enum_v<value_type>)
+        {
+            append_argument(buffer, static_cast<std::underlying_type_t<value_type>>(value));
+        }
+        else if constexpr (std::signed_integral<value_type>)
+        {
+            append(buffer, argument_type::signed_integer);
+            append(buffer, static_cast<std::int64_t>(value));
+        }
+        else if constexpr (std::unsigned_integral<value_type>)
+        {
+            append(buffer, argument_type::unsigned_integer);
+            append(buffer, static_cast<std::uint64_t>(value));
+        }
+        else if constexpr (std::floating_point<value_type>)
+        {
+            append(buffer, argument_type::floating_point);
+            append(buffer, static_cast<double>(value));
+        }
+        else if constexpr (std::convertible_to<const value_type&, std::string_view>)
+        {
+            append(buffer, argument_type::string);
+            append_string(buffer, std::string_view{ value });
+        }
+        else if constexpr (std::same_as<value_type, std::filesystem::path>)
+        {
+            append(buffer, argument_type::string);
+            append_string(buffer, value.string());
+        }
+        else if constexpr (fmt::is_formattable<value_type>::value)
+        {
+            append(buffer, argument_type::string);
+            append_string(buffer, fmt::to_string(value));
+        }
+        else
+        {
+            std::ostringstream stream{};
+            stream << value;
+            append(buffer, argument_type::string);
+            append_string(buffer, stream.view());
+        }
+    }
+
+    template<typename... TArgs>
+    void write_event(writer& target, const site& site, const TArgs&... args)
+    {
+        thread_local std::string buffer{};
+        buffer.clear();
+        append(buffer, std::uint32_t{});
+        append(buffer, record_kind::event);
+        append(buffer, site.id);
+        append(buffer, now());
+        (append_argument(buffer, args), ...);
+        auto size{ static_cast<std::uint32_t>(buffer.size() - sizeof(std::uint32_t)) };
+        std::memcpy(buffer.data(), &size, sizeof(size));
+        target.push(buffer);
+    }
+
+    inline void push_text(logger& lg, const site& site, std::string message, bool binary)
+    {
+        auto rec{ lg.open_record(boost::log::keywords::severity = site.severity) };
+        if (!rec)
+        {
+            return;
+        }
+#if !defined(NDEBUG) || defined(_DEBUG)
+        rec.attribute_values().insert(location_attribute_name, boost::log::attributes::make_attribute_value(
+            source_location{ .file = site.file, .line = site.line }));
+#endif
+        if (binary)
+        {
+            rec.attribute_values().insert(binary_attribute_name, boost::log::attributes::make_attribute_value(true));
+        }
+        boost::log::record_ostream stream{ rec };
+        stream << message;
+        stream.flush();
+        lg.push_record(std::move(rec));
+    }
+
+    // Format-string logging: in binary mode only the raw arguments are recorded and formatting is deferred to
+    // plasma-logcat, otherwise the message is formatted here and goes through the regular sinks.
+    template<typename... TArgs>
+    void write(logger& lg, const site& site, fmt::format_string<TArgs...> format, TArgs&&... args)
+    {
+        auto target{ writer::active() };
+        if (target)
+        {
+            write_event(*target, site, args...);
+            if (!target->mirrors(site.severity))
+            {
+                return;
+            }
+        }
+        push_text(lg, site, fmt::format(format, std::forward<TArgs>(args)...), target != nullptr);
+    }
+}
+
+#define PLASMA_LOGF(lg, sev, format, ...) \
+    do \
+    { \
+        if (::plasma::log::is_enabled(sev)) \
+        { \
+            static const auto& plasma_log_site_{ \
+                ::plasma::log::binary::register_site((sev), (format), ::std::source_location::current()) }; \
+            ::plasma::log::binary::write((lg), plasma_log_site_, (format) __VA_OPT__(,) __VA_ARGS__); \
+        } \
+    } \
+    while (false)
+
+#define TRCF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::trace, format __VA_OPT__(,) __VA_ARGS__)
+#define DBGF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::debug, format __VA_OPT__(,) __VA_ARGS__)
+#define INFF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::info, format __VA_OPT__(,) __VA_ARGS__)
+#define WRNF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::warning, format __VA_OPT__(,) __VA_ARGS__)
+#define ERRF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::error, format __VA_OPT__(,) __VA_ARGS__)
+#define FTLF(lg, format, ...) PLASMA_LOGF(lg, ::plasma::log::severity_level::fatal, format __VA_OPT__(,) __VA_ARGS__)
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <plasma/metrics/metrics_segment.h>
+
+namespace plasma::metrics
+{
+    // Spreads threads over the shards in the order they first update a metric.
+    inline std::size_t get_shard() noexcept
+    {
+        static std::atomic<std::size_t> next{};
+        thread_local const auto shard{ next.fetch_add(1, std::memory_order_relaxed) % shard_count };
+        return shard;
+    }
+
+    // Scratch space for handles that were never registered. Nothing reads it.
+    metrics_segment& get_detached_segment() noexcept;
+
+    class counter
+    {
+    private:
+        metrics_segment* segment_;
+        std::uint32_t slot_;
+    public:
+        counter() noexcept :
+            segment_{ &get_detached_segment() }, slot_{}
+        {
+        }
+
+        counter(metrics_segment& segment, std::uint32_t slot) noexcept :
+            segment_{ &segment }, slot_{ slot }
+        {
+        }
+
+        void add(std::uint64_t amount = 1) noexcept
+        {
+            segment_->shards[get_shard()].values[slot_].fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        // For totals kept elsewhere and copied over periodically. Do not mix with add().
+        void set(std::uint64_t total) noexcept
+        {
+            segment_->shards[0].values[slot_].store(total, std::memory_order_relaxed);
+        }
+    };
+
+    class gauge
+    {
+    private:
+        metrics_segment* segment_;
+        std::uint32_t slot_;
+    public:
+        gauge() noexcept :
+            segment_{ &get_detached_segment() }, slot_{}
+        {
+        }
+
+        gauge(metrics_segment& segment, std::uint32_t slot) noexcept :
+            segment_{ &segment }, slot_{ slot }
+        {
+        }
+
+        void set(double value) noexcept
+        {
+            segment_->shards[0].values[slot_].store(encode_gauge(value), std::memory_order_relaxed);
+        }
+    };
+
+    class histogram_metric
+    {
+    private:
+        metrics_segment* segment_;
+        std::uint32_t slot_;
+    public:
+        histogram_metric() noexcept :
+            segment_{ &get_detached_segment() }, slot_{}
+        {
+        }
+
+        histogram_metric(metrics_segment& segment, std::uint32_t slot) noexcept :
+            segment_{ &segment }, slot_{ slot }
+        {
+        }
+
+        void record(std::uint64_t value) noexcept
+        {
+            auto& histogram{ segment_->shards[get_shard()].histograms[slot_] };
+            histogram[get_histogram_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+            histogram[histogram_buckets + 1].fetch_add(value, std::memory_order_relaxed);
+        }
+    };
+
+    // Counters, gauges and histograms in a named shared memory segment that plasma-stat reads while the server runs.
+    // Updates are relaxed atomic operations on memory mapped once at startup: no locks and no system calls. Only
+    // registering a metric takes a lock.
+    class metrics_registry
+    {
+    private:
+        std::string name_;
+        boost::interprocess::mapped_region region_;
+        std::unique_ptr<metrics_segment> local_;
+        metrics_segment* segment_;
+        std::mutex mutex_;
+        std::uint32_t values_;
+        std::uint32_t histograms_;
+
+        std::uint32_t add(std::string_view name, std::string_view help, metric_kind kind, double unit);
+    public:
+        // An empty name, a segment that cannot be created, or one still in use by another running server keeps the
+        // metrics in process memory instead.
+        explicit metrics_registry(std::string name);
+
+        metrics_registry(const metrics_registry&) = delete;
+
+        metrics_registry& operator=(const metrics_registry&) = delete;
+
+        // Removes the segment if this registry created it.
+        ~metrics_registry();
+
+        // Names follow the Prometheus conventions. Throws std::length_error once the segment is full.
+        counter add_counter(std::string_view name, std::string_view help);
+
+        gauge add_gauge(std::string_view name, std::string_view help);
+
+        // Recorded values are multiplied by the unit when exported.
+        histogram_metric add_histogram(std::string_view name, std::string_view help, double unit);
+
+        // Tells readers the server is still alive.
+        void beat() noexcept;
+
+        [[nodiscard]] bool is_shared() const noexcept
+        {
+            return !local_;
+        }
+
+        [[nodiscard]] const std::string& get_name() const noexcept
+        {
+            return name_;
+        }
+    };
+}
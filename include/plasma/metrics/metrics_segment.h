@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace plasma::metrics
+{
+    inline constexpr std::uint32_t segment_magic{ 0x534d4c50 };
+    inline constexpr std::uint32_t segment_version{ 1 };
+    inline constexpr std::size_t max_values{ 64 };
+    inline constexpr std::size_t max_histograms{ 8 };
+    inline constexpr std::size_t max_metrics{ max_values + max_histograms };
+    inline constexpr std::size_t shard_count{ 16 };
+    // Bucket i counts values up to 2^i, one more counts everything larger.
+    inline constexpr std::size_t histogram_buckets{ 24 };
+    // A segment whose heartbeat is older than this belongs to a server that is gone or hung.
+    inline constexpr std::int64_t stale_heartbeat_ms{ 5000 };
+
+    enum class metric_kind : std::uint8_t
+    {
+        counter,
+        gauge,
+        histogram
+    };
+
+    class metric_descriptor
+    {
+    public:
+        std::array<char, 64> name;
+        std::array<char, 128> help;
+        metric_kind kind;
+        std::uint32_t slot;
+        // Converts recorded histogram values to the unit in the metric name, seconds for example.
+        double unit;
+    };
+
+    // Threads update the shard they were assigned, so two threads bumping one counter do not fight over its cache
+    // line. Counters and histograms are the sum over every shard; gauges only live in the first.
+    class alignas(64) metrics_shard
+    {
+    public:
+        std::array<std::atomic<std::uint64_t>, max_values> values;
+        // The buckets, the overflow bucket, then the sum of the recorded values.
+        std::array<std::array<std::atomic<std::uint64_t>, histogram_buckets + 2>, max_histograms> histograms;
+    };
+
+    // The whole shared memory segment. Descriptors are written before metric_count is raised past them.
+    class metrics_segment
+    {
+    public:
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t process_id;
+        std::atomic<std::uint32_t> metric_count;
+        // Unix milliseconds of the last update from the server, so readers can tell it has gone away.
+        std::atomic<std::int64_t> heartbeat;
+        std::array<metric_descriptor, max_metrics> metrics;
+        std::array<metrics_shard, shard_count> shards;
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::int64_t>::is_always_lock_free,
+        "Metrics are shared with other processes through lock-free atomics");
+
+    inline std::uint64_t encode_gauge(double value) noexcept
+    {
+        return std::bit_cast<std::uint64_t>(value);
+    }
+
+    inline double decode_gauge(std::uint64_t value) noexcept
+    {
+        return std::bit_cast<double>(value);
+    }
+
+    inline std::size_t get_histogram_bucket(std::uint64_t value) noexcept
+    {
+        auto bucket{ value <= 1 ? 0 : static_cast<std::size_t>(std::bit_width(value - 1)) };
+        return bucket < histogram_buckets ? bucket : histogram_buckets;
+    }
+}
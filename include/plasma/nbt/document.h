@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+
+#include <plasma/nbt/tag.h>
+
+namespace plasma::nbt
+{
+    // A tag in a document. Children of compounds and lists are linked through first, last and next.
+    class node
+    {
+    public:
+        tag_type type;
+        tag_type element;
+        std::string_view name;
+        node* first;
+        node* last;
+        node* next;
+        std::size_t size;
+        const void* data;
+        std::int64_t integer;
+        double floating;
+
+        [[nodiscard]] const node* find(std::string_view child) const noexcept;
+
+        [[nodiscard]] std::string_view as_string() const noexcept
+        {
+            return { static_cast<const char*>(data), size };
+        }
+
+        [[nodiscard]] std::span<const std::int8_t> as_byte_array() const noexcept
+        {
+            return { static_cast<const std::int8_t*>(data), size };
+        }
+
+        [[nodiscard]] std::span<const std::int32_t> as_int_array() const noexcept
+        {
+            return { static_cast<const std::int32_t*>(data), size };
+        }
+
+        [[nodiscard]] std::span<const std::int64_t> as_long_array() const noexcept
+        {
+            return { static_cast<const std::int64_t*>(data), size };
+        }
+    };
+
+    // Owns a tree of nodes. Nodes, names, strings and arrays all live in one arena that is freed at once, arrays are
+    // stored in native byte order.
+    class document
+    {
+    private:
+        std::pmr::monotonic_buffer_resource arena_;
+        node* root_;
+
+        std::string_view copy_string(std::string_view value);
+
+        const void* copy_array(const void* data, std::size_t count, std::size_t width, bool swap);
+    public:
+        explicit document(std::size_t initial_size = 4096);
+
+        document(const document&) = delete;
+
+        document& operator=(const document&) = delete;
+
+        // Replaces the contents with the named root tag at the start of data and returns the bytes it took.
+        std::size_t parse(std::span<const std::byte> data);
+
+        void clear() noexcept;
+
+        [[nodiscard]] node* get_root() noexcept
+        {
+            return root_;
+        }
+
+        [[nodiscard]] const node* get_root() const noexcept
+        {
+            return root_;
+        }
+
+        node& create_root(tag_type type, std::string_view name = {});
+
+        // Appends a child; inside a list the name is dropped and the type must match the list's element type.
+        node& add(node& parent, tag_type type, std::string_view name = {});
+
+        node& add_integer(node& parent, tag_type type, std::string_view name, std::int64_t value);
+
+        node& add_floating(node& parent, tag_type type, std::string_view name, double value);
+
+        node& add_string(node& parent, std::string_view name, std::string_view value);
+
+        node& add_byte_array(node& parent, std::string_view name, std::span<const std::int8_t> values);
+
+        node& add_int_array(node& parent, std::string_view name, std::span<const std::int32_t> values);
+
+        node& add_long_array(node& parent, std::string_view name, std::span<const std::int64_t> values);
+
+        // Sets the element type of an empty list.
+        void set_element(node& list, tag_type element);
+
+        friend class document_builder;
+    };
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <plasma/nbt/tag.h>
+
+namespace plasma::nbt
+{
+    // Bounds-checked big-endian input over a byte range.
+    class cursor
+    {
+    private:
+        const std::byte* data_;
+        std::size_t size_;
+        std::size_t position_;
+    public:
+        explicit cursor(std::span<const std::byte> data) noexcept :
+            data_{ data.data() }, size_{ data.size() }, position_{}
+        {
+        }
+
+        [[nodiscard]] std::size_t position() const noexcept
+        {
+            return position_;
+        }
+
+        [[nodiscard]] std::size_t remaining() const noexcept
+        {
+            return size_ - position_;
+        }
+
+        const std::byte* read_bytes(std::size_t size)
+        {
+            if (size > size_ - position_)
+            {
+                throw parse_error{ fmt::format("NBT ends {} bytes early at offset {}", size - (size_ - position_),
+                    position_) };
+            }
+            auto bytes{ data_ + position_ };
+            position_ += size;
+            return bytes;
+        }
+
+        template<typename T>
+        T read()
+        {
+            return load_big_endian<T>(read_bytes(sizeof(T)));
+        }
+
+        // Strings are modified UTF-8 and are returned as such.
+        std::string_view read_string()
+        {
+            auto size{ read<std::uint16_t>() };
+            return { reinterpret_cast<const char*>(read_bytes(size)), size };
+        }
+
+        std::size_t read_size()
+        {
+            auto size{ read<std::int32_t>() };
+            if (size < 0)
+            {
+                throw parse_error{ fmt::format("Negative NBT length {} at offset {}", size, position_ - 4) };
+            }
+            return static_cast<std::size_t>(size);
+        }
+
+        template<typename T>
+        big_endian_array<T> read_array()
+        {
+            auto size{ read_size() };
+            if (size > remaining() / sizeof(T))
+            {
+                throw parse_error{ fmt::format("NBT array of {} elements overruns the input", size) };
+            }
+            return { read_bytes(size * sizeof(T)), size };
+        }
+    };
+
+    // Every callback a SAX handler needs, doing nothing; derive from it and hide the ones of interest. Names of list
+    // elements are empty.
+    class null_handler
+    {
+    public:
+        void begin_compound(std::string_view) noexcept
+        {
+        }
+
+        void end_compound() noexcept
+        {
+        }
+
+        void begin_list(std::string_view, tag_type, std::size_t) noexcept
+        {
+        }
+
+        void end_list() noexcept
+        {
+        }
+
+        void byte_value(std::string_view, std::int8_t) noexcept
+        {
+        }
+
+        void short_value(std::string_view, std::int16_t) noexcept
+        {
+        }
+
+        void int_value(std::string_view, std::int32_t) noexcept
+        {
+        }
+
+        void long_value(std::string_view, std::int64_t) noexcept
+        {
+        }
+
+        void float_value(std::string_view, float) noexcept
+        {
+        }
+
+        void double_value(std::string_view, double) noexcept
+        {
+        }
+
+        void string_value(std::string_view, std::string_view) noexcept
+        {
+        }
+
+        void byte_array(std::string_view, big_endian_array<std::int8_t>) noexcept
+        {
+        }
+
+        void int_array(std::string_view, big_endian_array<std::int32_t>) noexcept
+        {
+        }
+
+        void long_array(std::string_view, big_endian_array<std::int64_t>) noexcept
+        {
+        }
+    };
+
+    // Streams the payload of one tag to the handler. Nesting is tracked on a fixed stack, so nothing is allocated
+    // and strings and arrays are views into the input.
+    template<typename THandler>
+    void parse_payload(cursor& input, tag_type type, std::string_view name, THandler& handler)
+    {
+        class frame
+        {
+        public:
+            bool compound;
+            tag_type element;
+            std::size_t remaining;
+        };
+
+        std::array<frame, max_depth> stack;
+        std::size_t depth{};
+
+        auto visit{ [&](tag_type type, std::string_view name)
+        {
+            switch (type)
+            {
+            case tag_type::tag_byte:
+                handler.byte_value(name, input.read<std::int8_t>());
+                break;
+            case tag_type::tag_short:
+                handler.short_value(name, input.read<std::int16_t>());
+                break;
+            case tag_type::tag_int:
+                handler.int_value(name, input.read<std::int32_t>());
+                break;
+            case tag_type::tag_long:
+                handler.long_value(name, input.read<std::int64_t>());
+                break;
+            case tag_type::tag_float:
+                handler.float_value(name, input.read<float>());
+                break;
+            case tag_type::tag_double:
+                handler.double_value(name, input.read<double>());
+                break;
+            case tag_type::tag_byte_array:
+                handler.byte_array(name, input.read_array<std::int8_t>());
+                break;
+            case tag_type::tag_string:
+                handler.string_value(name, input.read_string());
+                break;
+            case tag_type::tag_int_array:
+                handler.int_array(name, input.read_array<std::int32_t>());
+                break;
+            case tag_type::tag_long_array:
+                handler.long_array(name, input.read_array<std::int64_t>());
+                break;
+            case tag_type::tag_list:
+            {
+                auto element{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+                auto size{ input.read_size() };
+                if (element == tag_type::tag_end && size)
+                {
+                    throw parse_error{ "NBT list of TAG_End elements" };
+                }
+                if (element > tag_type::tag_long_array)
+                {
+                    throw parse_error{ fmt::format("Unknown NBT tag type {}", static_cast<int>(element)) };
+                }
+                if (depth == max_depth)
+                {
+                    throw parse_error{ "NBT nested too deeply" };
+                }
+                handler.begin_list(name, element, size);
+                stack[depth++] = { .compound = false, .element = element, .remaining = size };
+                break;
+            }
+            case tag_type::tag_compound:
+                if (depth == max_depth)
+                {
+                    throw parse_error{ "NBT nested too deeply" };
+                }
+                handler.begin_compound(name);
+                stack[depth++] = { .compound = true, .element = tag_type::tag_end, .remaining = 0 };
+                break;
+            default:
+                throw parse_error{ fmt::format("Unknown NBT tag type {}", static_cast<int>(type)) };
+            }
+        } };
+
+        visit(type, name);
+        while (depth)
+        {
+            auto& top{ stack[depth - 1] };
+            if (top.compound)
+            {
+                auto child{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+                if (child == tag_type::tag_end)
+                {
+                    --depth;
+                    handler.end_compound();
+                    continue;
+                }
+                auto child_name{ input.read_string() };
+                visit(child, child_name);
+            }
+            else
+            {
+                if (!top.remaining)
+                {
+                    --depth;
+                    handler.end_list();
+                    continue;
+                }
+                --top.remaining;
+                visit(top.element, {});
+            }
+        }
+    }
+
+    // Parses a named root tag and returns the number of bytes it took.
+    template<typename THandler>
+    std::size_t parse(std::span<const std::byte> data, THandler& handler)
+    {
+        cursor input{ data };
+        auto type{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+        if (type == tag_type::tag_end)
+        {
+            return input.position();
+        }
+        auto name{ input.read_string() };
+        parse_payload(input, type, name, handler);
+        return input.position();
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <plasma/nbt/byteswap.h>
+
+namespace plasma::nbt
+{
+    enum class tag_type : std::uint8_t
+    {
+        tag_end,
+        tag_byte,
+        tag_short,
+        tag_int,
+        tag_long,
+        tag_float,
+        tag_double,
+        tag_byte_array,
+        tag_string,
+        tag_list,
+        tag_compound,
+        tag_int_array,
+        tag_long_array
+    };
+
+    std::string_view get_tag_name(tag_type type) noexcept;
+
+    class parse_error : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Nesting deeper than this is rejected, as vanilla does.
+    inline constexpr std::size_t max_depth{ 512 };
+
+    template<typename T>
+    T load_big_endian(const std::byte* data) noexcept
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            return static_cast<T>(*data);
+        }
+        else
+        {
+            using unsigned_type = std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+            unsigned_type value{};
+            std::memcpy(&value, data, sizeof(value));
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                value = std::byteswap(value);
+            }
+            return std::bit_cast<T>(value);
+        }
+    }
+
+    template<typename T>
+    void store_big_endian(std::byte* data, T value) noexcept
+    {
+        if constexpr (sizeof(T) == 1)
+        {
+            *data = static_cast<std::byte>(value);
+        }
+        else
+        {
+            using unsigned_type = std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>>;
+            auto bits{ std::bit_cast<unsigned_type>(value) };
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                bits = std::byteswap(bits);
+            }
+            std::memcpy(data, &bits, sizeof(bits));
+        }
+    }
+
+    // An array still in big-endian order. Elements are swapped on access, whole ranges with SIMD by copy_to().
+    template<typename T>
+    class big_endian_array
+    {
+    private:
+        const std::byte* data_;
+        std::size_t size_;
+    public:
+        big_endian_array() noexcept :
+            data_{}, size_{}
+        {
+        }
+
+        big_endian_array(const std::byte* data, std::size_t size) noexcept :
+            data_{ data }, size_{ size }
+        {
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return !size_;
+        }
+
+        [[nodiscard]] std::span<const std::byte> bytes() const noexcept
+        {
+            return { data_, size_ * sizeof(T) };
+        }
+
+        T operator[](std::size_t index) const noexcept
+        {
+            return load_big_endian<T>(data_ + index * sizeof(T));
+        }
+
+        // Copies min(size(), out.size()) elements.
+        void copy_to(std::span<T> out) const noexcept
+        {
+            byteswap_copy(data_, out.data(), std::min(size_, out.size()), sizeof(T));
+        }
+
+        [[nodiscard]] std::vector<T> to_vector() const
+        {
+            std::vector<T> values(size_);
+            copy_to(values);
+            return values;
+        }
+    };
+}
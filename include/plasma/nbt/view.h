@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <plasma/nbt/reader.hpp>
+#include <plasma/nbt/tag.h>
+
+namespace plasma::nbt
+{
+    // Reads tags in place, for example straight out of a mapped region file. Nothing is copied or decoded until it
+    // is accessed and the underlying bytes must outlive the view. An empty view has type TAG_End.
+    class view
+    {
+    private:
+        std::span<const std::byte> data_;
+        tag_type type_;
+        std::string_view name_;
+
+        template<typename T>
+        T get(tag_type type) const
+        {
+            if (type_ != type)
+            {
+                throw parse_error{ fmt::format("Expected {} but found {}", get_tag_name(type), get_tag_name(type_)) };
+            }
+            cursor input{ data_ };
+            return input.read<T>();
+        }
+    public:
+        view() noexcept :
+            data_{}, type_{ tag_type::tag_end }, name_{}
+        {
+        }
+
+        view(std::span<const std::byte> payload, tag_type type, std::string_view name) noexcept :
+            data_{ payload }, type_{ type }, name_{ name }
+        {
+        }
+
+        // Views the named root tag at the start of data.
+        explicit view(std::span<const std::byte> data);
+
+        [[nodiscard]] tag_type get_type() const noexcept
+        {
+            return type_;
+        }
+
+        [[nodiscard]] std::string_view get_name() const noexcept
+        {
+            return name_;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return type_ != tag_type::tag_end;
+        }
+
+        // Size of the payload, found by skipping over it.
+        [[nodiscard]] std::size_t get_payload_size() const;
+
+        [[nodiscard]] std::span<const std::byte> get_payload() const
+        {
+            return data_.first(get_payload_size());
+        }
+
+        // Linear scan of a compound, returns an empty view when the child is missing.
+        [[nodiscard]] view find(std::string_view name) const;
+
+        // Calls function(view) for each child of a compound or element of a list.
+        template<typename TFunction>
+        void for_each(TFunction&& function) const
+        {
+            cursor input{ data_ };
+            null_handler skip{};
+            if (type_ == tag_type::tag_compound)
+            {
+                while (true)
+                {
+                    auto type{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+                    if (type == tag_type::tag_end)
+                    {
+                        return;
+                    }
+                    auto name{ input.read_string() };
+                    view child{ data_.subspan(input.position()), type, name };
+                    function(child);
+                    parse_payload(input, type, name, skip);
+                }
+            }
+            if (type_ == tag_type::tag_list)
+            {
+                auto element{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+                auto size{ input.read_size() };
+                for (std::size_t i{}; i < size; ++i)
+                {
+                    view child{ data_.subspan(input.position()), element, {} };
+                    function(child);
+                    parse_payload(input, element, {}, skip);
+                }
+                return;
+            }
+            throw parse_error{ fmt::format("{} has no children", get_tag_name(type_)) };
+        }
+
+        [[nodiscard]] tag_type get_element() const;
+
+        [[nodiscard]] std::size_t get_size() const;
+
+        [[nodiscard]] std::int8_t as_byte() const
+        {
+            return get<std::int8_t>(tag_type::tag_byte);
+        }
+
+        [[nodiscard]] std::int16_t as_short() const
+        {
+            return get<std::int16_t>(tag_type::tag_short);
+        }
+
+        [[nodiscard]] std::int32_t as_int() const
+        {
+            return get<std::int32_t>(tag_type::tag_int);
+        }
+
+        [[nodiscard]] std::int64_t as_long() const
+        {
+            return get<std::int64_t>(tag_type::tag_long);
+        }
+
+        [[nodiscard]] float as_float() const
+        {
+            return get<float>(tag_type::tag_float);
+        }
+
+        [[nodiscard]] double as_double() const
+        {
+            return get<double>(tag_type::tag_double);
+        }
+
+        // Any integral tag, widened.
+        [[nodiscard]] std::int64_t as_integer() const;
+
+        [[nodiscard]] std::string_view as_string() const;
+
+        [[nodiscard]] big_endian_array<std::int8_t> as_byte_array() const;
+
+        [[nodiscard]] big_endian_array<std::int32_t> as_int_array() const;
+
+        [[nodiscard]] big_endian_array<std::int64_t> as_long_array() const;
+    };
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <plasma/nbt/tag.h>
+
+namespace plasma::nbt
+{
+    class node;
+    class view;
+
+    // Appends tags to a buffer as they are written. Names are ignored inside lists, list lengths are patched in by
+    // end_list().
+    class writer
+    {
+    private:
+        class frame
+        {
+        public:
+            bool compound;
+            tag_type element;
+            std::size_t size_offset;
+            std::int32_t size;
+        };
+
+        std::vector<std::byte>& out_;
+        std::vector<frame> stack_;
+
+        std::byte* grow(std::size_t size);
+
+        void write_header(tag_type type, std::string_view name);
+
+        void write_name(std::string_view name);
+
+        template<typename T>
+        void write_value(tag_type type, std::string_view name, T value)
+        {
+            write_header(type, name);
+            store_big_endian(grow(sizeof(T)), value);
+        }
+
+        void write_array(tag_type type, std::string_view name, const void* data, std::size_t count, std::size_t width);
+
+        void write_raw_array(tag_type type, std::string_view name, std::span<const std::byte> bytes, std::size_t count);
+    public:
+        explicit writer(std::vector<std::byte>& out);
+
+        // True when every compound and list has been closed.
+        [[nodiscard]] bool is_complete() const noexcept
+        {
+            return stack_.empty();
+        }
+
+        void begin_compound(std::string_view name = {});
+
+        void end_compound();
+
+        void begin_list(std::string_view name, tag_type element);
+
+        void end_list();
+
+        void write_byte(std::string_view name, std::int8_t value)
+        {
+            write_value(tag_type::tag_byte, name, value);
+        }
+
+        void write_short(std::string_view name, std::int16_t value)
+        {
+            write_value(tag_type::tag_short, name, value);
+        }
+
+        void write_int(std::string_view name, std::int32_t value)
+        {
+            write_value(tag_type::tag_int, name, value);
+        }
+
+        void write_long(std::string_view name, std::int64_t value)
+        {
+            write_value(tag_type::tag_long, name, value);
+        }
+
+        void write_float(std::string_view name, float value)
+        {
+            write_value(tag_type::tag_float, name, value);
+        }
+
+        void write_double(std::string_view name, double value)
+        {
+            write_value(tag_type::tag_double, name, value);
+        }
+
+        void write_string(std::string_view name, std::string_view value);
+
+        void write_byte_array(std::string_view name, std::span<const std::int8_t> values);
+
+        void write_int_array(std::string_view name, std::span<const std::int32_t> values);
+
+        void write_long_array(std::string_view name, std::span<const std::int64_t> values);
+
+        // Arrays already in big-endian order are copied as is.
+        void write_int_array(std::string_view name, big_endian_array<std::int32_t> values);
+
+        void write_long_array(std::string_view name, big_endian_array<std::int64_t> values);
+
+        void write(const node& value);
+
+        // Copies the tag's payload through as is.
+        void write(std::string_view name, const view& value);
+    };
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <plasma/network/compression.h>
+#include <plasma/world/chunk.h>
+
+namespace plasma::network
+{
+    class chunk_packet_statistics
+    {
+    public:
+        std::size_t entries;
+        std::size_t bytes;
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t invalidations;
+        std::uint64_t evictions;
+        // Encoded bytes handed out again instead of being serialized and compressed once more.
+        std::uint64_t bytes_saved;
+        std::uint64_t encode_nanoseconds;
+    };
+
+    // Update Light and Chunk Data frames for a chunk, encoded once in the server's play-state wire format and
+    // shared read-only by every connection that sends them. Entries are keyed by chunk and revision, so any change
+    // to a section or its light makes the next lookup encode afresh. Tick thread only.
+    class chunk_packet_cache
+    {
+    private:
+        class entry
+        {
+        public:
+            std::uint64_t revision;
+            std::shared_ptr<const std::vector<std::byte>> frames;
+            std::list<std::uint64_t>::iterator recent;
+        };
+
+        std::int32_t threshold_;
+        std::size_t max_bytes_;
+        compressor compressor_;
+        compression_statistics& compression_statistics_;
+        std::unordered_map<std::uint64_t, entry> entries_;
+        // Most recently used first.
+        std::list<std::uint64_t> recent_;
+        std::vector<std::byte> sections_;
+        std::vector<std::byte> heightmaps_;
+        std::size_t bytes_;
+        std::uint64_t hits_;
+        std::uint64_t misses_;
+        std::uint64_t invalidations_;
+        std::uint64_t evictions_;
+        std::uint64_t bytes_saved_;
+        std::uint64_t encode_nanoseconds_;
+
+        void append_frame(std::vector<std::byte>& out, std::vector<std::byte> frame);
+
+        void erase(std::unordered_map<std::uint64_t, entry>::iterator found);
+    public:
+        // A negative threshold leaves the frames uncompressed, as connections are when compression is disabled.
+        chunk_packet_cache(std::int32_t threshold, std::int32_t level, std::size_t max_bytes,
+            compression_statistics& statistics);
+
+        chunk_packet_cache(const chunk_packet_cache&) = delete;
+
+        chunk_packet_cache& operator=(const chunk_packet_cache&) = delete;
+
+        // The frames for the chunk as it is now, ready for connection::send_shared().
+        std::shared_ptr<const std::vector<std::byte>> get(const plasma::world::chunk& chunk);
+
+        // Encodes without looking at or filling the cache.
+        std::shared_ptr<const std::vector<std::byte>> encode(const plasma::world::chunk& chunk);
+
+        void invalidate(std::int32_t x, std::int32_t z);
+
+        [[nodiscard]] chunk_packet_statistics get_statistics() const noexcept;
+    };
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <zlib.h>
+
+namespace plasma::network
+{
+    class compression_statistics
+    {
+    public:
+        std::atomic<std::uint64_t> packets_compressed;
+        std::atomic<std::uint64_t> bytes_in;
+        std::atomic<std::uint64_t> bytes_out;
+        std::atomic<std::uint64_t> compress_nanoseconds;
+        std::atomic<std::uint64_t> packets_decompressed;
+        std::atomic<std::uint64_t> bytes_decompressed;
+        std::atomic<std::uint64_t> decompress_nanoseconds;
+
+        // Compressed size over uncompressed size of everything deflated so far.
+        [[nodiscard]] double get_ratio() const noexcept;
+    };
+
+    // Recycles byte buffers between packets so that steady-state compression does not allocate.
+    class buffer_pool : public std::enable_shared_from_this<buffer_pool>
+    {
+    private:
+        std::mutex mutex_;
+        std::vector<std::vector<std::byte>> free_;
+        std::size_t max_pooled_;
+        std::size_t max_capacity_;
+    public:
+        buffer_pool(std::size_t max_pooled, std::size_t max_capacity);
+
+        std::vector<std::byte> acquire(std::size_t size);
+
+        void release(std::vector<std::byte> buffer);
+
+        // The buffer goes back to the pool once the last reference is dropped.
+        std::shared_ptr<const std::vector<std::byte>> share(std::vector<std::byte> buffer);
+    };
+
+    // Long-lived deflate and inflate streams, reset between packets instead of being reinitialized.
+    class compressor
+    {
+    private:
+        z_stream deflate_;
+        z_stream inflate_;
+    public:
+        explicit compressor(int level);
+
+        compressor(const compressor&) = delete;
+
+        compressor& operator=(const compressor&) = delete;
+
+        ~compressor();
+
+        void compress(std::span<const std::byte> data, std::vector<std::byte>& out);
+
+        // Throws unless data inflates to exactly out.size() bytes.
+        void decompress(std::span<const std::byte> data, std::span<std::byte> out);
+    };
+
+    // Appends the frame for packet (id and body) in the compressed format: the uncompressed length, zero when
+    // below the threshold, followed by the zlib stream or the raw packet.
+    void append_compressed_frame(compressor& compressor, std::span<const std::byte> packet, std::size_t threshold,
+        std::vector<std::byte>& out, compression_statistics& statistics);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <plasma/network/compression.h>
+#include <plasma/network/protocol.h>
+
+namespace plasma::network
+{
+    class reactor;
+
+    class connection : public std::enable_shared_from_this<connection>
+    {
+    private:
+        // Frames waiting to be written, in order. A batch either owns its bytes or shares an immutable frame, and
+        // is not ready while it is being compressed elsewhere.
+        class outgoing_batch
+        {
+        public:
+            std::vector<std::byte> data;
+            std::shared_ptr<const std::vector<std::byte>> shared;
+            bool ready;
+        };
+
+        reactor& reactor_;
+        boost::asio::ip::tcp::socket socket_;
+        std::uint64_t id_;
+        connection_state state_;
+        std::int32_t client_protocol_;
+        std::string player_name_;
+        std::array<std::uint8_t, 16> player_uuid_;
+        std::shared_ptr<std::vector<std::byte>> read_buffer_;
+        std::size_t read_start_;
+        std::size_t read_end_;
+        std::unique_ptr<compressor> compressor_;
+        std::size_t compression_threshold_;
+        bool status_answered_;
+        std::deque<outgoing_batch> pending_writes_;
+        std::vector<outgoing_batch> active_writes_;
+        std::vector<boost::asio::const_buffer> write_buffers_;
+        bool writing_;
+        bool close_after_write_;
+
+        void read();
+
+        void on_read(const boost::system::error_code& error, std::size_t transferred);
+
+        void process();
+
+        void handle_frame(std::span<const std::byte> payload);
+
+        void handle_packet(std::span<const std::byte> payload, std::shared_ptr<const std::vector<std::byte>> owner);
+
+        void handle_handshake(std::int32_t id, std::span<const std::byte> body);
+
+        void handle_status(std::int32_t id, std::span<const std::byte> body);
+
+        void handle_login(std::int32_t id, std::span<const std::byte> body);
+
+        void queue_write(std::vector<std::byte> frame);
+
+        // Written without copying unless the connection has switched to the compressed format.
+        void queue_write(std::shared_ptr<const std::vector<std::byte>> frame);
+
+        // Frames already in the connection's wire format, written straight from the shared buffer.
+        void queue_encoded(std::shared_ptr<const std::vector<std::byte>> frames);
+
+        // Splits a buffer of back-to-back frames so that each one is compressed on its own.
+        void queue_frames(std::vector<std::byte> frames);
+
+        std::vector<std::byte>& ready_batch();
+
+        void offload_write(std::vector<std::byte> frame);
+
+        void write();
+
+        void close();
+    public:
+        connection(reactor& reactor, boost::asio::ip::tcp::socket socket);
+
+        connection(const connection&) = delete;
+
+        connection& operator=(const connection&) = delete;
+
+        void start();
+
+        // Reactor thread only, reads again after the reactor paused the connection.
+        void resume();
+
+        // Safe to call from any thread, the frame (as built by packet_writer) is written by the owning reactor.
+        void send(std::vector<std::byte> frame);
+
+        // Like send(), for a buffer holding several frames back to back, which are handed over with one post.
+        void send_batch(std::vector<std::byte> frames);
+
+        // For frames encoded once in the play-state format of the server, compressed when compression is enabled,
+        // and shared between connections: each one writes the same buffer without copying it.
+        void send_shared(std::shared_ptr<const std::vector<std::byte>> frames);
+
+        void disconnect(std::string reason);
+
+        [[nodiscard]] std::uint64_t get_id() const noexcept
+        {
+            return id_;
+        }
+
+        [[nodiscard]] const std::string& get_player_name() const noexcept
+        {
+            return player_name_;
+        }
+
+        [[nodiscard]] const std::array<std::uint8_t, 16>& get_player_uuid() const noexcept
+        {
+            return player_uuid_;
+        }
+    };
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <plasma/config/plasma_config.h>
+#include <plasma/job/job_system.h>
+#include <plasma/metrics/metrics_registry.h>
+#include <plasma/network/compression.h>
+#include <plasma/network/inbound_message.h>
+#include <plasma/network/rate_limiter.h>
+#include <plasma/network/reactor.h>
+
+namespace plasma::network
+{
+    class network_metrics
+    {
+    public:
+        plasma::metrics::counter received_bytes;
+        plasma::metrics::counter sent_bytes;
+        plasma::metrics::counter accepted_connections;
+        plasma::metrics::counter closed_connections;
+        plasma::metrics::counter paused_reads;
+    };
+
+    class network_manager
+    {
+    private:
+        plasma::job::job_system& jobs_;
+        std::string bind_address_;
+        std::uint16_t port_;
+        std::mutex status_mutex_;
+        std::string motd_;
+        std::atomic<std::uint32_t> max_players_;
+        std::string favicon_;
+        std::atomic<std::uint32_t> online_players_;
+        std::atomic<bool> status_dirty_;
+        std::atomic<std::shared_ptr<const std::vector<std::byte>>> status_frame_;
+        rate_limiter status_limiter_;
+        std::int32_t compression_threshold_;
+        std::int32_t compression_level_;
+        std::size_t offload_size_;
+        std::shared_ptr<buffer_pool> buffers_;
+        compression_statistics compression_statistics_;
+        network_metrics metrics_;
+        std::vector<std::unique_ptr<reactor>> reactors_;
+
+        void rebuild_status();
+    public:
+        network_manager(const plasma::config::plasma_config& config, plasma::job::job_system& jobs,
+            plasma::metrics::metrics_registry& metrics);
+
+        network_manager(const network_manager&) = delete;
+
+        network_manager& operator=(const network_manager&) = delete;
+
+        ~network_manager();
+
+        void start();
+
+        void stop();
+
+        // Game thread only: hands every message decoded since the last call to the function.
+        template<typename TFunction>
+        std::size_t poll(TFunction&& function)
+        {
+            std::size_t polled{};
+            for (auto& reactor : reactors_)
+            {
+                polled += reactor->drain(function);
+            }
+            return polled;
+        }
+
+        [[nodiscard]] std::size_t get_reactor_count() const noexcept
+        {
+            return reactors_.size();
+        }
+
+        reactor& get_reactor(std::size_t index)
+        {
+            return *reactors_.at(index);
+        }
+
+        [[nodiscard]] std::uint32_t get_online_players() const noexcept
+        {
+            return online_players_.load(std::memory_order_relaxed);
+        }
+
+        // Negative when compression is disabled.
+        [[nodiscard]] std::int32_t get_compression_threshold() const noexcept
+        {
+            return compression_threshold_;
+        }
+
+        [[nodiscard]] std::int32_t get_compression_level() const noexcept
+        {
+            return compression_level_;
+        }
+
+        // Packets at least this large are deflated on the job system instead of the reactor.
+        [[nodiscard]] std::size_t get_offload_size() const noexcept
+        {
+            return offload_size_;
+        }
+
+        [[nodiscard]] buffer_pool& get_buffer_pool() noexcept
+        {
+            return *buffers_;
+        }
+
+        [[nodiscard]] compression_statistics& get_compression_statistics() noexcept
+        {
+            return compression_statistics_;
+        }
+
+        // Updated from the reactor threads.
+        [[nodiscard]] network_metrics& get_metrics() noexcept
+        {
+            return metrics_;
+        }
+
+        plasma::job::job_system& get_job_system() noexcept
+        {
+            return jobs_;
+        }
+
+        // Counts a player logging in, false when the server already holds network.max_players.
+        [[nodiscard]] bool try_player_join() noexcept;
+
+        void player_left() noexcept;
+
+        // The framed status response, shared by every connection until its inputs change.
+        [[nodiscard]] std::shared_ptr<const std::vector<std::byte>> get_status_frame();
+
+        // Takes the MOTD, player limit and favicon from a reloaded configuration.
+        void reload_status(const plasma::config::plasma_config& config);
+
+        bool try_acquire_status(const boost::asio::ip::address& address)
+        {
+            return status_limiter_.try_acquire(address);
+        }
+    };
+}
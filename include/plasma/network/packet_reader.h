@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include <plasma/network/varint.h>
+
+namespace plasma::network
+{
+    // A length-prefixed frame as it sits in the receive buffer, the payload is a view into that buffer.
+    class frame
+    {
+    public:
+        std::size_t size;
+        bool complete;
+        std::span<const std::byte> payload;
+    };
+
+    // Returns std::nullopt until the length prefix has arrived and an incomplete frame until the rest of it has.
+    // Throws on malformed or oversized frames.
+    std::optional<frame> read_frame(std::span<const std::byte> data, std::size_t max_size);
+
+    // Reads fields in place, strings and byte arrays are returned as views that are only valid as long as the
+    // underlying buffer.
+    class packet_reader
+    {
+    private:
+        std::span<const std::byte> data_;
+
+        std::span<const std::byte> take(std::size_t size)
+        {
+            if (data_.size() < size) [[unlikely]]
+            {
+                throw std::runtime_error{ "Packet is truncated" };
+            }
+            auto taken{ data_.first(size) };
+            data_ = data_.subspan(size);
+            return taken;
+        }
+
+        template<typename TValue>
+        TValue read_big_endian()
+        {
+            TValue value{};
+            std::memcpy(&value, take(sizeof(TValue)).data(), sizeof(TValue));
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                value = std::byteswap(value);
+            }
+            return value;
+        }
+    public:
+        explicit packet_reader(std::span<const std::byte> data) noexcept :
+            data_{ data }
+        {
+        }
+
+        [[nodiscard]] std::size_t remaining() const noexcept
+        {
+            return data_.size();
+        }
+
+        std::uint8_t read_byte()
+        {
+            return std::to_integer<std::uint8_t>(take(1)[0]);
+        }
+
+        bool read_bool()
+        {
+            return read_byte() != 0;
+        }
+
+        std::int16_t read_short()
+        {
+            return read_big_endian<std::int16_t>();
+        }
+
+        std::uint16_t read_unsigned_short()
+        {
+            return read_big_endian<std::uint16_t>();
+        }
+
+        std::int32_t read_int()
+        {
+            return read_big_endian<std::int32_t>();
+        }
+
+        std::int64_t read_long()
+        {
+            return read_big_endian<std::int64_t>();
+        }
+
+        float read_float()
+        {
+            return std::bit_cast<float>(read_big_endian<std::uint32_t>());
+        }
+
+        double read_double()
+        {
+            return std::bit_cast<double>(read_big_endian<std::uint64_t>());
+        }
+
+        std::int32_t read_varint()
+        {
+            auto result{ network::read_varint(data_) };
+            if (!result) [[unlikely]]
+            {
+                throw std::runtime_error{ "Packet is truncated" };
+            }
+            data_ = data_.subspan(result->size);
+            return result->value;
+        }
+
+        std::int64_t read_varlong()
+        {
+            auto result{ network::read_varlong(data_) };
+            if (!result) [[unlikely]]
+            {
+                throw std::runtime_error{ "Packet is truncated" };
+            }
+            data_ = data_.subspan(result->size);
+            return result->value;
+        }
+
+        // max_length counts characters, as in the protocol, so up to four bytes each are accepted.
+        std::string_view read_string(std::size_t max_length = 32767)
+        {
+            auto length{ read_varint() };
+            if (length < 0 || static_cast<std::size_t>(length) > max_length * 4) [[unlikely]]
+            {
+                throw std::runtime_error{ "String is too long" };
+            }
+            auto bytes{ take(static_cast<std::size_t>(length)) };
+            return { reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+        }
+
+        std::array<std::uint8_t, 16> read_uuid()
+        {
+            std::array<std::uint8_t, 16> uuid{};
+            std::memcpy(uuid.data(), take(uuid.size()).data(), uuid.size());
+            return uuid;
+        }
+
+        std::span<const std::byte> read_bytes(std::size_t size)
+        {
+            return take(size);
+        }
+
+        std::span<const std::byte> read_remaining() noexcept
+        {
+            auto remaining{ data_ };
+            data_ = {};
+            return remaining;
+        }
+    };
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace plasma::network
+{
+    // Builds a complete frame in place: the length prefix is reserved up front as a padded three-byte VarInt,
+    // which the vanilla frame decoder accepts, so finishing a packet never moves its body.
+    class packet_writer
+    {
+    private:
+        std::vector<std::byte> buffer_;
+        std::size_t frame_start_;
+
+        template<typename TValue>
+        packet_writer& write_big_endian(TValue value)
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                value = std::byteswap(value);
+            }
+            auto bytes{ std::bit_cast<std::array<std::byte, sizeof(TValue)>>(value) };
+            buffer_.insert(buffer_.end(), bytes.begin(), bytes.end());
+            return *this;
+        }
+    public:
+        static constexpr std::size_t header_size{ 3 };
+
+        explicit packet_writer(std::int32_t id, std::size_t reserve = 64);
+
+        // Appends the frame to the end of buffer, so several packets can be batched into one write.
+        packet_writer(std::int32_t id, std::vector<std::byte> buffer);
+
+        packet_writer& write_byte(std::uint8_t value);
+
+        packet_writer& write_bool(bool value);
+
+        packet_writer& write_short(std::int16_t value);
+
+        packet_writer& write_int(std::int32_t value);
+
+        packet_writer& write_long(std::int64_t value);
+
+        packet_writer& write_float(float value);
+
+        packet_writer& write_double(double value);
+
+        packet_writer& write_varint(std::int32_t value);
+
+        packet_writer& write_varlong(std::int64_t value);
+
+        packet_writer& write_string(std::string_view value);
+
+        packet_writer& write_uuid(const std::array<std::uint8_t, 16>& value);
+
+        packet_writer& write_bytes(std::span<const std::byte> value);
+
+        [[nodiscard]] std::size_t size() const noexcept
+        {
+            return buffer_.size() - frame_start_;
+        }
+
+        std::vector<std::byte> finish();
+    };
+}
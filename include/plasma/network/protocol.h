@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace plasma::network
+{
+    inline constexpr std::int32_t protocol_version{ 754 };
+
+    inline constexpr const char* protocol_name{ "1.16.5" };
+
+    // Frames are prefixed by a VarInt of at most three bytes.
+    inline constexpr std::size_t max_frame_size{ (1 << 21) - 1 };
+
+    // Upper bound on the declared length of a compressed packet once inflated.
+    inline constexpr std::size_t max_uncompressed_size{ 1 << 21 };
+
+    enum class connection_state : std::uint8_t
+    {
+        handshaking,
+        status,
+        login,
+        play,
+        closed
+    };
+
+    std::string json_escape(std::string_view value);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include <boost/asio/ip/address.hpp>
+
+namespace plasma::network
+{
+    // Token bucket per remote address, sharded so that reactors rarely contend on the same lock. IPv6 clients are
+    // keyed by their /64, which a single host usually owns whole. Each shard holds at most max_shard_size buckets and
+    // evicts the least recently used one to make room, so a flood of distinct sources costs constant time per call.
+    class rate_limiter
+    {
+    private:
+        // IPv4 addresses are keyed by their IPv4-mapped IPv6 form.
+        using key_type = boost::asio::ip::address_v6::bytes_type;
+
+        class bucket
+        {
+        public:
+            double tokens;
+            std::chrono::steady_clock::time_point updated;
+            std::list<key_type>::iterator recent;
+        };
+
+        class key_hash
+        {
+        public:
+            std::size_t operator()(const key_type& key) const noexcept;
+        };
+
+        class shard
+        {
+        public:
+            std::mutex mutex;
+            std::unordered_map<key_type, bucket, key_hash> buckets;
+            // Most recently used first.
+            std::list<key_type> recent;
+            std::chrono::steady_clock::time_point swept;
+        };
+
+        static constexpr std::size_t shard_count{ 16 };
+        static constexpr std::size_t max_shard_size{ 4096 };
+        static constexpr std::chrono::seconds sweep_interval{ 10 };
+
+        double rate_;
+        double burst_;
+        std::array<shard, shard_count> shards_;
+
+        static key_type get_key(const boost::asio::ip::address& address) noexcept;
+
+        // Drops the buckets that have been idle long enough to refill, oldest first.
+        void sweep(shard& shard, std::chrono::steady_clock::time_point now);
+    public:
+        // A non-positive rate disables limiting.
+        rate_limiter(double rate, double burst);
+
+        rate_limiter(const rate_limiter&) = delete;
+
+        rate_limiter& operator=(const rate_limiter&) = delete;
+
+        bool try_acquire(const boost::asio::ip::address& address);
+    };
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <plasma/network/inbound_message.h>
+
+namespace plasma::network
+{
+    class connection;
+
+    class network_manager;
+
+    // An event loop on its own thread. Every connection lives on exactly one reactor, so its socket is only ever
+    // touched by that thread, and the reactor is the single producer of its inbound queue.
+    class reactor
+    {
+    private:
+        network_manager& manager_;
+        std::size_t index_;
+        boost::asio::io_context io_context_;
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_guard_;
+        std::optional<boost::asio::ip::tcp::acceptor> acceptor_;
+        bool distribute_;
+        std::size_t next_reactor_;
+        boost::lockfree::spsc_queue<inbound_message*> inbound_;
+        std::deque<inbound_message*> overflow_;
+        std::size_t overflow_limit_;
+        std::vector<std::shared_ptr<connection>> paused_;
+        boost::asio::steady_timer retry_timer_;
+        bool retry_pending_;
+        std::thread thread_;
+
+        void accept();
+
+        void flush_overflow();
+    public:
+        reactor(network_manager& manager, std::size_t index, std::size_t queue_capacity);
+
+        reactor(const reactor&) = delete;
+
+        reactor& operator=(const reactor&) = delete;
+
+        ~reactor();
+
+        // With reuse_port every reactor binds its own acceptor; otherwise only the first one listens and
+        // distributes accepted sockets round-robin.
+        void listen(const boost::asio::ip::tcp::endpoint& endpoint, bool reuse_port, bool distribute);
+
+        void start();
+
+        void stop();
+
+        [[nodiscard]] std::size_t get_index() const noexcept
+        {
+            return index_;
+        }
+
+        boost::asio::io_context& get_io_context() noexcept
+        {
+            return io_context_;
+        }
+
+        network_manager& get_manager() noexcept
+        {
+            return manager_;
+        }
+
+        // Reactor thread only. Messages the game thread has no room for wait in the overflow, which connections
+        // keep from growing: they stop reading once it is half full and close instead of adding packets when it is
+        // full, so only their joined and left events go past the limit.
+        void push(std::unique_ptr<inbound_message> message);
+
+        [[nodiscard]] bool is_backlogged() const noexcept
+        {
+            return overflow_.size() >= overflow_limit_ / 2;
+        }
+
+        [[nodiscard]] bool is_full() const noexcept
+        {
+            return overflow_.size() >= overflow_limit_;
+        }
+
+        // Reactor thread only. The connection is resumed once the overflow has drained.
+        void pause(std::shared_ptr<connection> paused);
+
+        // Game thread only.
+        template<typename TFunction>
+        std::size_t drain(TFunction&& function)
+        {
+            return inbound_.consume_all([&function](inbound_message* message)
+            {
+                std::unique_ptr<inbound_message> owner{ message };
+                function(*owner);
+            });
+        }
+    };
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace plasma::network
+{
+    template<typename TValue>
+    class varnum_result
+    {
+    public:
+        TValue value;
+        std::size_t size;
+    };
+
+    using varint_result = varnum_result<std::int32_t>;
+
+    using varlong_result = varnum_result<std::int64_t>;
+
+    std::size_t varint_size(std::uint32_t value) noexcept;
+
+    std::size_t write_varint(std::byte* out, std::uint32_t value) noexcept;
+
+    std::size_t write_varlong(std::byte* out, std::uint64_t value) noexcept;
+
+    // Both return std::nullopt if more bytes are needed and throw if the number is longer than five (ten) bytes.
+    // The implementation is picked once at startup from the features of the running CPU.
+    std::optional<varint_result> read_varint(std::span<const std::byte> data);
+
+    std::optional<varlong_result> read_varlong(std::span<const std::byte> data);
+
+    const char* get_varint_codec_name() noexcept;
+}
@@ -22,20 +22,100 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
 #include <boost/program_options.hpp>
 
+#include <plasma/config/config_watcher.h>
 #include <plasma/config/plasma_config.h>
+#include <plasma/console/console.h>
+#include <plasma/entity/entity_store.h>
+#include <plasma/entity/entity_tracker.h>
+#include <plasma/job/job_system.h>
+#include <plasma/metrics/metrics_registry.h>
+#include <plasma/network/chunk_packet_cache.h>
+#include <plasma/network/network_manager.h>
 #include <plasma/plugin/plugin.h>
+#include <plasma/tick/tick_scheduler.h>
+#include <plasma/util/directory_lock.h>
+#include <plasma/world/backup_engine.h>
+#include <plasma/world/chunk_cache.h>
+#include <plasma/world/chunk_saver.h>
+#include <plasma/world/light_engine.h>
+#include <plasma/world/region_storage.h>
+#include <plasma/world/terrain_generator.h>
 
 #include <version.hpp>
 
 namespace plasma
 {
+    // Statistics kept by the subsystems themselves are copied into these once a second.
+    class server_metrics
+    {
+    public:
+        plasma::metrics::counter ticks;
+        plasma::metrics::histogram_metric tick_duration;
+        plasma::metrics::gauge tps;
+        plasma::metrics::gauge mspt_p50;
+        plasma::metrics::gauge mspt_p99;
+        plasma::metrics::gauge mspt_max;
+        plasma::metrics::counter overruns;
+        plasma::metrics::gauge online_players;
+        plasma::metrics::gauge resident_chunks;
+        plasma::metrics::gauge resident_bytes;
+        plasma::metrics::counter chunk_hits;
+        plasma::metrics::counter chunk_misses;
+        plasma::metrics::counter chunk_loads;
+        plasma::metrics::counter chunk_evictions;
+        plasma::metrics::gauge entities;
+        plasma::metrics::gauge allocator_rss;
+        plasma::metrics::gauge allocator_peak_rss;
+        plasma::metrics::gauge allocator_commit;
+        plasma::metrics::counter allocator_page_faults;
+    };
+
     class plasma_server : public plasma::plugin::plugin
     {
     private:
         plasma::config::plasma_config config_;
+        std::unique_ptr<plasma::config::config_watcher> config_watcher_;
+        std::unique_ptr<plasma::metrics::metrics_registry> metrics_;
+        server_metrics server_metrics_;
         boost::program_options::variables_map vm_;
+        std::shared_ptr<plasma::job::job_system> jobs_;
+        std::unique_ptr<plasma::network::network_manager> network_;
+        std::unique_ptr<plasma::network::chunk_packet_cache> chunk_packets_;
+        std::unique_ptr<plasma::tick::tick_scheduler> scheduler_;
+        // Declared before everything that writes to the world, so that it is released after all of it.
+        std::unique_ptr<plasma::util::directory_lock> world_lock_;
+        std::unique_ptr<plasma::world::region_storage> regions_;
+        std::unique_ptr<plasma::world::chunk_saver> saver_;
+        std::unique_ptr<plasma::world::terrain_generator> generator_;
+        std::unique_ptr<plasma::world::backup_engine> backups_;
+        std::unique_ptr<plasma::world::chunk_cache> chunks_;
+        std::unique_ptr<plasma::world::light_engine> lights_;
+        std::unique_ptr<plasma::entity::entity_store> entities_;
+        std::unique_ptr<plasma::entity::entity_tracker> tracker_;
+        plasma::console::console console_;
+        plasma::plugin::plugin_manager* manager_;
+        std::atomic<bool> running_;
+        // Returned by run() when initialize stopped short of starting the server.
+        int exit_code_;
+
+        void register_commands();
+
+        void register_metrics();
+
+        void update_metrics();
+
+        void handle_message(plasma::network::inbound_message& message);
+
+        // Loads, generates and lights the chunks around spawn before logins are accepted.
+        void prepare_spawn_area(std::int32_t radius);
+
+        void pregenerate(std::int32_t radius);
     public:
         explicit plasma_server(boost::program_options::variables_map vm);
 
@@ -44,5 +124,69 @@ namespace plasma
         const char* get_version() noexcept override;
 
         void initialize(plasma::plugin::plugin_manager& manager) override;
+
+        // Runs the server until it is stopped and returns the process exit code.
+        int run();
+
+        void stop() noexcept;
+
+        // The settings as last reloaded. Those only read at startup are in effect as of the first snapshot.
+        plasma::config::config_watcher& get_config_watcher() noexcept
+        {
+            return *config_watcher_;
+        }
+
+        // Plugins may add their own metrics while they initialize.
+        plasma::metrics::metrics_registry& get_metrics_registry() noexcept
+        {
+            return *metrics_;
+        }
+
+        plasma::tick::tick_scheduler& get_tick_scheduler() noexcept
+        {
+            return *scheduler_;
+        }
+
+        plasma::world::region_storage& get_region_storage() noexcept
+        {
+            return *regions_;
+        }
+
+        plasma::world::chunk_saver& get_chunk_saver() noexcept
+        {
+            return *saver_;
+        }
+
+        plasma::world::chunk_cache& get_chunk_cache() noexcept
+        {
+            return *chunks_;
+        }
+
+        plasma::world::light_engine& get_light_engine() noexcept
+        {
+            return *lights_;
+        }
+
+        plasma::network::chunk_packet_cache& get_chunk_packet_cache() noexcept
+        {
+            return *chunk_packets_;
+        }
+
+        plasma::entity::entity_store& get_entity_store() noexcept
+        {
+            return *entities_;
+        }
+
+        plasma::entity::entity_tracker& get_entity_tracker() noexcept
+        {
+            return *tracker_;
+        }
+
+        plasma::console::console& get_console() noexcept
+        {
+            return console_;
+        }
+
+        ~plasma_server() override;
     };
 }
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <plasma/plugin/plugin.h>
+
+// Every plugin library exports plasma_plugin_entry, which returns a descriptor of the plugin. The descriptor is plain
+// data so that a library built against another ABI version is rejected before any of its C++ types are touched.
+extern "C"
+{
+    struct plasma_plugin_descriptor
+    {
+        std::uint32_t abi_version;
+        const char* name;
+        const char* version;
+        // Names of the plugins to initialize first, terminated by a null pointer.
+        const char* const* dependencies;
+        plasma::plugin::plugin* (*create)();
+        void (*destroy)(plasma::plugin::plugin* instance);
+    };
+
+    using plasma_plugin_entry_function = const plasma_plugin_descriptor* (*)();
+}
+
+namespace plasma::plugin
+{
+    // Bumped whenever the descriptor or the plugin and plugin_manager classes change incompatibly.
+    inline constexpr std::uint32_t abi_version{ 2 };
+
+    inline constexpr const char* entry_symbol{ "plasma_plugin_entry" };
+}
+
+// Defines the entry point of a plugin library, e.g. PLASMA_PLUGIN(my_plugin, "my-plugin", "1.0", "plasma").
+#define PLASMA_PLUGIN(type, name, version, ...) \
+    extern "C" __attribute__((visibility("default"))) const plasma_plugin_descriptor* plasma_plugin_entry() \
+    { \
+        static const char* const dependencies[]{ __VA_ARGS__ __VA_OPT__(,) nullptr }; \
+        static const plasma_plugin_descriptor descriptor{ \
+            plasma::plugin::abi_version, name, version, dependencies, \
+            []() -> plasma::plugin::plugin* { return new type{}; }, \
+            [](plasma::plugin::plugin* instance) { delete instance; } \
+        }; \
+        return &descriptor; \
+    }
@@ -22,25 +22,110 @@
 
 #pragma once
 
+#include <cstddef>
+#include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include <plasma/event/event_bus.h>
+#include <plasma/job/job_system.h>
 #include <plasma/plugin/plugin.h>
 
+struct plasma_plugin_descriptor;
+
 namespace plasma::plugin
 {
     class plugin;
     class plugin_manager
     {
     private:
-        std::map<const char*, std::unique_ptr<plugin>> plugins_;
+        class loaded_plugin
+        {
+        public:
+            plugin* instance;
+            // Null for plugins compiled into the binary, which are deleted directly.
+            void (*destroy)(plugin* instance);
+            void* library;
+            std::filesystem::path path;
+            std::vector<std::string> dependencies;
+        };
+
+        class library_candidate
+        {
+        public:
+            std::filesystem::path path;
+            void* library;
+            const plasma_plugin_descriptor* descriptor;
+            std::vector<std::string> dependencies;
+            double open_milliseconds;
+        };
+
+        mutable std::shared_mutex mutex_;
+        std::map<std::string, loaded_plugin, std::less<>> plugins_;
+        // Initialization order, so that walking it backwards unloads dependents before their dependencies.
+        std::vector<std::string> order_;
+        std::shared_ptr<plasma::job::job_system> job_system_;
+        plasma::event::event_bus events_;
+
+        // Drops the handlers of the plugin before destroying it, so must not run while events are published.
+        void release(loaded_plugin& loaded) noexcept;
+
+        bool open_library(const std::filesystem::path& path, std::vector<library_candidate>& candidates);
+
+        std::size_t initialize_libraries(std::vector<library_candidate> candidates);
+
+        // The plugin and everything depending on it, directly or not, in reverse initialization order.
+        std::vector<std::string> collect_dependents(std::string_view name) const;
+
+        std::size_t unload(const std::vector<std::string>& names);
     public:
         plugin_manager();
+
+        plugin_manager(const plugin_manager&) = delete;
+
+        plugin_manager& operator=(const plugin_manager&) = delete;
+
+        // Unloads every plugin in reverse initialization order.
+        ~plugin_manager();
+
+        // Takes ownership of a plugin compiled into the binary and initializes it on the calling thread.
         bool load_plugin(plugin* plugin);
 
-        std::size_t unload_plugin(const char* name);
+        // Opens every shared library in the directory through its plasma_plugin_entry symbol, orders the plugins by
+        // their declared dependencies and initializes independent ones in parallel on the job system. Returns how
+        // many were initialized.
+        std::size_t load_directory(const std::filesystem::path& directory);
+
+        // Unloads the plugin and every plugin depending on it, dependents first. Returns how many were unloaded.
+        std::size_t unload_plugin(std::string_view name);
+
+        // Unloads the plugin and its dependents, then loads their libraries again. Returns how many came back.
+        std::size_t reload_plugin(std::string_view name);
+
+        // Unloads every plugin that came from a shared library, dependents first.
+        std::size_t unload_libraries();
+
+        [[nodiscard]] bool has_plugin(std::string_view name) const;
 
-        const std::unique_ptr<plugin>& get_plugin(const char* name) const;
+        // Throws std::out_of_range unless the plugin is loaded.
+        [[nodiscard]] plugin& get_plugin(std::string_view name) const;
+
+        // Calls the function with the name, version and dependencies of every plugin, in initialization order.
+        void for_each_plugin(const std::function<void(plugin&, const std::vector<std::string>&)>& function) const;
+
+        void set_job_system(std::shared_ptr<plasma::job::job_system> job_system);
+
+        // The shared worker pool, set up by the server before any other plugin is initialized.
+        plasma::job::job_system& get_job_system() const;
+
+        plasma::event::event_bus& get_event_bus() noexcept
+        {
+            return events_;
+        }
     };
 }
-
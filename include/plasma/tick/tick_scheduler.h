@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include <plasma/util/histogram.h>
+
+namespace plasma::tick
+{
+    enum class tick_phase : std::uint8_t
+    {
+        network_ingress,
+        world,
+        entities,
+        chunk_io,
+        network_egress
+    };
+
+    inline constexpr std::size_t phase_count{ 5 };
+
+    std::string_view get_phase_name(tick_phase phase) noexcept;
+
+    enum class overrun_policy
+    {
+        // Run late ticks back to back until the schedule is met again.
+        catch_up,
+        // Drop late ticks and restart the schedule from now.
+        skip
+    };
+
+    overrun_policy parse_overrun_policy(std::string_view name);
+
+    class mspt_statistics
+    {
+    public:
+        double p50;
+        double p99;
+        double max;
+    };
+
+    class tick_statistics
+    {
+    public:
+        std::uint64_t tick;
+        double tps;
+        mspt_statistics mspt;
+        std::array<mspt_statistics, phase_count> phases;
+        std::uint64_t overruns;
+        std::uint64_t skipped;
+    };
+
+    // Runs the phases of every tick in order at a fixed rate on the calling thread, recording how long each took.
+    class tick_scheduler
+    {
+    public:
+        using tick_listener = std::function<void(std::chrono::nanoseconds duration)>;
+    private:
+        // Durations go to the current window; statistics cover it and the one before.
+        class window
+        {
+        public:
+            util::histogram total;
+            std::array<util::histogram, phase_count> phases;
+        };
+
+        static constexpr std::uint64_t window_ticks{ 1200 };
+        static constexpr std::size_t tps_samples{ 100 };
+
+        std::chrono::nanoseconds interval_;
+        overrun_policy policy_;
+        std::uint64_t max_catch_up_;
+        std::array<std::vector<std::function<void()>>, phase_count> handlers_;
+        std::array<window, 2> windows_;
+        std::atomic<std::size_t> current_window_;
+        std::atomic<std::uint64_t> tick_;
+        std::atomic<double> tps_;
+        std::atomic<std::uint64_t> overruns_;
+        std::atomic<std::uint64_t> skipped_;
+        std::array<std::chrono::steady_clock::time_point, tps_samples> tick_starts_;
+        std::array<std::chrono::nanoseconds, phase_count> last_durations_;
+        tick_listener listener_;
+
+        void tick(std::chrono::steady_clock::time_point start);
+    public:
+        tick_scheduler(std::uint32_t tps, overrun_policy policy, std::uint64_t max_catch_up);
+
+        tick_scheduler(const tick_scheduler&) = delete;
+
+        tick_scheduler& operator=(const tick_scheduler&) = delete;
+
+        // Handlers must be added before run() and are called on the tick thread in registration order.
+        void add_handler(tick_phase phase, std::function<void()> handler);
+
+        // Called on the tick thread after every tick with how long it took. Must be set before run().
+        void set_tick_listener(tick_listener listener);
+
+        void run(const std::atomic<bool>& running);
+
+        [[nodiscard]] std::uint64_t get_tick() const noexcept
+        {
+            return tick_.load(std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] double get_tps() const noexcept
+        {
+            return tps_.load(std::memory_order_relaxed);
+        }
+
+        // Safe to call from any thread.
+        [[nodiscard]] tick_statistics get_statistics() const;
+    };
+}
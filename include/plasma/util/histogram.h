@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace plasma::util
+{
+    class histogram;
+
+    // Bucket counts summed from one or more histograms, for percentile queries.
+    class histogram_snapshot
+    {
+    private:
+        friend class histogram;
+
+        static constexpr unsigned sub_bucket_bits{ 5 };
+        static constexpr std::size_t bucket_count{ (64 - sub_bucket_bits + 1) << sub_bucket_bits };
+
+        std::array<std::uint64_t, bucket_count> counts_;
+        std::uint64_t total_;
+        std::uint64_t max_;
+    public:
+        histogram_snapshot() noexcept;
+
+        [[nodiscard]] std::uint64_t get_count() const noexcept
+        {
+            return total_;
+        }
+
+        [[nodiscard]] std::uint64_t get_max() const noexcept
+        {
+            return max_;
+        }
+
+        // The highest value equivalent to the one at quantile (0 to 1), within about 3%.
+        [[nodiscard]] std::uint64_t get_percentile(double quantile) const noexcept;
+    };
+
+    // Log-linear histogram in the style of HdrHistogram: 32 linear sub-buckets per power of two, so the relative
+    // error stays around 3% over the whole 64-bit range. Recording is wait-free and may race with readers.
+    class histogram
+    {
+    private:
+        static constexpr auto sub_bucket_bits{ histogram_snapshot::sub_bucket_bits };
+        static constexpr auto bucket_count{ histogram_snapshot::bucket_count };
+
+        std::array<std::atomic<std::uint64_t>, bucket_count> counts_;
+        std::atomic<std::uint64_t> total_;
+        std::atomic<std::uint64_t> max_;
+    public:
+        histogram() noexcept;
+
+        histogram(const histogram&) = delete;
+
+        histogram& operator=(const histogram&) = delete;
+
+        static std::size_t get_bucket_index(std::uint64_t value) noexcept;
+
+        static std::uint64_t get_bucket_limit(std::size_t index) noexcept;
+
+        void record(std::uint64_t value) noexcept;
+
+        // Not atomic with respect to concurrent recording.
+        void reset() noexcept;
+
+        void add_to(histogram_snapshot& snapshot) const noexcept;
+    };
+}
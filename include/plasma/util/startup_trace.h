@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace plasma::util
+{
+    class startup_trace;
+
+    // Times a step from construction until next() or destruction. Does nothing once the trace has been written.
+    class trace_span
+    {
+    private:
+        startup_trace* trace_;
+        std::string name_;
+        const char* category_;
+        std::chrono::steady_clock::time_point started_;
+    public:
+        trace_span(startup_trace* trace, std::string_view name, const char* category);
+
+        trace_span(trace_span&& other) noexcept;
+
+        trace_span(const trace_span&) = delete;
+
+        trace_span& operator=(const trace_span&) = delete;
+
+        trace_span& operator=(trace_span&&) = delete;
+
+        // Ends this step and starts timing the next one in the same category.
+        void next(std::string_view name);
+
+        void end();
+
+        ~trace_span();
+    };
+
+    // Records how long each step of startup takes, on whichever thread it runs, and writes them in the Chrome trace
+    // event format, which chrome://tracing and Perfetto open. Recording stops once the trace is written.
+    class startup_trace
+    {
+    private:
+        class trace_event
+        {
+        public:
+            std::string name;
+            const char* category;
+            std::uint32_t thread;
+            std::chrono::steady_clock::time_point started;
+            std::chrono::steady_clock::time_point finished;
+        };
+
+        std::chrono::steady_clock::time_point origin_;
+        std::atomic<bool> recording_;
+        std::mutex mutex_;
+        std::vector<trace_event> events_;
+        std::vector<std::thread::id> threads_;
+    public:
+        startup_trace();
+
+        startup_trace(const startup_trace&) = delete;
+
+        startup_trace& operator=(const startup_trace&) = delete;
+
+        [[nodiscard]] bool is_recording() const noexcept
+        {
+            return recording_.load(std::memory_order_relaxed);
+        }
+
+        // The category must outlive the trace, a string literal in practice.
+        [[nodiscard]] trace_span span(std::string_view name, const char* category);
+
+        void record(std::string_view name, const char* category, std::chrono::steady_clock::time_point started,
+            std::chrono::steady_clock::time_point finished);
+
+        [[nodiscard]] std::chrono::steady_clock::duration get_elapsed() const noexcept
+        {
+            return std::chrono::steady_clock::now() - origin_;
+        }
+
+        // Stops recording and writes everything recorded to a new file in the directory, which is returned.
+        std::filesystem::path write(const std::filesystem::path& directory);
+    };
+
+    // Starts timing on first use, which main() makes its first statement.
+    startup_trace& get_startup_trace() noexcept;
+}
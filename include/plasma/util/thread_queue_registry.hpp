@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <boost/thread/tss.hpp>
+
+namespace plasma::util
+{
+    // One single-producer queue per producing thread, drained by a single consumer.
+    // Producers only take the registry mutex the first time they touch it.
+    template<typename TQueue>
+    class thread_queue_registry
+    {
+    private:
+        std::size_t capacity_;
+        std::mutex mutex_;
+        std::vector<std::shared_ptr<TQueue>> queues_;
+        boost::thread_specific_ptr<std::shared_ptr<TQueue>> local_;
+    public:
+        explicit thread_queue_registry(std::size_t capacity) :
+            capacity_{ capacity }
+        {
+        }
+
+        thread_queue_registry(const thread_queue_registry&) = delete;
+
+        thread_queue_registry& operator=(const thread_queue_registry&) = delete;
+
+        [[nodiscard]] std::size_t capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        TQueue& local()
+        {
+            auto queue{ local_.get() };
+            if (!queue) [[unlikely]]
+            {
+                auto created{ std::make_shared<TQueue>(capacity_) };
+                {
+                    std::lock_guard lock{ mutex_ };
+                    queues_.push_back(created);
+                }
+                queue = new std::shared_ptr<TQueue>{ std::move(created) };
+                local_.reset(queue);
+            }
+            return **queue;
+        }
+
+        // Consumer side only. Queues whose producer thread has exited are released once empty.
+        template<typename TFunction>
+        void for_each(TFunction&& function)
+        {
+            std::vector<std::shared_ptr<TQueue>> snapshot{};
+            {
+                std::lock_guard lock{ mutex_ };
+                snapshot = queues_;
+            }
+            for (auto& queue : snapshot)
+            {
+                function(*queue);
+            }
+            snapshot.clear();
+
+            std::lock_guard lock{ mutex_ };
+            std::erase_if(queues_, [](const std::shared_ptr<TQueue>& queue)
+            {
+                return queue.use_count() == 1 && queue->read_available() == 0;
+            });
+        }
+
+        [[nodiscard]] std::size_t size()
+        {
+            std::lock_guard lock{ mutex_ };
+            return queues_.size();
+        }
+    };
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <plasma/world/chunk_saver.h>
+#include <plasma/world/region_file.h>
+#include <plasma/world/region_storage.h>
+
+namespace plasma::world
+{
+    class backup_progress
+    {
+    public:
+        bool running;
+        std::string name;
+        std::size_t chunks_total;
+        std::size_t chunks_done;
+        std::uint64_t objects_written;
+        std::uint64_t objects_reused;
+        std::uint64_t bytes_copied;
+        std::uint64_t bytes_cloned;
+    };
+
+    // Online backups into a content addressed store. Each chunk blob and each other world file is kept once under
+    // objects/ by its SHA-1, so a backup only costs what changed since the last one, plus a manifest under
+    // manifests/ naming every object. Region headers are snapshotted while chunk saves are paused; since region
+    // sectors are not reused while a snapshot holds them, the chunks can then be copied out at leisure while the
+    // server keeps ticking. The caller must hold the world's directory lock while the engine exists.
+    class backup_engine
+    {
+    private:
+        class region_entry
+        {
+        public:
+            std::int32_t x;
+            std::int32_t z;
+            std::filesystem::path path;
+            std::shared_ptr<region_file> region;
+            region_snapshot snapshot;
+            // External chunk files are rewritten rather than appended to, so they are read along with the snapshot.
+            std::map<std::size_t, std::vector<std::byte>> externals;
+        };
+
+        std::filesystem::path world_directory_;
+        std::filesystem::path backup_directory_;
+        region_storage& storage_;
+        chunk_saver& saver_;
+        std::uint64_t rate_;
+        std::mutex mutex_;
+        std::thread worker_;
+        std::string name_;
+        std::atomic<bool> running_;
+        std::atomic<bool> cancelled_;
+        std::atomic<std::size_t> chunks_total_;
+        std::atomic<std::size_t> chunks_done_;
+        std::atomic<std::uint64_t> objects_written_;
+        std::atomic<std::uint64_t> objects_reused_;
+        std::atomic<std::uint64_t> bytes_copied_;
+        std::atomic<std::uint64_t> bytes_cloned_;
+        std::chrono::steady_clock::time_point throttle_start_;
+        std::uint64_t throttled_bytes_;
+
+        // Sleeps to keep backup I/O under the configured rate and yields to pending chunk saves.
+        void throttle(std::uint64_t bytes);
+
+        void run(std::string name, std::vector<region_entry> regions, std::int64_t created);
+    public:
+        // rate is in bytes per second, 0 for unlimited.
+        backup_engine(std::filesystem::path world_directory, std::filesystem::path backup_directory,
+            region_storage& storage, chunk_saver& saver, std::uint64_t rate);
+
+        backup_engine(const backup_engine&) = delete;
+
+        backup_engine& operator=(const backup_engine&) = delete;
+
+        ~backup_engine();
+
+        // Snapshots the world on the calling thread and copies it in the background. Throws if a backup is running.
+        std::string start();
+
+        void cancel();
+
+        [[nodiscard]] backup_progress get_progress();
+    };
+
+    // Names of the backups in a backup directory, oldest first.
+    std::vector<std::string> list_backups(const std::filesystem::path& backup_directory);
+
+    // Rebuilds the world directory from a backup. The previous contents are moved to a sibling directory ending in
+    // .pre-restore. The caller must hold the world's directory lock, so that no server is running on it.
+    void restore_backup(const std::filesystem::path& world_directory, const std::filesystem::path& backup_directory,
+        const std::string& name);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <plasma/world/chunk_section.h>
+#include <plasma/world/nibble_array.h>
+
+namespace plasma::world
+{
+    // Revisions are unique across every chunk, so a revision identifies one state of one chunk even after the chunk
+    // was unloaded and loaded again.
+    std::uint64_t next_chunk_revision() noexcept;
+
+    // A 16x256x16 column of sections. Owned by the tick thread; anything else works on a copy.
+    class chunk
+    {
+    public:
+        static constexpr std::size_t section_count{ 16 };
+        // 1.16.5
+        static constexpr std::int32_t data_version{ 2586 };
+    private:
+        std::int32_t x_;
+        std::int32_t z_;
+        std::array<chunk_section, section_count> sections_;
+        // Null is dark. Arrays are never changed once published, so a copy of the pointer is a consistent snapshot.
+        std::array<std::shared_ptr<const nibble_array>, section_count> block_light_;
+        std::array<std::shared_ptr<const nibble_array>, section_count> sky_light_;
+        std::uint64_t revision_;
+        bool dirty_;
+        bool lit_;
+    public:
+        chunk(std::int32_t x, std::int32_t z);
+
+        [[nodiscard]] std::int32_t get_x() const noexcept
+        {
+            return x_;
+        }
+
+        [[nodiscard]] std::int32_t get_z() const noexcept
+        {
+            return z_;
+        }
+
+        [[nodiscard]] const chunk_section& get_section(std::size_t index) const noexcept
+        {
+            return sections_[index];
+        }
+
+        // Marks the chunk dirty, since the caller may change the section.
+        [[nodiscard]] chunk_section& get_section(std::size_t index) noexcept
+        {
+            dirty_ = true;
+            revision_ = next_chunk_revision();
+            return sections_[index];
+        }
+
+        // Coordinates are local to the chunk, y from 0 to 255.
+        [[nodiscard]] std::uint32_t get_block(std::uint32_t x, std::uint32_t y, std::uint32_t z) const noexcept
+        {
+            return sections_[y >> 4].get(x, y & 15, z);
+        }
+
+        std::uint32_t set_block(std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t state);
+
+        [[nodiscard]] const std::shared_ptr<const nibble_array>& get_block_light(std::size_t index) const noexcept
+        {
+            return block_light_[index];
+        }
+
+        [[nodiscard]] const std::shared_ptr<const nibble_array>& get_sky_light(std::size_t index) const noexcept
+        {
+            return sky_light_[index];
+        }
+
+        void set_block_light(std::size_t index, std::shared_ptr<const nibble_array> light) noexcept
+        {
+            block_light_[index] = std::move(light);
+            dirty_ = true;
+            revision_ = next_chunk_revision();
+        }
+
+        void set_sky_light(std::size_t index, std::shared_ptr<const nibble_array> light) noexcept
+        {
+            sky_light_[index] = std::move(light);
+            dirty_ = true;
+            revision_ = next_chunk_revision();
+        }
+
+        // Whether the light has been computed since the chunk was generated.
+        [[nodiscard]] bool is_lit() const noexcept
+        {
+            return lit_;
+        }
+
+        void set_lit(bool lit) noexcept
+        {
+            lit_ = lit;
+        }
+
+        // Changes whenever a section or its light may have changed.
+        [[nodiscard]] std::uint64_t get_revision() const noexcept
+        {
+            return revision_;
+        }
+
+        [[nodiscard]] bool is_dirty() const noexcept
+        {
+            return dirty_;
+        }
+
+        void set_dirty(bool dirty) noexcept
+        {
+            dirty_ = dirty;
+        }
+
+        // Bytes held by the chunk, palettes and packed data included.
+        [[nodiscard]] std::size_t get_memory_usage() const noexcept;
+
+        // Chunk NBT in the region file layout. Block states are stored by their global id in a StatePalette int
+        // array next to BlockStates, since there is no block registry to produce vanilla palettes from.
+        void serialize(std::vector<std::byte>& nbt) const;
+
+        static std::shared_ptr<chunk> deserialize(std::int32_t x, std::int32_t z, std::span<const std::byte> nbt);
+    };
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <plasma/job/job_system.h>
+#include <plasma/util/histogram.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/chunk_saver.h>
+#include <plasma/world/region_storage.h>
+
+namespace plasma::world
+{
+    class cache_statistics
+    {
+    public:
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t loads;
+        std::uint64_t failed_loads;
+        std::uint64_t evictions;
+        std::uint64_t prefetches;
+        std::uint64_t prefetch_hits;
+        std::size_t resident_chunks;
+        std::size_t resident_bytes;
+        std::size_t saving_chunks;
+        std::size_t saving_bytes;
+        std::size_t loading;
+        std::size_t ticketed;
+        std::uint64_t load_p50;
+        std::uint64_t load_p99;
+        std::uint64_t load_max;
+    };
+
+    // Keeps chunks resident while they hold tickets and, memory permitting, for a while after. Everything but the
+    // loading itself happens on the tick thread: loads run as jobs and their results are picked up by tick(), so
+    // the tick never waits on the disk. Unticketed chunks are evicted with the CLOCK algorithm once the resident
+    // bytes exceed the budget, and chunks in front of moving viewers are loaded before anyone asks for them.
+    class chunk_cache
+    {
+    public:
+        // Makes chunks that are not in the region files yet. Called from job workers.
+        using generator = std::function<std::shared_ptr<chunk>(std::int32_t x, std::int32_t z)>;
+        using load_listener = std::function<void(const std::shared_ptr<chunk>& loaded)>;
+    private:
+        enum class entry_state : std::uint8_t
+        {
+            loading,
+            loaded,
+            failed
+        };
+
+        class entry
+        {
+        public:
+            std::int32_t x;
+            std::int32_t z;
+            entry_state state;
+            bool referenced;
+            bool prefetched;
+            bool touched;
+            std::uint32_t tickets;
+            // Consecutive failed loads, which space out the retries of a ticketed chunk.
+            std::uint32_t failures;
+            std::chrono::steady_clock::time_point retry_at;
+            std::size_t bytes;
+            std::size_t clock_index;
+            std::shared_ptr<chunk> loaded;
+            job::job_handle job;
+        };
+
+        class completion
+        {
+        public:
+            std::uint64_t key;
+            std::shared_ptr<chunk> loaded;
+            std::chrono::nanoseconds latency;
+        };
+
+        class viewer
+        {
+        public:
+            double x;
+            double z;
+            double velocity_x;
+            double velocity_z;
+            std::int32_t radius;
+            std::int32_t predicted_x;
+            std::int32_t predicted_z;
+            bool predicted;
+            std::chrono::steady_clock::time_point updated;
+        };
+
+        region_storage& storage_;
+        chunk_saver& saver_;
+        job::job_system& jobs_;
+        generator generator_;
+        load_listener listener_;
+        std::size_t memory_budget_;
+        double prefetch_seconds_;
+        std::size_t max_prefetch_per_tick_;
+        std::unordered_map<std::uint64_t, entry> entries_;
+        std::vector<std::uint64_t> clock_;
+        std::size_t hand_;
+        std::unordered_map<std::uint64_t, std::shared_ptr<chunk>> saving_;
+        std::unordered_map<std::uint64_t, viewer> viewers_;
+        std::vector<std::uint64_t> touched_;
+        std::vector<std::uint64_t> failed_;
+        std::mutex completed_mutex_;
+        std::vector<completion> completed_;
+        std::size_t resident_bytes_;
+        std::size_t saving_bytes_;
+        std::size_t loading_;
+        std::size_t ticketed_;
+        std::size_t prefetch_allowance_;
+        std::uint64_t hits_;
+        std::uint64_t misses_;
+        std::uint64_t loads_;
+        std::uint64_t failed_loads_;
+        std::uint64_t evictions_;
+        std::uint64_t prefetches_;
+        std::uint64_t prefetch_hits_;
+        util::histogram load_latency_;
+
+        static std::uint64_t get_key(std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(z);
+        }
+
+        entry& request(std::int32_t x, std::int32_t z, bool prefetch);
+
+        void load(entry& target);
+
+        void integrate();
+
+        void retry_failed();
+
+        void release_saved();
+
+        bool offer_save(std::shared_ptr<const chunk> snapshot, std::size_t estimated_size);
+
+        void erase(std::uint64_t key);
+
+        void evict();
+
+        void prefetch(viewer& moving);
+    public:
+        chunk_cache(region_storage& storage, chunk_saver& saver, job::job_system& jobs, generator generate,
+            std::size_t memory_budget, double prefetch_seconds, std::size_t max_prefetch_per_tick);
+
+        chunk_cache(const chunk_cache&) = delete;
+
+        chunk_cache& operator=(const chunk_cache&) = delete;
+
+        ~chunk_cache();
+
+        // Tickets keep a chunk resident. Adding one starts loading the chunk if it is not already, and a ticketed chunk
+        // that fails to load is tried again with a growing delay.
+        void add_ticket(std::int32_t x, std::int32_t z);
+
+        void remove_ticket(std::int32_t x, std::int32_t z);
+
+        // The chunk if it is resident, otherwise nullptr and the chunk starts loading. Never blocks.
+        std::shared_ptr<chunk> get(std::int32_t x, std::int32_t z);
+
+        // The chunk if it is resident, without counting a lookup or starting a load.
+        [[nodiscard]] std::shared_ptr<chunk> find(std::int32_t x, std::int32_t z);
+
+        // Called on the tick thread for every chunk that finishes loading.
+        void set_load_listener(load_listener listener);
+
+        // Starts loading the chunk without counting a miss.
+        void preload(std::int32_t x, std::int32_t z);
+
+        // Positions are in blocks, the radius in chunks. The velocity is estimated from successive updates and used to
+        // load the chunks that will come into view where the viewer is heading.
+        void update_viewer(std::uint64_t id, double x, double z, std::int32_t radius);
+
+        void remove_viewer(std::uint64_t id);
+
+        // Once per tick: integrates finished loads, retries failed ones that are due, then evicts down to the memory
+        // budget.
+        void tick();
+
+        // Hands every dirty chunk to the saver, waiting for room when its budget is spent.
+        void save_all();
+
+        [[nodiscard]] cache_statistics get_statistics() const;
+    };
+}
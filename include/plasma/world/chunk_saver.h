@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <plasma/job/job_system.h>
+#include <plasma/world/region_file.h>
+#include <plasma/world/region_storage.h>
+
+namespace plasma::world
+{
+    class save_statistics
+    {
+    public:
+        std::size_t backlog_chunks;
+        std::size_t backlog_bytes;
+        std::uint64_t saved;
+        std::uint64_t superseded;
+        // Attempts to serialize or write a chunk that failed and were retried.
+        std::uint64_t failed;
+        // Chunks given up on while stopping.
+        std::uint64_t lost;
+        std::uint64_t batches;
+        std::uint64_t bytes_written;
+    };
+
+    // Saves chunks behind the tick thread. The tick thread hands over a snapshot, job workers serialize and compress
+    // it, and a writer thread appends everything queued for a region as one batch. A chunk that fails to serialize or
+    // write is retried with backoff and counts as saving until it succeeds, so the cache keeps the newer copy in
+    // memory. Only stop() gives up on one, retrying it without delay until it has failed max_attempts_when_stopping
+    // times in all. flush() retries the same way but stops waiting for such a chunk instead of dropping it. The caller
+    // must hold the world's directory lock while the saver runs, so that no second server writes the same regions.
+    class chunk_saver
+    {
+    public:
+        using serializer = std::function<void(std::vector<std::byte>& nbt)>;
+
+        static constexpr std::uint32_t max_attempts_when_stopping{ 3 };
+    private:
+        class pending_chunk
+        {
+        public:
+            std::int32_t x;
+            std::int32_t z;
+            std::uint64_t sequence;
+            std::uint32_t timestamp;
+            std::size_t reserved;
+            std::uint32_t attempts;
+            std::vector<std::byte> data;
+        };
+
+        class retry_entry
+        {
+        public:
+            std::chrono::steady_clock::time_point due;
+            pending_chunk chunk;
+            // Set when serializing failed, empty when only the write did.
+            serializer snapshot;
+        };
+
+        class chunk_tracking
+        {
+        public:
+            std::size_t pending;
+            std::uint64_t written;
+        };
+
+        region_storage& storage_;
+        job::job_system& jobs_;
+        std::size_t max_in_flight_;
+        std::mutex mutex_;
+        std::mutex write_gate_;
+        std::condition_variable work_condition_;
+        std::condition_variable idle_condition_;
+        std::map<std::pair<std::int32_t, std::int32_t>, std::vector<pending_chunk>> queues_;
+        std::unordered_map<std::uint64_t, chunk_tracking> tracking_;
+        std::vector<retry_entry> retries_;
+        std::uint64_t sequence_;
+        std::size_t in_flight_chunks_;
+        std::size_t in_flight_bytes_;
+        std::size_t flushing_;
+        bool running_;
+        bool stopping_;
+        std::atomic<std::uint64_t> saved_;
+        std::atomic<std::uint64_t> superseded_;
+        std::atomic<std::uint64_t> failed_;
+        std::atomic<std::uint64_t> lost_;
+        std::atomic<std::uint64_t> batches_;
+        std::atomic<std::uint64_t> bytes_written_;
+        std::thread writer_;
+
+        static std::uint64_t get_key(std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(z);
+        }
+
+        void serialize(pending_chunk chunk, serializer snapshot);
+
+        void enqueue(pending_chunk chunk);
+
+        // Called with the mutex held once a chunk has been written or dropped.
+        void finish(const pending_chunk& chunk, bool written);
+
+        // Called with the mutex held after a failed attempt.
+        void retry(pending_chunk chunk, serializer snapshot);
+
+        // Called with the mutex held. Chunks waiting to be retried after failing max_attempts_when_stopping times.
+        [[nodiscard]] std::size_t count_failing() const;
+
+        // Called with the mutex held on the writer thread. Queues due writes again and returns due serializations.
+        std::vector<retry_entry> take_due_retries();
+
+        void write_region(std::pair<std::int32_t, std::int32_t> region, const std::vector<pending_chunk>& chunks);
+
+        void run();
+    public:
+        chunk_saver(region_storage& storage, job::job_system& jobs, std::size_t max_in_flight);
+
+        chunk_saver(const chunk_saver&) = delete;
+
+        chunk_saver& operator=(const chunk_saver&) = delete;
+
+        ~chunk_saver();
+
+        // Call from the tick thread with a snapshot that is cheap to take. Returns false without taking it when the
+        // in-flight byte budget is spent, in which case the chunk should stay dirty and be offered again later.
+        bool save(std::int32_t x, std::int32_t z, std::size_t estimated_size, serializer snapshot);
+
+        // Blocks until everything handed over so far is on disk, or until the only chunks left have failed
+        // max_attempts_when_stopping times. Returns how many of those are left, 0 when everything was saved.
+        [[nodiscard]] std::size_t flush();
+
+        void stop();
+
+        // Runs function while no region is being written, so every region header it reads belongs to the same
+        // moment. Keep it short, saves queue up behind it.
+        template<typename TFunction>
+        void pause_writes(TFunction&& function)
+        {
+            std::lock_guard gate{ write_gate_ };
+            function();
+        }
+
+        // True while a save of the chunk has been handed over but not yet written, so reading it back from the
+        // region file would return older data.
+        [[nodiscard]] bool is_saving(std::int32_t x, std::int32_t z);
+
+        [[nodiscard]] save_statistics get_statistics();
+    };
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace plasma::world
+{
+    // A 16x16x16 block of block states in the 1.16.5 layout: a palette and big-endian longs whose entries never
+    // straddle two longs. The longs are kept in wire order, so writing a section is a copy.
+    class chunk_section
+    {
+    public:
+        static constexpr std::size_t volume{ 4096 };
+        // Bits of a state in the global palette, enough for every 1.16.5 block state.
+        static constexpr std::uint8_t global_bits{ 15 };
+        static constexpr std::uint8_t min_bits{ 4 };
+        static constexpr std::uint8_t max_palette_bits{ 8 };
+        static constexpr std::uint32_t air{ 0 };
+        static constexpr std::uint32_t void_air{ 9669 };
+        static constexpr std::uint32_t cave_air{ 9670 };
+    private:
+        // Zero while every block holds palette_[0].
+        std::uint8_t bits_;
+        std::uint8_t per_word_;
+        std::uint16_t non_air_;
+        std::vector<std::uint32_t> palette_;
+        std::vector<std::uint64_t> data_;
+
+        [[nodiscard]] std::uint32_t get_entry(std::size_t index) const noexcept;
+
+        void set_entry(std::size_t index, std::uint32_t value) noexcept;
+
+        void encode(const std::uint32_t* values, std::uint8_t bits);
+
+        void resize(std::uint8_t bits);
+    public:
+        explicit chunk_section(std::uint32_t state = air);
+
+        static constexpr bool is_air(std::uint32_t state) noexcept
+        {
+            return state == air || state == void_air || state == cave_air;
+        }
+
+        static constexpr std::size_t get_index(std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept
+        {
+            return (y << 8) | (z << 4) | x;
+        }
+
+        [[nodiscard]] std::uint32_t get(std::size_t index) const noexcept;
+
+        [[nodiscard]] std::uint32_t get(std::uint32_t x, std::uint32_t y, std::uint32_t z) const noexcept
+        {
+            return get(get_index(x, y, z));
+        }
+
+        // Returns the previous state. Grows the palette, and the entry width with it, as needed.
+        std::uint32_t set(std::size_t index, std::uint32_t state);
+
+        std::uint32_t set(std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t state)
+        {
+            return set(get_index(x, y, z), state);
+        }
+
+        void fill(std::uint32_t state);
+
+        void unpack(std::span<std::uint32_t, volume> states) const noexcept;
+
+        // Replaces every block and picks the narrowest palette for them.
+        void pack(std::span<const std::uint32_t, volume> states);
+
+        // Drops palette entries no block uses any more.
+        void compact();
+
+        // Takes a palette and its packed big-endian longs, as stored under Palette and BlockStates in region files.
+        void load(std::span<const std::uint32_t> palette, std::span<const std::byte> data);
+
+        [[nodiscard]] std::uint8_t get_bits() const noexcept
+        {
+            return bits_;
+        }
+
+        [[nodiscard]] std::span<const std::uint32_t> get_palette() const noexcept
+        {
+            return palette_;
+        }
+
+        // Empty in single value mode.
+        [[nodiscard]] std::span<const std::byte> get_data() const noexcept
+        {
+            return std::as_bytes(std::span{ data_ });
+        }
+
+        [[nodiscard]] std::uint16_t get_non_air_count() const noexcept
+        {
+            return non_air_;
+        }
+
+        [[nodiscard]] bool empty() const noexcept
+        {
+            return !non_air_;
+        }
+
+        [[nodiscard]] std::size_t get_network_size() const noexcept;
+
+        // Appends the section as it appears in the Chunk Data packet.
+        void write(std::vector<std::byte>& out) const;
+    };
+
+    const char* get_section_codec_name() noexcept;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <plasma/job/job_system.h>
+#include <plasma/world/chunk.h>
+
+namespace plasma::world
+{
+    class light_statistics
+    {
+    public:
+        std::size_t pending_chunks;
+        std::uint64_t processed_chunks;
+        std::uint64_t changes;
+        std::uint64_t relights;
+        std::uint64_t batches;
+        std::uint64_t sections_published;
+        std::uint64_t last_batch_nanoseconds;
+    };
+
+    // Block and sky light, updated in batches. Changes queue up during the tick; process() then runs a breadth-first
+    // search per changed chunk over the packed light of the 3x3 chunks around it. Light travels at most 15 blocks, so
+    // neighbourhoods whose centres are three chunks apart never touch, and the nine groups of chunks sharing their
+    // coordinates modulo three each run in parallel. Workers write copies of the sections they change, which the tick
+    // thread swaps in one section at a time; readers holding the old section never see a half-updated array.
+    class light_engine
+    {
+    public:
+        using chunk_lookup = std::function<std::shared_ptr<chunk>(std::int32_t x, std::int32_t z)>;
+    private:
+        class pending_chunk
+        {
+        public:
+            std::int32_t x;
+            std::int32_t z;
+            bool relight;
+            // Packed as y << 8 | z << 4 | x within the chunk.
+            std::vector<std::uint16_t> changes;
+        };
+
+        job::job_system& jobs_;
+        chunk_lookup lookup_;
+        std::unordered_map<std::uint64_t, pending_chunk> pending_;
+        std::uint64_t processed_chunks_;
+        std::uint64_t changes_;
+        std::uint64_t relights_;
+        std::uint64_t batches_;
+        std::uint64_t sections_published_;
+        std::uint64_t last_batch_nanoseconds_;
+
+        static std::uint64_t get_key(std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(z);
+        }
+    public:
+        light_engine(job::job_system& jobs, chunk_lookup lookup);
+
+        light_engine(const light_engine&) = delete;
+
+        light_engine& operator=(const light_engine&) = delete;
+
+        // Block coordinates of a block whose state has changed.
+        void queue_change(std::int32_t x, std::int32_t y, std::int32_t z);
+
+        // Computes the chunk's light from scratch, keeping the light its neighbours shine into it.
+        void queue_relight(std::int32_t chunk_x, std::int32_t chunk_z);
+
+        // Tick thread only. Updates at most max_chunks chunks, on the job workers unless parallel is false, and
+        // returns how many it updated. Chunks that are not resident are dropped from the queue.
+        std::size_t process(std::size_t max_chunks, bool parallel = true);
+
+        [[nodiscard]] light_statistics get_statistics() const noexcept;
+
+        // Light-blocking of a block state, from 0 for air to 15 for full blocks.
+        static std::uint8_t get_opacity(std::uint32_t state) noexcept;
+
+        static std::uint8_t get_emission(std::uint32_t state) noexcept;
+    };
+}
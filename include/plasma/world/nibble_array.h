@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace plasma::world
+{
+    // Four bits per block of a section, in the order and packing of the BlockLight and SkyLight arrays: the low
+    // nibble of each byte holds the even index.
+    class nibble_array
+    {
+    public:
+        static constexpr std::size_t size{ 2048 };
+    private:
+        std::array<std::uint8_t, size> data_;
+    public:
+        explicit nibble_array(std::uint8_t value = 0) noexcept;
+
+        explicit nibble_array(std::span<const std::byte, size> bytes) noexcept;
+
+        [[nodiscard]] std::uint8_t get(std::size_t index) const noexcept
+        {
+            return (data_[index >> 1] >> ((index & 1) << 2)) & 15;
+        }
+
+        void set(std::size_t index, std::uint8_t value) noexcept
+        {
+            auto shift{ (index & 1) << 2 };
+            auto& packed{ data_[index >> 1] };
+            packed = static_cast<std::uint8_t>((packed & ~(15 << shift)) | (value << shift));
+        }
+
+        [[nodiscard]] std::span<const std::byte, size> get_bytes() const noexcept
+        {
+            return std::span<const std::byte, size>{ reinterpret_cast<const std::byte*>(data_.data()), size };
+        }
+
+        [[nodiscard]] bool is_uniform(std::uint8_t value) const noexcept;
+
+        // One shared array of full light, for the open sky above the terrain.
+        static const std::shared_ptr<const nibble_array>& get_full() noexcept;
+    };
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+namespace plasma::world
+{
+    enum class chunk_compression : std::uint8_t
+    {
+        gzip = 1,
+        zlib = 2,
+        none = 3
+    };
+
+    // A read-only view of the region file, one per batch of writes. Readers keep it alive while they hold chunk data:
+    // sectors freed by a later batch are only reused once this view and every one before it is gone. Views share
+    // the memory mapping until the file grows.
+    class region_mapping
+    {
+    private:
+        std::shared_ptr<const boost::interprocess::mapped_region> region_;
+        std::shared_ptr<const region_mapping> successor_;
+    public:
+        explicit region_mapping(const std::filesystem::path& path);
+
+        explicit region_mapping(std::shared_ptr<const boost::interprocess::mapped_region> region) noexcept;
+
+        [[nodiscard]] std::span<const std::byte> get_bytes() const noexcept
+        {
+            return { static_cast<const std::byte*>(region_->get_address()), region_->get_size() };
+        }
+
+        [[nodiscard]] const std::shared_ptr<const boost::interprocess::mapped_region>& get_region() const noexcept
+        {
+            return region_;
+        }
+
+        // Keeps the next view alive as long as this one, so holding a view protects everything freed after it.
+        void set_successor(std::shared_ptr<const region_mapping> successor) noexcept
+        {
+            successor_ = std::move(successor);
+        }
+    };
+
+    class raw_chunk
+    {
+    public:
+        std::shared_ptr<const region_mapping> owner;
+        std::vector<std::byte> external;
+        std::span<const std::byte> data;
+        chunk_compression compression;
+    };
+
+    class chunk_write
+    {
+    public:
+        std::int32_t x;
+        std::int32_t z;
+        std::span<const std::byte> data;
+        chunk_compression compression;
+        std::uint32_t timestamp;
+    };
+
+    class region_snapshot;
+
+    // An Anvil region file holding 32x32 chunks. The header is parsed once on open; chunks are read straight out of
+    // a memory mapping and only inflated on request. Any number of threads may read while one thread writes, since
+    // writes only go to free sectors and then publish the new location. Trailing free sectors are cut off on open.
+    class region_file
+    {
+    public:
+        static constexpr std::size_t sector_size{ 4096 };
+        static constexpr std::size_t chunk_count{ 1024 };
+        static constexpr std::size_t max_sectors{ 255 };
+        // Locations keep the first sector in 24 bits.
+        static constexpr std::size_t max_file_sectors{ std::size_t{ 1 } << 24 };
+    private:
+        // Sectors of superseded chunks, reusable once nobody can still read them through view.
+        class freed_sectors
+        {
+        public:
+            std::weak_ptr<const region_mapping> view;
+            std::vector<std::uint32_t> locations;
+        };
+
+        std::filesystem::path path_;
+        std::array<std::atomic<std::uint32_t>, chunk_count> locations_;
+        std::array<std::atomic<std::uint32_t>, chunk_count> timestamps_;
+        std::atomic<std::shared_ptr<const region_mapping>> mapping_;
+        mutable std::mutex write_mutex_;
+        std::FILE* file_;
+        std::shared_ptr<region_mapping> latest_;
+        std::vector<bool> used_sectors_;
+        std::vector<freed_sectors> freed_;
+
+        static std::size_t get_index(std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::size_t>(x & 31) + static_cast<std::size_t>(z & 31) * 32;
+        }
+
+        void mark_sectors(std::uint32_t location, bool used);
+
+        // First fit among the free sectors, growing the file when none fit.
+        std::uint32_t allocate_sectors(std::uint32_t count);
+
+        void reclaim_sectors();
+    public:
+        // Missing files are created when writable, otherwise the region is treated as empty.
+        region_file(std::filesystem::path path, bool writable);
+
+        region_file(const region_file&) = delete;
+
+        region_file& operator=(const region_file&) = delete;
+
+        ~region_file();
+
+        [[nodiscard]] const std::filesystem::path& get_path() const noexcept
+        {
+            return path_;
+        }
+
+        // Where a chunk too large for the region goes.
+        [[nodiscard]] std::filesystem::path get_external_path(std::int32_t x, std::int32_t z) const;
+
+        // Chunk coordinates are taken modulo 32.
+        [[nodiscard]] bool contains(std::int32_t x, std::int32_t z) const noexcept;
+
+        [[nodiscard]] std::uint32_t get_timestamp(std::int32_t x, std::int32_t z) const noexcept;
+
+        // The compressed chunk payload, without copying unless it is stored in an external file.
+        [[nodiscard]] std::optional<raw_chunk> read_raw(std::int32_t x, std::int32_t z) const;
+
+        // Inflates the chunk NBT into out. Returns false when the chunk does not exist.
+        bool read(std::int32_t x, std::int32_t z, std::vector<std::byte>& out) const;
+
+        void write_raw(std::int32_t x, std::int32_t z, std::span<const std::byte> data, chunk_compression compression,
+            std::uint32_t timestamp);
+
+        // Waits for a write in progress; empty for a missing read-only region.
+        [[nodiscard]] region_snapshot snapshot();
+
+        // Writes every chunk to free sectors and syncs them to disk before the header points at them. Later writes of
+        // the same chunk win. Costs two syncs however many chunks there are. Throws once the file would need more
+        // sectors than a location can address.
+        void write_batch(std::span<const chunk_write> chunks);
+
+        void write(std::int32_t x, std::int32_t z, std::span<const std::byte> nbt, std::uint32_t timestamp);
+    };
+
+    // The header of a region file at one moment. The mapping keeps the sectors of every chunk the header points at
+    // from being reused, so they stay readable as they were.
+    class region_snapshot
+    {
+    public:
+        std::shared_ptr<const region_mapping> mapping;
+        std::array<std::uint32_t, region_file::chunk_count> locations;
+        std::array<std::uint32_t, region_file::chunk_count> timestamps;
+    };
+
+    void decompress_chunk(std::span<const std::byte> data, chunk_compression compression, std::vector<std::byte>& out);
+
+    void compress_chunk(std::span<const std::byte> nbt, std::vector<std::byte>& out);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <plasma/world/region_file.h>
+
+namespace plasma::world
+{
+    // Opens the region files of a dimension on demand and keeps them open.
+    class region_storage
+    {
+    private:
+        std::filesystem::path directory_;
+        bool writable_;
+        std::mutex mutex_;
+        std::map<std::pair<std::int32_t, std::int32_t>, std::shared_ptr<region_file>> regions_;
+    public:
+        region_storage(std::filesystem::path directory, bool writable);
+
+        region_storage(const region_storage&) = delete;
+
+        region_storage& operator=(const region_storage&) = delete;
+
+        [[nodiscard]] const std::filesystem::path& get_directory() const noexcept
+        {
+            return directory_;
+        }
+
+        // The region holding a chunk, or nullptr if its file does not exist and create is false.
+        std::shared_ptr<region_file> get_region(std::int32_t chunk_x, std::int32_t chunk_z, bool create = false);
+
+        bool read_chunk(std::int32_t chunk_x, std::int32_t chunk_z, std::vector<std::byte>& out);
+
+        void write_chunk(std::int32_t chunk_x, std::int32_t chunk_z, std::span<const std::byte> nbt,
+            std::uint32_t timestamp);
+
+        // Region coordinates of every region file on disk.
+        [[nodiscard]] std::vector<std::pair<std::int32_t, std::int32_t>> list_regions() const;
+    };
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+#include <plasma/world/chunk.h>
+
+namespace plasma::world
+{
+    // Height map terrain from octaves of 2D gradient noise. The noise is computed in fixed point, so a seed produces
+    // the same chunks bit for bit whichever kernel runs it and however the chunks are spread over threads.
+    class terrain_generator
+    {
+    public:
+        static constexpr std::int32_t sea_level{ 62 };
+        static constexpr std::size_t octave_count{ 6 };
+
+        // Block state ids of the 1.16.5 global palette.
+        static constexpr std::uint32_t stone{ 1 };
+        static constexpr std::uint32_t grass_block{ 9 };
+        static constexpr std::uint32_t dirt{ 10 };
+        static constexpr std::uint32_t bedrock{ 33 };
+        static constexpr std::uint32_t water{ 34 };
+        static constexpr std::uint32_t sand{ 66 };
+        static constexpr std::uint32_t gravel{ 68 };
+
+        // One octave samples a lattice of 2^shift blocks, shifted by an offset so the octaves' lattices do not line up.
+        class octave
+        {
+        public:
+            std::uint32_t salt;
+            std::int32_t shift;
+            std::int32_t offset_x;
+            std::int32_t offset_z;
+            std::int32_t amplitude;
+        };
+    private:
+        std::uint64_t seed_;
+        std::array<octave, octave_count> octaves_;
+    public:
+        explicit terrain_generator(std::uint64_t seed) noexcept;
+
+        [[nodiscard]] std::uint64_t get_seed() const noexcept
+        {
+            return seed_;
+        }
+
+        // Surface heights of a chunk's columns, indexed by z * 16 + x.
+        void get_heights(std::int32_t chunk_x, std::int32_t chunk_z,
+            std::span<std::int32_t, 256> heights) const noexcept;
+
+        // Safe to call from any number of threads at once. The chunk comes back dirty, as it is not on disk yet.
+        [[nodiscard]] std::shared_ptr<chunk> generate(std::int32_t chunk_x, std::int32_t chunk_z) const;
+    };
+
+    // Name of the noise kernel picked for this CPU.
+    const char* get_noise_codec_name() noexcept;
+}
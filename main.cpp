@@ -20,19 +20,15 @@
  * SOFTWARE.
  */
 
+#include <atomic>
+#include <cstddef>
 #include <iostream>
 #include <exception>
 #include <filesystem>
+#include <span>
 
 #include <boost/program_options.hpp>
-#include <boost/log/attributes.hpp>
-#include <boost/log/core.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/sinks/sync_frontend.hpp>
-#include <boost/log/sinks/text_ostream_backend.hpp>
-#include <boost/log/sinks/text_file_backend.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-#include <boost/log/support/date_time.hpp>
+#include <fmt/format.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -41,10 +37,13 @@
 #include <version.hpp>
 
 #include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/log/logging_system.h>
 #include <plasma/plugin/plugin_manager.h>
+#include <plasma/util/startup_trace.h>
 #include <plasma/plasma_server.h>
 
-bool g_color_enabled{ true };
+std::atomic<bool> g_color_enabled{ true };
 
 namespace
 {
@@ -55,123 +54,11 @@ namespace
         R"( |    |   |  |__/ __ \_\___ \|  Y Y  \/ __ \_)""\n"
         R"( |____|   |____(____  /____  >__|_|  (____  /)""\n"
         R"(                    \/     \/      \/     \/ )""\n" };
-
-#if !defined(NDEBUG) || defined(_DEBUG)
-    auto formatter{
-        boost::log::expressions::format("[%1%] [%2%:%3%] [%4%]: %5%")
-        % boost::log::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S")
-        % boost::log::expressions::attr<const char*>("File")
-        % boost::log::expressions::attr<int>("Line")
-        % boost::log::expressions::attr<boost::log::trivial::severity_level>("Severity")
-        % boost::log::expressions::message
-    };
-#else
-    auto formatter{
-        boost::log::expressions::format("[%1%] [%2%]: %3%")
-        % boost::log::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S")
-        % boost::log::expressions::attr<boost::log::trivial::severity_level>("Severity")
-        % boost::log::expressions::message
-    };
-#endif
-
-#ifdef _WIN32
-    bool enable_ansi_escape_sequence()
-    {
-        HANDLE handle_stderr{ GetStdHandle(STD_ERROR_HANDLE) };
-        if (handle_stderr == INVALID_HANDLE_VALUE)
-        {
-            return false;
-        }
-
-        DWORD mode{};
-        if (!GetConsoleMode(handle_stderr, &mode))
-        {
-            return false;
-        }
-
-        mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
-        if (!SetConsoleMode(handle_stderr, mode))
-        {
-            return false;
-        }
-        return true;
-    }
-#endif
-
-    void color_formatter(boost::log::record_view const& rec, boost::log::formatting_ostream& strm)
-    {
-        auto severity{ rec[boost::log::trivial::severity] };
-        if (severity && g_color_enabled)
-        {
-            switch (severity.get())
-            {
-            case boost::log::trivial::severity_level::trace:
-            case boost::log::trivial::severity_level::debug:
-                strm << "\x1b[0;90m";
-                break;
-            case boost::log::trivial::severity_level::info:
-                strm << "\x1b[0;37m";
-                break;
-            case boost::log::trivial::severity_level::warning:
-                strm << "\x1b[0;33m";
-                break;
-            case boost::log::trivial::severity_level::error:
-                strm << "\x1b[0;31m";
-                break;
-            case boost::log::trivial::severity_level::fatal:
-                strm << "\x1b[0;91m";
-                break;
-            default:
-                break;
-            }
-        }
-        formatter(rec, strm);
-        if (severity && g_color_enabled)
-        {
-            strm << "\x1b[0m";
-        }
-    }
-
-    void initialize_logging_system()
-    {
-        boost::log::add_common_attributes();
-        auto console_sink{ boost::make_shared<boost::log::sinks::synchronous_sink<boost::log::sinks::text_ostream_backend>>() };
-        console_sink->set_formatter(&color_formatter);
-        console_sink->locked_backend()->add_stream(plasma::log::clog_stream_ptr);
-
-        std::filesystem::create_directory("./logs");
-        auto file_sink{ boost::make_shared<boost::log::sinks::synchronous_sink<boost::log::sinks::text_file_backend>>(
-            boost::log::keywords::target = "./logs",
-            boost::log::keywords::file_name = "./logs/log_%N.log",
-            boost::log::keywords::rotation_size = 10 * 1024 * 1024,
-            boost::log::keywords::auto_flush = true,
-            boost::log::keywords::time_based_rotation = boost::log::sinks::file::rotation_at_time_point(0, 0, 0)
-        ) };
-        file_sink->set_formatter(formatter);
-        file_sink->locked_backend()->set_file_collector(boost::log::sinks::file::make_collector(boost::log::keywords::target = "./logs"));
-        file_sink->locked_backend()->scan_for_files();
-#if !defined(NDEBUG) || defined(_DEBUG)
-        boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::trace);
-#else
-        boost::log::core::get()->set_filter(boost::log::trivial::severity >= boost::log::trivial::info);
-#endif
-        boost::log::core::get()->add_thread_attribute("File", boost::log::attributes::mutable_constant<const char*>(""));
-        boost::log::core::get()->add_thread_attribute("Line", boost::log::attributes::mutable_constant<int>(0));
-        boost::log::core::get()->add_sink(console_sink);
-        boost::log::core::get()->add_sink(file_sink);
-#ifdef _WIN32
-        if (!enable_ansi_escape_sequence())
-        {
-            g_color_enabled = false;
-            logger lg{};
-            WRN(lg) << "Failed to enable Win32 ANSI escape sequence support, colorful console output will be disabled";
-        }
-#endif
-    }
 }
 
 int main(const int argc, const char* argv[])
 {
+    auto& trace{ plasma::util::get_startup_trace() };
 #ifdef _WIN32
     SetConsoleCP(CP_UTF8);
     SetConsoleOutputCP(CP_UTF8);
@@ -181,24 +68,22 @@ int main(const int argc, const char* argv[])
     std::cout << plasma_logo;
 #endif
 
-    initialize_logging_system();
+    auto step{ trace.span("initialize logging", "main") };
+    plasma::log::initialize_logging_system();
     logger lg{};
-    TRC(lg) << "Logging system initialized";
+    TRCF(lg, "Logging system initialized");
 
-    INF(lg) << g_full_version_string;
+    INFF(lg, "{}", g_full_version_string);
 
-    {
-        std::stringstream ss{};
-        for (int i{}; i < argc; ++i)
-        {
-            ss << argv[i] << " ";
-        }
-        DBG(lg) << "Console argument: " << ss.str();
-    }
+    DBGF(lg, "Console argument: {}", fmt::join(std::span{ argv, static_cast<std::size_t>(argc) }, " "));
+    step.next("parse options");
     boost::program_options::options_description desc{ "Plasma: Usage" };
     desc.add_options()
         ("help", "Show the help")
-        ("init", "Initialize configurations only");
+        ("init", "Initialize configurations only")
+        ("restore", boost::program_options::value<std::string>(), "Restore the world from the named backup and exit")
+        ("pregenerate", boost::program_options::value<std::int32_t>(),
+            "Generate and save the chunks within the given radius in chunks of spawn and exit");
     boost::program_options::variables_map vm{};
     try
     {
@@ -207,7 +92,7 @@ int main(const int argc, const char* argv[])
     }
     catch (const std::exception& e)
     {
-        FTL(lg) << "Failed to parse command line: " << e.what();
+        FTLF(lg, "Failed to parse command line: {}", e.what());
         return 1;
     }
 
@@ -217,7 +102,18 @@ int main(const int argc, const char* argv[])
         return 1;
     }
 
-    plasma::plugin::plugin_manager manager{};
-    manager.load_plugin(new plasma::plasma_server{ std::move(vm) });
-    return 0;
+    step.next("load server");
+    auto exit_code{ 1 };
+    {
+        // Unloading the plugins destroys the server, which still logs, so the manager goes before logging does.
+        plasma::plugin::plugin_manager manager{};
+        auto server{ new plasma::plasma_server{ std::move(vm) } };
+        if (manager.load_plugin(server))
+        {
+            step.end();
+            exit_code = server->run();
+        }
+    }
+    plasma::log::shutdown_logging_system();
+    return exit_code;
 }
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <chrono>
+#include <exception>
+#include <string_view>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/config/config_watcher.h>
+
+namespace plasma::config
+{
+    config_watcher::config_watcher(const plasma_config& initial) :
+        running_{}, descriptor_{ -1 }, reloads_{}
+    {
+        snapshots_.push_back(std::make_unique<const plasma_config>(initial));
+        current_.store(snapshots_.back().get(), std::memory_order_release);
+        notified_ = snapshots_.back().get();
+    }
+
+    config_watcher::~config_watcher()
+    {
+        stop();
+    }
+
+    void config_watcher::start()
+    {
+#ifdef __linux__
+        logger lg{};
+        const auto& path{ get().get_file_path() };
+        auto directory{ path.parent_path() };
+        descriptor_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (descriptor_ < 0 || ::inotify_add_watch(descriptor_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            auto error{ errno };
+            WRNF(lg, "Failed to watch {} for configuration changes: {}", directory.string(), std::strerror(error));
+            if (descriptor_ >= 0)
+            {
+                ::close(descriptor_);
+                descriptor_ = -1;
+            }
+            return;
+        }
+        running_.store(true, std::memory_order_release);
+        watcher_ = std::thread{ &config_watcher::run, this };
+#endif
+    }
+
+    void config_watcher::stop()
+    {
+        if (!running_.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        watcher_.join();
+#ifdef __linux__
+        ::close(descriptor_);
+        descriptor_ = -1;
+#endif
+    }
+
+    void config_watcher::run()
+    {
+#ifdef __linux__
+        auto name{ get().get_file_path().filename().string() };
+        alignas(inotify_event) std::array<char, 4096> buffer{};
+        // True when an event in the buffer names the configuration file.
+        auto drain{ [this, &name, &buffer]
+        {
+            auto changed{ false };
+            ssize_t length{};
+            while ((length = ::read(descriptor_, buffer.data(), buffer.size())) > 0)
+            {
+                for (auto offset{ static_cast<ssize_t>(0) }; offset < length;)
+                {
+                    const auto* event{ reinterpret_cast<const inotify_event*>(buffer.data() + offset) };
+                    changed = changed || (event->len && std::string_view{ event->name } == name);
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+            }
+            return changed;
+        } };
+        while (running_.load(std::memory_order_acquire))
+        {
+            pollfd watched{ .fd = descriptor_, .events = POLLIN, .revents = 0 };
+            if (::poll(&watched, 1, 250) <= 0 || !drain())
+            {
+                continue;
+            }
+            // Editors tend to write in several steps, so let them finish before reading.
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+            drain();
+            reload();
+        }
+#endif
+    }
+
+    bool config_watcher::reload()
+    {
+        logger lg{};
+        std::lock_guard lock{ mutex_ };
+        auto loaded{ std::make_unique<plasma_config>(get()) };
+        try
+        {
+            if (!loaded->reload())
+            {
+                return false;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            WRNF(lg, "Failed to reload {}, keeping the current settings: {}", loaded->get_file_path().string(), e.what());
+            return false;
+        }
+        current_.store(loaded.get(), std::memory_order_release);
+        snapshots_.push_back(std::move(loaded));
+        reloads_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void config_watcher::add_listener(listener function)
+    {
+        listeners_.push_back(std::move(function));
+    }
+
+    void config_watcher::poll()
+    {
+        auto current{ current_.load(std::memory_order_acquire) };
+        if (current == notified_) [[likely]]
+        {
+            return;
+        }
+        auto previous{ notified_ };
+        notified_ = current;
+        for (const auto& function : listeners_)
+        {
+            function(*previous, *current);
+        }
+    }
+}
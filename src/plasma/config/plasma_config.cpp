@@ -20,6 +20,7 @@
  * SOFTWARE.
  */
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 
@@ -27,6 +28,7 @@
 #include <boost/property_tree/info_parser.hpp>
 
 #include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
 #include <plasma/config/plasma_config.h>
 
 namespace plasma::config
@@ -36,48 +38,215 @@ namespace plasma::config
         file_path_ = "./configs/plasma.info";
         logging =
         {
-            .color_enabled = true
+            .color_enabled = true,
+            .async =
+            {
+                .enabled = false,
+                .queue_capacity = 8192,
+                .overflow_policy = "block",
+                .flush_interval_ms = 5
+            },
+            .binary =
+            {
+                .enabled = false,
+                .queue_bytes = 1024 * 1024,
+                .rotation_size = 10 * 1024 * 1024,
+                .console_severity = "info"
+            }
+        };
+        network =
+        {
+            .bind_address = "0.0.0.0",
+            .port = 25565,
+            .reactor_threads = 0,
+            .inbound_queue_capacity = 65536,
+            .motd = "A Plasma Server",
+            .max_players = 20,
+            .chunk_packet_cache_size = 64 * 1024 * 1024,
+            .status =
+            {
+                .favicon = "./server-icon.png",
+                .requests_per_second = 2,
+                .burst = 10
+            },
+            .compression =
+            {
+                .threshold = 256,
+                .level = 6,
+                .offload_size = 64 * 1024
+            }
+        };
+        tick =
+        {
+            .rate = 20,
+            .overrun_policy = "catch_up",
+            .max_catch_up = 20
+        };
+        jobs =
+        {
+            .workers = 0,
+            .affinity = false
+        };
+        metrics =
+        {
+            .enabled = true,
+            .segment = "plasma-metrics"
         };
         world =
         {
             .storage =
             {
                 .base_dir = ".",
-                .backup_dir = "./backups"
+                .backup_dir = "./backups",
+                .max_in_flight = 64 * 1024 * 1024,
+                .backup_rate = 32 * 1024 * 1024
             },
-            .name = "world"
+            .cache =
+            {
+                .memory_budget = 512 * 1024 * 1024,
+                .prefetch_seconds = 3.0,
+                .max_prefetch_per_tick = 32
+            },
+            .light =
+            {
+                .max_chunks_per_tick = 128
+            },
+            .entities =
+            {
+                .view_distance = 48.0
+            },
+            .name = "world",
+            .seed = std::chrono::system_clock::now().time_since_epoch().count(),
+            .spawn_radius = 10
         };
     }
 
-    void plasma_config::load()
+    void plasma_config::read(const boost::property_tree::ptree& tree)
     {
-        if (!exists(file_path_))
-        {
-            logger lg{};
-            WRN(lg) << "Failed to find " << file_path_ << ", initializing a new one";
-            save();
-        }
-        boost::property_tree::ptree tree{};
-        boost::property_tree::read_info(file_path_.string(), tree);
-
         logging.color_enabled = tree.get<bool>("logging.color_enabled", logging.color_enabled);
+        logging.async.enabled = tree.get<bool>("logging.async.enabled", logging.async.enabled);
+        logging.async.queue_capacity = tree.get<std::size_t>("logging.async.queue_capacity", logging.async.queue_capacity);
+        logging.async.overflow_policy = tree.get<std::string>("logging.async.overflow_policy", logging.async.overflow_policy);
+        logging.async.flush_interval_ms = tree.get<std::uint32_t>("logging.async.flush_interval_ms", logging.async.flush_interval_ms);
+        logging.binary.enabled = tree.get<bool>("logging.binary.enabled", logging.binary.enabled);
+        logging.binary.queue_bytes = tree.get<std::size_t>("logging.binary.queue_bytes", logging.binary.queue_bytes);
+        logging.binary.rotation_size = tree.get<std::uintmax_t>("logging.binary.rotation_size", logging.binary.rotation_size);
+        logging.binary.console_severity = tree.get<std::string>("logging.binary.console_severity", logging.binary.console_severity);
+        network.bind_address = tree.get<std::string>("network.bind_address", network.bind_address);
+        network.port = tree.get<std::uint16_t>("network.port", network.port);
+        network.reactor_threads = tree.get<std::size_t>("network.reactor_threads", network.reactor_threads);
+        network.inbound_queue_capacity = tree.get<std::size_t>("network.inbound_queue_capacity", network.inbound_queue_capacity);
+        network.motd = tree.get<std::string>("network.motd", network.motd);
+        network.max_players = tree.get<std::uint32_t>("network.max_players", network.max_players);
+        network.chunk_packet_cache_size = tree.get<std::size_t>("network.chunk_packet_cache_size",
+            network.chunk_packet_cache_size);
+        network.status.favicon = tree.get<std::string>("network.status.favicon", network.status.favicon.string());
+        network.status.requests_per_second = tree.get<double>("network.status.requests_per_second", network.status.requests_per_second);
+        network.status.burst = tree.get<double>("network.status.burst", network.status.burst);
+        network.compression.threshold = tree.get<std::int32_t>("network.compression.threshold", network.compression.threshold);
+        network.compression.level = tree.get<std::int32_t>("network.compression.level", network.compression.level);
+        network.compression.offload_size = tree.get<std::size_t>("network.compression.offload_size", network.compression.offload_size);
+        tick.rate = tree.get<std::uint32_t>("tick.rate", tick.rate);
+        tick.overrun_policy = tree.get<std::string>("tick.overrun_policy", tick.overrun_policy);
+        tick.max_catch_up = tree.get<std::uint64_t>("tick.max_catch_up", tick.max_catch_up);
+        jobs.workers = tree.get<std::size_t>("jobs.workers", jobs.workers);
+        jobs.affinity = tree.get<bool>("jobs.affinity", jobs.affinity);
+        metrics.enabled = tree.get<bool>("metrics.enabled", metrics.enabled);
+        metrics.segment = tree.get<std::string>("metrics.segment", metrics.segment);
         world.storage.base_dir = tree.get<std::string>("world.storage.base_dir", world.storage.base_dir.string());
         world.storage.backup_dir = tree.get<std::string>("world.storage.backup_dir", world.storage.backup_dir.string());
+        world.storage.max_in_flight = tree.get<std::size_t>("world.storage.max_in_flight", world.storage.max_in_flight);
+        world.storage.backup_rate = tree.get<std::uint64_t>("world.storage.backup_rate", world.storage.backup_rate);
+        world.cache.memory_budget = tree.get<std::size_t>("world.cache.memory_budget", world.cache.memory_budget);
+        world.cache.prefetch_seconds = tree.get<double>("world.cache.prefetch_seconds", world.cache.prefetch_seconds);
+        world.cache.max_prefetch_per_tick = tree.get<std::size_t>("world.cache.max_prefetch_per_tick",
+            world.cache.max_prefetch_per_tick);
+        world.light.max_chunks_per_tick = tree.get<std::size_t>("world.light.max_chunks_per_tick",
+            world.light.max_chunks_per_tick);
+        world.entities.view_distance = tree.get<double>("world.entities.view_distance", world.entities.view_distance);
         world.name = tree.get<std::string>("world.name", world.name);
-
-        save();
+        world.seed = tree.get<std::int64_t>("world.seed", world.seed);
+        world.spawn_radius = tree.get<std::int32_t>("world.spawn_radius", world.spawn_radius);
     }
 
-    void plasma_config::save()
+    boost::property_tree::ptree plasma_config::write() const
     {
         boost::property_tree::ptree tree{};
 
         tree.put("logging.color_enabled", logging.color_enabled);
+        tree.put("logging.async.enabled", logging.async.enabled);
+        tree.put("logging.async.queue_capacity", logging.async.queue_capacity);
+        tree.put("logging.async.overflow_policy", logging.async.overflow_policy);
+        tree.put("logging.async.flush_interval_ms", logging.async.flush_interval_ms);
+        tree.put("logging.binary.enabled", logging.binary.enabled);
+        tree.put("logging.binary.queue_bytes", logging.binary.queue_bytes);
+        tree.put("logging.binary.rotation_size", logging.binary.rotation_size);
+        tree.put("logging.binary.console_severity", logging.binary.console_severity);
+        tree.put("network.bind_address", network.bind_address);
+        tree.put("network.port", network.port);
+        tree.put("network.reactor_threads", network.reactor_threads);
+        tree.put("network.inbound_queue_capacity", network.inbound_queue_capacity);
+        tree.put("network.motd", network.motd);
+        tree.put("network.max_players", network.max_players);
+        tree.put("network.chunk_packet_cache_size", network.chunk_packet_cache_size);
+        tree.put("network.status.favicon", network.status.favicon.string());
+        tree.put("network.status.requests_per_second", network.status.requests_per_second);
+        tree.put("network.status.burst", network.status.burst);
+        tree.put("network.compression.threshold", network.compression.threshold);
+        tree.put("network.compression.level", network.compression.level);
+        tree.put("network.compression.offload_size", network.compression.offload_size);
+        tree.put("tick.rate", tick.rate);
+        tree.put("tick.overrun_policy", tick.overrun_policy);
+        tree.put("tick.max_catch_up", tick.max_catch_up);
+        tree.put("jobs.workers", jobs.workers);
+        tree.put("jobs.affinity", jobs.affinity);
+        tree.put("metrics.enabled", metrics.enabled);
+        tree.put("metrics.segment", metrics.segment);
         tree.put("world.storage.base_dir", world.storage.base_dir.string());
         tree.put("world.storage.backup_dir", world.storage.backup_dir.string());
+        tree.put("world.storage.max_in_flight", world.storage.max_in_flight);
+        tree.put("world.storage.backup_rate", world.storage.backup_rate);
+        tree.put("world.cache.memory_budget", world.cache.memory_budget);
+        tree.put("world.cache.prefetch_seconds", world.cache.prefetch_seconds);
+        tree.put("world.cache.max_prefetch_per_tick", world.cache.max_prefetch_per_tick);
+        tree.put("world.light.max_chunks_per_tick", world.light.max_chunks_per_tick);
+        tree.put("world.entities.view_distance", world.entities.view_distance);
         tree.put("world.name", world.name);
+        tree.put("world.seed", world.seed);
+        tree.put("world.spawn_radius", world.spawn_radius);
+        return tree;
+    }
+
+    void plasma_config::load()
+    {
+        if (!exists(file_path_))
+        {
+            logger lg{};
+            WRNF(lg, "Failed to find {}, initializing a new one", file_path_.string());
+            save();
+        }
+        boost::property_tree::ptree tree{};
+        boost::property_tree::read_info(file_path_.string(), tree);
+        read(tree);
+        // Only rewritten to add missing settings or normalize values, so an unchanged file keeps its timestamp.
+        if (write() != tree)
+        {
+            save();
+        }
+    }
 
+    bool plasma_config::reload()
+    {
+        boost::property_tree::ptree tree{};
+        boost::property_tree::read_info(file_path_.string(), tree);
+        auto previous{ write() };
+        read(tree);
+        return write() != previous;
+    }
+
+    void plasma_config::save()
+    {
         create_directories(file_path_.parent_path());
-        write_info(file_path_.string(), tree);
+        write_info(file_path_.string(), write());
     }
 }
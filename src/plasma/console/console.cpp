@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/console/console.h>
+
+namespace plasma::console
+{
+    console::console() :
+        input_{ std::make_shared<input>() }
+    {
+        register_command("help", "Lists every command", [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            for (const auto& [name, command] : commands_)
+            {
+                INFF(lg, "{}: {}", name, command.description);
+            }
+        });
+    }
+
+    void console::register_command(std::string name, std::string description, command_handler handler)
+    {
+        commands_.insert_or_assign(std::move(name), command{ std::move(description), std::move(handler) });
+    }
+
+    void console::start()
+    {
+        // Blocking reads cannot be interrupted portably, so the reader is detached and only holds the shared input.
+        std::thread{ [input = input_]
+        {
+            std::string line{};
+            while (std::getline(std::cin, line))
+            {
+                std::lock_guard lock{ input->mutex };
+                input->lines.push_back(std::move(line));
+            }
+        } }.detach();
+    }
+
+    std::size_t console::poll()
+    {
+        std::deque<std::string> lines{};
+        {
+            std::lock_guard lock{ input_->mutex };
+            if (input_->lines.empty())
+            {
+                return 0;
+            }
+            std::swap(lines, input_->lines);
+        }
+        for (const auto& line : lines)
+        {
+            execute(line);
+        }
+        return lines.size();
+    }
+
+    void console::execute(std::string_view line)
+    {
+        std::vector<std::string_view> arguments{};
+        std::size_t position{};
+        while (position < line.size())
+        {
+            auto start{ line.find_first_not_of(" \t\r", position) };
+            if (start == std::string_view::npos)
+            {
+                break;
+            }
+            auto end{ line.find_first_of(" \t\r", start) };
+            end = end == std::string_view::npos ? line.size() : end;
+            arguments.push_back(line.substr(start, end - start));
+            position = end;
+        }
+        if (arguments.empty())
+        {
+            return;
+        }
+        logger lg{};
+        auto found{ commands_.find(arguments.front()) };
+        if (found == commands_.end())
+        {
+            WRNF(lg, "Unknown command {}, type help for a list of commands", arguments.front());
+            return;
+        }
+        try
+        {
+            found->second.handler(std::span<const std::string_view>{ arguments }.subspan(1));
+        }
+        catch (const std::exception& e)
+        {
+            ERRF(lg, "Command {} failed: {}", arguments.front(), e.what());
+        }
+    }
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <plasma/entity/entity_store.h>
+
+namespace plasma::entity
+{
+    entity_store::entity_store(std::int32_t cell_size) :
+        cell_shift_{}, max_half_width_{}, next_network_id_{ 1 }, random_{ std::random_device{}() }, created_{},
+        destroyed_{}, cell_moves_{}
+    {
+        if (cell_size <= 0 || !std::has_single_bit(static_cast<std::uint32_t>(cell_size)))
+        {
+            throw std::invalid_argument{ "Entity grid cell size must be a power of two" };
+        }
+        cell_shift_ = std::countr_zero(static_cast<std::uint32_t>(cell_size));
+    }
+
+    std::int32_t entity_store::get_cell(double coordinate) const noexcept
+    {
+        return static_cast<std::int32_t>(std::floor(coordinate)) >> cell_shift_;
+    }
+
+    std::uint64_t entity_store::get_cell_key(std::int32_t x, std::int32_t z) noexcept
+    {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(z);
+    }
+
+    void entity_store::insert_into_cell(std::uint32_t index, std::uint64_t key)
+    {
+        auto& members{ cells_[key] };
+        cell_key_[index] = key;
+        cell_slot_[index] = static_cast<std::uint32_t>(members.size());
+        members.push_back(index);
+    }
+
+    void entity_store::remove_from_cell(std::uint32_t index)
+    {
+        auto found{ cells_.find(cell_key_[index]) };
+        auto& members{ found->second };
+        auto position{ cell_slot_[index] };
+        auto last{ members.back() };
+        members[position] = last;
+        cell_slot_[last] = position;
+        members.pop_back();
+        if (members.empty())
+        {
+            cells_.erase(found);
+        }
+    }
+
+    template<typename TVisitor>
+    void entity_store::visit_cells(double min_x, double min_z, double max_x, double max_z, TVisitor&& visitor) const
+    {
+        auto first_x{ get_cell(min_x) };
+        auto first_z{ get_cell(min_z) };
+        auto last_x{ get_cell(max_x) };
+        auto last_z{ get_cell(max_z) };
+        for (auto cell_x{ first_x }; cell_x <= last_x; ++cell_x)
+        {
+            for (auto cell_z{ first_z }; cell_z <= last_z; ++cell_z)
+            {
+                auto found{ cells_.find(get_cell_key(cell_x, cell_z)) };
+                if (found != cells_.end())
+                {
+                    visitor(found->second);
+                }
+            }
+        }
+    }
+
+    entity_id entity_store::create(std::int32_t type, double x, double y, double z, float width, float height)
+    {
+        std::uint32_t slot_index{};
+        if (free_slots_.empty())
+        {
+            slot_index = static_cast<std::uint32_t>(slots_.size());
+            slots_.push_back({ invalid_index, 0 });
+        }
+        else
+        {
+            slot_index = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        auto index{ static_cast<std::uint32_t>(size()) };
+        slots_[slot_index].dense = index;
+        slot_of_.push_back(slot_index);
+        x_.push_back(x);
+        y_.push_back(y);
+        z_.push_back(z);
+        velocity_x_.push_back(0.0);
+        velocity_y_.push_back(0.0);
+        velocity_z_.push_back(0.0);
+        half_width_.push_back(width / 2);
+        height_.push_back(height);
+        flags_.push_back(0);
+        type_.push_back(type);
+        network_id_.push_back(next_network_id_++);
+        yaw_.push_back(0.0f);
+        pitch_.push_back(0.0f);
+
+        // Random version 4 UUID, as vanilla assigns to non-player entities.
+        std::array<std::uint8_t, 16> uuid{};
+        for (std::size_t i{}; i < uuid.size(); i += 8)
+        {
+            auto bits{ random_() };
+            for (std::size_t j{}; j < 8; ++j)
+            {
+                uuid[i + j] = static_cast<std::uint8_t>(bits >> (j * 8));
+            }
+        }
+        uuid[6] = static_cast<std::uint8_t>((uuid[6] & 0x0F) | 0x40);
+        uuid[8] = static_cast<std::uint8_t>((uuid[8] & 0x3F) | 0x80);
+        uuid_.push_back(uuid);
+
+        cell_key_.push_back(0);
+        cell_slot_.push_back(0);
+        insert_into_cell(index, get_cell_key(get_cell(x), get_cell(z)));
+        for (auto& [name, column] : components_)
+        {
+            column->push();
+        }
+        max_half_width_ = std::max(max_half_width_, width / 2);
+        ++created_;
+        return { slot_index, slots_[slot_index].generation };
+    }
+
+    bool entity_store::destroy(entity_id id)
+    {
+        auto index{ get_index(id) };
+        if (index == invalid_index)
+        {
+            return false;
+        }
+        remove_from_cell(index);
+        auto last{ static_cast<std::uint32_t>(size() - 1) };
+        if (index != last)
+        {
+            slot_of_[index] = slot_of_[last];
+            slots_[slot_of_[index]].dense = index;
+            x_[index] = x_[last];
+            y_[index] = y_[last];
+            z_[index] = z_[last];
+            velocity_x_[index] = velocity_x_[last];
+            velocity_y_[index] = velocity_y_[last];
+            velocity_z_[index] = velocity_z_[last];
+            half_width_[index] = half_width_[last];
+            height_[index] = height_[last];
+            flags_[index] = flags_[last];
+            type_[index] = type_[last];
+            network_id_[index] = network_id_[last];
+            yaw_[index] = yaw_[last];
+            pitch_[index] = pitch_[last];
+            uuid_[index] = uuid_[last];
+            cell_key_[index] = cell_key_[last];
+            cell_slot_[index] = cell_slot_[last];
+            cells_.find(cell_key_[index])->second[cell_slot_[index]] = index;
+        }
+        slot_of_.pop_back();
+        x_.pop_back();
+        y_.pop_back();
+        z_.pop_back();
+        velocity_x_.pop_back();
+        velocity_y_.pop_back();
+        velocity_z_.pop_back();
+        half_width_.pop_back();
+        height_.pop_back();
+        flags_.pop_back();
+        type_.pop_back();
+        network_id_.pop_back();
+        yaw_.pop_back();
+        pitch_.pop_back();
+        uuid_.pop_back();
+        cell_key_.pop_back();
+        cell_slot_.pop_back();
+        for (auto& [name, column] : components_)
+        {
+            column->remove(index);
+        }
+
+        auto& freed{ slots_[id.index] };
+        freed.dense = invalid_index;
+        ++freed.generation;
+        free_slots_.push_back(id.index);
+        ++destroyed_;
+        return true;
+    }
+
+    bool entity_store::contains(entity_id id) const noexcept
+    {
+        return get_index(id) != invalid_index;
+    }
+
+    std::uint32_t entity_store::get_index(entity_id id) const noexcept
+    {
+        if (id.index >= slots_.size())
+        {
+            return invalid_index;
+        }
+        const auto& found{ slots_[id.index] };
+        return found.generation == id.generation ? found.dense : invalid_index;
+    }
+
+    void entity_store::set_position(std::uint32_t index, double x, double y, double z)
+    {
+        x_[index] = x;
+        y_[index] = y;
+        z_[index] = z;
+        auto key{ get_cell_key(get_cell(x), get_cell(z)) };
+        if (key != cell_key_[index])
+        {
+            remove_from_cell(index);
+            insert_into_cell(index, key);
+            ++cell_moves_;
+        }
+    }
+
+    void entity_store::integrate()
+    {
+        // Separate passes over each column keep the loops trivially vectorizable.
+        auto count{ size() };
+        for (std::size_t i{}; i < count; ++i)
+        {
+            x_[i] += velocity_x_[i];
+        }
+        for (std::size_t i{}; i < count; ++i)
+        {
+            y_[i] += velocity_y_[i];
+        }
+        for (std::size_t i{}; i < count; ++i)
+        {
+            z_[i] += velocity_z_[i];
+        }
+        update_grid();
+    }
+
+    void entity_store::update_grid()
+    {
+        auto count{ static_cast<std::uint32_t>(size()) };
+        for (std::uint32_t i{}; i < count; ++i)
+        {
+            auto key{ get_cell_key(get_cell(x_[i]), get_cell(z_[i])) };
+            if (key != cell_key_[i]) [[unlikely]]
+            {
+                remove_from_cell(i);
+                insert_into_cell(i, key);
+                ++cell_moves_;
+            }
+        }
+    }
+
+    bounding_box entity_store::get_bounding_box(std::uint32_t index) const noexcept
+    {
+        return {
+            .min_x = x_[index] - half_width_[index],
+            .min_y = y_[index],
+            .min_z = z_[index] - half_width_[index],
+            .max_x = x_[index] + half_width_[index],
+            .max_y = y_[index] + height_[index],
+            .max_z = z_[index] + half_width_[index]
+        };
+    }
+
+    void entity_store::set_flag(std::uint32_t index, entity_flag flag, bool value) noexcept
+    {
+        auto bit{ static_cast<std::uint32_t>(flag) };
+        flags_[index] = value ? flags_[index] | bit : flags_[index] & ~bit;
+    }
+
+    std::span<const std::uint32_t> entity_store::query_radius(double x, double y, double z, double radius)
+    {
+        return query_radius(x, y, z, radius, scratch_);
+    }
+
+    std::span<const std::uint32_t> entity_store::query_radius(double x, double y, double z, double radius,
+        std::vector<std::uint32_t>& result) const
+    {
+        result.clear();
+        auto limit{ radius * radius };
+        visit_cells(x - radius, z - radius, x + radius, z + radius, [&](const std::vector<std::uint32_t>& members)
+        {
+            for (auto index : members)
+            {
+                auto dx{ x_[index] - x };
+                auto dy{ y_[index] - y };
+                auto dz{ z_[index] - z };
+                if (dx * dx + dy * dy + dz * dz <= limit)
+                {
+                    result.push_back(index);
+                }
+            }
+        });
+        return result;
+    }
+
+    std::span<const std::uint32_t> entity_store::query_box(const bounding_box& box)
+    {
+        return query_box(box, scratch_);
+    }
+
+    std::span<const std::uint32_t> entity_store::query_box(const bounding_box& box,
+        std::vector<std::uint32_t>& result) const
+    {
+        result.clear();
+        // Entities are bucketed by position, so widen the search by the widest box that could reach into the query.
+        auto margin{ static_cast<double>(max_half_width_) };
+        visit_cells(box.min_x - margin, box.min_z - margin, box.max_x + margin, box.max_z + margin,
+            [&](const std::vector<std::uint32_t>& members)
+        {
+            for (auto index : members)
+            {
+                auto half_width{ static_cast<double>(half_width_[index]) };
+                if (x_[index] + half_width >= box.min_x && x_[index] - half_width <= box.max_x
+                    && z_[index] + half_width >= box.min_z && z_[index] - half_width <= box.max_z
+                    && y_[index] + height_[index] >= box.min_y && y_[index] <= box.max_y)
+                {
+                    result.push_back(index);
+                }
+            }
+        });
+        return result;
+    }
+
+    entity_statistics entity_store::get_statistics() const noexcept
+    {
+        return {
+            .entities = size(),
+            .cells = cells_.size(),
+            .components = components_.size(),
+            .created = created_,
+            .destroyed = destroyed_,
+            .cell_moves = cell_moves_
+        };
+    }
+}
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include <plasma/entity/entity_tracker.h>
+#include <plasma/network/packet_writer.h>
+
+namespace plasma::entity
+{
+    namespace
+    {
+        // Clientbound play packet ids of protocol 754.
+        constexpr std::int32_t spawn_entity_packet{ 0x00 };
+        constexpr std::int32_t spawn_living_entity_packet{ 0x02 };
+        constexpr std::int32_t spawn_player_packet{ 0x04 };
+        constexpr std::int32_t entity_position_packet{ 0x27 };
+        constexpr std::int32_t entity_position_rotation_packet{ 0x28 };
+        constexpr std::int32_t entity_rotation_packet{ 0x29 };
+        constexpr std::int32_t destroy_entities_packet{ 0x36 };
+        constexpr std::int32_t entity_head_look_packet{ 0x3A };
+        constexpr std::int32_t entity_teleport_packet{ 0x56 };
+
+        std::int64_t to_fixed(double coordinate) noexcept
+        {
+            return std::llround(coordinate * 4096.0);
+        }
+
+        double from_fixed(std::int64_t coordinate) noexcept
+        {
+            return static_cast<double>(coordinate) / 4096.0;
+        }
+
+        std::uint8_t to_angle(float degrees) noexcept
+        {
+            return static_cast<std::uint8_t>(static_cast<std::int32_t>(std::floor(degrees * 256.0f / 360.0f)));
+        }
+
+        std::int16_t to_velocity(double velocity) noexcept
+        {
+            return static_cast<std::int16_t>(std::clamp(velocity, -3.9, 3.9) * 8000.0);
+        }
+
+        bool fits_relative(std::int64_t delta) noexcept
+        {
+            return delta >= std::numeric_limits<std::int16_t>::min() && delta <= std::numeric_limits<std::int16_t>::max();
+        }
+
+        bool precedes(entity_id left, entity_id right) noexcept
+        {
+            return left.index != right.index ? left.index < right.index : left.generation < right.generation;
+        }
+    }
+
+    entity_tracker::entity_tracker(entity_store& store, double view_distance) :
+        store_{ store }, view_distance_{ view_distance }, tracked_pairs_{}, spawns_{}, despawns_{},
+        relative_moves_{}, teleports_{}, bytes_sent_{}
+    {
+    }
+
+    void entity_tracker::add_viewer(std::shared_ptr<plasma::network::connection> connection, entity_id self)
+    {
+        auto id{ connection->get_id() };
+        viewers_[id] = { .connection = std::move(connection), .self = self };
+    }
+
+    std::optional<entity_id> entity_tracker::remove_viewer(std::uint64_t connection_id)
+    {
+        auto found{ viewers_.find(connection_id) };
+        if (found == viewers_.end())
+        {
+            return std::nullopt;
+        }
+        for (const auto& tracked : found->second.tracked)
+        {
+            auto& sent{ sent_[tracked.id.index] };
+            if (sent.generation == tracked.id.generation && sent.watchers)
+            {
+                --sent.watchers;
+            }
+        }
+        auto self{ found->second.self };
+        viewers_.erase(found);
+        return self;
+    }
+
+    std::optional<entity_id> entity_tracker::find_viewer(std::uint64_t connection_id) const
+    {
+        auto found{ viewers_.find(connection_id) };
+        return found == viewers_.end() ? std::nullopt : std::optional{ found->second.self };
+    }
+
+    void entity_tracker::encode_movement()
+    {
+        moves_.clear();
+        auto x{ store_.get_x() };
+        auto y{ store_.get_y() };
+        auto z{ store_.get_z() };
+        auto yaw{ store_.get_yaw() };
+        auto pitch{ store_.get_pitch() };
+        auto flags{ store_.get_flags() };
+        auto network_ids{ store_.get_network_ids() };
+        auto count{ static_cast<std::uint32_t>(store_.size()) };
+        for (std::uint32_t i{}; i < count; ++i)
+        {
+            auto id{ store_.get_id(i) };
+            if (id.index >= sent_.size())
+            {
+                sent_.resize(id.index + 1);
+            }
+            auto& sent{ sent_[id.index] };
+            sent.frame_size = 0;
+            sent.teleported = false;
+            auto current_x{ to_fixed(x[i]) };
+            auto current_y{ to_fixed(y[i]) };
+            auto current_z{ to_fixed(z[i]) };
+            auto current_yaw{ to_angle(yaw[i]) };
+            auto current_pitch{ to_angle(pitch[i]) };
+            auto on_ground{ (flags[i] & static_cast<std::uint32_t>(entity_flag::on_ground)) != 0 };
+            if (!sent.valid || sent.generation != id.generation)
+            {
+                sent = { .generation = id.generation, .valid = true, .on_ground = on_ground, .yaw = current_yaw,
+                    .pitch = current_pitch, .x = current_x, .y = current_y, .z = current_z };
+                continue;
+            }
+            auto delta_x{ current_x - sent.x };
+            auto delta_y{ current_y - sent.y };
+            auto delta_z{ current_z - sent.z };
+            auto moved{ delta_x || delta_y || delta_z };
+            auto turned{ current_yaw != sent.yaw || current_pitch != sent.pitch };
+            if (!moved && !turned && on_ground == sent.on_ground)
+            {
+                continue;
+            }
+            sent.x = current_x;
+            sent.y = current_y;
+            sent.z = current_z;
+            sent.yaw = current_yaw;
+            sent.pitch = current_pitch;
+            sent.on_ground = on_ground;
+            if (!sent.watchers)
+            {
+                continue;
+            }
+
+            // Encoded once here and copied into the batch of every viewer tracking the entity.
+            auto offset{ moves_.size() };
+            auto network_id{ network_ids[i] };
+            if (!fits_relative(delta_x) || !fits_relative(delta_y) || !fits_relative(delta_z))
+            {
+                moves_ = plasma::network::packet_writer{ entity_teleport_packet, std::move(moves_) }
+                    .write_varint(network_id).write_double(from_fixed(current_x)).write_double(from_fixed(current_y))
+                    .write_double(from_fixed(current_z)).write_byte(current_yaw).write_byte(current_pitch)
+                    .write_bool(on_ground).finish();
+                sent.teleported = true;
+            }
+            else if (!moved && turned)
+            {
+                moves_ = plasma::network::packet_writer{ entity_rotation_packet, std::move(moves_) }
+                    .write_varint(network_id).write_byte(current_yaw).write_byte(current_pitch).write_bool(on_ground)
+                    .finish();
+            }
+            else
+            {
+                plasma::network::packet_writer writer{ turned ? entity_position_rotation_packet : entity_position_packet,
+                    std::move(moves_) };
+                writer.write_varint(network_id).write_short(static_cast<std::int16_t>(delta_x))
+                    .write_short(static_cast<std::int16_t>(delta_y)).write_short(static_cast<std::int16_t>(delta_z));
+                if (turned)
+                {
+                    writer.write_byte(current_yaw).write_byte(current_pitch);
+                }
+                moves_ = writer.write_bool(on_ground).finish();
+            }
+            if (turned && !(flags[i] & static_cast<std::uint32_t>(entity_flag::object)))
+            {
+                moves_ = plasma::network::packet_writer{ entity_head_look_packet, std::move(moves_) }
+                    .write_varint(network_id).write_byte(current_yaw).finish();
+            }
+            sent.frame_offset = static_cast<std::uint32_t>(offset);
+            sent.frame_size = static_cast<std::uint32_t>(moves_.size() - offset);
+        }
+    }
+
+    std::vector<std::byte> entity_tracker::write_spawn(std::vector<std::byte> batch, std::uint32_t index)
+    {
+        // Spawn at the position last sent, so later relative moves line up with what the client holds.
+        const auto& sent{ sent_[store_.get_id(index).index] };
+        auto network_id{ store_.get_network_ids()[index] };
+        auto type{ store_.get_types()[index] };
+        const auto& uuid{ store_.get_uuid(index) };
+        if (type == player_type)
+        {
+            batch = plasma::network::packet_writer{ spawn_player_packet, std::move(batch) }.write_varint(network_id)
+                .write_uuid(uuid).write_double(from_fixed(sent.x)).write_double(from_fixed(sent.y))
+                .write_double(from_fixed(sent.z)).write_byte(sent.yaw).write_byte(sent.pitch).finish();
+        }
+        else if (store_.has_flag(index, entity_flag::object))
+        {
+            return plasma::network::packet_writer{ spawn_entity_packet, std::move(batch) }.write_varint(network_id)
+                .write_uuid(uuid).write_varint(type).write_double(from_fixed(sent.x)).write_double(from_fixed(sent.y))
+                .write_double(from_fixed(sent.z)).write_byte(sent.pitch).write_byte(sent.yaw).write_int(0)
+                .write_short(to_velocity(store_.get_velocity_x()[index]))
+                .write_short(to_velocity(store_.get_velocity_y()[index]))
+                .write_short(to_velocity(store_.get_velocity_z()[index])).finish();
+        }
+        else
+        {
+            batch = plasma::network::packet_writer{ spawn_living_entity_packet, std::move(batch) }
+                .write_varint(network_id).write_uuid(uuid).write_varint(type).write_double(from_fixed(sent.x))
+                .write_double(from_fixed(sent.y)).write_double(from_fixed(sent.z)).write_byte(sent.yaw)
+                .write_byte(sent.pitch).write_byte(sent.yaw).write_short(to_velocity(store_.get_velocity_x()[index]))
+                .write_short(to_velocity(store_.get_velocity_y()[index]))
+                .write_short(to_velocity(store_.get_velocity_z()[index])).finish();
+        }
+        return plasma::network::packet_writer{ entity_head_look_packet, std::move(batch) }.write_varint(network_id)
+            .write_byte(sent.yaw).finish();
+    }
+
+    void entity_tracker::update_viewer(viewer& viewer)
+    {
+        auto self{ store_.get_index(viewer.self) };
+        if (self == entity_store::invalid_index)
+        {
+            return;
+        }
+        auto x{ store_.get_x()[self] };
+        auto z{ store_.get_z()[self] };
+        bounding_box area{
+            .min_x = x - view_distance_,
+            .min_y = std::numeric_limits<double>::lowest(),
+            .min_z = z - view_distance_,
+            .max_x = x + view_distance_,
+            .max_y = std::numeric_limits<double>::max(),
+            .max_z = z + view_distance_
+        };
+        auto network_ids{ store_.get_network_ids() };
+        viewer.visible.clear();
+        for (auto index : store_.query_box(area, query_))
+        {
+            if (index != self)
+            {
+                viewer.visible.push_back({ store_.get_id(index), network_ids[index] });
+            }
+        }
+        std::sort(viewer.visible.begin(), viewer.visible.end(), [](const tracked_entity& left,
+            const tracked_entity& right)
+        {
+            return precedes(left.id, right.id);
+        });
+
+        // Both lists are sorted by id, so one merge pass yields what stayed, what left and what arrived.
+        std::vector<std::byte> batch{};
+        despawned_.clear();
+        auto tracked{ viewer.tracked.begin() };
+        auto visible{ viewer.visible.begin() };
+        while (tracked != viewer.tracked.end() || visible != viewer.visible.end())
+        {
+            if (tracked != viewer.tracked.end() && visible != viewer.visible.end() && tracked->id == visible->id)
+            {
+                const auto& sent{ sent_[tracked->id.index] };
+                if (sent.frame_size)
+                {
+                    auto frame{ moves_.begin() + sent.frame_offset };
+                    batch.insert(batch.end(), frame, frame + sent.frame_size);
+                    ++(sent.teleported ? teleports_ : relative_moves_);
+                }
+                ++tracked;
+                ++visible;
+            }
+            else if (visible == viewer.visible.end()
+                || (tracked != viewer.tracked.end() && precedes(tracked->id, visible->id)))
+            {
+                despawned_.push_back(tracked->network_id);
+                auto& sent{ sent_[tracked->id.index] };
+                if (sent.generation == tracked->id.generation && sent.watchers)
+                {
+                    --sent.watchers;
+                }
+                ++tracked;
+            }
+            else
+            {
+                batch = write_spawn(std::move(batch), store_.get_index(visible->id));
+                ++sent_[visible->id.index].watchers;
+                ++spawns_;
+                ++visible;
+            }
+        }
+        if (!despawned_.empty())
+        {
+            plasma::network::packet_writer writer{ destroy_entities_packet, std::move(batch) };
+            writer.write_varint(static_cast<std::int32_t>(despawned_.size()));
+            for (auto network_id : despawned_)
+            {
+                writer.write_varint(network_id);
+            }
+            batch = writer.finish();
+            despawns_ += despawned_.size();
+        }
+        std::swap(viewer.tracked, viewer.visible);
+        tracked_pairs_ += viewer.tracked.size();
+        if (!batch.empty())
+        {
+            bytes_sent_ += batch.size();
+            viewer.connection->send_batch(std::move(batch));
+        }
+    }
+
+    void entity_tracker::tick()
+    {
+        auto started{ std::chrono::steady_clock::now() };
+        tracked_pairs_ = 0;
+        encode_movement();
+        for (auto& [id, viewer] : viewers_)
+        {
+            update_viewer(viewer);
+        }
+        durations_.record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+    }
+
+    tracker_statistics entity_tracker::get_statistics() const
+    {
+        util::histogram_snapshot durations{};
+        durations_.add_to(durations);
+        return {
+            .viewers = viewers_.size(),
+            .tracked_pairs = tracked_pairs_,
+            .spawns = spawns_,
+            .despawns = despawns_,
+            .relative_moves = relative_moves_,
+            .teleports = teleports_,
+            .bytes_sent = bytes_sent_,
+            .tick_p50 = durations.get_percentile(0.5),
+            .tick_p99 = durations.get_percentile(0.99)
+        };
+    }
+}
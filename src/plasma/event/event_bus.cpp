@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include <plasma/event/event_bus.h>
+
+namespace plasma::event
+{
+    event_bus::event_bus(std::size_t queue_capacity) :
+        changed_{}, next_id_{ 1 }, queues_{ queue_capacity }, posted_{}, dropped_{}, delivered_{}, max_depth_{}
+    {
+    }
+
+    subscription event_bus::add(event_type type, const plugin::plugin* owner, event_priority priority, invoker invoke,
+        std::shared_ptr<void> target)
+    {
+        std::lock_guard lock{ mutex_ };
+        auto& registrations{ registrations_[static_cast<std::size_t>(type)] };
+        auto position{ std::upper_bound(registrations.begin(), registrations.end(), priority,
+            [](event_priority value, const registration& current)
+        {
+            return value < current.priority;
+        }) };
+        auto id{ next_id_++ };
+        registrations.insert(position, registration{
+            .id = id,
+            .owner = owner,
+            .priority = priority,
+            .invoke = invoke,
+            .target = std::move(target),
+            .applied = false
+        });
+        changed_.store(true, std::memory_order_release);
+        return id;
+    }
+
+    void event_bus::retire(registration& removed)
+    {
+        // Handlers that never reached the arrays can go right away, while the code of their owner is still loaded.
+        if (removed.applied)
+        {
+            retired_.push_back(std::move(removed.target));
+        }
+        changed_.store(true, std::memory_order_release);
+    }
+
+    bool event_bus::unsubscribe(subscription id)
+    {
+        std::lock_guard lock{ mutex_ };
+        for (auto& registrations : registrations_)
+        {
+            auto found{ std::find_if(registrations.begin(), registrations.end(), [id](const registration& current)
+            {
+                return current.id == id;
+            }) };
+            if (found != registrations.end())
+            {
+                retire(*found);
+                registrations.erase(found);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t event_bus::unsubscribe_owner(const plugin::plugin* owner)
+    {
+        std::lock_guard lock{ mutex_ };
+        std::size_t removed{};
+        for (auto& registrations : registrations_)
+        {
+            removed += std::erase_if(registrations, [this, owner](registration& current)
+            {
+                if (current.owner != owner)
+                {
+                    return false;
+                }
+                retire(current);
+                return true;
+            });
+        }
+        return removed;
+    }
+
+    void event_bus::apply_changes()
+    {
+        if (!changed_.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        std::lock_guard lock{ mutex_ };
+        for (std::size_t i{}; i < event_type_count; ++i)
+        {
+            auto& handlers{ handlers_[i] };
+            handlers.clear();
+            for (auto& current : registrations_[i])
+            {
+                handlers.push_back(handler{ .invoke = current.invoke, .target = current.target.get() });
+                current.applied = true;
+            }
+        }
+        retired_.clear();
+    }
+
+    std::size_t event_bus::dispatch_posted()
+    {
+        std::size_t dispatched{};
+        queues_.for_each([this, &dispatched](queue_type& queue)
+        {
+            max_depth_ = std::max(max_depth_, queue.read_available());
+            dispatched += queue.consume_all([this](const posted_event& posted)
+            {
+                switch (posted.type)
+                {
+                case event_type::player_join:
+                    publish_posted<player_join_event>(posted);
+                    break;
+                case event_type::player_leave:
+                    publish_posted<player_leave_event>(posted);
+                    break;
+                case event_type::player_move:
+                    publish_posted<player_move_event>(posted);
+                    break;
+                case event_type::chunk_load:
+                    publish_posted<chunk_load_event>(posted);
+                    break;
+                }
+            });
+        });
+        delivered_ += dispatched;
+        return dispatched;
+    }
+
+    event_statistics event_bus::get_statistics()
+    {
+        std::size_t handlers{};
+        {
+            std::lock_guard lock{ mutex_ };
+            for (const auto& registrations : registrations_)
+            {
+                handlers += registrations.size();
+            }
+        }
+        return {
+            .handlers = handlers,
+            .posted = posted_.load(std::memory_order_relaxed),
+            .delivered = delivered_,
+            .dropped = dropped_.load(std::memory_order_relaxed),
+            .max_depth = max_depth_,
+            .queues = queues_.size()
+        };
+    }
+}
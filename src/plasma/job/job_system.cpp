@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <exception>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/job/job_system.h>
+
+namespace plasma::job
+{
+    namespace
+    {
+        constexpr std::chrono::milliseconds idle_timeout{ 10 };
+
+        thread_local job_system* current_system{};
+
+        thread_local std::size_t current_worker{};
+
+        void pin_current_thread(std::size_t core)
+        {
+#ifdef _WIN32
+            SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{ 1 } << (core % (sizeof(DWORD_PTR) * 8)));
+#else
+            cpu_set_t set{};
+            CPU_ZERO(&set);
+            CPU_SET(core % CPU_SETSIZE, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+        }
+    }
+
+    job::job(std::function<void()> function, bool main_thread) :
+        function_{ std::move(function) }, main_thread_{ main_thread }, unresolved_{}, finished_{}
+    {
+    }
+
+    bool job::is_done() noexcept
+    {
+        return finished_.load(std::memory_order_acquire);
+    }
+
+    job_system::job_system(std::size_t workers, bool affinity) :
+        queued_{}, next_worker_{}, sleeping_{}, running_{ true }, scheduling_{}, started_{ std::chrono::steady_clock::now() }
+    {
+        if (!workers)
+        {
+            workers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+        for (std::size_t i{}; i < workers; ++i)
+        {
+            workers_.push_back(std::make_unique<worker>());
+        }
+        for (std::size_t i{}; i < workers; ++i)
+        {
+            workers_[i]->thread = std::thread{ &job_system::run, this, i, affinity };
+        }
+    }
+
+    job_system::~job_system()
+    {
+        stop();
+    }
+
+    job_handle job_system::submit(std::function<void()> function, std::span<const job_handle> dependencies)
+    {
+        return create(std::move(function), false, dependencies);
+    }
+
+    job_handle job_system::submit_main(std::function<void()> function, std::span<const job_handle> dependencies)
+    {
+        return create(std::move(function), true, dependencies);
+    }
+
+    job_handle job_system::create(std::function<void()> function, bool main_thread,
+        std::span<const job_handle> dependencies)
+    {
+        auto created{ std::make_shared<job>(std::move(function), main_thread) };
+        created->unresolved_.store(static_cast<std::uint32_t>(dependencies.size()) + 1, std::memory_order_relaxed);
+        for (const auto& dependency : dependencies)
+        {
+            if (dependency)
+            {
+                std::lock_guard lock{ dependency->mutex_ };
+                if (!dependency->finished_.load(std::memory_order_relaxed))
+                {
+                    dependency->dependents_.push_back(created);
+                    continue;
+                }
+            }
+            created->unresolved_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        if (created->unresolved_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            schedule(created);
+        }
+        return created;
+    }
+
+    void job_system::schedule(job_handle job)
+    {
+        if (job->main_thread_)
+        {
+            std::lock_guard lock{ main_mutex_ };
+            main_jobs_.push_back(std::move(job));
+            return;
+        }
+        scheduling_.fetch_add(1);
+        if (!running_.load())
+        {
+            scheduling_.fetch_sub(1);
+            execute(*job);
+            return;
+        }
+        auto own{ current_system == this };
+        auto index{ own ? current_worker : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size() };
+        auto& target{ *workers_[index] };
+        {
+            std::lock_guard lock{ target.mutex };
+            if (own)
+            {
+                target.jobs.push_back(std::move(job));
+            }
+            else
+            {
+                target.jobs.push_front(std::move(job));
+            }
+        }
+        queued_.fetch_add(1);
+        scheduling_.fetch_sub(1);
+        if (sleeping_.load())
+        {
+            std::lock_guard lock{ sleep_mutex_ };
+            sleep_condition_.notify_one();
+        }
+    }
+
+    void job_system::execute(job& job)
+    {
+        try
+        {
+            job.function_();
+        }
+        catch (const std::exception& e)
+        {
+            logger lg{};
+            ERRF(lg, "Job failed: {}", e.what());
+        }
+        job.function_ = nullptr;
+        std::vector<job_handle> dependents{};
+        {
+            std::lock_guard lock{ job.mutex_ };
+            job.finished_.store(true, std::memory_order_release);
+            std::swap(dependents, job.dependents_);
+        }
+        for (auto& dependent : dependents)
+        {
+            if (dependent->unresolved_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                schedule(std::move(dependent));
+            }
+        }
+    }
+
+    bool job_system::run_one()
+    {
+        auto self{ current_system == this ? workers_[current_worker].get() : nullptr };
+        job_handle job{};
+        if (self)
+        {
+            std::lock_guard lock{ self->mutex };
+            if (!self->jobs.empty())
+            {
+                job = std::move(self->jobs.back());
+                self->jobs.pop_back();
+            }
+        }
+        if (!job)
+        {
+            auto start{ self ? current_worker : next_worker_.load(std::memory_order_relaxed) };
+            for (std::size_t i{ 1 }; i <= workers_.size() && !job; ++i)
+            {
+                auto& victim{ *workers_[(start + i) % workers_.size()] };
+                if (&victim == self)
+                {
+                    continue;
+                }
+                if (self)
+                {
+                    self->steal_attempts.fetch_add(1, std::memory_order_relaxed);
+                }
+                std::lock_guard lock{ victim.mutex };
+                if (!victim.jobs.empty())
+                {
+                    job = std::move(victim.jobs.front());
+                    victim.jobs.pop_front();
+                    if (self)
+                    {
+                        self->stolen.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+        if (!job)
+        {
+            return false;
+        }
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        auto start{ std::chrono::steady_clock::now() };
+        execute(*job);
+        if (self)
+        {
+            self->executed.fetch_add(1, std::memory_order_relaxed);
+            self->busy_nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    void job_system::run(std::size_t index, bool affinity)
+    {
+        current_system = this;
+        current_worker = index;
+        if (affinity)
+        {
+            pin_current_thread(index + 1);
+        }
+        while (true)
+        {
+            if (run_one())
+            {
+                continue;
+            }
+            if (!running_.load(std::memory_order_acquire) && !queued_.load())
+            {
+                break;
+            }
+            std::unique_lock lock{ sleep_mutex_ };
+            sleeping_.fetch_add(1);
+            sleep_condition_.wait_for(lock, idle_timeout, [this]
+            {
+                return queued_.load() || !running_.load(std::memory_order_acquire);
+            });
+            sleeping_.fetch_sub(1);
+        }
+    }
+
+    void job_system::wait(const job_handle& job)
+    {
+        while (!job->is_done())
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool job_system::help()
+    {
+        return run_one();
+    }
+
+    std::size_t job_system::run_main_jobs()
+    {
+        std::vector<job_handle> jobs{};
+        {
+            std::lock_guard lock{ main_mutex_ };
+            if (main_jobs_.empty())
+            {
+                return 0;
+            }
+            std::swap(jobs, main_jobs_);
+        }
+        for (auto& job : jobs)
+        {
+            execute(*job);
+        }
+        return jobs.size();
+    }
+
+    void job_system::stop()
+    {
+        if (!running_.exchange(false))
+        {
+            return;
+        }
+        {
+            std::lock_guard lock{ sleep_mutex_ };
+            sleep_condition_.notify_all();
+        }
+        for (auto& worker : workers_)
+        {
+            worker->thread.join();
+        }
+        // A job pushed while the workers were leaving would otherwise never run.
+        while (scheduling_.load() || queued_.load())
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::vector<worker_statistics> job_system::get_statistics() const
+    {
+        auto uptime{ std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started_).count() };
+        std::vector<worker_statistics> statistics{};
+        for (const auto& worker : workers_)
+        {
+            statistics.push_back({
+                .executed = worker->executed.load(std::memory_order_relaxed),
+                .stolen = worker->stolen.load(std::memory_order_relaxed),
+                .steal_attempts = worker->steal_attempts.load(std::memory_order_relaxed),
+                .busy_nanoseconds = worker->busy_nanoseconds.load(std::memory_order_relaxed),
+                .uptime_nanoseconds = static_cast<std::uint64_t>(uptime)
+            });
+        }
+        return statistics;
+    }
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string_view>
+
+#include <fmt/args.h>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <plasma/log/binary_format.h>
+
+namespace plasma::log::binary
+{
+    namespace
+    {
+        constexpr std::array<const char*, 6> severity_names{ "trace", "debug", "info", "warning", "error", "fatal" };
+
+        class cursor
+        {
+        private:
+            std::string_view data_;
+        public:
+            explicit cursor(std::string_view data) :
+                data_{ data }
+            {
+            }
+
+            template<typename TValue>
+            TValue read()
+            {
+                if (data_.size() < sizeof(TValue))
+                {
+                    throw std::runtime_error{ "Truncated binary log record" };
+                }
+                TValue value{};
+                std::memcpy(&value, data_.data(), sizeof(TValue));
+                data_.remove_prefix(sizeof(TValue));
+                return value;
+            }
+
+            std::string_view read_string()
+            {
+                auto size{ read<std::uint32_t>() };
+                if (data_.size() < size)
+                {
+                    throw std::runtime_error{ "Truncated binary log string" };
+                }
+                auto value{ data_.substr(0, size) };
+                data_.remove_prefix(size);
+                return value;
+            }
+
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return data_.empty();
+            }
+        };
+
+        const char* severity_name(std::uint8_t severity)
+        {
+            return severity < severity_names.size() ? severity_names[severity] : "unknown";
+        }
+
+        std::string format_prefix(std::uint64_t timestamp, std::uint8_t severity, std::string_view file,
+            std::uint32_t line, bool with_location)
+        {
+            auto seconds{ static_cast<std::time_t>(timestamp / 1'000'000'000) };
+            if (with_location && line)
+            {
+                return fmt::format("[{:%Y-%m-%d %H:%M:%S}] [{}:{}] [{}]: ", fmt::localtime(seconds), file, line,
+                    severity_name(severity));
+            }
+            return fmt::format("[{:%Y-%m-%d %H:%M:%S}] [{}]: ", fmt::localtime(seconds), severity_name(severity));
+        }
+    }
+
+    decoder::decoder(std::istream& stream, bool with_location) :
+        stream_{ stream }, with_location_{ with_location }
+    {
+        std::array<char, 4> magic{};
+        std::uint16_t version{};
+        stream_.read(magic.data(), magic.size());
+        stream_.read(reinterpret_cast<char*>(&version), sizeof(version));
+        if (!stream_ || magic != file_magic)
+        {
+            throw std::runtime_error{ "Not a Plasma binary log" };
+        }
+        if (version != format_version)
+        {
+            throw std::runtime_error{ fmt::format("Unsupported binary log version {}", version) };
+        }
+    }
+
+    bool decoder::next(std::string& line)
+    {
+        while (true)
+        {
+            std::uint32_t size{};
+            if (!stream_.read(reinterpret_cast<char*>(&size), sizeof(size)))
+            {
+                return false;
+            }
+            payload_.resize(size);
+            if (!stream_.read(payload_.data(), size))
+            {
+                throw std::runtime_error{ "Truncated binary log file" };
+            }
+
+            cursor in{ payload_ };
+            switch (static_cast<record_kind>(in.read<std::uint8_t>()))
+            {
+            case record_kind::site:
+            {
+                auto id{ in.read<std::uint32_t>() };
+                site_info site{};
+                site.severity = in.read<std::uint8_t>();
+                site.line = in.read<std::uint32_t>();
+                site.file = in.read_string();
+                site.format = in.read_string();
+                sites_.insert_or_assign(id, std::move(site));
+                continue;
+            }
+            case record_kind::event:
+            {
+                auto id{ in.read<std::uint32_t>() };
+                auto timestamp{ in.read<std::uint64_t>() };
+                auto site{ sites_.find(id) };
+                if (site == sites_.end())
+                {
+                    throw std::runtime_error{ fmt::format("Binary log event refers to unknown site {}", id) };
+                }
+                fmt::dynamic_format_arg_store<fmt::format_context> arguments{};
+                while (!in.empty())
+                {
+                    switch (static_cast<argument_type>(in.read<std::uint8_t>()))
+                    {
+                    case argument_type::boolean:
+                        arguments.push_back(in.read<std::uint8_t>() != 0);
+                        break;
+                    case argument_type::character:
+                        arguments.push_back(in.read<char>());
+                        break;
+                    case argument_type::signed_integer:
+                        arguments.push_back(in.read<std::int64_t>());
+                        break;
+                    case argument_type::unsigned_integer:
+                        arguments.push_back(in.read<std::uint64_t>());
+                        break;
+                    case argument_type::floating_point:
+                        arguments.push_back(in.read<double>());
+                        break;
+                    case argument_type::string:
+                        arguments.push_back(std::string{ in.read_string() });
+                        break;
+                    default:
+                        throw std::runtime_error{ "Unknown binary log argument type" };
+                    }
+                }
+                line = format_prefix(timestamp, site->second.severity, site->second.file, site->second.line,
+                    with_location_);
+                try
+                {
+                    line += fmt::vformat(site->second.format, arguments);
+                }
+                catch (const fmt::format_error& e)
+                {
+                    line += fmt::format("{} <format error: {}>", site->second.format, e.what());
+                }
+                return true;
+            }
+            case record_kind::text:
+            {
+                auto timestamp{ in.read<std::uint64_t>() };
+                auto severity{ in.read<std::uint8_t>() };
+                auto source_line{ in.read<std::uint32_t>() };
+                auto file{ in.read_string() };
+                line = format_prefix(timestamp, severity, file, source_line, with_location_);
+                line += in.read_string();
+                return true;
+            }
+            default:
+                throw std::runtime_error{ "Unknown binary log record" };
+            }
+        }
+    }
+}
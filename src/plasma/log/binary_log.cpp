@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/log/expressions/message.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+
+namespace plasma::log::binary
+{
+    namespace
+    {
+        std::mutex sites_mutex{};
+        std::vector<std::unique_ptr<site>> sites{};
+
+        const site& get_site(std::uint32_t id)
+        {
+            std::lock_guard lock{ sites_mutex };
+            return *sites.at(id);
+        }
+    }
+
+    const site& register_site(severity_level severity, const char* format, const std::source_location& location)
+    {
+        std::lock_guard lock{ sites_mutex };
+        auto id{ static_cast<std::uint32_t>(sites.size()) };
+        sites.push_back(std::make_unique<site>(site{
+            .id = id,
+            .severity = severity,
+            .file = location.file_name(),
+            .line = location.line(),
+            .format = format
+        }));
+        return *sites.back();
+    }
+
+    std::atomic<writer*> writer::active_{};
+
+    writer::writer(std::filesystem::path directory, std::uintmax_t rotation_size, std::size_t queue_bytes,
+        overflow_policy policy, std::chrono::milliseconds flush_interval, severity_level console_severity) :
+        directory_{ std::move(directory) }, rotation_size_{ rotation_size }, policy_{ policy },
+        flush_interval_{ flush_interval }, console_severity_{ console_severity }, queues_{ queue_bytes }, dropped_{},
+        written_{}, running_{ true }, flush_requested_{}, flush_completed_{}, file_{}, file_size_{}
+    {
+        open_next_file();
+        thread_ = std::thread{ &writer::run, this };
+        active_.store(this, std::memory_order_release);
+    }
+
+    writer::~writer()
+    {
+        stop();
+    }
+
+    void writer::open_next_file()
+    {
+        if (file_)
+        {
+            std::fclose(file_);
+        }
+        std::uint32_t next{};
+        for (const auto& entry : std::filesystem::directory_iterator{ directory_ })
+        {
+            auto name{ entry.path().filename().string() };
+            if (!name.starts_with("log_") || !name.ends_with(".plog"))
+            {
+                continue;
+            }
+            std::uint32_t index{};
+            auto digits{ std::string_view{ name }.substr(4, name.size() - 9) };
+            if (std::from_chars(digits.data(), digits.data() + digits.size(), index).ec == std::errc{})
+            {
+                next = std::max(next, index + 1);
+            }
+        }
+        auto path{ directory_ / ("log_" + std::to_string(next) + ".plog") };
+        file_ = std::fopen(path.string().c_str(), "wb");
+        if (!file_)
+        {
+            throw std::runtime_error{ "Failed to open binary log file " + path.string() };
+        }
+        std::fwrite(file_magic.data(), 1, file_magic.size(), file_);
+        std::fwrite(&format_version, sizeof(format_version), 1, file_);
+        file_size_ = file_magic.size() + sizeof(format_version);
+        emitted_sites_.clear();
+    }
+
+    void writer::emit_site(std::uint32_t id)
+    {
+        const auto& site{ get_site(id) };
+        auto offset{ output_.size() };
+        append(output_, std::uint32_t{});
+        append(output_, record_kind::site);
+        append(output_, site.id);
+        append(output_, static_cast<std::uint8_t>(site.severity));
+        append(output_, site.line);
+        append_string(output_, site.file);
+        append_string(output_, site.format);
+        auto size{ static_cast<std::uint32_t>(output_.size() - offset - sizeof(std::uint32_t)) };
+        std::memcpy(output_.data() + offset, &size, sizeof(size));
+        if (emitted_sites_.size() <= id)
+        {
+            emitted_sites_.resize(id + 1);
+        }
+        emitted_sites_[id] = true;
+    }
+
+    void writer::process(std::string_view record)
+    {
+        if (file_size_ + output_.size() + record.size() > rotation_size_)
+        {
+            std::fwrite(output_.data(), 1, output_.size(), file_);
+            output_.clear();
+            open_next_file();
+        }
+        if (static_cast<record_kind>(record[sizeof(std::uint32_t)]) == record_kind::event)
+        {
+            std::uint32_t id{};
+            std::memcpy(&id, record.data() + sizeof(std::uint32_t) + 1, sizeof(id));
+            if (id >= emitted_sites_.size() || !emitted_sites_[id])
+            {
+                emit_site(id);
+            }
+        }
+        output_.append(record);
+    }
+
+    std::size_t writer::drain()
+    {
+        std::size_t records{};
+        queues_.for_each([this, &records](queue_type& queue)
+        {
+            auto available{ queue.read_available() };
+            if (!available)
+            {
+                return;
+            }
+            batch_.resize(available);
+            queue.pop(batch_.data(), available);
+            std::string_view data{ batch_.data(), available };
+            while (!data.empty())
+            {
+                std::uint32_t size{};
+                std::memcpy(&size, data.data(), sizeof(size));
+                process(data.substr(0, sizeof(size) + size));
+                data.remove_prefix(sizeof(size) + size);
+                ++records;
+            }
+        });
+        if (!output_.empty())
+        {
+            std::fwrite(output_.data(), 1, output_.size(), file_);
+            std::fflush(file_);
+            file_size_ += output_.size();
+            output_.clear();
+        }
+        written_.fetch_add(records, std::memory_order_relaxed);
+        return records;
+    }
+
+    void writer::complete_flush_requests()
+    {
+        std::unique_lock lock{ flush_mutex_ };
+        if (flush_completed_ == flush_requested_)
+        {
+            return;
+        }
+        auto requested{ flush_requested_ };
+        lock.unlock();
+        drain();
+        lock.lock();
+        flush_completed_ = requested;
+        flush_condition_.notify_all();
+    }
+
+    void writer::run()
+    {
+        while (running_.load(std::memory_order_acquire))
+        {
+            auto records{ drain() };
+            complete_flush_requests();
+            if (!records)
+            {
+                std::this_thread::sleep_for(flush_interval_);
+            }
+        }
+        drain();
+        complete_flush_requests();
+    }
+
+    void writer::push(std::string_view record)
+    {
+        auto& queue{ queues_.local() };
+        if (record.size() > queues_.capacity())
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        while (queue.write_available() < record.size())
+        {
+            if (policy_ != overflow_policy::block || !running_.load(std::memory_order_acquire))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
+        queue.push(record.data(), record.size());
+    }
+
+    void writer::flush()
+    {
+        std::unique_lock lock{ flush_mutex_ };
+        if (!running_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        auto ticket{ ++flush_requested_ };
+        flush_condition_.wait(lock, [this, ticket]
+        {
+            return flush_completed_ >= ticket;
+        });
+    }
+
+    void writer::stop()
+    {
+        auto self{ this };
+        active_.compare_exchange_strong(self, nullptr, std::memory_order_acq_rel);
+        if (!running_.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        thread_.join();
+        {
+            std::lock_guard lock{ flush_mutex_ };
+            flush_completed_ = flush_requested_;
+            flush_condition_.notify_all();
+        }
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    record_sink::record_sink(writer& writer) :
+        basic_sink_frontend{ false }, writer_{ writer }
+    {
+    }
+
+    void record_sink::consume(const boost::log::record_view& rec)
+    {
+        const auto& values{ rec.attribute_values() };
+        if (values.find(binary_attribute_name) != values.end())
+        {
+            return;
+        }
+        auto severity{ rec[boost::log::trivial::severity] };
+        auto location{ boost::log::extract<source_location>(location_attribute_name, values) };
+        auto message{ rec[boost::log::expressions::smessage] };
+
+        thread_local std::string buffer{};
+        buffer.clear();
+        append(buffer, std::uint32_t{});
+        append(buffer, record_kind::text);
+        append(buffer, now());
+        append(buffer, static_cast<std::uint8_t>(severity ? severity.get() : severity_level::info));
+        append(buffer, static_cast<std::uint32_t>(location ? location->line : 0));
+        append_string(buffer, location ? location->file : "");
+        append_string(buffer, message ? message.get() : std::string{});
+        auto size{ static_cast<std::uint32_t>(buffer.size() - sizeof(std::uint32_t)) };
+        std::memcpy(buffer.data(), &size, sizeof(size));
+        writer_.push(buffer);
+    }
+
+    void record_sink::flush()
+    {
+        writer_.flush();
+    }
+}
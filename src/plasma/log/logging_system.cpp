@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+
+#include <boost/log/attributes.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
+#include <boost/log/utility/setup/common_attributes.hpp>
+#include <boost/log/support/date_time.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <plasma/log.hpp>
+#include <plasma/log/async_sink.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/log/logging_system.h>
+#include <plasma/config/plasma_config.h>
+
+extern std::atomic<bool> g_color_enabled;
+
+namespace plasma::log
+{
+    namespace
+    {
+        using console_backend = boost::log::sinks::text_ostream_backend;
+        using file_backend = boost::log::sinks::text_file_backend;
+
+#if !defined(NDEBUG) || defined(_DEBUG)
+        auto formatter{
+            boost::log::expressions::format("[%1%] [%2%] [%3%]: %4%")
+            % boost::log::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S")
+            % boost::log::expressions::attr<source_location>(location_attribute_name)
+            % boost::log::expressions::attr<boost::log::trivial::severity_level>("Severity")
+            % boost::log::expressions::message
+        };
+#else
+        auto formatter{
+            boost::log::expressions::format("[%1%] [%2%]: %3%")
+            % boost::log::expressions::format_date_time<boost::posix_time::ptime>("TimeStamp", "%Y-%m-%d %H:%M:%S")
+            % boost::log::expressions::attr<boost::log::trivial::severity_level>("Severity")
+            % boost::log::expressions::message
+        };
+#endif
+
+        boost::shared_ptr<console_backend> console_backend_ptr{};
+        boost::shared_ptr<file_backend> file_backend_ptr{};
+        boost::shared_ptr<boost::log::sinks::basic_sink_frontend> console_sink_ptr{};
+        boost::shared_ptr<boost::log::sinks::basic_sink_frontend> file_sink_ptr{};
+        boost::shared_ptr<async_sink<console_backend>> async_console_sink_ptr{};
+        boost::shared_ptr<async_sink<file_backend>> async_file_sink_ptr{};
+        std::unique_ptr<binary::writer> binary_writer_ptr{};
+
+#ifdef _WIN32
+        bool enable_ansi_escape_sequence()
+        {
+            HANDLE handle_stderr{ GetStdHandle(STD_ERROR_HANDLE) };
+            if (handle_stderr == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            DWORD mode{};
+            if (!GetConsoleMode(handle_stderr, &mode))
+            {
+                return false;
+            }
+
+            mode |= ENABLE_VIRTUAL_TERMINAL_PROCESSING;
+            if (!SetConsoleMode(handle_stderr, mode))
+            {
+                return false;
+            }
+            return true;
+        }
+#endif
+
+        void color_formatter(boost::log::record_view const& rec, boost::log::formatting_ostream& strm)
+        {
+            auto severity{ rec[boost::log::trivial::severity] };
+            auto colored{ severity && g_color_enabled.load(std::memory_order_relaxed) };
+            if (colored)
+            {
+                switch (severity.get())
+                {
+                case boost::log::trivial::severity_level::trace:
+                case boost::log::trivial::severity_level::debug:
+                    strm << "\x1b[0;90m";
+                    break;
+                case boost::log::trivial::severity_level::info:
+                    strm << "\x1b[0;37m";
+                    break;
+                case boost::log::trivial::severity_level::warning:
+                    strm << "\x1b[0;33m";
+                    break;
+                case boost::log::trivial::severity_level::error:
+                    strm << "\x1b[0;31m";
+                    break;
+                case boost::log::trivial::severity_level::fatal:
+                    strm << "\x1b[0;91m";
+                    break;
+                default:
+                    break;
+                }
+            }
+            formatter(rec, strm);
+            if (colored)
+            {
+                strm << "\x1b[0m";
+            }
+        }
+
+        template<typename TBackend>
+        void report_statistics(const char* name, async_sink<TBackend>& sink)
+        {
+            auto statistics{ sink.get_statistics() };
+            logger lg{};
+            INFF(lg, "Asynchronous {} sink: {} records dropped, max queue depth {}/{} across {} queues", name,
+                statistics.dropped, statistics.max_depth, statistics.capacity, statistics.queues);
+        }
+    }
+
+    void initialize_logging_system()
+    {
+        boost::log::add_common_attributes();
+        console_backend_ptr = boost::make_shared<console_backend>();
+        console_backend_ptr->add_stream(clog_stream_ptr);
+        auto console_sink{ boost::make_shared<boost::log::sinks::synchronous_sink<console_backend>>(console_backend_ptr) };
+        console_sink->set_formatter(&color_formatter);
+        console_sink_ptr = console_sink;
+
+        std::filesystem::create_directory("./logs");
+        file_backend_ptr = boost::make_shared<file_backend>(
+            boost::log::keywords::target = "./logs",
+            boost::log::keywords::file_name = "./logs/log_%N.log",
+            boost::log::keywords::rotation_size = 10 * 1024 * 1024,
+            boost::log::keywords::auto_flush = true,
+            boost::log::keywords::time_based_rotation = boost::log::sinks::file::rotation_at_time_point(0, 0, 0)
+        );
+        file_backend_ptr->set_file_collector(boost::log::sinks::file::make_collector(boost::log::keywords::target = "./logs"));
+        file_backend_ptr->scan_for_files();
+        auto file_sink{ boost::make_shared<boost::log::sinks::synchronous_sink<file_backend>>(file_backend_ptr) };
+        file_sink->set_formatter(formatter);
+        file_sink_ptr = file_sink;
+        set_minimum_severity(minimum_severity.load(std::memory_order_relaxed));
+        boost::log::core::get()->add_sink(console_sink_ptr);
+        boost::log::core::get()->add_sink(file_sink_ptr);
+#ifdef _WIN32
+        if (!enable_ansi_escape_sequence())
+        {
+            g_color_enabled.store(false, std::memory_order_relaxed);
+            logger lg{};
+            WRNF(lg, "Failed to enable Win32 ANSI escape sequence support, colorful console output will be disabled");
+        }
+#endif
+    }
+
+    void set_minimum_severity(severity_level severity)
+    {
+        minimum_severity.store(severity, std::memory_order_relaxed);
+        boost::log::core::get()->set_filter(boost::log::trivial::severity >= severity);
+    }
+
+    void configure_logging_system(const plasma::config::plasma_config& config)
+    {
+        const auto& async{ config.logging.async };
+        const auto& binary{ config.logging.binary };
+        auto policy{ parse_overflow_policy(async.overflow_policy) };
+        std::chrono::milliseconds flush_interval{ async.flush_interval_ms };
+        auto core{ boost::log::core::get() };
+        logger lg{};
+
+        if (async.enabled && !async_console_sink_ptr)
+        {
+            auto console_sink{ boost::make_shared<async_sink<console_backend>>(
+                console_backend_ptr, async.queue_capacity, policy, flush_interval) };
+            console_sink->set_formatter(&color_formatter);
+            core->remove_sink(console_sink_ptr);
+            core->add_sink(console_sink);
+            async_console_sink_ptr = console_sink;
+            console_sink_ptr = console_sink;
+            if (!binary.enabled)
+            {
+                file_backend_ptr->auto_flush(false);
+                auto file_sink{ boost::make_shared<async_sink<file_backend>>(
+                    file_backend_ptr, async.queue_capacity, policy, flush_interval) };
+                file_sink->set_formatter(formatter);
+                core->remove_sink(file_sink_ptr);
+                core->add_sink(file_sink);
+                async_file_sink_ptr = file_sink;
+                file_sink_ptr = file_sink;
+            }
+            DBGF(lg, "Asynchronous logging enabled with {} records per thread, overflow policy {}", async.queue_capacity,
+                async.overflow_policy);
+        }
+
+        if (binary.enabled && !binary_writer_ptr)
+        {
+            severity_level console_severity{};
+            if (!boost::log::trivial::from_string(binary.console_severity.data(), binary.console_severity.size(),
+                console_severity))
+            {
+                throw std::invalid_argument{ "Unknown logging severity: " + binary.console_severity };
+            }
+            binary_writer_ptr = std::make_unique<binary::writer>("./logs", binary.rotation_size, binary.queue_bytes,
+                policy, flush_interval, console_severity);
+            auto record_sink{ boost::make_shared<binary::record_sink>(*binary_writer_ptr) };
+            record_sink->set_filter(!boost::log::expressions::has_attr(binary::binary_attribute_name));
+            console_sink_ptr->set_filter(boost::log::trivial::severity >= console_severity);
+            core->remove_sink(file_sink_ptr);
+            core->add_sink(record_sink);
+            file_sink_ptr = record_sink;
+            DBGF(lg, "Binary logging enabled, console output limited to {}",
+                boost::log::trivial::to_string(console_severity));
+        }
+    }
+
+    void shutdown_logging_system()
+    {
+        if (async_file_sink_ptr)
+        {
+            report_statistics("file", *async_file_sink_ptr);
+            async_file_sink_ptr->stop();
+        }
+        if (binary_writer_ptr)
+        {
+            logger lg{};
+            INFF(lg, "Binary log writer: {} records written, {} dropped", binary_writer_ptr->written(),
+                binary_writer_ptr->dropped());
+            binary_writer_ptr->stop();
+        }
+        if (async_console_sink_ptr)
+        {
+            report_statistics("console", *async_console_sink_ptr);
+            async_console_sink_ptr->stop();
+        }
+        boost::log::core::get()->flush();
+    }
+}
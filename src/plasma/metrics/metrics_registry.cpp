@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdexcept>
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#endif
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/metrics/metrics_registry.h>
+
+namespace plasma::metrics
+{
+    namespace
+    {
+        std::uint32_t get_process_id() noexcept
+        {
+#ifdef _WIN32
+            return static_cast<std::uint32_t>(_getpid());
+#else
+            return static_cast<std::uint32_t>(getpid());
+#endif
+        }
+
+        std::int64_t get_unix_time() noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        bool is_process_alive(std::uint32_t process_id) noexcept
+        {
+#ifdef _WIN32
+            static_cast<void>(process_id);
+            return false;
+#else
+            return kill(static_cast<pid_t>(process_id), 0) == 0 || errno == EPERM;
+#endif
+        }
+
+        // Tells whether a segment left under the name still belongs to a running server. A segment from another version
+        // is never in use by anything that reads it the same way, so it can be replaced.
+        bool is_segment_in_use(const std::string& name)
+        {
+            try
+            {
+                boost::interprocess::shared_memory_object memory{ boost::interprocess::open_only, name.c_str(),
+                    boost::interprocess::read_only };
+                boost::interprocess::mapped_region region{ memory, boost::interprocess::read_only };
+                if (region.get_size() < sizeof(metrics_segment))
+                {
+                    return false;
+                }
+                const auto& segment{ *static_cast<const metrics_segment*>(region.get_address()) };
+                if (segment.magic != segment_magic || segment.version != segment_version)
+                {
+                    return false;
+                }
+                if (get_unix_time() - segment.heartbeat.load(std::memory_order_relaxed) < stale_heartbeat_ms)
+                {
+                    return true;
+                }
+                // A restarted container usually hands the server the same pid it had before.
+                return segment.process_id != get_process_id() && is_process_alive(segment.process_id);
+            }
+            catch (const boost::interprocess::interprocess_exception&)
+            {
+                return false;
+            }
+        }
+    }
+
+    metrics_segment& get_detached_segment() noexcept
+    {
+        static auto detached{ std::make_unique<metrics_segment>() };
+        return *detached;
+    }
+
+    metrics_registry::metrics_registry(std::string name) :
+        name_{ std::move(name) }, segment_{}, values_{}, histograms_{}
+    {
+        if (!name_.empty())
+        {
+            try
+            {
+                if (is_segment_in_use(name_))
+                {
+                    logger lg{};
+                    WRNF(lg, "The shared memory segment {} is in use by another running server, metrics will only be kept in "
+                        "memory. Set a different metrics segment name to publish them.", name_);
+                }
+                else
+                {
+                    boost::interprocess::shared_memory_object::remove(name_.c_str());
+                    // Fails rather than share the segment if another server created it since the check.
+                    boost::interprocess::shared_memory_object memory{ boost::interprocess::create_only, name_.c_str(),
+                        boost::interprocess::read_write, boost::interprocess::permissions{ 0644 } };
+                    try
+                    {
+                        memory.truncate(sizeof(metrics_segment));
+                        region_ = boost::interprocess::mapped_region{ memory, boost::interprocess::read_write };
+                        segment_ = new (region_.get_address()) metrics_segment{};
+                    }
+                    catch (const boost::interprocess::interprocess_exception&)
+                    {
+                        boost::interprocess::shared_memory_object::remove(name_.c_str());
+                        throw;
+                    }
+                }
+            }
+            catch (const boost::interprocess::interprocess_exception& e)
+            {
+                logger lg{};
+                WRNF(lg, "Failed to create the shared memory segment {} for metrics, they will only be kept in memory: {}",
+                    name_, e.what());
+            }
+        }
+        if (!segment_)
+        {
+            local_ = std::make_unique<metrics_segment>();
+            segment_ = local_.get();
+        }
+        segment_->magic = segment_magic;
+        segment_->version = segment_version;
+        segment_->process_id = get_process_id();
+        beat();
+    }
+
+    metrics_registry::~metrics_registry()
+    {
+        if (is_shared())
+        {
+            boost::interprocess::shared_memory_object::remove(name_.c_str());
+        }
+    }
+
+    std::uint32_t metrics_registry::add(std::string_view name, std::string_view help, metric_kind kind, double unit)
+    {
+        std::lock_guard lock{ mutex_ };
+        auto index{ segment_->metric_count.load(std::memory_order_relaxed) };
+        auto& slots{ kind == metric_kind::histogram ? histograms_ : values_ };
+        if (index == max_metrics || slots == (kind == metric_kind::histogram ? max_histograms : max_values))
+        {
+            throw std::length_error{ fmt::format("No room left for metric {}", name) };
+        }
+        auto& descriptor{ segment_->metrics[index] };
+        if (name.empty() || name.size() >= descriptor.name.size())
+        {
+            throw std::invalid_argument{ fmt::format("Invalid metric name {}", name) };
+        }
+        descriptor.name.fill('\0');
+        std::copy(name.begin(), name.end(), descriptor.name.begin());
+        descriptor.help.fill('\0');
+        help = help.substr(0, descriptor.help.size() - 1);
+        std::copy(help.begin(), help.end(), descriptor.help.begin());
+        descriptor.kind = kind;
+        descriptor.slot = slots++;
+        descriptor.unit = unit;
+        segment_->metric_count.store(index + 1, std::memory_order_release);
+        return descriptor.slot;
+    }
+
+    counter metrics_registry::add_counter(std::string_view name, std::string_view help)
+    {
+        return { *segment_, add(name, help, metric_kind::counter, 1.0) };
+    }
+
+    gauge metrics_registry::add_gauge(std::string_view name, std::string_view help)
+    {
+        return { *segment_, add(name, help, metric_kind::gauge, 1.0) };
+    }
+
+    histogram_metric metrics_registry::add_histogram(std::string_view name, std::string_view help, double unit)
+    {
+        return { *segment_, add(name, help, metric_kind::histogram, unit) };
+    }
+
+    void metrics_registry::beat() noexcept
+    {
+        segment_->heartbeat.store(get_unix_time(), std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include <plasma/nbt/byteswap.h>
+
+namespace plasma::nbt
+{
+    namespace
+    {
+        template<typename T>
+        void byteswap_scalar(const std::byte* in, std::byte* out, std::size_t count) noexcept
+        {
+            for (std::size_t i{}; i < count; ++i)
+            {
+                T value{};
+                std::memcpy(&value, in + i * sizeof(T), sizeof(T));
+                value = std::byteswap(value);
+                std::memcpy(out + i * sizeof(T), &value, sizeof(T));
+            }
+        }
+
+        void byteswap_copy_scalar(const std::byte* in, std::byte* out, std::size_t count, std::size_t width) noexcept
+        {
+            switch (width)
+            {
+            case 2:
+                byteswap_scalar<std::uint16_t>(in, out, count);
+                break;
+            case 4:
+                byteswap_scalar<std::uint32_t>(in, out, count);
+                break;
+            case 8:
+                byteswap_scalar<std::uint64_t>(in, out, count);
+                break;
+            default:
+                std::memcpy(out, in, count * width);
+                break;
+            }
+        }
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define PLASMA_BYTESWAP_AVX2
+        // Swaps 32 bytes per shuffle, the scalar loop finishes the tail.
+        __attribute__((target("avx2"))) void byteswap_copy_avx2(const std::byte* in, std::byte* out,
+            std::size_t count, std::size_t width) noexcept
+        {
+            __m256i mask{};
+            switch (width)
+            {
+            case 2:
+                mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+                break;
+            case 4:
+                mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+                break;
+            case 8:
+                mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                    7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+                break;
+            default:
+                std::memcpy(out, in, count * width);
+                return;
+            }
+            auto bytes{ count * width };
+            std::size_t offset{};
+            for (; offset + 32 <= bytes; offset += 32)
+            {
+                auto block{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + offset)) };
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + offset), _mm256_shuffle_epi8(block, mask));
+            }
+            byteswap_copy_scalar(in + offset, out + offset, (bytes - offset) / width, width);
+        }
+#endif
+
+        class codec
+        {
+        public:
+            const char* name;
+            void (*copy)(const std::byte*, std::byte*, std::size_t, std::size_t) noexcept;
+        };
+
+        codec select_codec() noexcept
+        {
+#ifdef PLASMA_BYTESWAP_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return { .name = "avx2", .copy = &byteswap_copy_avx2 };
+            }
+#endif
+            return { .name = "scalar", .copy = &byteswap_copy_scalar };
+        }
+
+        const codec selected_codec{ select_codec() };
+    }
+
+    void byteswap_copy(const void* in, void* out, std::size_t count, std::size_t width) noexcept
+    {
+        if (!count)
+        {
+            return;
+        }
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            std::memcpy(out, in, count * width);
+        }
+        else
+        {
+            selected_codec.copy(static_cast<const std::byte*>(in), static_cast<std::byte*>(out), count, width);
+        }
+    }
+
+    const char* get_byteswap_codec_name() noexcept
+    {
+        return selected_codec.name;
+    }
+}
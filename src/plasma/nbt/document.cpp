@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <plasma/nbt/byteswap.h>
+#include <plasma/nbt/document.h>
+#include <plasma/nbt/reader.hpp>
+
+namespace plasma::nbt
+{
+    const node* node::find(std::string_view child) const noexcept
+    {
+        for (auto current{ first }; current; current = current->next)
+        {
+            if (current->name == child)
+            {
+                return current;
+            }
+        }
+        return nullptr;
+    }
+
+    // Turns parser events into nodes.
+    class document_builder : public null_handler
+    {
+    private:
+        document& document_;
+        std::array<node*, max_depth> stack_;
+        std::size_t depth_;
+
+        node& add(tag_type type, std::string_view name)
+        {
+            if (!depth_)
+            {
+                return document_.create_root(type, name);
+            }
+            return document_.add(*stack_[depth_ - 1], type, name);
+        }
+
+        template<typename T>
+        void add_array(tag_type type, std::string_view name, big_endian_array<T> values)
+        {
+            auto& array{ add(type, name) };
+            array.data = document_.copy_array(values.bytes().data(), values.size(), sizeof(T), true);
+            array.size = values.size();
+        }
+    public:
+        explicit document_builder(document& document) noexcept :
+            document_{ document }, stack_{}, depth_{}
+        {
+        }
+
+        void begin_compound(std::string_view name)
+        {
+            stack_[depth_++] = &add(tag_type::tag_compound, name);
+        }
+
+        void end_compound() noexcept
+        {
+            --depth_;
+        }
+
+        void begin_list(std::string_view name, tag_type element, std::size_t)
+        {
+            auto& list{ add(tag_type::tag_list, name) };
+            list.element = element;
+            stack_[depth_++] = &list;
+        }
+
+        void end_list() noexcept
+        {
+            --depth_;
+        }
+
+        void byte_value(std::string_view name, std::int8_t value)
+        {
+            add(tag_type::tag_byte, name).integer = value;
+        }
+
+        void short_value(std::string_view name, std::int16_t value)
+        {
+            add(tag_type::tag_short, name).integer = value;
+        }
+
+        void int_value(std::string_view name, std::int32_t value)
+        {
+            add(tag_type::tag_int, name).integer = value;
+        }
+
+        void long_value(std::string_view name, std::int64_t value)
+        {
+            add(tag_type::tag_long, name).integer = value;
+        }
+
+        void float_value(std::string_view name, float value)
+        {
+            add(tag_type::tag_float, name).floating = value;
+        }
+
+        void double_value(std::string_view name, double value)
+        {
+            add(tag_type::tag_double, name).floating = value;
+        }
+
+        void string_value(std::string_view name, std::string_view value)
+        {
+            auto& string{ add(tag_type::tag_string, name) };
+            auto copy{ document_.copy_string(value) };
+            string.data = copy.data();
+            string.size = copy.size();
+        }
+
+        void byte_array(std::string_view name, big_endian_array<std::int8_t> values)
+        {
+            add_array(tag_type::tag_byte_array, name, values);
+        }
+
+        void int_array(std::string_view name, big_endian_array<std::int32_t> values)
+        {
+            add_array(tag_type::tag_int_array, name, values);
+        }
+
+        void long_array(std::string_view name, big_endian_array<std::int64_t> values)
+        {
+            add_array(tag_type::tag_long_array, name, values);
+        }
+    };
+
+    document::document(std::size_t initial_size) :
+        arena_{ initial_size }, root_{}
+    {
+    }
+
+    std::string_view document::copy_string(std::string_view value)
+    {
+        if (value.empty())
+        {
+            return {};
+        }
+        auto copy{ static_cast<char*>(arena_.allocate(value.size(), 1)) };
+        std::memcpy(copy, value.data(), value.size());
+        return { copy, value.size() };
+    }
+
+    const void* document::copy_array(const void* data, std::size_t count, std::size_t width, bool swap)
+    {
+        if (!count)
+        {
+            return nullptr;
+        }
+        auto copy{ arena_.allocate(count * width, width) };
+        if (swap)
+        {
+            byteswap_copy(data, copy, count, width);
+        }
+        else
+        {
+            std::memcpy(copy, data, count * width);
+        }
+        return copy;
+    }
+
+    std::size_t document::parse(std::span<const std::byte> data)
+    {
+        clear();
+        document_builder builder{ *this };
+        try
+        {
+            return nbt::parse(data, builder);
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
+    }
+
+    void document::clear() noexcept
+    {
+        arena_.release();
+        root_ = nullptr;
+    }
+
+    node& document::create_root(tag_type type, std::string_view name)
+    {
+        clear();
+        root_ = static_cast<node*>(arena_.allocate(sizeof(node), alignof(node)));
+        *root_ = { .type = type, .element = tag_type::tag_end, .name = copy_string(name) };
+        return *root_;
+    }
+
+    node& document::add(node& parent, tag_type type, std::string_view name)
+    {
+        if (parent.type == tag_type::tag_list)
+        {
+            if (parent.element == tag_type::tag_end && !parent.size)
+            {
+                parent.element = type;
+            }
+            if (parent.element != type)
+            {
+                throw std::logic_error{ fmt::format("Can't add {} to a list of {}", get_tag_name(type),
+                    get_tag_name(parent.element)) };
+            }
+            name = {};
+        }
+        else if (parent.type != tag_type::tag_compound)
+        {
+            throw std::logic_error{ fmt::format("Can't add children to {}", get_tag_name(parent.type)) };
+        }
+
+        auto child{ static_cast<node*>(arena_.allocate(sizeof(node), alignof(node))) };
+        *child = { .type = type, .element = tag_type::tag_end, .name = copy_string(name) };
+        if (parent.last)
+        {
+            parent.last->next = child;
+        }
+        else
+        {
+            parent.first = child;
+        }
+        parent.last = child;
+        ++parent.size;
+        return *child;
+    }
+
+    node& document::add_integer(node& parent, tag_type type, std::string_view name, std::int64_t value)
+    {
+        auto& child{ add(parent, type, name) };
+        child.integer = value;
+        return child;
+    }
+
+    node& document::add_floating(node& parent, tag_type type, std::string_view name, double value)
+    {
+        auto& child{ add(parent, type, name) };
+        child.floating = value;
+        return child;
+    }
+
+    node& document::add_string(node& parent, std::string_view name, std::string_view value)
+    {
+        auto& child{ add(parent, tag_type::tag_string, name) };
+        auto copy{ copy_string(value) };
+        child.data = copy.data();
+        child.size = copy.size();
+        return child;
+    }
+
+    node& document::add_byte_array(node& parent, std::string_view name, std::span<const std::int8_t> values)
+    {
+        auto& child{ add(parent, tag_type::tag_byte_array, name) };
+        child.data = copy_array(values.data(), values.size(), sizeof(std::int8_t), false);
+        child.size = values.size();
+        return child;
+    }
+
+    node& document::add_int_array(node& parent, std::string_view name, std::span<const std::int32_t> values)
+    {
+        auto& child{ add(parent, tag_type::tag_int_array, name) };
+        child.data = copy_array(values.data(), values.size(), sizeof(std::int32_t), false);
+        child.size = values.size();
+        return child;
+    }
+
+    node& document::add_long_array(node& parent, std::string_view name, std::span<const std::int64_t> values)
+    {
+        auto& child{ add(parent, tag_type::tag_long_array, name) };
+        child.data = copy_array(values.data(), values.size(), sizeof(std::int64_t), false);
+        child.size = values.size();
+        return child;
+    }
+
+    void document::set_element(node& list, tag_type element)
+    {
+        if (list.type != tag_type::tag_list || list.size)
+        {
+            throw std::logic_error{ "Only the element type of an empty list can be set" };
+        }
+        list.element = element;
+    }
+}
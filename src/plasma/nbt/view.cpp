@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <plasma/nbt/view.h>
+
+namespace plasma::nbt
+{
+    namespace
+    {
+        void expect(tag_type actual, tag_type expected)
+        {
+            if (actual != expected)
+            {
+                throw parse_error{ fmt::format("Expected {} but found {}", get_tag_name(expected),
+                    get_tag_name(actual)) };
+            }
+        }
+    }
+
+    view::view(std::span<const std::byte> data) :
+        view{}
+    {
+        cursor input{ data };
+        type_ = static_cast<tag_type>(input.read<std::uint8_t>());
+        if (type_ == tag_type::tag_end)
+        {
+            return;
+        }
+        name_ = input.read_string();
+        data_ = data.subspan(input.position());
+    }
+
+    std::size_t view::get_payload_size() const
+    {
+        if (type_ == tag_type::tag_end)
+        {
+            return 0;
+        }
+        cursor input{ data_ };
+        null_handler skip{};
+        parse_payload(input, type_, name_, skip);
+        return input.position();
+    }
+
+    view view::find(std::string_view name) const
+    {
+        expect(type_, tag_type::tag_compound);
+        cursor input{ data_ };
+        null_handler skip{};
+        while (true)
+        {
+            auto type{ static_cast<tag_type>(input.read<std::uint8_t>()) };
+            if (type == tag_type::tag_end)
+            {
+                return {};
+            }
+            auto child{ input.read_string() };
+            if (child == name)
+            {
+                return { data_.subspan(input.position()), type, child };
+            }
+            parse_payload(input, type, child, skip);
+        }
+    }
+
+    tag_type view::get_element() const
+    {
+        expect(type_, tag_type::tag_list);
+        cursor input{ data_ };
+        return static_cast<tag_type>(input.read<std::uint8_t>());
+    }
+
+    std::size_t view::get_size() const
+    {
+        cursor input{ data_ };
+        switch (type_)
+        {
+        case tag_type::tag_list:
+            input.read<std::uint8_t>();
+            return input.read_size();
+        case tag_type::tag_byte_array:
+        case tag_type::tag_int_array:
+        case tag_type::tag_long_array:
+            return input.read_size();
+        case tag_type::tag_string:
+            return input.read<std::uint16_t>();
+        case tag_type::tag_compound:
+        {
+            std::size_t size{};
+            for_each([&size](const view&)
+            {
+                ++size;
+            });
+            return size;
+        }
+        default:
+            throw parse_error{ fmt::format("{} has no size", get_tag_name(type_)) };
+        }
+    }
+
+    std::int64_t view::as_integer() const
+    {
+        switch (type_)
+        {
+        case tag_type::tag_byte:
+            return as_byte();
+        case tag_type::tag_short:
+            return as_short();
+        case tag_type::tag_int:
+            return as_int();
+        case tag_type::tag_long:
+            return as_long();
+        default:
+            throw parse_error{ fmt::format("Expected an integral tag but found {}", get_tag_name(type_)) };
+        }
+    }
+
+    std::string_view view::as_string() const
+    {
+        expect(type_, tag_type::tag_string);
+        cursor input{ data_ };
+        return input.read_string();
+    }
+
+    big_endian_array<std::int8_t> view::as_byte_array() const
+    {
+        expect(type_, tag_type::tag_byte_array);
+        cursor input{ data_ };
+        return input.read_array<std::int8_t>();
+    }
+
+    big_endian_array<std::int32_t> view::as_int_array() const
+    {
+        expect(type_, tag_type::tag_int_array);
+        cursor input{ data_ };
+        return input.read_array<std::int32_t>();
+    }
+
+    big_endian_array<std::int64_t> view::as_long_array() const
+    {
+        expect(type_, tag_type::tag_long_array);
+        cursor input{ data_ };
+        return input.read_array<std::int64_t>();
+    }
+}
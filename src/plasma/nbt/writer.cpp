@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <plasma/nbt/byteswap.h>
+#include <plasma/nbt/document.h>
+#include <plasma/nbt/view.h>
+#include <plasma/nbt/writer.h>
+
+namespace plasma::nbt
+{
+    writer::writer(std::vector<std::byte>& out) :
+        out_{ out }
+    {
+        stack_.reserve(16);
+    }
+
+    std::byte* writer::grow(std::size_t size)
+    {
+        auto offset{ out_.size() };
+        out_.resize(offset + size);
+        return out_.data() + offset;
+    }
+
+    void writer::write_name(std::string_view name)
+    {
+        if (name.size() > std::numeric_limits<std::uint16_t>::max())
+        {
+            throw std::length_error{ fmt::format("NBT string of {} bytes is too long", name.size()) };
+        }
+        auto bytes{ grow(2 + name.size()) };
+        store_big_endian(bytes, static_cast<std::uint16_t>(name.size()));
+        if (!name.empty())
+        {
+            std::memcpy(bytes + 2, name.data(), name.size());
+        }
+    }
+
+    void writer::write_header(tag_type type, std::string_view name)
+    {
+        if (!stack_.empty() && !stack_.back().compound)
+        {
+            auto& list{ stack_.back() };
+            if (list.element != type)
+            {
+                throw std::logic_error{ fmt::format("Can't write {} to a list of {}", get_tag_name(type),
+                    get_tag_name(list.element)) };
+            }
+            ++list.size;
+            return;
+        }
+        *grow(1) = static_cast<std::byte>(type);
+        write_name(name);
+    }
+
+    void writer::write_array(tag_type type, std::string_view name, const void* data, std::size_t count,
+        std::size_t width)
+    {
+        if (count > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+        {
+            throw std::length_error{ fmt::format("NBT array of {} elements is too long", count) };
+        }
+        write_header(type, name);
+        auto bytes{ grow(4 + count * width) };
+        store_big_endian(bytes, static_cast<std::int32_t>(count));
+        byteswap_copy(data, bytes + 4, count, width);
+    }
+
+    void writer::write_raw_array(tag_type type, std::string_view name, std::span<const std::byte> bytes,
+        std::size_t count)
+    {
+        if (count > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+        {
+            throw std::length_error{ fmt::format("NBT array of {} elements is too long", count) };
+        }
+        write_header(type, name);
+        auto out{ grow(4 + bytes.size()) };
+        store_big_endian(out, static_cast<std::int32_t>(count));
+        if (!bytes.empty())
+        {
+            std::memcpy(out + 4, bytes.data(), bytes.size());
+        }
+    }
+
+    void writer::begin_compound(std::string_view name)
+    {
+        if (stack_.size() == max_depth)
+        {
+            throw std::length_error{ "NBT nested too deeply" };
+        }
+        write_header(tag_type::tag_compound, name);
+        stack_.push_back({ .compound = true, .element = tag_type::tag_end, .size_offset = 0, .size = 0 });
+    }
+
+    void writer::end_compound()
+    {
+        if (stack_.empty() || !stack_.back().compound)
+        {
+            throw std::logic_error{ "No compound to end" };
+        }
+        stack_.pop_back();
+        *grow(1) = static_cast<std::byte>(tag_type::tag_end);
+    }
+
+    void writer::begin_list(std::string_view name, tag_type element)
+    {
+        if (stack_.size() == max_depth)
+        {
+            throw std::length_error{ "NBT nested too deeply" };
+        }
+        write_header(tag_type::tag_list, name);
+        *grow(1) = static_cast<std::byte>(element);
+        auto offset{ out_.size() };
+        grow(4);
+        stack_.push_back({ .compound = false, .element = element, .size_offset = offset, .size = 0 });
+    }
+
+    void writer::end_list()
+    {
+        if (stack_.empty() || stack_.back().compound)
+        {
+            throw std::logic_error{ "No list to end" };
+        }
+        auto& list{ stack_.back() };
+        if (list.element == tag_type::tag_end && list.size)
+        {
+            throw std::logic_error{ "List of TAG_End isn't empty" };
+        }
+        store_big_endian(out_.data() + list.size_offset, list.size);
+        stack_.pop_back();
+    }
+
+    void writer::write_string(std::string_view name, std::string_view value)
+    {
+        write_header(tag_type::tag_string, name);
+        write_name(value);
+    }
+
+    void writer::write_byte_array(std::string_view name, std::span<const std::int8_t> values)
+    {
+        write_array(tag_type::tag_byte_array, name, values.data(), values.size(), sizeof(std::int8_t));
+    }
+
+    void writer::write_int_array(std::string_view name, std::span<const std::int32_t> values)
+    {
+        write_array(tag_type::tag_int_array, name, values.data(), values.size(), sizeof(std::int32_t));
+    }
+
+    void writer::write_long_array(std::string_view name, std::span<const std::int64_t> values)
+    {
+        write_array(tag_type::tag_long_array, name, values.data(), values.size(), sizeof(std::int64_t));
+    }
+
+    void writer::write_int_array(std::string_view name, big_endian_array<std::int32_t> values)
+    {
+        write_raw_array(tag_type::tag_int_array, name, values.bytes(), values.size());
+    }
+
+    void writer::write_long_array(std::string_view name, big_endian_array<std::int64_t> values)
+    {
+        write_raw_array(tag_type::tag_long_array, name, values.bytes(), values.size());
+    }
+
+    void writer::write(const node& value)
+    {
+        switch (value.type)
+        {
+        case tag_type::tag_byte:
+            write_byte(value.name, static_cast<std::int8_t>(value.integer));
+            break;
+        case tag_type::tag_short:
+            write_short(value.name, static_cast<std::int16_t>(value.integer));
+            break;
+        case tag_type::tag_int:
+            write_int(value.name, static_cast<std::int32_t>(value.integer));
+            break;
+        case tag_type::tag_long:
+            write_long(value.name, value.integer);
+            break;
+        case tag_type::tag_float:
+            write_float(value.name, static_cast<float>(value.floating));
+            break;
+        case tag_type::tag_double:
+            write_double(value.name, value.floating);
+            break;
+        case tag_type::tag_string:
+            write_string(value.name, value.as_string());
+            break;
+        case tag_type::tag_byte_array:
+            write_byte_array(value.name, value.as_byte_array());
+            break;
+        case tag_type::tag_int_array:
+            write_int_array(value.name, value.as_int_array());
+            break;
+        case tag_type::tag_long_array:
+            write_long_array(value.name, value.as_long_array());
+            break;
+        case tag_type::tag_list:
+            begin_list(value.name, value.element);
+            for (auto child{ value.first }; child; child = child->next)
+            {
+                write(*child);
+            }
+            end_list();
+            break;
+        case tag_type::tag_compound:
+            begin_compound(value.name);
+            for (auto child{ value.first }; child; child = child->next)
+            {
+                write(*child);
+            }
+            end_compound();
+            break;
+        default:
+            throw std::logic_error{ fmt::format("Can't write {}", get_tag_name(value.type)) };
+        }
+    }
+
+    void writer::write(std::string_view name, const view& value)
+    {
+        auto payload{ value.get_payload() };
+        write_header(value.get_type(), name);
+        auto bytes{ grow(payload.size()) };
+        std::memcpy(bytes, payload.data(), payload.size());
+    }
+}
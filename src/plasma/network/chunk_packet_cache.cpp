@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <chrono>
+#include <span>
+
+#include <plasma/nbt/writer.h>
+#include <plasma/network/chunk_packet_cache.h>
+#include <plasma/network/packet_writer.h>
+
+namespace plasma::network
+{
+    namespace
+    {
+        // Clientbound play packet ids of protocol 754.
+        constexpr std::int32_t chunk_data_packet{ 0x20 };
+        constexpr std::int32_t update_light_packet{ 0x23 };
+
+        constexpr std::size_t biome_count{ 1024 };
+        constexpr std::int32_t plains_biome{ 1 };
+        // Light masks cover the section below the world, the 16 sections and the one above it.
+        constexpr std::size_t light_sections{ plasma::world::chunk::section_count + 2 };
+
+        std::uint64_t get_key(std::int32_t x, std::int32_t z) noexcept
+        {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(z);
+        }
+
+        // MOTION_BLOCKING and WORLD_SURFACE, both taken as one above the highest block that isn't air: 256 nine bit
+        // entries, seven to a long.
+        void write_heightmaps(const plasma::world::chunk& chunk, std::vector<std::byte>& out)
+        {
+            std::array<std::int64_t, 37> packed{};
+            for (std::uint32_t z{}; z < 16; ++z)
+            {
+                for (std::uint32_t x{}; x < 16; ++x)
+                {
+                    std::uint64_t height{};
+                    for (auto section{ plasma::world::chunk::section_count }; section-- > 0 && !height;)
+                    {
+                        const auto& blocks{ chunk.get_section(section) };
+                        if (blocks.empty())
+                        {
+                            continue;
+                        }
+                        for (std::uint32_t y{ 16 }; y-- > 0;)
+                        {
+                            if (!plasma::world::chunk_section::is_air(blocks.get(x, y, z)))
+                            {
+                                height = section * 16 + y + 1;
+                                break;
+                            }
+                        }
+                    }
+                    auto index{ z * 16 + x };
+                    packed[index / 7] |= static_cast<std::int64_t>(height << (index % 7 * 9));
+                }
+            }
+            out.clear();
+            nbt::writer writer{ out };
+            writer.begin_compound();
+            writer.write_long_array("MOTION_BLOCKING", packed);
+            writer.write_long_array("WORLD_SURFACE", packed);
+            writer.end_compound();
+        }
+    }
+
+    chunk_packet_cache::chunk_packet_cache(std::int32_t threshold, std::int32_t level, std::size_t max_bytes,
+        compression_statistics& statistics) :
+        threshold_{ threshold }, max_bytes_{ max_bytes }, compressor_{ level }, compression_statistics_{ statistics },
+        bytes_{}, hits_{}, misses_{}, invalidations_{}, evictions_{}, bytes_saved_{}, encode_nanoseconds_{}
+    {
+    }
+
+    void chunk_packet_cache::append_frame(std::vector<std::byte>& out, std::vector<std::byte> frame)
+    {
+        if (threshold_ < 0)
+        {
+            out.insert(out.end(), frame.begin(), frame.end());
+            return;
+        }
+        append_compressed_frame(compressor_, std::span<const std::byte>{ frame }.subspan(packet_writer::header_size),
+            static_cast<std::size_t>(threshold_), out, compression_statistics_);
+    }
+
+    std::shared_ptr<const std::vector<std::byte>> chunk_packet_cache::encode(const plasma::world::chunk& chunk)
+    {
+        auto started{ std::chrono::steady_clock::now() };
+        std::vector<std::byte> frames{};
+
+        std::int32_t sky_mask{};
+        std::int32_t block_mask{};
+        for (std::size_t i{}; i < plasma::world::chunk::section_count; ++i)
+        {
+            sky_mask |= chunk.get_sky_light(i) ? 1 << (i + 1) : 0;
+            block_mask |= chunk.get_block_light(i) ? 1 << (i + 1) : 0;
+        }
+        // Open sky above the world.
+        sky_mask |= 1 << (light_sections - 1);
+        constexpr std::int32_t all_sections{ (1 << light_sections) - 1 };
+        packet_writer light{ update_light_packet, 2 * light_sections * (plasma::world::nibble_array::size + 3) };
+        light.write_varint(chunk.get_x()).write_varint(chunk.get_z()).write_bool(true).write_varint(sky_mask)
+            .write_varint(block_mask).write_varint(all_sections & ~sky_mask).write_varint(all_sections & ~block_mask);
+        for (std::size_t i{}; i < plasma::world::chunk::section_count; ++i)
+        {
+            if (const auto& sky{ chunk.get_sky_light(i) })
+            {
+                light.write_varint(plasma::world::nibble_array::size).write_bytes(sky->get_bytes());
+            }
+        }
+        light.write_varint(plasma::world::nibble_array::size)
+            .write_bytes(plasma::world::nibble_array::get_full()->get_bytes());
+        for (std::size_t i{}; i < plasma::world::chunk::section_count; ++i)
+        {
+            if (const auto& block{ chunk.get_block_light(i) })
+            {
+                light.write_varint(plasma::world::nibble_array::size).write_bytes(block->get_bytes());
+            }
+        }
+        append_frame(frames, light.finish());
+
+        std::int32_t section_mask{};
+        sections_.clear();
+        for (std::size_t i{}; i < plasma::world::chunk::section_count; ++i)
+        {
+            const auto& section{ chunk.get_section(i) };
+            if (!section.empty())
+            {
+                section_mask |= 1 << i;
+                section.write(sections_);
+            }
+        }
+        write_heightmaps(chunk, heightmaps_);
+        packet_writer data{ chunk_data_packet, heightmaps_.size() + biome_count + sections_.size() + 32 };
+        data.write_int(chunk.get_x()).write_int(chunk.get_z()).write_bool(true).write_varint(section_mask)
+            .write_bytes(heightmaps_).write_varint(static_cast<std::int32_t>(biome_count));
+        for (std::size_t i{}; i < biome_count; ++i)
+        {
+            data.write_varint(plains_biome);
+        }
+        data.write_varint(static_cast<std::int32_t>(sections_.size())).write_bytes(sections_).write_varint(0);
+        append_frame(frames, data.finish());
+
+        encode_nanoseconds_ += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        return std::make_shared<const std::vector<std::byte>>(std::move(frames));
+    }
+
+    void chunk_packet_cache::erase(std::unordered_map<std::uint64_t, entry>::iterator found)
+    {
+        bytes_ -= found->second.frames->size();
+        recent_.erase(found->second.recent);
+        entries_.erase(found);
+    }
+
+    std::shared_ptr<const std::vector<std::byte>> chunk_packet_cache::get(const plasma::world::chunk& chunk)
+    {
+        auto key{ get_key(chunk.get_x(), chunk.get_z()) };
+        auto found{ entries_.find(key) };
+        if (found != entries_.end())
+        {
+            if (found->second.revision == chunk.get_revision())
+            {
+                ++hits_;
+                bytes_saved_ += found->second.frames->size();
+                recent_.splice(recent_.begin(), recent_, found->second.recent);
+                return found->second.frames;
+            }
+            ++invalidations_;
+            erase(found);
+        }
+        ++misses_;
+        auto frames{ encode(chunk) };
+        recent_.push_front(key);
+        entries_.emplace(key, entry{ .revision = chunk.get_revision(), .frames = frames, .recent = recent_.begin() });
+        bytes_ += frames->size();
+        while (bytes_ > max_bytes_ && recent_.size() > 1)
+        {
+            // Connections still writing an evicted entry keep its buffer alive.
+            erase(entries_.find(recent_.back()));
+            ++evictions_;
+        }
+        return frames;
+    }
+
+    void chunk_packet_cache::invalidate(std::int32_t x, std::int32_t z)
+    {
+        auto found{ entries_.find(get_key(x, z)) };
+        if (found != entries_.end())
+        {
+            ++invalidations_;
+            erase(found);
+        }
+    }
+
+    chunk_packet_statistics chunk_packet_cache::get_statistics() const noexcept
+    {
+        return {
+            .entries = entries_.size(),
+            .bytes = bytes_,
+            .hits = hits_,
+            .misses = misses_,
+            .invalidations = invalidations_,
+            .evictions = evictions_,
+            .bytes_saved = bytes_saved_,
+            .encode_nanoseconds = encode_nanoseconds_
+        };
+    }
+}
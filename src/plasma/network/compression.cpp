@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include <plasma/network/compression.h>
+#include <plasma/network/protocol.h>
+#include <plasma/network/varint.h>
+
+namespace plasma::network
+{
+    double compression_statistics::get_ratio() const noexcept
+    {
+        auto in{ bytes_in.load(std::memory_order_relaxed) };
+        return in ? static_cast<double>(bytes_out.load(std::memory_order_relaxed)) / static_cast<double>(in) : 1.0;
+    }
+
+    buffer_pool::buffer_pool(std::size_t max_pooled, std::size_t max_capacity) :
+        max_pooled_{ max_pooled }, max_capacity_{ max_capacity }
+    {
+    }
+
+    std::vector<std::byte> buffer_pool::acquire(std::size_t size)
+    {
+        std::vector<std::byte> buffer{};
+        {
+            std::lock_guard lock{ mutex_ };
+            if (!free_.empty())
+            {
+                buffer = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+        buffer.resize(size);
+        return buffer;
+    }
+
+    void buffer_pool::release(std::vector<std::byte> buffer)
+    {
+        if (buffer.capacity() > max_capacity_)
+        {
+            return;
+        }
+        buffer.clear();
+        std::lock_guard lock{ mutex_ };
+        if (free_.size() < max_pooled_)
+        {
+            free_.push_back(std::move(buffer));
+        }
+    }
+
+    std::shared_ptr<const std::vector<std::byte>> buffer_pool::share(std::vector<std::byte> buffer)
+    {
+        return { new std::vector<std::byte>{ std::move(buffer) }, [pool = shared_from_this()](std::vector<std::byte>* shared)
+        {
+            pool->release(std::move(*shared));
+            delete shared;
+        } };
+    }
+
+    compressor::compressor(int level) :
+        deflate_{}, inflate_{}
+    {
+        if (deflateInit(&deflate_, level) != Z_OK)
+        {
+            throw std::runtime_error{ "Failed to initialize deflate" };
+        }
+        if (inflateInit(&inflate_) != Z_OK)
+        {
+            deflateEnd(&deflate_);
+            throw std::runtime_error{ "Failed to initialize inflate" };
+        }
+    }
+
+    compressor::~compressor()
+    {
+        deflateEnd(&deflate_);
+        inflateEnd(&inflate_);
+    }
+
+    void compressor::compress(std::span<const std::byte> data, std::vector<std::byte>& out)
+    {
+        deflateReset(&deflate_);
+        auto offset{ out.size() };
+        out.resize(offset + deflateBound(&deflate_, static_cast<uLong>(data.size())));
+        deflate_.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data()));
+        deflate_.avail_in = static_cast<uInt>(data.size());
+        deflate_.next_out = reinterpret_cast<Bytef*>(out.data() + offset);
+        deflate_.avail_out = static_cast<uInt>(out.size() - offset);
+        if (deflate(&deflate_, Z_FINISH) != Z_STREAM_END)
+        {
+            throw std::runtime_error{ "Failed to deflate packet" };
+        }
+        out.resize(out.size() - deflate_.avail_out);
+    }
+
+    void compressor::decompress(std::span<const std::byte> data, std::span<std::byte> out)
+    {
+        inflateReset(&inflate_);
+        inflate_.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data()));
+        inflate_.avail_in = static_cast<uInt>(data.size());
+        inflate_.next_out = reinterpret_cast<Bytef*>(out.data());
+        inflate_.avail_out = static_cast<uInt>(out.size());
+        if (inflate(&inflate_, Z_FINISH) != Z_STREAM_END || inflate_.avail_out)
+        {
+            throw std::runtime_error{ "Badly compressed packet" };
+        }
+    }
+
+    void append_compressed_frame(compressor& compressor, std::span<const std::byte> packet, std::size_t threshold,
+        std::vector<std::byte>& out, compression_statistics& statistics)
+    {
+        auto frame_start{ out.size() };
+        out.resize(frame_start + 3);
+        if (packet.size() < threshold)
+        {
+            out.push_back(std::byte{ 0 });
+            out.insert(out.end(), packet.begin(), packet.end());
+        }
+        else
+        {
+            std::array<std::byte, 5> length{};
+            auto length_size{ write_varint(length.data(), static_cast<std::uint32_t>(packet.size())) };
+            out.insert(out.end(), length.begin(), length.begin() + length_size);
+            auto compressed_start{ out.size() };
+            auto start{ std::chrono::steady_clock::now() };
+            compressor.compress(packet, out);
+            auto elapsed{ std::chrono::steady_clock::now() - start };
+            statistics.packets_compressed.fetch_add(1, std::memory_order_relaxed);
+            statistics.bytes_in.fetch_add(packet.size(), std::memory_order_relaxed);
+            statistics.bytes_out.fetch_add(out.size() - compressed_start, std::memory_order_relaxed);
+            statistics.compress_nanoseconds.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        }
+        auto frame_length{ out.size() - frame_start - 3 };
+        if (frame_length > max_frame_size)
+        {
+            out.resize(frame_start);
+            throw std::length_error{ "Compressed packet exceeds the maximum frame size" };
+        }
+        out[frame_start] = static_cast<std::byte>((frame_length & 0x7f) | 0x80);
+        out[frame_start + 1] = static_cast<std::byte>(((frame_length >> 7) & 0x7f) | 0x80);
+        out[frame_start + 2] = static_cast<std::byte>(frame_length >> 14);
+    }
+}
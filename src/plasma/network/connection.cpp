@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/uuid/detail/md5.hpp>
+#include <fmt/format.h>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/network/connection.h>
+#include <plasma/network/inbound_message.h>
+#include <plasma/network/network_manager.h>
+#include <plasma/network/packet_reader.h>
+#include <plasma/network/packet_writer.h>
+#include <plasma/network/reactor.h>
+
+namespace plasma::network
+{
+    namespace
+    {
+        constexpr std::size_t initial_read_buffer_size{ 4096 };
+
+        std::atomic<std::uint64_t> next_connection_id{ 1 };
+
+        compressor& worker_compressor(int level)
+        {
+            thread_local std::unique_ptr<compressor> local{};
+            if (!local)
+            {
+                local = std::make_unique<compressor>(level);
+            }
+            return *local;
+        }
+
+        std::array<std::uint8_t, 16> offline_uuid(std::string_view name)
+        {
+            boost::uuids::detail::md5 hash{};
+            auto input{ fmt::format("OfflinePlayer:{}", name) };
+            hash.process_bytes(input.data(), input.size());
+            boost::uuids::detail::md5::digest_type digest{};
+            hash.get_digest(digest);
+            std::array<std::uint8_t, 16> uuid{};
+            std::memcpy(uuid.data(), digest, uuid.size());
+            uuid[6] = static_cast<std::uint8_t>((uuid[6] & 0x0f) | 0x30);
+            uuid[8] = static_cast<std::uint8_t>((uuid[8] & 0x3f) | 0x80);
+            return uuid;
+        }
+    }
+
+    connection::connection(reactor& reactor, boost::asio::ip::tcp::socket socket) :
+        reactor_{ reactor }, socket_{ std::move(socket) }, id_{ next_connection_id.fetch_add(1) },
+        state_{ connection_state::handshaking }, client_protocol_{}, player_uuid_{},
+        read_buffer_{ std::make_shared<std::vector<std::byte>>(initial_read_buffer_size) }, read_start_{}, read_end_{},
+        compression_threshold_{}, status_answered_{}, writing_{}, close_after_write_{}
+    {
+    }
+
+    void connection::start()
+    {
+        read();
+    }
+
+    void connection::send(std::vector<std::byte> frame)
+    {
+        boost::asio::post(socket_.get_executor(), [self = shared_from_this(), frame = std::move(frame)]() mutable
+        {
+            self->queue_write(std::move(frame));
+        });
+    }
+
+    void connection::send_batch(std::vector<std::byte> frames)
+    {
+        boost::asio::post(socket_.get_executor(), [self = shared_from_this(), frames = std::move(frames)]() mutable
+        {
+            self->queue_frames(std::move(frames));
+        });
+    }
+
+    void connection::send_shared(std::shared_ptr<const std::vector<std::byte>> frames)
+    {
+        boost::asio::post(socket_.get_executor(), [self = shared_from_this(), frames = std::move(frames)]() mutable
+        {
+            self->queue_encoded(std::move(frames));
+        });
+    }
+
+    void connection::disconnect(std::string reason)
+    {
+        boost::asio::post(socket_.get_executor(), [self = shared_from_this(), reason = std::move(reason)]
+        {
+            if (self->state_ == connection_state::closed)
+            {
+                return;
+            }
+            auto json{ fmt::format(R"({{"text":"{}"}})", json_escape(reason)) };
+            if (self->state_ == connection_state::login || self->state_ == connection_state::play)
+            {
+                auto id{ self->state_ == connection_state::login ? 0x00 : 0x19 };
+                self->queue_write(packet_writer{ id }.write_string(json).finish());
+                self->close_after_write_ = true;
+            }
+            else
+            {
+                self->close();
+            }
+        });
+    }
+
+    void connection::resume()
+    {
+        if (state_ != connection_state::closed)
+        {
+            read();
+        }
+    }
+
+    void connection::read()
+    {
+        auto& buffer{ *read_buffer_ };
+        if (read_start_ && buffer.size() - read_end_ < initial_read_buffer_size)
+        {
+            std::memmove(buffer.data(), buffer.data() + read_start_, read_end_ - read_start_);
+            read_end_ -= read_start_;
+            read_start_ = 0;
+        }
+        if (read_end_ == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+        socket_.async_read_some(
+            boost::asio::buffer(buffer.data() + read_end_, buffer.size() - read_end_),
+            [self = shared_from_this()](const boost::system::error_code& error, std::size_t transferred)
+            {
+                self->on_read(error, transferred);
+            });
+    }
+
+    void connection::on_read(const boost::system::error_code& error, std::size_t transferred)
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        if (error)
+        {
+            close();
+            return;
+        }
+        read_end_ += transferred;
+        reactor_.get_manager().get_metrics().received_bytes.add(transferred);
+        try
+        {
+            process();
+        }
+        catch (const std::exception& e)
+        {
+            logger lg{};
+            DBGF(lg, "Closing connection {}: {}", id_, e.what());
+            close();
+            return;
+        }
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        if (reactor_.is_backlogged())
+        {
+            reactor_.pause(shared_from_this());
+        }
+        else
+        {
+            read();
+        }
+    }
+
+    void connection::process()
+    {
+        std::size_t required{};
+        while (state_ != connection_state::closed && !close_after_write_)
+        {
+            std::span<const std::byte> data{ read_buffer_->data() + read_start_, read_end_ - read_start_ };
+            auto frame{ read_frame(data, max_frame_size) };
+            if (!frame)
+            {
+                break;
+            }
+            if (!frame->complete)
+            {
+                required = frame->size;
+                break;
+            }
+            read_start_ += frame->size;
+            handle_frame(frame->payload);
+        }
+
+        auto remaining{ read_end_ - read_start_ };
+        if (read_buffer_.use_count() > 1)
+        {
+            // Packets handed to the game thread still point into the buffer, continue in a fresh one.
+            auto buffer{ std::make_shared<std::vector<std::byte>>(
+                std::max({ read_buffer_->size(), required, initial_read_buffer_size })) };
+            std::memcpy(buffer->data(), read_buffer_->data() + read_start_, remaining);
+            read_buffer_ = std::move(buffer);
+            read_start_ = 0;
+            read_end_ = remaining;
+        }
+        else if (!remaining)
+        {
+            read_start_ = read_end_ = 0;
+        }
+        else if (read_buffer_->size() - read_start_ < required)
+        {
+            std::memmove(read_buffer_->data(), read_buffer_->data() + read_start_, remaining);
+            read_start_ = 0;
+            read_end_ = remaining;
+            read_buffer_->resize(std::max(read_buffer_->size(), required));
+        }
+    }
+
+    void connection::handle_frame(std::span<const std::byte> payload)
+    {
+        if (!compressor_)
+        {
+            handle_packet(payload, read_buffer_);
+            return;
+        }
+        packet_reader reader{ payload };
+        auto data_length{ static_cast<std::uint32_t>(reader.read_varint()) };
+        if (!data_length)
+        {
+            handle_packet(reader.read_remaining(), read_buffer_);
+            return;
+        }
+        if (data_length < compression_threshold_ || data_length > max_uncompressed_size)
+        {
+            throw std::runtime_error{ fmt::format("Badly compressed packet of size {}", data_length) };
+        }
+        auto& manager{ reactor_.get_manager() };
+        auto buffer{ manager.get_buffer_pool().acquire(data_length) };
+        auto start{ std::chrono::steady_clock::now() };
+        compressor_->decompress(reader.read_remaining(), buffer);
+        auto elapsed{ std::chrono::steady_clock::now() - start };
+        auto& statistics{ manager.get_compression_statistics() };
+        statistics.packets_decompressed.fetch_add(1, std::memory_order_relaxed);
+        statistics.bytes_decompressed.fetch_add(data_length, std::memory_order_relaxed);
+        statistics.decompress_nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+        auto packet{ manager.get_buffer_pool().share(std::move(buffer)) };
+        std::span<const std::byte> inflated{ *packet };
+        handle_packet(inflated, std::move(packet));
+    }
+
+    void connection::handle_packet(std::span<const std::byte> payload, std::shared_ptr<const std::vector<std::byte>> owner)
+    {
+        packet_reader reader{ payload };
+        auto id{ reader.read_varint() };
+        auto body{ reader.read_remaining() };
+        switch (state_)
+        {
+        case connection_state::handshaking:
+            handle_handshake(id, body);
+            break;
+        case connection_state::status:
+            handle_status(id, body);
+            break;
+        case connection_state::login:
+            handle_login(id, body);
+            break;
+        case connection_state::play:
+        {
+            if (reactor_.is_full())
+            {
+                throw std::runtime_error{ "The server fell too far behind its packets" };
+            }
+            auto message{ std::make_unique<inbound_message>() };
+            message->kind = inbound_message::kind_type::packet;
+            message->source = shared_from_this();
+            message->id = id;
+            message->buffer = std::move(owner);
+            message->payload = body;
+            reactor_.push(std::move(message));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void connection::handle_handshake(std::int32_t id, std::span<const std::byte> body)
+    {
+        if (id != 0x00)
+        {
+            throw std::runtime_error{ "Unexpected packet during handshake" };
+        }
+        packet_reader reader{ body };
+        client_protocol_ = reader.read_varint();
+        reader.read_string(255);
+        reader.read_unsigned_short();
+        switch (reader.read_varint())
+        {
+        case 1:
+        {
+            boost::system::error_code error{};
+            auto endpoint{ socket_.remote_endpoint(error) };
+            if (error || !reactor_.get_manager().try_acquire_status(endpoint.address()))
+            {
+                close();
+                return;
+            }
+            state_ = connection_state::status;
+            break;
+        }
+        case 2:
+            state_ = connection_state::login;
+            break;
+        default:
+            throw std::runtime_error{ "Invalid next state" };
+        }
+    }
+
+    void connection::handle_status(std::int32_t id, std::span<const std::byte> body)
+    {
+        switch (id)
+        {
+        case 0x00:
+            if (status_answered_)
+            {
+                throw std::runtime_error{ "Status request already handled" };
+            }
+            status_answered_ = true;
+            queue_write(reactor_.get_manager().get_status_frame());
+            break;
+        case 0x01:
+            queue_write(packet_writer{ 0x01 }.write_long(packet_reader{ body }.read_long()).finish());
+            close_after_write_ = true;
+            break;
+        default:
+            throw std::runtime_error{ "Unexpected packet during status" };
+        }
+    }
+
+    void connection::handle_login(std::int32_t id, std::span<const std::byte> body)
+    {
+        if (id != 0x00)
+        {
+            throw std::runtime_error{ "Unexpected packet during login" };
+        }
+        player_name_ = packet_reader{ body }.read_string(16);
+        if (client_protocol_ != protocol_version)
+        {
+            auto reason{ fmt::format("Outdated {}, please use {}",
+                client_protocol_ < protocol_version ? "client" : "server", protocol_name) };
+            queue_write(packet_writer{ 0x00 }.write_string(fmt::format(R"({{"text":"{}"}})", reason)).finish());
+            close_after_write_ = true;
+            return;
+        }
+        player_uuid_ = offline_uuid(player_name_);
+        auto& manager{ reactor_.get_manager() };
+        auto threshold{ manager.get_compression_threshold() };
+        // Built before the player is counted, so nothing can throw between taking a slot and entering play.
+        auto deflater{ threshold >= 0 ? std::make_unique<compressor>(manager.get_compression_level()) : nullptr };
+        if (!manager.try_player_join())
+        {
+            queue_write(packet_writer{ 0x00 }.write_string(R"({"text":"The server is full"})").finish());
+            close_after_write_ = true;
+            return;
+        }
+        if (deflater)
+        {
+            queue_write(packet_writer{ 0x03 }.write_varint(threshold).finish());
+            compressor_ = std::move(deflater);
+            compression_threshold_ = static_cast<std::size_t>(threshold);
+        }
+        queue_write(packet_writer{ 0x02 }.write_uuid(player_uuid_).write_string(player_name_).finish());
+        state_ = connection_state::play;
+
+        auto message{ std::make_unique<inbound_message>() };
+        message->kind = inbound_message::kind_type::joined;
+        message->source = shared_from_this();
+        reactor_.push(std::move(message));
+    }
+
+    void connection::queue_write(std::vector<std::byte> frame)
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        if (!compressor_)
+        {
+            auto& batch{ ready_batch() };
+            batch.insert(batch.end(), frame.begin(), frame.end());
+        }
+        else
+        {
+            auto& manager{ reactor_.get_manager() };
+            auto packet{ std::span<const std::byte>{ frame }.subspan(packet_writer::header_size) };
+            auto offload_size{ manager.get_offload_size() };
+            if (offload_size && packet.size() >= offload_size)
+            {
+                offload_write(std::move(frame));
+                return;
+            }
+            append_compressed_frame(*compressor_, packet, compression_threshold_, ready_batch(),
+                manager.get_compression_statistics());
+        }
+        if (!writing_)
+        {
+            write();
+        }
+    }
+
+    void connection::queue_write(std::shared_ptr<const std::vector<std::byte>> frame)
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        if (compressor_)
+        {
+            queue_write(std::vector<std::byte>{ frame->begin(), frame->end() });
+            return;
+        }
+        queue_encoded(std::move(frame));
+    }
+
+    void connection::queue_encoded(std::shared_ptr<const std::vector<std::byte>> frames)
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        pending_writes_.push_back({ .shared = std::move(frames), .ready = true });
+        if (!writing_)
+        {
+            write();
+        }
+    }
+
+    void connection::queue_frames(std::vector<std::byte> frames)
+    {
+        if (!compressor_)
+        {
+            queue_write(std::move(frames));
+            return;
+        }
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        auto& manager{ reactor_.get_manager() };
+        auto offload_size{ manager.get_offload_size() };
+        std::span<const std::byte> remaining{ frames };
+        while (remaining.size() >= packet_writer::header_size)
+        {
+            // packet_writer always pads the length to three bytes.
+            auto length{ static_cast<std::size_t>(remaining[0] & std::byte{ 0x7f })
+                | static_cast<std::size_t>(remaining[1] & std::byte{ 0x7f }) << 7
+                | static_cast<std::size_t>(remaining[2]) << 14 };
+            auto frame{ remaining.first(packet_writer::header_size + length) };
+            remaining = remaining.subspan(frame.size());
+            auto packet{ frame.subspan(packet_writer::header_size) };
+            if (offload_size && packet.size() >= offload_size)
+            {
+                offload_write(std::vector<std::byte>{ frame.begin(), frame.end() });
+                continue;
+            }
+            append_compressed_frame(*compressor_, packet, compression_threshold_, ready_batch(),
+                manager.get_compression_statistics());
+        }
+        if (!writing_)
+        {
+            write();
+        }
+    }
+
+    std::vector<std::byte>& connection::ready_batch()
+    {
+        if (pending_writes_.empty() || !pending_writes_.back().ready || pending_writes_.back().shared)
+        {
+            pending_writes_.push_back({ .data = reactor_.get_manager().get_buffer_pool().acquire(0), .ready = true });
+        }
+        return pending_writes_.back().data;
+    }
+
+    void connection::offload_write(std::vector<std::byte> frame)
+    {
+        // Deque elements keep their address while other batches are pushed and popped around them.
+        auto& batch{ pending_writes_.emplace_back() };
+        auto& manager{ reactor_.get_manager() };
+        manager.get_job_system().submit([self = shared_from_this(), &batch, &manager, frame = std::move(frame)]
+        {
+            auto data{ manager.get_buffer_pool().acquire(0) };
+            auto failed{ false };
+            try
+            {
+                append_compressed_frame(worker_compressor(manager.get_compression_level()),
+                    std::span<const std::byte>{ frame }.subspan(packet_writer::header_size),
+                    self->compression_threshold_, data, manager.get_compression_statistics());
+            }
+            catch (const std::exception& e)
+            {
+                logger lg{};
+                DBGF(lg, "Closing connection {}: {}", self->id_, e.what());
+                failed = true;
+            }
+            boost::asio::post(self->socket_.get_executor(), [self, &batch, data = std::move(data), failed]() mutable
+            {
+                batch.data = std::move(data);
+                batch.ready = true;
+                if (failed)
+                {
+                    self->close();
+                }
+                else if (!self->writing_)
+                {
+                    self->write();
+                }
+            });
+        });
+    }
+
+    void connection::write()
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        auto& pool{ reactor_.get_manager().get_buffer_pool() };
+        for (auto& batch : active_writes_)
+        {
+            pool.release(std::move(batch.data));
+        }
+        active_writes_.clear();
+        write_buffers_.clear();
+        while (!pending_writes_.empty() && pending_writes_.front().ready)
+        {
+            auto& batch{ active_writes_.emplace_back(std::move(pending_writes_.front())) };
+            pending_writes_.pop_front();
+            const auto& bytes{ batch.shared ? *batch.shared : batch.data };
+            write_buffers_.push_back(boost::asio::buffer(bytes));
+        }
+        if (write_buffers_.empty())
+        {
+            if (close_after_write_ && pending_writes_.empty())
+            {
+                close();
+            }
+            return;
+        }
+        writing_ = true;
+        boost::asio::async_write(socket_, write_buffers_,
+            [self = shared_from_this()](const boost::system::error_code& error, std::size_t transferred)
+            {
+                self->writing_ = false;
+                if (error)
+                {
+                    self->close();
+                    return;
+                }
+                self->reactor_.get_manager().get_metrics().sent_bytes.add(transferred);
+                self->write();
+            });
+    }
+
+    void connection::close()
+    {
+        if (state_ == connection_state::closed)
+        {
+            return;
+        }
+        auto was_playing{ state_ == connection_state::play };
+        state_ = connection_state::closed;
+        boost::system::error_code ignored{};
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        socket_.close(ignored);
+        reactor_.get_manager().get_metrics().closed_connections.add();
+        if (was_playing)
+        {
+            reactor_.get_manager().player_left();
+            auto message{ std::make_unique<inbound_message>() };
+            message->kind = inbound_message::kind_type::left;
+            message->source = shared_from_this();
+            reactor_.push(std::move(message));
+        }
+    }
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <thread>
+
+#include <boost/asio/ip/address.hpp>
+#include <fmt/format.h>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/config/plasma_config.h>
+#include <plasma/network/protocol.h>
+#include <plasma/network/network_manager.h>
+#include <plasma/network/packet_writer.h>
+
+#include <version.hpp>
+
+namespace plasma::network
+{
+    namespace
+    {
+        std::string encode_base64(std::string_view data)
+        {
+            constexpr std::string_view alphabet{ "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/" };
+            std::string encoded{};
+            encoded.reserve((data.size() + 2) / 3 * 4);
+            std::size_t i{};
+            for (; i + 2 < data.size(); i += 3)
+            {
+                auto triple{ static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i])) << 16
+                    | static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i + 1])) << 8
+                    | static_cast<std::uint8_t>(data[i + 2]) };
+                encoded += alphabet[triple >> 18];
+                encoded += alphabet[(triple >> 12) & 0x3f];
+                encoded += alphabet[(triple >> 6) & 0x3f];
+                encoded += alphabet[triple & 0x3f];
+            }
+            if (auto left{ data.size() - i })
+            {
+                auto triple{ static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i])) << 16 };
+                if (left == 2)
+                {
+                    triple |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(data[i + 1])) << 8;
+                }
+                encoded += alphabet[triple >> 18];
+                encoded += alphabet[(triple >> 12) & 0x3f];
+                encoded += left == 2 ? alphabet[(triple >> 6) & 0x3f] : '=';
+                encoded += '=';
+            }
+            return encoded;
+        }
+
+        std::string load_favicon(const std::filesystem::path& path)
+        {
+            if (path.empty() || !exists(path))
+            {
+                return {};
+            }
+            std::ifstream stream{ path, std::ios::binary };
+            std::string data{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+            if (!data.starts_with("\x89PNG\r\n\x1a\n"))
+            {
+                logger lg{};
+                WRNF(lg, "Ignoring favicon {}, it is not a PNG image", path.string());
+                return {};
+            }
+            return "data:image/png;base64," + encode_base64(data);
+        }
+    }
+
+    network_manager::network_manager(const plasma::config::plasma_config& config, plasma::job::job_system& jobs,
+        plasma::metrics::metrics_registry& metrics) :
+        jobs_{ jobs }, bind_address_{ config.network.bind_address }, port_{ config.network.port }, motd_{ config.network.motd },
+        max_players_{ config.network.max_players }, favicon_{ load_favicon(config.network.status.favicon) },
+        online_players_{}, status_dirty_{ true },
+        status_limiter_{ config.network.status.requests_per_second, config.network.status.burst },
+        compression_threshold_{ config.network.compression.threshold },
+        compression_level_{ config.network.compression.level }, offload_size_{ config.network.compression.offload_size },
+        buffers_{ std::make_shared<buffer_pool>(128, 256 * 1024) }, compression_statistics_{},
+        metrics_{
+            .received_bytes = metrics.add_counter("plasma_network_received_bytes_total", "Bytes read from clients"),
+            .sent_bytes = metrics.add_counter("plasma_network_sent_bytes_total", "Bytes written to clients"),
+            .accepted_connections = metrics.add_counter("plasma_network_accepted_connections_total",
+                "Connections accepted, including status pings"),
+            .closed_connections = metrics.add_counter("plasma_network_closed_connections_total", "Connections closed"),
+            .paused_reads = metrics.add_counter("plasma_network_paused_reads_total",
+                "Reads paused until the game thread caught up with its inbound queue")
+        }
+    {
+        auto count{ config.network.reactor_threads };
+        if (!count)
+        {
+            count = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (std::size_t i{}; i < count; ++i)
+        {
+            reactors_.push_back(std::make_unique<reactor>(*this, i, config.network.inbound_queue_capacity));
+        }
+        rebuild_status();
+    }
+
+    network_manager::~network_manager()
+    {
+        stop();
+    }
+
+    void network_manager::start()
+    {
+        logger lg{};
+        boost::asio::ip::tcp::endpoint endpoint{ boost::asio::ip::make_address(bind_address_), port_ };
+#ifdef SO_REUSEPORT
+        for (auto& reactor : reactors_)
+        {
+            reactor->listen(endpoint, true, false);
+        }
+#else
+        reactors_.front()->listen(endpoint, false, true);
+#endif
+        for (auto& reactor : reactors_)
+        {
+            reactor->start();
+        }
+        INFF(lg, "Listening on {} port {} with {} reactor threads", endpoint.address().to_string(), endpoint.port(),
+            reactors_.size());
+    }
+
+    void network_manager::stop()
+    {
+        for (auto& reactor : reactors_)
+        {
+            reactor->stop();
+        }
+    }
+
+    bool network_manager::try_player_join() noexcept
+    {
+        auto online{ online_players_.load(std::memory_order_relaxed) };
+        do
+        {
+            if (online >= max_players_.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+        }
+        while (!online_players_.compare_exchange_weak(online, online + 1, std::memory_order_relaxed));
+        status_dirty_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void network_manager::player_left() noexcept
+    {
+        online_players_.fetch_sub(1, std::memory_order_relaxed);
+        status_dirty_.store(true, std::memory_order_release);
+    }
+
+    std::shared_ptr<const std::vector<std::byte>> network_manager::get_status_frame()
+    {
+        if (status_dirty_.load(std::memory_order_acquire)) [[unlikely]]
+        {
+            rebuild_status();
+        }
+        return status_frame_.load(std::memory_order_acquire);
+    }
+
+    void network_manager::reload_status(const plasma::config::plasma_config& config)
+    {
+        auto favicon{ load_favicon(config.network.status.favicon) };
+        {
+            std::lock_guard lock{ status_mutex_ };
+            motd_ = config.network.motd;
+            max_players_.store(config.network.max_players, std::memory_order_relaxed);
+            favicon_ = std::move(favicon);
+        }
+        status_dirty_.store(true, std::memory_order_release);
+    }
+
+    void network_manager::rebuild_status()
+    {
+        // Rebuilds are serialized and clear the flag before reading the player count, so a change that lands during
+        // one marks the status dirty again and the last frame stored is never stale. A frame is built in the
+        // constructor, so readers that see the flag cleared by another thread always find one.
+        std::lock_guard lock{ status_mutex_ };
+        if (!status_dirty_.exchange(false, std::memory_order_acq_rel))
+        {
+            return;
+        }
+        auto json{ fmt::format(
+            R"({{"version":{{"name":"Plasma {} {}","protocol":{}}},"players":{{"max":{},"online":{},"sample":[]}},)"
+            R"("description":{{"text":"{}"}}{}}})",
+            g_release_version, protocol_name, protocol_version, max_players_.load(std::memory_order_relaxed),
+            get_online_players(), json_escape(motd_),
+            favicon_.empty() ? std::string{} : fmt::format(R"(,"favicon":"{}")", favicon_)) };
+        status_frame_.store(std::make_shared<const std::vector<std::byte>>(packet_writer{ 0x00, json.size() + 8 }
+            .write_string(json).finish()), std::memory_order_release);
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <plasma/network/packet_reader.h>
+
+namespace plasma::network
+{
+    std::optional<frame> read_frame(std::span<const std::byte> data, std::size_t max_size)
+    {
+        auto length{ read_varint(data) };
+        if (!length)
+        {
+            if (data.size() >= 3)
+            {
+                throw std::runtime_error{ "Frame length is too big" };
+            }
+            return std::nullopt;
+        }
+        if (length->size > 3 || length->value <= 0 || static_cast<std::size_t>(length->value) > max_size)
+        {
+            throw std::runtime_error{ "Invalid frame length" };
+        }
+        auto size{ length->size + static_cast<std::size_t>(length->value) };
+        if (data.size() < size)
+        {
+            return frame{ .size = size, .complete = false, .payload = {} };
+        }
+        return frame{ .size = size, .complete = true, .payload = data.subspan(length->size, size - length->size) };
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdexcept>
+#include <utility>
+
+#include <plasma/network/protocol.h>
+#include <plasma/network/varint.h>
+#include <plasma/network/packet_writer.h>
+
+namespace plasma::network
+{
+    packet_writer::packet_writer(std::int32_t id, std::size_t reserve) :
+        frame_start_{}
+    {
+        buffer_.reserve(header_size + reserve);
+        buffer_.resize(header_size);
+        write_varint(id);
+    }
+
+    packet_writer::packet_writer(std::int32_t id, std::vector<std::byte> buffer) :
+        buffer_{ std::move(buffer) }, frame_start_{ buffer_.size() }
+    {
+        buffer_.resize(frame_start_ + header_size);
+        write_varint(id);
+    }
+
+    packet_writer& packet_writer::write_byte(std::uint8_t value)
+    {
+        buffer_.push_back(static_cast<std::byte>(value));
+        return *this;
+    }
+
+    packet_writer& packet_writer::write_bool(bool value)
+    {
+        return write_byte(value ? 1 : 0);
+    }
+
+    packet_writer& packet_writer::write_short(std::int16_t value)
+    {
+        return write_big_endian(value);
+    }
+
+    packet_writer& packet_writer::write_int(std::int32_t value)
+    {
+        return write_big_endian(value);
+    }
+
+    packet_writer& packet_writer::write_long(std::int64_t value)
+    {
+        return write_big_endian(value);
+    }
+
+    packet_writer& packet_writer::write_float(float value)
+    {
+        return write_big_endian(std::bit_cast<std::uint32_t>(value));
+    }
+
+    packet_writer& packet_writer::write_double(double value)
+    {
+        return write_big_endian(std::bit_cast<std::uint64_t>(value));
+    }
+
+    packet_writer& packet_writer::write_varint(std::int32_t value)
+    {
+        std::array<std::byte, 5> bytes{};
+        auto size{ network::write_varint(bytes.data(), static_cast<std::uint32_t>(value)) };
+        buffer_.insert(buffer_.end(), bytes.begin(), bytes.begin() + size);
+        return *this;
+    }
+
+    packet_writer& packet_writer::write_varlong(std::int64_t value)
+    {
+        std::array<std::byte, 10> bytes{};
+        auto size{ network::write_varlong(bytes.data(), static_cast<std::uint64_t>(value)) };
+        buffer_.insert(buffer_.end(), bytes.begin(), bytes.begin() + size);
+        return *this;
+    }
+
+    packet_writer& packet_writer::write_string(std::string_view value)
+    {
+        write_varint(static_cast<std::int32_t>(value.size()));
+        return write_bytes(std::as_bytes(std::span{ value }));
+    }
+
+    packet_writer& packet_writer::write_uuid(const std::array<std::uint8_t, 16>& value)
+    {
+        return write_bytes(std::as_bytes(std::span{ value }));
+    }
+
+    packet_writer& packet_writer::write_bytes(std::span<const std::byte> value)
+    {
+        buffer_.insert(buffer_.end(), value.begin(), value.end());
+        return *this;
+    }
+
+    std::vector<std::byte> packet_writer::finish()
+    {
+        auto length{ buffer_.size() - frame_start_ - header_size };
+        if (length > max_frame_size)
+        {
+            throw std::length_error{ "Packet exceeds the maximum frame size" };
+        }
+        buffer_[frame_start_] = static_cast<std::byte>((length & 0x7f) | 0x80);
+        buffer_[frame_start_ + 1] = static_cast<std::byte>(((length >> 7) & 0x7f) | 0x80);
+        buffer_[frame_start_ + 2] = static_cast<std::byte>(length >> 14);
+        return std::move(buffer_);
+    }
+}
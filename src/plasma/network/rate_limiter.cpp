@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+#include <plasma/network/rate_limiter.h>
+
+namespace plasma::network
+{
+    rate_limiter::rate_limiter(double rate, double burst) :
+        rate_{ rate }, burst_{ std::max(burst, 1.0) }
+    {
+    }
+
+    std::size_t rate_limiter::key_hash::operator()(const key_type& key) const noexcept
+    {
+        return std::hash<std::string_view>{}({ reinterpret_cast<const char*>(key.data()), key.size() });
+    }
+
+    rate_limiter::key_type rate_limiter::get_key(const boost::asio::ip::address& address) noexcept
+    {
+        if (address.is_v4())
+        {
+            return boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+        }
+        auto v6{ address.to_v6() };
+        auto key{ v6.to_bytes() };
+        if (!v6.is_v4_mapped())
+        {
+            std::fill(key.begin() + 8, key.end(), 0);
+        }
+        return key;
+    }
+
+    void rate_limiter::sweep(shard& shard, std::chrono::steady_clock::time_point now)
+    {
+        shard.swept = now;
+        while (!shard.recent.empty())
+        {
+            auto found{ shard.buckets.find(shard.recent.back()) };
+            const auto& bucket{ found->second };
+            // Addresses that have been quiet long enough to refill are indistinguishable from new ones.
+            if (bucket.tokens + std::chrono::duration<double>(now - bucket.updated).count() * rate_ < burst_)
+            {
+                break;
+            }
+            shard.buckets.erase(found);
+            shard.recent.pop_back();
+        }
+    }
+
+    bool rate_limiter::try_acquire(const boost::asio::ip::address& address)
+    {
+        if (rate_ <= 0)
+        {
+            return true;
+        }
+        auto key{ get_key(address) };
+        auto& shard{ shards_[key_hash{}(key) % shard_count] };
+        auto now{ std::chrono::steady_clock::now() };
+        std::lock_guard lock{ shard.mutex };
+        if (now - shard.swept >= sweep_interval)
+        {
+            sweep(shard, now);
+        }
+        auto found{ shard.buckets.find(key) };
+        if (found == shard.buckets.end())
+        {
+            if (shard.buckets.size() >= max_shard_size)
+            {
+                shard.buckets.erase(shard.recent.back());
+                shard.recent.pop_back();
+            }
+            shard.recent.push_front(key);
+            found = shard.buckets.emplace(key, bucket{ .tokens = burst_, .updated = now,
+                .recent = shard.recent.begin() }).first;
+        }
+        else
+        {
+            auto& refilled{ found->second };
+            refilled.tokens = std::min(burst_,
+                refilled.tokens + std::chrono::duration<double>(now - refilled.updated).count() * rate_);
+            refilled.updated = now;
+            shard.recent.splice(shard.recent.begin(), shard.recent, refilled.recent);
+        }
+        auto& bucket{ found->second };
+        if (bucket.tokens < 1)
+        {
+            return false;
+        }
+        bucket.tokens -= 1;
+        return true;
+    }
+}
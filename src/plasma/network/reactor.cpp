@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <memory>
+#include <utility>
+
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/detail/socket_option.hpp>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/network/connection.h>
+#include <plasma/network/network_manager.h>
+#include <plasma/network/reactor.h>
+
+namespace plasma::network
+{
+    reactor::reactor(network_manager& manager, std::size_t index, std::size_t queue_capacity) :
+        manager_{ manager }, index_{ index }, io_context_{ 1 }, work_guard_{ io_context_.get_executor() },
+        distribute_{}, next_reactor_{}, inbound_{ queue_capacity },
+        overflow_limit_{ queue_capacity }, retry_timer_{ io_context_ },
+        retry_pending_{}
+    {
+    }
+
+    reactor::~reactor()
+    {
+        stop();
+        inbound_.consume_all([](inbound_message* message)
+        {
+            delete message;
+        });
+        for (auto message : overflow_)
+        {
+            delete message;
+        }
+    }
+
+    void reactor::listen(const boost::asio::ip::tcp::endpoint& endpoint, bool reuse_port, bool distribute)
+    {
+        acceptor_.emplace(io_context_);
+        acceptor_->open(endpoint.protocol());
+        acceptor_->set_option(boost::asio::socket_base::reuse_address{ true });
+#ifdef SO_REUSEPORT
+        if (reuse_port)
+        {
+            acceptor_->set_option(boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>{ true });
+        }
+#endif
+        acceptor_->bind(endpoint);
+        acceptor_->listen();
+        distribute_ = distribute;
+    }
+
+    void reactor::start()
+    {
+        if (acceptor_)
+        {
+            accept();
+        }
+        thread_ = std::thread{ [this]
+        {
+            logger lg{};
+            TRCF(lg, "Reactor {} started", index_);
+            io_context_.run();
+            TRCF(lg, "Reactor {} stopped", index_);
+        } };
+    }
+
+    void reactor::stop()
+    {
+        work_guard_.reset();
+        io_context_.stop();
+        if (thread_.joinable())
+        {
+            thread_.join();
+        }
+    }
+
+    void reactor::accept()
+    {
+        auto& target{ distribute_ ? manager_.get_reactor(next_reactor_++ % manager_.get_reactor_count()) : *this };
+        acceptor_->async_accept(target.io_context_,
+            [this, &target](const boost::system::error_code& error, boost::asio::ip::tcp::socket socket)
+            {
+                if (error)
+                {
+                    if (error == boost::asio::error::operation_aborted)
+                    {
+                        return;
+                    }
+                    logger lg{};
+                    WRNF(lg, "Failed to accept a connection: {}", error.message());
+                }
+                else
+                {
+                    socket.set_option(boost::asio::ip::tcp::no_delay{ true });
+                    manager_.get_metrics().accepted_connections.add();
+                    auto created{ std::make_shared<connection>(target, std::move(socket)) };
+                    boost::asio::post(target.io_context_, [created]
+                    {
+                        created->start();
+                    });
+                }
+                accept();
+            });
+    }
+
+    void reactor::push(std::unique_ptr<inbound_message> message)
+    {
+        if (overflow_.empty() && inbound_.push(message.get()))
+        {
+            message.release();
+            return;
+        }
+        overflow_.push_back(message.release());
+        flush_overflow();
+    }
+
+    void reactor::pause(std::shared_ptr<connection> paused)
+    {
+        manager_.get_metrics().paused_reads.add();
+        paused_.push_back(std::move(paused));
+        flush_overflow();
+    }
+
+    void reactor::flush_overflow()
+    {
+        while (!overflow_.empty() && inbound_.push(overflow_.front()))
+        {
+            overflow_.pop_front();
+        }
+        if (overflow_.empty())
+        {
+            auto resumed{ std::exchange(paused_, {}) };
+            for (auto& paused : resumed)
+            {
+                paused->resume();
+            }
+            return;
+        }
+        if (retry_pending_)
+        {
+            return;
+        }
+        retry_pending_ = true;
+        retry_timer_.expires_after(std::chrono::milliseconds{ 1 });
+        retry_timer_.async_wait([this](const boost::system::error_code& error)
+        {
+            retry_pending_ = false;
+            if (!error)
+            {
+                flush_overflow();
+            }
+        });
+    }
+}
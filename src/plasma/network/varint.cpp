@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include <plasma/network/varint.h>
+
+namespace plasma::network
+{
+    namespace
+    {
+        constexpr std::uint64_t continuation_bits{ 0x8080808080808080 };
+
+        constexpr std::uint64_t payload_bits{ 0x7f7f7f7f7f7f7f7f };
+
+        std::optional<varint_result> read_varint_scalar(std::span<const std::byte> data)
+        {
+            std::uint32_t value{};
+            for (std::size_t i{}; i < 5; ++i)
+            {
+                if (i == data.size())
+                {
+                    return std::nullopt;
+                }
+                auto byte{ std::to_integer<std::uint32_t>(data[i]) };
+                value |= (byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80))
+                {
+                    return varint_result{ .value = static_cast<std::int32_t>(value), .size = i + 1 };
+                }
+            }
+            throw std::runtime_error{ "VarInt is too big" };
+        }
+
+        std::optional<varlong_result> read_varlong_scalar(std::span<const std::byte> data)
+        {
+            std::uint64_t value{};
+            for (std::size_t i{}; i < 10; ++i)
+            {
+                if (i == data.size())
+                {
+                    return std::nullopt;
+                }
+                auto byte{ std::to_integer<std::uint64_t>(data[i]) };
+                value |= (byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80))
+                {
+                    return varlong_result{ .value = static_cast<std::int64_t>(value), .size = i + 1 };
+                }
+            }
+            throw std::runtime_error{ "VarLong is too big" };
+        }
+
+        // Loads eight bytes at once and finds the terminating byte from the cleared continuation bits. Returns the
+        // payload bytes of the number (continuation bits still set) and its length, or a length of zero when the
+        // number does not end within the word.
+        inline std::uint64_t load_word(std::span<const std::byte> data, std::size_t& size) noexcept
+        {
+            std::uint64_t word{};
+            std::memcpy(&word, data.data(), sizeof(word));
+            if constexpr (std::endian::native == std::endian::big)
+            {
+                word = std::byteswap(word);
+            }
+            auto stops{ ~word & continuation_bits };
+            if (!stops)
+            {
+                size = 0;
+                return word;
+            }
+            size = static_cast<std::size_t>(std::countr_zero(stops) >> 3) + 1;
+            return size == 8 ? word : word & ((std::uint64_t{ 1 } << (size * 8)) - 1);
+        }
+
+        inline std::uint64_t compact_shift(std::uint64_t word) noexcept
+        {
+            word &= payload_bits;
+            word = (word & 0x007f007f007f007f) | ((word & 0x7f007f007f007f00) >> 1);
+            word = (word & 0x00003fff00003fff) | ((word & 0x3fff00003fff0000) >> 2);
+            return (word & 0x000000000fffffff) | ((word & 0x0fffffff00000000) >> 4);
+        }
+
+        std::optional<varint_result> read_varint_word(std::span<const std::byte> data)
+        {
+            if (data.size() < sizeof(std::uint64_t))
+            {
+                return read_varint_scalar(data);
+            }
+            std::size_t size{};
+            auto word{ load_word(data, size) };
+            if (!size || size > 5)
+            {
+                throw std::runtime_error{ "VarInt is too big" };
+            }
+            return varint_result{ .value = static_cast<std::int32_t>(compact_shift(word)), .size = size };
+        }
+
+        std::optional<varlong_result> read_varlong_word(std::span<const std::byte> data)
+        {
+            if (data.size() < sizeof(std::uint64_t))
+            {
+                return read_varlong_scalar(data);
+            }
+            std::size_t size{};
+            auto word{ load_word(data, size) };
+            if (!size)
+            {
+                return read_varlong_scalar(data);
+            }
+            return varlong_result{ .value = static_cast<std::int64_t>(compact_shift(word)), .size = size };
+        }
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define PLASMA_VARINT_BMI2
+        __attribute__((target("bmi2"))) std::optional<varint_result> read_varint_bmi2(std::span<const std::byte> data)
+        {
+            if (data.size() < sizeof(std::uint64_t))
+            {
+                return read_varint_scalar(data);
+            }
+            std::size_t size{};
+            auto word{ load_word(data, size) };
+            if (!size || size > 5)
+            {
+                throw std::runtime_error{ "VarInt is too big" };
+            }
+            return varint_result{ .value = static_cast<std::int32_t>(_pext_u64(word, payload_bits)), .size = size };
+        }
+
+        __attribute__((target("bmi2"))) std::optional<varlong_result> read_varlong_bmi2(std::span<const std::byte> data)
+        {
+            if (data.size() < sizeof(std::uint64_t))
+            {
+                return read_varlong_scalar(data);
+            }
+            std::size_t size{};
+            auto word{ load_word(data, size) };
+            if (!size)
+            {
+                return read_varlong_scalar(data);
+            }
+            return varlong_result{ .value = static_cast<std::int64_t>(_pext_u64(word, payload_bits)), .size = size };
+        }
+#endif
+
+        class codec
+        {
+        public:
+            const char* name;
+            std::optional<varint_result> (*read_varint)(std::span<const std::byte>);
+            std::optional<varlong_result> (*read_varlong)(std::span<const std::byte>);
+        };
+
+        codec select_codec() noexcept
+        {
+#ifdef PLASMA_VARINT_BMI2
+            // pext is microcoded and slow before Zen 3, only trust it on Intel.
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("bmi2") && __builtin_cpu_is("intel"))
+            {
+                return { .name = "bmi2", .read_varint = &read_varint_bmi2, .read_varlong = &read_varlong_bmi2 };
+            }
+#endif
+            return { .name = "word", .read_varint = &read_varint_word, .read_varlong = &read_varlong_word };
+        }
+
+        const codec selected_codec{ select_codec() };
+    }
+
+    std::size_t varint_size(std::uint32_t value) noexcept
+    {
+        return static_cast<std::size_t>(38 - std::countl_zero(value | 1)) / 7;
+    }
+
+    std::size_t write_varint(std::byte* out, std::uint32_t value) noexcept
+    {
+        std::size_t size{};
+        while (value >= 0x80)
+        {
+            out[size++] = static_cast<std::byte>(value | 0x80);
+            value >>= 7;
+        }
+        out[size++] = static_cast<std::byte>(value);
+        return size;
+    }
+
+    std::size_t write_varlong(std::byte* out, std::uint64_t value) noexcept
+    {
+        std::size_t size{};
+        while (value >= 0x80)
+        {
+            out[size++] = static_cast<std::byte>(value | 0x80);
+            value >>= 7;
+        }
+        out[size++] = static_cast<std::byte>(value);
+        return size;
+    }
+
+    std::optional<varint_result> read_varint(std::span<const std::byte> data)
+    {
+        return selected_codec.read_varint(data);
+    }
+
+    std::optional<varlong_result> read_varlong(std::span<const std::byte> data)
+    {
+        return selected_codec.read_varlong(data);
+    }
+
+    const char* get_varint_codec_name() noexcept
+    {
+        return selected_codec.name;
+    }
+}
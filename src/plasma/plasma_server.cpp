@@ -20,24 +20,91 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include <boost/program_options.hpp>
+#include <fmt/format.h>
+#include <mimalloc.h>
 
 #include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/log/logging_system.h>
 #include <plasma/config/plasma_config.h>
+#include <plasma/event/event_bus.h>
+#include <plasma/event/events.h>
+#include <plasma/network/connection.h>
+#include <plasma/network/network_manager.h>
+#include <plasma/network/packet_reader.h>
 #include <plasma/plugin/plugin.h>
+#include <plasma/util/startup_trace.h>
 #include <plasma/plasma_server.h>
 
 #include <version.hpp>
 
-extern bool g_color_enabled;
+extern std::atomic<bool> g_color_enabled;
 
 namespace plasma
 {
+    namespace
+    {
+        // Vanilla kicks players that claim to be beyond these.
+        constexpr double max_horizontal_position{ 3.0e7 };
+        constexpr double max_vertical_position{ 2.0e7 };
+
+        // Entity cells and tracker deltas assume finite positions within the world border.
+        bool is_valid_move(const plasma::event::player_move_event& moved) noexcept
+        {
+            return std::isfinite(moved.x) && std::isfinite(moved.y) && std::isfinite(moved.z)
+                && std::isfinite(moved.yaw) && std::isfinite(moved.pitch)
+                && std::abs(moved.x) <= max_horizontal_position && std::abs(moved.z) <= max_horizontal_position
+                && std::abs(moved.y) <= max_vertical_position;
+        }
+
+        std::atomic<plasma_server*> signalled_server{};
+
+        void handle_signal(int)
+        {
+            if (auto server{ signalled_server.load() })
+            {
+                server->stop();
+            }
+        }
+    }
+
     plasma_server::plasma_server(boost::program_options::variables_map vm) :
-        config_{}, vm_{ std::move(vm) }
+        config_{}, vm_{ std::move(vm) }, manager_{}, running_{}, exit_code_{}
     {
     }
 
+    // In the order run() stops them, for when it did not: reactors submit jobs, so they stop before the job system.
+    plasma_server::~plasma_server()
+    {
+        if (network_)
+        {
+            network_->stop();
+        }
+        backups_.reset();
+        lights_.reset();
+        chunks_.reset();
+        if (saver_)
+        {
+            saver_->stop();
+        }
+        if (jobs_)
+        {
+            jobs_->stop();
+        }
+    }
+
     const char* plasma_server::get_name() noexcept
     {
         return "plasma";
@@ -51,12 +118,686 @@ namespace plasma
     void plasma_server::initialize(plasma::plugin::plugin_manager& manager)
     {
         logger lg{};
+        auto step{ plasma::util::get_startup_trace().span("load configuration", "server") };
         config_.load();
         if (vm_.count("init"))
         {
-            INF(lg) << "Initialized configurations";
+            INFF(lg, "Initialized configurations");
+            return;
+        }
+        step.next("configure logging");
+        g_color_enabled.store(config_.logging.color_enabled, std::memory_order_relaxed);
+        plasma::log::configure_logging_system(config_);
+
+        step.next("start job system");
+        jobs_ = std::make_shared<plasma::job::job_system>(config_.jobs.workers, config_.jobs.affinity);
+        manager.set_job_system(jobs_);
+        manager_ = &manager;
+        step.next("lock world");
+        auto world_directory{ config_.world.storage.base_dir / config_.world.name };
+        try
+        {
+            world_lock_ = std::make_unique<plasma::util::directory_lock>(world_directory);
+        }
+        catch (const boost::interprocess::interprocess_exception& e)
+        {
+            FTLF(lg, "World {} is in use by another server: {}", world_directory.string(), e.what());
+            exit_code_ = 1;
+            return;
+        }
+        if (vm_.count("restore"))
+        {
+            try
+            {
+                plasma::world::restore_backup(world_directory, config_.world.storage.backup_dir,
+                    vm_["restore"].as<std::string>());
+            }
+            catch (const std::exception& e)
+            {
+                FTLF(lg, "Failed to restore the backup: {}", e.what());
+                exit_code_ = 1;
+            }
             return;
         }
-        g_color_enabled = config_.logging.color_enabled;
+        step.next("open region storage");
+        regions_ = std::make_unique<plasma::world::region_storage>(world_directory / "region", true);
+        saver_ = std::make_unique<plasma::world::chunk_saver>(*regions_, *jobs_, config_.world.storage.max_in_flight);
+        step.next("create terrain generator");
+        generator_ = std::make_unique<plasma::world::terrain_generator>(
+            static_cast<std::uint64_t>(config_.world.seed));
+        if (vm_.count("pregenerate"))
+        {
+            try
+            {
+                pregenerate(vm_["pregenerate"].as<std::int32_t>());
+            }
+            catch (const std::exception& e)
+            {
+                FTLF(lg, "Failed to pregenerate the world: {}", e.what());
+                exit_code_ = 1;
+            }
+            saver_->stop();
+            return;
+        }
+        step.next("create metrics");
+        metrics_ = std::make_unique<plasma::metrics::metrics_registry>(config_.metrics.enabled ? config_.metrics.segment
+            : std::string{});
+        register_metrics();
+        step.next("create network");
+        network_ = std::make_unique<plasma::network::network_manager>(config_, *jobs_, *metrics_);
+        chunk_packets_ = std::make_unique<plasma::network::chunk_packet_cache>(config_.network.compression.threshold,
+            config_.network.compression.level, config_.network.chunk_packet_cache_size,
+            network_->get_compression_statistics());
+        step.next("create world");
+        backups_ = std::make_unique<plasma::world::backup_engine>(world_directory, config_.world.storage.backup_dir,
+            *regions_, *saver_, config_.world.storage.backup_rate);
+        chunks_ = std::make_unique<plasma::world::chunk_cache>(*regions_, *saver_, *jobs_,
+            [this](std::int32_t x, std::int32_t z)
+        {
+            return generator_->generate(x, z);
+        }, config_.world.cache.memory_budget, config_.world.cache.prefetch_seconds,
+            config_.world.cache.max_prefetch_per_tick);
+        lights_ = std::make_unique<plasma::world::light_engine>(*jobs_, [this](std::int32_t x, std::int32_t z)
+        {
+            return chunks_->find(x, z);
+        });
+        chunks_->set_load_listener([this](const std::shared_ptr<plasma::world::chunk>& loaded)
+        {
+            if (!loaded->is_lit())
+            {
+                lights_->queue_relight(loaded->get_x(), loaded->get_z());
+            }
+            plasma::event::chunk_load_event event{ .x = loaded->get_x(), .z = loaded->get_z(), .loaded = loaded.get() };
+            manager_->get_event_bus().publish(event);
+        });
+        entities_ = std::make_unique<plasma::entity::entity_store>();
+        tracker_ = std::make_unique<plasma::entity::entity_tracker>(*entities_, config_.world.entities.view_distance);
+        config_watcher_ = std::make_unique<plasma::config::config_watcher>(config_);
+        config_watcher_->add_listener([this](const plasma::config::plasma_config& previous,
+            const plasma::config::plasma_config& current)
+        {
+            logger lg{};
+            INFF(lg, "Reloaded {}", current.get_file_path().string());
+            g_color_enabled.store(current.logging.color_enabled, std::memory_order_relaxed);
+            const auto& network{ current.network };
+            if (network.motd != previous.network.motd || network.max_players != previous.network.max_players
+                || network.status.favicon != previous.network.status.favicon)
+            {
+                network_->reload_status(current);
+            }
+            if (current.world.entities.view_distance != previous.world.entities.view_distance)
+            {
+                tracker_->set_view_distance(current.world.entities.view_distance);
+            }
+        });
+        scheduler_ = std::make_unique<plasma::tick::tick_scheduler>(config_.tick.rate,
+            plasma::tick::parse_overrun_policy(config_.tick.overrun_policy), config_.tick.max_catch_up);
+        scheduler_->set_tick_listener([this](std::chrono::nanoseconds duration)
+        {
+            server_metrics_.ticks.add();
+            server_metrics_.tick_duration.record(static_cast<std::uint64_t>(duration.count() / 1000));
+        });
+        scheduler_->add_handler(plasma::tick::tick_phase::network_ingress, [this]
+        {
+            config_watcher_->poll();
+            auto& events{ manager_->get_event_bus() };
+            events.apply_changes();
+            events.dispatch_posted();
+            console_.poll();
+            network_->poll([this](plasma::network::inbound_message& message)
+            {
+                handle_message(message);
+            });
+            jobs_->run_main_jobs();
+        });
+        scheduler_->add_handler(plasma::tick::tick_phase::entities, [this]
+        {
+            entities_->integrate();
+        });
+        scheduler_->add_handler(plasma::tick::tick_phase::chunk_io, [this]
+        {
+            chunks_->tick();
+            lights_->process(config_watcher_->get().world.light.max_chunks_per_tick);
+        });
+        scheduler_->add_handler(plasma::tick::tick_phase::network_egress, [this]
+        {
+            tracker_->tick();
+            if (scheduler_->get_tick() % config_.tick.rate == 0)
+            {
+                update_metrics();
+            }
+        });
+        register_commands();
+        step.next("load plugins");
+        manager.load_directory("plugins");
+        step.next("prepare spawn area");
+        if (config_.world.spawn_radius >= 0)
+        {
+            prepare_spawn_area(config_.world.spawn_radius);
+        }
+        step.next("listen");
+        network_->start();
+        config_watcher_->start();
+        console_.start();
+        running_ = true;
+    }
+
+    void plasma_server::handle_message(plasma::network::inbound_message& message)
+    {
+        logger lg{};
+        auto& source{ *message.source };
+        switch (message.kind)
+        {
+        case plasma::network::inbound_message::kind_type::joined:
+        {
+            INFF(lg, "{} joined the game", source.get_player_name());
+            auto self{ entities_->create(plasma::entity::player_type, 0.5, 100.0, 0.5, 0.6f, 1.8f) };
+            tracker_->add_viewer(message.source, self);
+            plasma::event::player_join_event event{ .connection = source.get_id(), .entity = self };
+            manager_->get_event_bus().publish(event);
+            break;
+        }
+        case plasma::network::inbound_message::kind_type::left:
+            INFF(lg, "{} left the game", source.get_player_name());
+            if (auto self{ tracker_->remove_viewer(source.get_id()) })
+            {
+                plasma::event::player_leave_event event{ .connection = source.get_id(), .entity = *self };
+                manager_->get_event_bus().publish(event);
+                entities_->destroy(*self);
+            }
+            break;
+        case plasma::network::inbound_message::kind_type::packet:
+        {
+            auto self{ tracker_->find_viewer(source.get_id()) };
+            auto index{ self ? entities_->get_index(*self) : plasma::entity::entity_store::invalid_index };
+            if (index == plasma::entity::entity_store::invalid_index)
+            {
+                break;
+            }
+            try
+            {
+                // Serverbound movement packets of protocol 754.
+                if (message.id < 0x12 || message.id > 0x15)
+                {
+                    break;
+                }
+                plasma::network::packet_reader reader{ message.payload };
+                plasma::event::player_move_event moved{
+                    .connection = source.get_id(),
+                    .entity = *self,
+                    .x = entities_->get_x()[index],
+                    .y = entities_->get_y()[index],
+                    .z = entities_->get_z()[index],
+                    .yaw = entities_->get_yaw()[index],
+                    .pitch = entities_->get_pitch()[index],
+                    .on_ground = false,
+                    .cancelled = false
+                };
+                if (message.id == 0x12 || message.id == 0x13)
+                {
+                    moved.x = reader.read_double();
+                    moved.y = reader.read_double();
+                    moved.z = reader.read_double();
+                }
+                if (message.id == 0x13 || message.id == 0x14)
+                {
+                    moved.yaw = reader.read_float();
+                    moved.pitch = reader.read_float();
+                }
+                moved.on_ground = reader.read_bool();
+                if (!is_valid_move(moved))
+                {
+                    throw std::runtime_error{ "Invalid move player packet received" };
+                }
+                manager_->get_event_bus().publish(moved);
+                // Handlers may rewrite the move, which is only trusted as far as the client is.
+                if (moved.cancelled || !is_valid_move(moved))
+                {
+                    break;
+                }
+                entities_->set_position(index, moved.x, moved.y, moved.z);
+                entities_->get_yaw()[index] = moved.yaw;
+                entities_->get_pitch()[index] = moved.pitch;
+                entities_->set_flag(index, plasma::entity::entity_flag::on_ground, moved.on_ground);
+            }
+            catch (const std::exception& e)
+            {
+                source.disconnect(e.what());
+            }
+            break;
+        }
+        }
+    }
+
+    void plasma_server::register_metrics()
+    {
+        logger lg{};
+        if (metrics_->is_shared())
+        {
+            INFF(lg, "Publishing metrics in shared memory segment {}", metrics_->get_name());
+        }
+        auto& registry{ *metrics_ };
+        server_metrics_ = {
+            .ticks = registry.add_counter("plasma_ticks_total", "Ticks run"),
+            .tick_duration = registry.add_histogram("plasma_tick_duration_seconds", "Time spent running each tick",
+                1e-6),
+            .tps = registry.add_gauge("plasma_tps", "Ticks per second"),
+            .mspt_p50 = registry.add_gauge("plasma_mspt_p50", "Median milliseconds per tick"),
+            .mspt_p99 = registry.add_gauge("plasma_mspt_p99", "99th percentile milliseconds per tick"),
+            .mspt_max = registry.add_gauge("plasma_mspt_max", "Longest tick in milliseconds"),
+            .overruns = registry.add_counter("plasma_tick_overruns_total", "Ticks that took longer than their budget"),
+            .online_players = registry.add_gauge("plasma_online_players", "Players in game"),
+            .resident_chunks = registry.add_gauge("plasma_chunk_cache_resident_chunks", "Chunks held in memory"),
+            .resident_bytes = registry.add_gauge("plasma_chunk_cache_resident_bytes", "Memory used by resident chunks"),
+            .chunk_hits = registry.add_counter("plasma_chunk_cache_hits_total", "Chunk lookups served from memory"),
+            .chunk_misses = registry.add_counter("plasma_chunk_cache_misses_total", "Chunk lookups that missed"),
+            .chunk_loads = registry.add_counter("plasma_chunk_cache_loads_total", "Chunks read or generated"),
+            .chunk_evictions = registry.add_counter("plasma_chunk_cache_evictions_total", "Chunks evicted"),
+            .entities = registry.add_gauge("plasma_entities", "Live entities"),
+            .allocator_rss = registry.add_gauge("plasma_allocator_rss_bytes", "Resident set size"),
+            .allocator_peak_rss = registry.add_gauge("plasma_allocator_peak_rss_bytes", "Peak resident set size"),
+            .allocator_commit = registry.add_gauge("plasma_allocator_commit_bytes",
+                "Memory committed by the allocator"),
+            .allocator_page_faults = registry.add_counter("plasma_allocator_page_faults_total", "Hard page faults")
+        };
+    }
+
+    void plasma_server::update_metrics()
+    {
+        auto ticks{ scheduler_->get_statistics() };
+        server_metrics_.tps.set(ticks.tps);
+        server_metrics_.mspt_p50.set(ticks.mspt.p50);
+        server_metrics_.mspt_p99.set(ticks.mspt.p99);
+        server_metrics_.mspt_max.set(ticks.mspt.max);
+        server_metrics_.overruns.set(ticks.overruns);
+        server_metrics_.online_players.set(network_->get_online_players());
+        auto chunks{ chunks_->get_statistics() };
+        server_metrics_.resident_chunks.set(static_cast<double>(chunks.resident_chunks));
+        server_metrics_.resident_bytes.set(static_cast<double>(chunks.resident_bytes));
+        server_metrics_.chunk_hits.set(chunks.hits);
+        server_metrics_.chunk_misses.set(chunks.misses);
+        server_metrics_.chunk_loads.set(chunks.loads);
+        server_metrics_.chunk_evictions.set(chunks.evictions);
+        server_metrics_.entities.set(static_cast<double>(entities_->get_statistics().entities));
+        std::size_t elapsed{}, user{}, system{}, rss{}, peak_rss{}, commit{}, peak_commit{}, faults{};
+        mi_process_info(&elapsed, &user, &system, &rss, &peak_rss, &commit, &peak_commit, &faults);
+        server_metrics_.allocator_rss.set(static_cast<double>(rss));
+        server_metrics_.allocator_peak_rss.set(static_cast<double>(peak_rss));
+        server_metrics_.allocator_commit.set(static_cast<double>(commit));
+        server_metrics_.allocator_page_faults.set(faults);
+        metrics_->beat();
+    }
+
+    void plasma_server::register_commands()
+    {
+        console_.register_command("stop", "Stops the server", [this](std::span<const std::string_view>)
+        {
+            stop();
+        });
+        console_.register_command("reload", "Reads the configuration again and applies what can change while running",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            if (!config_watcher_->reload())
+            {
+                INFF(lg, "No settings changed");
+            }
+        });
+        console_.register_command("tps", "Shows ticks per second and milliseconds per tick",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ scheduler_->get_statistics() };
+            INFF(lg, "TPS {:.2f}, MSPT p50 {:.2f} p99 {:.2f} max {:.2f}, {} ticks over budget, {} skipped",
+                statistics.tps, statistics.mspt.p50, statistics.mspt.p99, statistics.mspt.max, statistics.overruns,
+                statistics.skipped);
+            for (std::size_t i{}; i < plasma::tick::phase_count; ++i)
+            {
+                const auto& phase{ statistics.phases[i] };
+                INFF(lg, "  {}: p50 {:.2f} p99 {:.2f} max {:.2f}",
+                    plasma::tick::get_phase_name(static_cast<plasma::tick::tick_phase>(i)), phase.p50, phase.p99, phase.max);
+            }
+        });
+        console_.register_command("metrics", "Shows where plasma-stat can read the metrics",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            if (metrics_->is_shared())
+            {
+                INFF(lg, "Metrics are published in shared memory segment {0}, run plasma-stat --segment {0}",
+                    metrics_->get_name());
+            }
+            else
+            {
+                INFF(lg, "Metrics are not shared, set metrics.enabled and metrics.segment to publish them");
+            }
+        });
+        console_.register_command("save-all", "Waits for every pending chunk save to reach the disk",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            chunks_->save_all();
+            auto backlog{ saver_->get_statistics() };
+            INFF(lg, "Waiting for {} chunks ({} KiB) to be saved", backlog.backlog_chunks,
+                backlog.backlog_bytes / 1024);
+            auto failing{ saver_->flush() };
+            auto statistics{ saver_->get_statistics() };
+            INFF(lg, "Saved {} chunks in {} batches, {} MiB written, {} superseded, {} failed attempts, "
+                "{} lost", statistics.saved, statistics.batches, statistics.bytes_written / (1024 * 1024),
+                statistics.superseded, statistics.failed, statistics.lost);
+            if (failing)
+            {
+                ERRF(lg, "{} chunks keep failing to save and are retried in the background", failing);
+            }
+        });
+        console_.register_command("chunks", "Shows chunk cache residency, hit rate and load latency",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ chunks_->get_statistics() };
+            auto lookups{ statistics.hits + statistics.misses };
+            auto hit_rate{ lookups ? static_cast<double>(statistics.hits) / static_cast<double>(lookups) : 0.0 };
+            INFF(lg, "{} chunks resident ({} of {} MiB), {} ticketed, {} loading, {} evicted "
+                "awaiting save ({} KiB)", statistics.resident_chunks, statistics.resident_bytes / (1024 * 1024),
+                config_.world.cache.memory_budget / (1024 * 1024), statistics.ticketed, statistics.loading,
+                statistics.saving_chunks, statistics.saving_bytes / 1024);
+            INFF(lg, "Hit rate {:.1f}% of {} lookups, {} loads ({} failed), {} evictions, {} prefetched "
+                "({} used)", 100.0 * hit_rate, lookups, statistics.loads, statistics.failed_loads, statistics.evictions,
+                statistics.prefetches, statistics.prefetch_hits);
+            INFF(lg, "Load latency p50 {:.2f} ms, p99 {:.2f} ms, max {:.2f} ms",
+                static_cast<double>(statistics.load_p50) / 1e6, static_cast<double>(statistics.load_p99) / 1e6,
+                static_cast<double>(statistics.load_max) / 1e6);
+        });
+        console_.register_command("light", "Shows light engine activity", [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ lights_->get_statistics() };
+            INFF(lg, "{} chunks queued, {} updated in {} batches ({} relit, {} block changes), {} "
+                "sections published, last batch {:.2f} ms", statistics.pending_chunks, statistics.processed_chunks,
+                statistics.batches, statistics.relights, statistics.changes, statistics.sections_published,
+                static_cast<double>(statistics.last_batch_nanoseconds) / 1e6);
+        });
+        console_.register_command("entities", "Shows entity storage", [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ entities_->get_statistics() };
+            INFF(lg, "{} entities in {} grid cells, {} components, {} created, {} destroyed, {} cell "
+                "changes", statistics.entities, statistics.cells, statistics.components, statistics.created,
+                statistics.destroyed, statistics.cell_moves);
+        });
+        console_.register_command("tracker", "Shows entity tracking pairs, packets and share of the tick",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ tracker_->get_statistics() };
+            auto mspt{ scheduler_->get_statistics().mspt };
+            auto p50{ static_cast<double>(statistics.tick_p50) / 1e6 };
+            INFF(lg, "{} viewers tracking {} pairs within {} blocks, {} spawns, {} despawns, {} relative "
+                "moves, {} teleports, {} KiB sent", statistics.viewers, statistics.tracked_pairs,
+                config_watcher_->get().world.entities.view_distance, statistics.spawns, statistics.despawns,
+                statistics.relative_moves, statistics.teleports, statistics.bytes_sent / 1024);
+            INFF(lg, "Tracker p50 {:.3f} ms, p99 {:.3f} ms, {:.1f}% of the median tick", p50,
+                static_cast<double>(statistics.tick_p99) / 1e6, mspt.p50 > 0.0 ? 100.0 * p50 / mspt.p50 : 0.0);
+        });
+        console_.register_command("chunk-packets", "Shows the shared chunk packet cache",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ chunk_packets_->get_statistics() };
+            auto lookups{ statistics.hits + statistics.misses };
+            INFF(lg, "{} chunks cached ({} KiB), hit ratio {:.1f}% of {} lookups, {} KiB saved, {} "
+                "invalidated, {} evicted, {:.1f} ms encoding", statistics.entries, statistics.bytes / 1024,
+                lookups ? 100.0 * static_cast<double>(statistics.hits) / static_cast<double>(lookups) : 0.0, lookups,
+                statistics.bytes_saved / 1024, statistics.invalidations, statistics.evictions,
+                static_cast<double>(statistics.encode_nanoseconds) / 1e6);
+        });
+        console_.register_command("backup", "Starts a backup, or shows its status, lists backups or cancels it",
+            [this](std::span<const std::string_view> arguments)
+        {
+            logger lg{};
+            auto action{ arguments.empty() ? std::string_view{ "start" } : arguments[0] };
+            if (action == "start")
+            {
+                try
+                {
+                    auto name{ backups_->start() };
+                    INFF(lg, "Started backup {}", name);
+                }
+                catch (const std::exception& e)
+                {
+                    WRNF(lg, "{}", e.what());
+                }
+            }
+            else if (action == "status")
+            {
+                auto progress{ backups_->get_progress() };
+                INFF(lg, "Backup {} {}: {}/{} chunks, {} new objects, {} reused, {} MiB copied, {} MiB "
+                    "cloned", progress.name, progress.running ? "running" : "idle", progress.chunks_done,
+                    progress.chunks_total, progress.objects_written, progress.objects_reused,
+                    progress.bytes_copied / (1024 * 1024), progress.bytes_cloned / (1024 * 1024));
+            }
+            else if (action == "list")
+            {
+                for (const auto& name : plasma::world::list_backups(config_.world.storage.backup_dir))
+                {
+                    INFF(lg, "{}", name);
+                }
+            }
+            else if (action == "cancel")
+            {
+                backups_->cancel();
+            }
+            else
+            {
+                WRNF(lg, "Usage: backup [start|status|list|cancel], restore with --restore <name>");
+            }
+        });
+        console_.register_command("plugins", "Lists the loaded plugins and what they depend on",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            manager_->for_each_plugin([&lg](plasma::plugin::plugin& plugin,
+                const std::vector<std::string>& dependencies)
+            {
+                INFF(lg, "{} {}{}{}", plugin.get_name(), plugin.get_version(),
+                    dependencies.empty() ? "" : ", depends on ", fmt::join(dependencies, ", "));
+            });
+        });
+        console_.register_command("events", "Shows plugin event handlers and posted events",
+            [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ manager_->get_event_bus().get_statistics() };
+            INFF(lg, "{} handlers, {} events posted from {} threads, {} delivered, {} dropped, deepest "
+                "queue {}", statistics.handlers, statistics.posted, statistics.queues, statistics.delivered,
+                statistics.dropped, statistics.max_depth);
+        });
+        console_.register_command("jobs", "Shows how busy each job worker is", [this](std::span<const std::string_view>)
+        {
+            logger lg{};
+            auto statistics{ jobs_->get_statistics() };
+            for (std::size_t i{}; i < statistics.size(); ++i)
+            {
+                const auto& worker{ statistics[i] };
+                INFF(lg, "Worker {}: {} jobs, {:.1f}% busy, {} stolen in {} attempts", i, worker.executed,
+                    100.0 * static_cast<double>(worker.busy_nanoseconds) / static_cast<double>(worker.uptime_nanoseconds),
+                    worker.stolen, worker.steal_attempts);
+            }
+        });
+    }
+
+    void plasma_server::prepare_spawn_area(std::int32_t radius)
+    {
+        logger lg{};
+        auto side{ radius * 2 + 1 };
+        auto total{ static_cast<std::size_t>(side) * static_cast<std::size_t>(side) };
+        INFF(lg, "Preparing {} spawn chunks on {} threads", total, jobs_->get_worker_count() + 1);
+
+        // Spawn chunks stay ticketed, as they are in vanilla. Their loads and light run on the job workers while this
+        // thread integrates the results and helps with whatever jobs are queued.
+        std::vector<std::pair<std::int32_t, std::int32_t>> pending{};
+        for (auto z{ -radius }; z <= radius; ++z)
+        {
+            for (auto x{ -radius }; x <= radius; ++x)
+            {
+                chunks_->add_ticket(x, z);
+                pending.emplace_back(x, z);
+            }
+        }
+        auto started{ std::chrono::steady_clock::now() };
+        auto reported{ started };
+        while (!pending.empty())
+        {
+            chunks_->tick();
+            lights_->process(total);
+            jobs_->run_main_jobs();
+            std::erase_if(pending, [this](const std::pair<std::int32_t, std::int32_t>& position)
+            {
+                auto resident{ chunks_->find(position.first, position.second) };
+                return resident && resident->is_lit();
+            });
+            if (!chunks_->get_statistics().loading && !lights_->get_statistics().pending_chunks && !pending.empty())
+            {
+                WRNF(lg, "Failed to prepare {} spawn chunks", pending.size());
+                break;
+            }
+            auto now{ std::chrono::steady_clock::now() };
+            if (now - reported >= std::chrono::seconds{ 1 })
+            {
+                INFF(lg, "Preparing spawn area: {}%", (total - pending.size()) * 100 / total);
+                reported = now;
+            }
+            if (!jobs_->help())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+            }
+        }
+        INFF(lg, "Prepared the spawn area in {:.0f} ms",
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count());
+    }
+
+    void plasma_server::pregenerate(std::int32_t radius)
+    {
+        logger lg{};
+        radius = std::max(radius, 0);
+        auto side{ static_cast<std::size_t>(radius) * 2 + 1 };
+        auto total{ side * side };
+        INFF(lg, "Pregenerating {} chunks with seed {} using the {} noise kernel on {} threads", total,
+            config_.world.seed, plasma::world::get_noise_codec_name(), jobs_->get_worker_count() + 1);
+
+        // Generate a batch in parallel, then hand it to the saver, which compresses and writes it behind the next one.
+        auto batch_size{ (jobs_->get_worker_count() + 1) * 64 };
+        std::vector<std::shared_ptr<plasma::world::chunk>> batch(batch_size);
+        std::size_t generated{};
+        std::size_t existing{};
+        auto started{ std::chrono::steady_clock::now() };
+        auto reported{ started };
+        for (std::size_t begin{}; begin < total; begin += batch_size)
+        {
+            auto end{ std::min(begin + batch_size, total) };
+            jobs_->parallel_for(begin, end, 4, [this, &batch, begin, side, radius](std::size_t i)
+            {
+                auto x{ static_cast<std::int32_t>(i % side) - radius };
+                auto z{ static_cast<std::int32_t>(i / side) - radius };
+                auto region{ regions_->get_region(x, z) };
+                batch[i - begin] = region && region->contains(x, z) ? nullptr : generator_->generate(x, z);
+            });
+            for (auto i{ begin }; i < end; ++i)
+            {
+                auto generated_chunk{ std::move(batch[i - begin]) };
+                if (!generated_chunk)
+                {
+                    ++existing;
+                    continue;
+                }
+                auto x{ generated_chunk->get_x() };
+                auto z{ generated_chunk->get_z() };
+                auto size{ generated_chunk->get_memory_usage() };
+                plasma::world::chunk_saver::serializer serialize{ [generated_chunk](std::vector<std::byte>& nbt)
+                {
+                    generated_chunk->serialize(nbt);
+                } };
+                for (std::size_t failing{}; !saver_->save(x, z, size, serialize);)
+                {
+                    if (failing)
+                    {
+                        throw std::runtime_error{ fmt::format("{} chunks keep failing to save", failing) };
+                    }
+                    failing = saver_->flush();
+                }
+                ++generated;
+            }
+            auto now{ std::chrono::steady_clock::now() };
+            if (now - reported >= std::chrono::seconds{ 5 })
+            {
+                INFF(lg, "Pregenerated {}/{} chunks, {:.0f} chunks/s", end, total,
+                    static_cast<double>(generated) / std::chrono::duration<double>(now - started).count());
+                reported = now;
+            }
+        }
+        if (auto failing{ saver_->flush() })
+        {
+            throw std::runtime_error{ fmt::format("{} chunks keep failing to save", failing) };
+        }
+        auto elapsed{ std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count() };
+        INFF(lg, "Pregenerated {} chunks in {:.1f} s, {:.0f} chunks/s including saving, {} already "
+            "existed", generated, elapsed, static_cast<double>(generated) / std::max(elapsed, 1e-9), existing);
+    }
+
+    int plasma_server::run()
+    {
+        if (!running_)
+        {
+            return exit_code_;
+        }
+        logger lg{};
+        auto& trace{ plasma::util::get_startup_trace() };
+        auto startup{ std::chrono::duration<double>(trace.get_elapsed()).count() };
+        try
+        {
+            auto path{ trace.write("./logs") };
+            INFF(lg, "Done ({:.3f} s), startup trace written to {}", startup, path.string());
+        }
+        catch (const std::exception& e)
+        {
+            WRNF(lg, "Done ({:.3f} s), but failed to write the startup trace: {}", startup, e.what());
+        }
+        signalled_server = this;
+        std::signal(SIGINT, &handle_signal);
+        std::signal(SIGTERM, &handle_signal);
+        scheduler_->run(running_);
+        INFF(lg, "Stopping server");
+        config_watcher_->stop();
+        network_->stop();
+        manager_->unload_libraries();
+        backups_.reset();
+        tracker_.reset();
+        entities_.reset();
+        lights_.reset();
+        try
+        {
+            chunks_->save_all();
+        }
+        catch (const std::exception& e)
+        {
+            ERRF(lg, "Failed to hand every chunk to the saver: {}", e.what());
+            exit_code_ = 1;
+        }
+        chunks_.reset();
+        saver_->stop();
+        jobs_->stop();
+        auto& compression{ network_->get_compression_statistics() };
+        if (auto packets{ compression.packets_compressed.load() })
+        {
+            INFF(lg, "Compressed {} packets at a ratio of {:.3f} in {} ms", packets, compression.get_ratio(),
+                compression.compress_nanoseconds.load() / 1000000);
+        }
+        signalled_server = nullptr;
+        return exit_code_;
+    }
+
+    void plasma_server::stop() noexcept
+    {
+        running_.store(false, std::memory_order_relaxed);
     }
 }
@@ -20,39 +20,492 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <dlfcn.h>
+#include <fmt/format.h>
 
 #include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
 #include <plasma/plugin/plugin.h>
+#include <plasma/plugin/plugin_abi.h>
+#include <plasma/util/startup_trace.h>
 
 #include <plasma/plugin/plugin_manager.h>
 
 namespace plasma::plugin
 {
+    namespace
+    {
+        double get_milliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+        {
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        }
+    }
+
     plugin_manager::plugin_manager() = default;
 
+    plugin_manager::~plugin_manager()
+    {
+        std::vector<std::string> names{ order_.rbegin(), order_.rend() };
+        unload(names);
+    }
+
+    void plugin_manager::release(loaded_plugin& loaded) noexcept
+    {
+        // Events the plugin posted may still be queued; they hold no code of the library, so it can be closed.
+        events_.unsubscribe_owner(loaded.instance);
+        events_.apply_changes();
+        if (loaded.destroy)
+        {
+            loaded.destroy(loaded.instance);
+        }
+        else
+        {
+            delete loaded.instance;
+        }
+        if (loaded.library)
+        {
+            dlclose(loaded.library);
+        }
+    }
+
     bool plugin_manager::load_plugin(plugin* plugin)
     {
         plasma::log::logger lg{};
-        TRC(lg) << "Loading plugin " << plugin->get_name() << " " << plugin->get_version();
-        if (plugins_.contains(plugin->get_name()))
+        TRCF(lg, "Loading plugin {} {}", plugin->get_name(), plugin->get_version());
+        std::string name{ plugin->get_name() };
+        {
+            std::unique_lock lock{ mutex_ };
+            if (plugins_.contains(name))
+            {
+                return false;
+            }
+            // Registered up front, so that the plugins it loads while initializing can depend on it.
+            plugins_.emplace(name, loaded_plugin{ .instance = plugin, .destroy = nullptr, .library = nullptr });
+            order_.push_back(name);
+        }
+        try
+        {
+            auto span{ plasma::util::get_startup_trace().span(fmt::format("initialize {}", name), "plugin") };
+            plugin->initialize(*this);
+        }
+        catch (...)
+        {
+            events_.unsubscribe_owner(plugin);
+            std::unique_lock lock{ mutex_ };
+            plugins_.erase(name);
+            std::erase(order_, name);
+            throw;
+        }
+        return true;
+    }
+
+    bool plugin_manager::open_library(const std::filesystem::path& path, std::vector<library_candidate>& candidates)
+    {
+        plasma::log::logger lg{};
+        auto started{ std::chrono::steady_clock::now() };
+        auto library{ dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL) };
+        if (!library)
+        {
+            ERRF(lg, "Failed to open plugin {}: {}", path.string(), dlerror());
+            return false;
+        }
+        auto entry{ reinterpret_cast<plasma_plugin_entry_function>(dlsym(library, entry_symbol)) };
+        auto descriptor{ entry ? entry() : nullptr };
+        std::string problem{};
+        if (!descriptor)
+        {
+            problem = fmt::format("it has no {} entry point", entry_symbol);
+        }
+        else if (descriptor->abi_version != abi_version)
+        {
+            problem = fmt::format("it was built for plugin ABI {}, the server provides {}", descriptor->abi_version,
+                abi_version);
+        }
+        else if (!descriptor->name || !descriptor->version || !descriptor->create || !descriptor->destroy)
+        {
+            problem = "its descriptor is incomplete";
+        }
+        else if (has_plugin(descriptor->name) || std::any_of(candidates.begin(), candidates.end(),
+            [descriptor](const library_candidate& candidate)
+        {
+            return std::string_view{ candidate.descriptor->name } == descriptor->name;
+        }))
         {
+            problem = fmt::format("a plugin named {} is already loaded", descriptor->name);
+        }
+        if (!problem.empty())
+        {
+            ERRF(lg, "Skipping plugin {}: {}", path.string(), problem);
+            dlclose(library);
             return false;
         }
-        plugin->initialize(*this);
-        plugins_.insert({ plugin->get_name(), std::unique_ptr<class plugin>{ plugin } });
+        std::vector<std::string> dependencies{};
+        for (auto dependency{ descriptor->dependencies }; dependency && *dependency; ++dependency)
+        {
+            dependencies.emplace_back(*dependency);
+        }
+        auto opened{ std::chrono::steady_clock::now() };
+        plasma::util::get_startup_trace().record(fmt::format("open {}", descriptor->name), "plugin", started, opened);
+        candidates.push_back({
+            .path = path,
+            .library = library,
+            .descriptor = descriptor,
+            .dependencies = std::move(dependencies),
+            .open_milliseconds = get_milliseconds(started, opened)
+        });
         return true;
     }
 
-    std::size_t plugin_manager::unload_plugin(const char* name)
+    std::size_t plugin_manager::initialize_libraries(std::vector<library_candidate> candidates)
     {
-        return plugins_.erase(name);
+        plasma::log::logger lg{};
+        auto count{ candidates.size() };
+        std::map<std::string_view, std::size_t> by_name{};
+        for (std::size_t i{}; i < count; ++i)
+        {
+            by_name.emplace(candidates[i].descriptor->name, i);
+        }
+
+        // Order the candidates with Kahn's algorithm; whatever is left over sits on a cycle.
+        std::vector<bool> failed(count);
+        std::vector<std::size_t> unresolved(count);
+        std::vector<std::vector<std::size_t>> dependents(count);
+        for (std::size_t i{}; i < count; ++i)
+        {
+            for (const auto& dependency : candidates[i].dependencies)
+            {
+                if (auto found{ by_name.find(dependency) }; found != by_name.end())
+                {
+                    dependents[found->second].push_back(i);
+                    ++unresolved[i];
+                }
+                else if (!has_plugin(dependency))
+                {
+                    ERRF(lg, "Skipping plugin {}: it depends on {}, which is not available",
+                        candidates[i].descriptor->name, dependency);
+                    failed[i] = true;
+                }
+            }
+        }
+        std::vector<std::size_t> order{};
+        std::deque<std::size_t> ready{};
+        for (std::size_t i{}; i < count; ++i)
+        {
+            if (!unresolved[i])
+            {
+                ready.push_back(i);
+            }
+        }
+        while (!ready.empty())
+        {
+            auto current{ ready.front() };
+            ready.pop_front();
+            order.push_back(current);
+            for (auto dependent : dependents[current])
+            {
+                failed[dependent] = failed[dependent] || failed[current];
+                if (!--unresolved[dependent])
+                {
+                    ready.push_back(dependent);
+                }
+            }
+        }
+        for (std::size_t i{}; i < count; ++i)
+        {
+            if (unresolved[i])
+            {
+                ERRF(lg, "Skipping plugin {}: its dependencies form a cycle",
+                    candidates[i].descriptor->name);
+                failed[i] = true;
+            }
+        }
+
+        // Each plugin waits for the jobs of its dependencies only, so independent plugins initialize side by side.
+        class timing
+        {
+        public:
+            double create;
+            double initialize;
+        };
+        std::vector<char> succeeded(count);
+        std::vector<timing> timings(count);
+        std::vector<plasma::job::job_handle> handles(count);
+        auto& jobs{ get_job_system() };
+        auto started{ std::chrono::steady_clock::now() };
+        for (auto i : order)
+        {
+            if (failed[i])
+            {
+                continue;
+            }
+            std::vector<plasma::job::job_handle> dependencies{};
+            for (const auto& dependency : candidates[i].dependencies)
+            {
+                if (auto found{ by_name.find(dependency) }; found != by_name.end())
+                {
+                    dependencies.push_back(handles[found->second]);
+                }
+            }
+            handles[i] = jobs.submit([this, i, &candidates, &by_name, &succeeded, &timings]
+            {
+                plasma::log::logger lg{};
+                const auto& candidate{ candidates[i] };
+                const auto& descriptor{ *candidate.descriptor };
+                for (const auto& dependency : candidate.dependencies)
+                {
+                    if (auto found{ by_name.find(dependency) }; found != by_name.end() && !succeeded[found->second])
+                    {
+                        ERRF(lg, "Skipping plugin {}: its dependency {} failed to initialize",
+                            descriptor.name, dependency);
+                        return;
+                    }
+                }
+                auto creating{ std::chrono::steady_clock::now() };
+                plugin* instance{};
+                try
+                {
+                    instance = descriptor.create();
+                    auto initializing{ std::chrono::steady_clock::now() };
+                    instance->initialize(*this);
+                    auto finished{ std::chrono::steady_clock::now() };
+                    plasma::util::get_startup_trace().record(fmt::format("initialize {}", descriptor.name), "plugin",
+                        creating, finished);
+                    timings[i] = {
+                        .create = get_milliseconds(creating, initializing),
+                        .initialize = get_milliseconds(initializing, finished)
+                    };
+                }
+                catch (const std::exception& e)
+                {
+                    ERRF(lg, "Plugin {} failed to initialize: {}", descriptor.name, e.what());
+                    if (instance)
+                    {
+                        events_.unsubscribe_owner(instance);
+                        descriptor.destroy(instance);
+                    }
+                    return;
+                }
+                {
+                    std::unique_lock lock{ mutex_ };
+                    plugins_.emplace(descriptor.name, loaded_plugin{
+                        .instance = instance,
+                        .destroy = descriptor.destroy,
+                        .library = candidate.library,
+                        .path = candidate.path,
+                        .dependencies = candidate.dependencies
+                    });
+                    order_.emplace_back(descriptor.name);
+                }
+                succeeded[i] = 1;
+            }, dependencies);
+        }
+        for (const auto& handle : handles)
+        {
+            if (handle)
+            {
+                jobs.wait(handle);
+            }
+        }
+        auto elapsed{ get_milliseconds(started, std::chrono::steady_clock::now()) };
+
+        std::size_t loaded{};
+        double serial{};
+        for (auto i : order)
+        {
+            if (!succeeded[i])
+            {
+                continue;
+            }
+            const auto& candidate{ candidates[i] };
+            ++loaded;
+            serial += timings[i].create + timings[i].initialize;
+            INFF(lg, "  {} {}: open {:.2f} ms, create {:.2f} ms, initialize {:.2f} ms",
+                candidate.descriptor->name, candidate.descriptor->version, candidate.open_milliseconds,
+                timings[i].create, timings[i].initialize);
+        }
+        for (std::size_t i{}; i < count; ++i)
+        {
+            if (!succeeded[i])
+            {
+                dlclose(candidates[i].library);
+            }
+        }
+        INFF(lg, "Initialized {} of {} plugins in {:.2f} ms ({:.2f} ms one after another)", loaded,
+            count, elapsed, serial);
+        return loaded;
     }
 
-    const std::unique_ptr<plugin>& plugin_manager::get_plugin(const char* name) const
+    std::size_t plugin_manager::load_directory(const std::filesystem::path& directory)
     {
-        return plugins_.at(name);
+        plasma::log::logger lg{};
+        std::error_code error{};
+        if (!std::filesystem::is_directory(directory, error))
+        {
+            TRCF(lg, "No plugin directory at {}", directory.string());
+            return 0;
+        }
+        std::vector<std::filesystem::path> paths{};
+        for (const auto& file : std::filesystem::directory_iterator{ directory })
+        {
+            if (file.is_regular_file() && file.path().extension() == ".so")
+            {
+                paths.push_back(file.path());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+        std::vector<library_candidate> candidates{};
+        for (const auto& path : paths)
+        {
+            open_library(path, candidates);
+        }
+        if (candidates.empty())
+        {
+            return 0;
+        }
+        return initialize_libraries(std::move(candidates));
     }
-}
 
+    std::vector<std::string> plugin_manager::collect_dependents(std::string_view name) const
+    {
+        // order_ lists dependencies before their dependents, so one forward pass finds them all.
+        std::shared_lock lock{ mutex_ };
+        std::vector<std::string> collected{};
+        for (const auto& current : order_)
+        {
+            const auto& dependencies{ plugins_.find(current)->second.dependencies };
+            auto depends{ std::any_of(dependencies.begin(), dependencies.end(),
+                [&collected](const std::string& dependency)
+            {
+                return std::find(collected.begin(), collected.end(), dependency) != collected.end();
+            }) };
+            if (current == name || depends)
+            {
+                collected.push_back(current);
+            }
+        }
+        std::reverse(collected.begin(), collected.end());
+        return collected;
+    }
+
+    std::size_t plugin_manager::unload(const std::vector<std::string>& names)
+    {
+        plasma::log::logger lg{};
+        std::size_t unloaded{};
+        for (const auto& name : names)
+        {
+            loaded_plugin loaded{};
+            {
+                std::unique_lock lock{ mutex_ };
+                auto found{ plugins_.find(name) };
+                if (found == plugins_.end())
+                {
+                    continue;
+                }
+                loaded = std::move(found->second);
+                plugins_.erase(found);
+                std::erase(order_, name);
+            }
+            TRCF(lg, "Unloading plugin {}", name);
+            release(loaded);
+            ++unloaded;
+        }
+        return unloaded;
+    }
+
+    std::size_t plugin_manager::unload_plugin(std::string_view name)
+    {
+        return unload(collect_dependents(name));
+    }
+
+    std::size_t plugin_manager::reload_plugin(std::string_view name)
+    {
+        auto names{ collect_dependents(name) };
+        std::vector<std::filesystem::path> paths{};
+        {
+            std::shared_lock lock{ mutex_ };
+            for (auto current{ names.rbegin() }; current != names.rend(); ++current)
+            {
+                const auto& loaded{ plugins_.find(*current)->second };
+                if (!loaded.library)
+                {
+                    throw std::logic_error{ fmt::format("Plugin {} is built into the server and can't be reloaded",
+                        *current) };
+                }
+                paths.push_back(loaded.path);
+            }
+        }
+        unload(names);
+        std::vector<library_candidate> candidates{};
+        for (const auto& path : paths)
+        {
+            open_library(path, candidates);
+        }
+        return candidates.empty() ? 0 : initialize_libraries(std::move(candidates));
+    }
+
+    std::size_t plugin_manager::unload_libraries()
+    {
+        std::vector<std::string> names{};
+        {
+            std::shared_lock lock{ mutex_ };
+            for (auto current{ order_.rbegin() }; current != order_.rend(); ++current)
+            {
+                if (plugins_.find(*current)->second.library)
+                {
+                    names.push_back(*current);
+                }
+            }
+        }
+        return unload(names);
+    }
+
+    bool plugin_manager::has_plugin(std::string_view name) const
+    {
+        std::shared_lock lock{ mutex_ };
+        return plugins_.find(name) != plugins_.end();
+    }
+
+    plugin& plugin_manager::get_plugin(std::string_view name) const
+    {
+        std::shared_lock lock{ mutex_ };
+        auto found{ plugins_.find(name) };
+        if (found == plugins_.end())
+        {
+            throw std::out_of_range{ fmt::format("Plugin {} is not loaded", name) };
+        }
+        return *found->second.instance;
+    }
+
+    void plugin_manager::for_each_plugin(
+        const std::function<void(plugin&, const std::vector<std::string>&)>& function) const
+    {
+        std::shared_lock lock{ mutex_ };
+        for (const auto& name : order_)
+        {
+            const auto& loaded{ plugins_.find(name)->second };
+            function(*loaded.instance, loaded.dependencies);
+        }
+    }
+
+    void plugin_manager::set_job_system(std::shared_ptr<plasma::job::job_system> job_system)
+    {
+        job_system_ = std::move(job_system);
+    }
+
+    plasma::job::job_system& plugin_manager::get_job_system() const
+    {
+        if (!job_system_)
+        {
+            throw std::logic_error{ "The job system is not running" };
+        }
+        return *job_system_;
+    }
+}
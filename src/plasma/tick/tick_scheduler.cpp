@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/tick/tick_scheduler.h>
+
+namespace plasma::tick
+{
+    namespace
+    {
+        constexpr std::array<std::string_view, phase_count> phase_names{
+            "network ingress", "world", "entities", "chunk I/O", "network egress"
+        };
+
+        constexpr std::chrono::seconds overrun_report_interval{ 5 };
+
+        mspt_statistics get_mspt(const util::histogram_snapshot& snapshot)
+        {
+            return {
+                .p50 = static_cast<double>(snapshot.get_percentile(0.5)) / 1e6,
+                .p99 = static_cast<double>(snapshot.get_percentile(0.99)) / 1e6,
+                .max = static_cast<double>(snapshot.get_max()) / 1e6
+            };
+        }
+    }
+
+    std::string_view get_phase_name(tick_phase phase) noexcept
+    {
+        return phase_names[static_cast<std::size_t>(phase)];
+    }
+
+    overrun_policy parse_overrun_policy(std::string_view name)
+    {
+        if (name == "catch_up")
+        {
+            return overrun_policy::catch_up;
+        }
+        if (name == "skip")
+        {
+            return overrun_policy::skip;
+        }
+        throw std::invalid_argument{ "Unknown tick overrun policy: " + std::string{ name } };
+    }
+
+    tick_scheduler::tick_scheduler(std::uint32_t tps, overrun_policy policy, std::uint64_t max_catch_up) :
+        interval_{ std::chrono::nanoseconds{ std::chrono::seconds{ 1 } } / std::max(tps, 1u) }, policy_{ policy },
+        max_catch_up_{ max_catch_up }, current_window_{}, tick_{}, tps_{}, overruns_{}, skipped_{}, tick_starts_{},
+        last_durations_{}
+    {
+    }
+
+    void tick_scheduler::add_handler(tick_phase phase, std::function<void()> handler)
+    {
+        handlers_[static_cast<std::size_t>(phase)].push_back(std::move(handler));
+    }
+
+    void tick_scheduler::set_tick_listener(tick_listener listener)
+    {
+        listener_ = std::move(listener);
+    }
+
+    void tick_scheduler::run(const std::atomic<bool>& running)
+    {
+        logger lg{};
+        auto next{ std::chrono::steady_clock::now() };
+        auto last_report{ next - overrun_report_interval };
+        std::uint64_t reported_overruns{};
+        while (running.load(std::memory_order_relaxed))
+        {
+            auto start{ std::chrono::steady_clock::now() };
+            tick(start);
+            next += interval_;
+
+            auto now{ std::chrono::steady_clock::now() };
+            if (now - start > interval_)
+            {
+                auto overruns{ overruns_.fetch_add(1, std::memory_order_relaxed) + 1 };
+                if (now - last_report >= overrun_report_interval)
+                {
+                    auto slowest{ std::ranges::max_element(last_durations_) - last_durations_.begin() };
+                    WRNF(lg, "Can't keep up! Tick {} took {:.2f} ms, mostly in {} ({:.2f} ms), {} ticks over budget since the last "
+                        "report", get_tick(), std::chrono::duration<double, std::milli>(now - start).count(),
+                        phase_names[slowest], std::chrono::duration<double, std::milli>(last_durations_[slowest]).count(),
+                        overruns - reported_overruns);
+                    reported_overruns = overruns;
+                    last_report = now;
+                }
+            }
+            if (now < next)
+            {
+                std::this_thread::sleep_until(next);
+                continue;
+            }
+            auto behind{ static_cast<std::uint64_t>((now - next) / interval_) };
+            if (policy_ == overrun_policy::skip || behind > max_catch_up_)
+            {
+                skipped_.fetch_add(behind, std::memory_order_relaxed);
+                next = now;
+            }
+        }
+    }
+
+    void tick_scheduler::tick(std::chrono::steady_clock::time_point start)
+    {
+        auto number{ tick_.load(std::memory_order_relaxed) };
+        if (number && number % window_ticks == 0)
+        {
+            auto next_window{ 1 - current_window_.load(std::memory_order_relaxed) };
+            windows_[next_window].total.reset();
+            for (auto& phase : windows_[next_window].phases)
+            {
+                phase.reset();
+            }
+            current_window_.store(next_window, std::memory_order_relaxed);
+        }
+        auto& current{ windows_[current_window_.load(std::memory_order_relaxed)] };
+
+        auto phase_start{ start };
+        for (std::size_t i{}; i < phase_count; ++i)
+        {
+            for (auto& handler : handlers_[i])
+            {
+                handler();
+            }
+            auto phase_end{ std::chrono::steady_clock::now() };
+            last_durations_[i] = phase_end - phase_start;
+            current.phases[i].record(last_durations_[i].count());
+            phase_start = phase_end;
+        }
+        auto duration{ std::chrono::duration_cast<std::chrono::nanoseconds>(phase_start - start) };
+        current.total.record(duration.count());
+        if (listener_)
+        {
+            listener_(duration);
+        }
+
+        auto& oldest{ tick_starts_[number % tps_samples] };
+        if (number >= tps_samples)
+        {
+            tps_.store(static_cast<double>(tps_samples) / std::chrono::duration<double>(start - oldest).count(),
+                std::memory_order_relaxed);
+        }
+        else if (number)
+        {
+            tps_.store(static_cast<double>(number) / std::chrono::duration<double>(start - tick_starts_[0]).count(),
+                std::memory_order_relaxed);
+        }
+        oldest = start;
+        tick_.store(number + 1, std::memory_order_relaxed);
+    }
+
+    tick_statistics tick_scheduler::get_statistics() const
+    {
+        util::histogram_snapshot total{};
+        std::array<util::histogram_snapshot, phase_count> phases{};
+        for (auto& window : windows_)
+        {
+            window.total.add_to(total);
+            for (std::size_t i{}; i < phase_count; ++i)
+            {
+                window.phases[i].add_to(phases[i]);
+            }
+        }
+        tick_statistics statistics{
+            .tick = get_tick(),
+            .tps = get_tps(),
+            .mspt = get_mspt(total),
+            .phases = {},
+            .overruns = overruns_.load(std::memory_order_relaxed),
+            .skipped = skipped_.load(std::memory_order_relaxed)
+        };
+        for (std::size_t i{}; i < phase_count; ++i)
+        {
+            statistics.phases[i] = get_mspt(phases[i]);
+        }
+        return statistics;
+    }
+}
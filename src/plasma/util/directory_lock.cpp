@@ -35,8 +35,8 @@ namespace plasma::util
 {
     directory_lock::directory_lock(std::filesystem::path directory)
     {
-        lock_file_path_ = std::filesystem::path{ directory /= directory_lock_name };
         create_directories(directory);
+        lock_file_path_ = directory / directory_lock_name;
         lock_file_ = std::ofstream{ lock_file_path_, std::ios::trunc };
         lock_file_ << "☃";
         lock_file_.flush();
@@ -45,7 +45,11 @@ namespace plasma::util
             throw boost::interprocess::lock_exception{};
         }
         lock_ = boost::interprocess::file_lock{ lock_file_path_.c_str() };
-        lock_.lock();
+        if (!lock_.try_lock())
+        {
+            throw boost::interprocess::interprocess_exception{
+                fmt::format("{} is held by another process", lock_file_path_.string()).c_str() };
+        }
     }
 
     bool directory_lock::is_locked(std::filesystem::path directory)
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#include <plasma/util/histogram.h>
+
+namespace plasma::util
+{
+    histogram_snapshot::histogram_snapshot() noexcept :
+        counts_{}, total_{}, max_{}
+    {
+    }
+
+    std::uint64_t histogram_snapshot::get_percentile(double quantile) const noexcept
+    {
+        if (!total_)
+        {
+            return 0;
+        }
+        auto rank{ static_cast<std::uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total_))) };
+        rank = std::max<std::uint64_t>(rank, 1);
+        std::uint64_t seen{};
+        for (std::size_t i{}; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= rank)
+            {
+                return std::min(histogram::get_bucket_limit(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    histogram::histogram() noexcept :
+        counts_{}, total_{}, max_{}
+    {
+    }
+
+    std::size_t histogram::get_bucket_index(std::uint64_t value) noexcept
+    {
+        if (value < (1u << sub_bucket_bits))
+        {
+            return static_cast<std::size_t>(value);
+        }
+        auto shift{ static_cast<unsigned>(std::bit_width(value)) - 1 - sub_bucket_bits };
+        return ((shift + 1) << sub_bucket_bits) + static_cast<std::size_t>((value >> shift) - (1u << sub_bucket_bits));
+    }
+
+    std::uint64_t histogram::get_bucket_limit(std::size_t index) noexcept
+    {
+        if (index < (1u << sub_bucket_bits))
+        {
+            return index;
+        }
+        auto shift{ static_cast<unsigned>(index >> sub_bucket_bits) - 1 };
+        auto low{ ((1ull << sub_bucket_bits) + (index & ((1u << sub_bucket_bits) - 1))) << shift };
+        return low + ((1ull << shift) - 1);
+    }
+
+    void histogram::record(std::uint64_t value) noexcept
+    {
+        counts_[get_bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        total_.fetch_add(1, std::memory_order_relaxed);
+        auto max{ max_.load(std::memory_order_relaxed) };
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void histogram::reset() noexcept
+    {
+        for (auto& count : counts_)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        total_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    void histogram::add_to(histogram_snapshot& snapshot) const noexcept
+    {
+        for (std::size_t i{}; i < bucket_count; ++i)
+        {
+            auto count{ counts_[i].load(std::memory_order_relaxed) };
+            snapshot.counts_[i] += count;
+            snapshot.total_ += count;
+        }
+        snapshot.max_ = std::max(snapshot.max_, max_.load(std::memory_order_relaxed));
+    }
+}
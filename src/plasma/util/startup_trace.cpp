@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#include <plasma/network/protocol.h>
+#include <plasma/util/startup_trace.h>
+
+namespace plasma::util
+{
+    namespace
+    {
+        double get_microseconds(std::chrono::steady_clock::duration duration) noexcept
+        {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        }
+    }
+
+    trace_span::trace_span(startup_trace* trace, std::string_view name, const char* category) :
+        trace_{ trace && trace->is_recording() ? trace : nullptr }, name_{ trace_ ? name : std::string_view{} },
+        category_{ category }, started_{ trace_ ? std::chrono::steady_clock::now() : decltype(started_){} }
+    {
+    }
+
+    trace_span::trace_span(trace_span&& other) noexcept :
+        trace_{ other.trace_ }, name_{ std::move(other.name_) }, category_{ other.category_ },
+        started_{ other.started_ }
+    {
+        other.trace_ = nullptr;
+    }
+
+    void trace_span::next(std::string_view name)
+    {
+        if (!trace_)
+        {
+            return;
+        }
+        auto now{ std::chrono::steady_clock::now() };
+        trace_->record(name_, category_, started_, now);
+        name_ = name;
+        started_ = now;
+    }
+
+    void trace_span::end()
+    {
+        if (trace_)
+        {
+            trace_->record(name_, category_, started_, std::chrono::steady_clock::now());
+            trace_ = nullptr;
+        }
+    }
+
+    trace_span::~trace_span()
+    {
+        end();
+    }
+
+    startup_trace::startup_trace() :
+        origin_{ std::chrono::steady_clock::now() }, recording_{ true }
+    {
+    }
+
+    trace_span startup_trace::span(std::string_view name, const char* category)
+    {
+        return { this, name, category };
+    }
+
+    void startup_trace::record(std::string_view name, const char* category,
+        std::chrono::steady_clock::time_point started, std::chrono::steady_clock::time_point finished)
+    {
+        if (!is_recording())
+        {
+            return;
+        }
+        auto id{ std::this_thread::get_id() };
+        std::lock_guard lock{ mutex_ };
+        auto thread{ std::find(threads_.begin(), threads_.end(), id) };
+        if (thread == threads_.end())
+        {
+            thread = threads_.insert(threads_.end(), id);
+        }
+        events_.push_back(trace_event{
+            .name = std::string{ name },
+            .category = category,
+            .thread = static_cast<std::uint32_t>(thread - threads_.begin()),
+            .started = started,
+            .finished = finished
+        });
+    }
+
+    std::filesystem::path startup_trace::write(const std::filesystem::path& directory)
+    {
+        recording_.store(false, std::memory_order_relaxed);
+        std::vector<trace_event> events{};
+        std::size_t threads{};
+        {
+            std::lock_guard lock{ mutex_ };
+            std::swap(events, events_);
+            threads = threads_.size();
+        }
+        create_directories(directory);
+        auto path{ directory / fmt::format("startup-{:%Y%m%d-%H%M%S}.json",
+            fmt::localtime(std::time(nullptr))) };
+        std::ofstream output{ path };
+        if (!output)
+        {
+            throw std::runtime_error{ fmt::format("Failed to create {}", path.string()) };
+        }
+        output << R"({"displayTimeUnit":"ms","traceEvents":[)";
+        for (std::size_t i{}; i < threads; ++i)
+        {
+            output << fmt::format(R"({}{{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                i ? ",\n" : "\n", i, i ? fmt::format("thread {}", i) : "main");
+        }
+        for (const auto& event : events)
+        {
+            output << fmt::format(",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                "\"ts\":{:.3f},\"dur\":{:.3f}}}", plasma::network::json_escape(event.name), event.category,
+                event.thread, get_microseconds(event.started - origin_),
+                get_microseconds(event.finished - event.started));
+        }
+        output << "\n]}\n";
+        return path;
+    }
+
+    startup_trace& get_startup_trace() noexcept
+    {
+        static startup_trace trace{};
+        return trace;
+    }
+}
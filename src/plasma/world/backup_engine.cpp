@@ -0,0 +1,613 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/uuid/detail/sha1.hpp>
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/util/directory_lock.h>
+#include <plasma/world/backup_engine.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        constexpr std::string_view manifest_header{ "plasma-backup 1" };
+        constexpr std::size_t chunk_header_size{ 5 };
+        constexpr std::uint8_t external_flag{ 0x80 };
+
+        std::uint32_t read_big_endian(const std::byte* data) noexcept
+        {
+            return static_cast<std::uint32_t>(data[0]) << 24 | static_cast<std::uint32_t>(data[1]) << 16
+                | static_cast<std::uint32_t>(data[2]) << 8 | static_cast<std::uint32_t>(data[3]);
+        }
+
+        std::string hash_bytes(std::span<const std::byte> bytes)
+        {
+            boost::uuids::detail::sha1 sha1{};
+            sha1.process_bytes(bytes.data(), bytes.size());
+            boost::uuids::detail::sha1::digest_type digest{};
+            sha1.get_digest(digest);
+            return fmt::format("{:08x}{:08x}{:08x}{:08x}{:08x}", digest[0], digest[1], digest[2], digest[3], digest[4]);
+        }
+
+        std::filesystem::path get_object_path(const std::filesystem::path& backup_directory, const std::string& hash)
+        {
+            return backup_directory / "objects" / hash.substr(0, 2) / hash.substr(2);
+        }
+
+        std::vector<std::byte> read_file(const std::filesystem::path& path)
+        {
+            std::ifstream stream{ path, std::ios::binary };
+            if (!stream)
+            {
+                throw std::runtime_error{ fmt::format("Failed to open {}", path.string()) };
+            }
+            std::vector<char> data{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+            std::vector<std::byte> bytes(data.size());
+            std::copy_n(reinterpret_cast<const std::byte*>(data.data()), data.size(), bytes.begin());
+            return bytes;
+        }
+
+        class store_result
+        {
+        public:
+            bool reused;
+            std::uint64_t copied;
+            std::uint64_t cloned;
+        };
+
+        // Stores bytes under the object path unless it exists already. When source is an open file holding the same
+        // bytes at offset, the kernel is asked to share or copy the extents instead.
+        store_result store_object(const std::filesystem::path& object, std::span<const std::byte> bytes,
+            [[maybe_unused]] int source, [[maybe_unused]] std::uint64_t offset)
+        {
+            if (exists(object))
+            {
+                return { .reused = true, .copied = 0, .cloned = 0 };
+            }
+            create_directories(object.parent_path());
+            auto temporary{ object };
+            temporary += ".tmp";
+            store_result result{ .reused = false, .copied = 0, .cloned = 0 };
+#ifdef __linux__
+            auto target{ ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) };
+            if (target < 0)
+            {
+                throw std::runtime_error{ fmt::format("Failed to create {}", temporary.string()) };
+            }
+            std::size_t done{};
+            if (source >= 0)
+            {
+                file_clone_range range{
+                    .src_fd = source,
+                    .src_offset = offset,
+                    .src_length = bytes.size(),
+                    .dest_offset = 0
+                };
+                if (!::ioctl(target, FICLONERANGE, &range))
+                {
+                    done = bytes.size();
+                    result.cloned = bytes.size();
+                }
+                while (done < bytes.size())
+                {
+                    auto input{ static_cast<loff_t>(offset + done) };
+                    auto copied{ ::copy_file_range(source, &input, target, nullptr, bytes.size() - done, 0) };
+                    if (copied <= 0)
+                    {
+                        break;
+                    }
+                    done += static_cast<std::size_t>(copied);
+                    result.copied += static_cast<std::uint64_t>(copied);
+                }
+            }
+            while (done < bytes.size())
+            {
+                auto written{ ::pwrite(target, bytes.data() + done, bytes.size() - done, static_cast<off_t>(done)) };
+                if (written < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (written <= 0)
+                {
+                    ::close(target);
+                    throw std::runtime_error{ fmt::format("Failed to write {}", temporary.string()) };
+                }
+                done += static_cast<std::size_t>(written);
+                result.copied += static_cast<std::uint64_t>(written);
+            }
+            ::close(target);
+#else
+            std::ofstream stream{ temporary, std::ios::binary | std::ios::trunc };
+            stream.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!stream.flush())
+            {
+                throw std::runtime_error{ fmt::format("Failed to write {}", temporary.string()) };
+            }
+            result.copied = bytes.size();
+#endif
+            std::filesystem::rename(temporary, object);
+            return result;
+        }
+
+        // Objects are only referenced once the manifest naming them is written, so one sync of the file system
+        // before that is enough.
+        void sync_directory([[maybe_unused]] const std::filesystem::path& directory)
+        {
+#ifdef __linux__
+            auto descriptor{ ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+            if (descriptor >= 0)
+            {
+                ::syncfs(descriptor);
+                ::close(descriptor);
+            }
+#endif
+        }
+
+        void write_file(const std::filesystem::path& path, std::string_view contents)
+        {
+            auto temporary{ path };
+            temporary += ".tmp";
+            {
+                std::ofstream stream{ temporary, std::ios::binary | std::ios::trunc };
+                stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+                if (!stream.flush())
+                {
+                    throw std::runtime_error{ fmt::format("Failed to write {}", temporary.string()) };
+                }
+            }
+            sync_directory(path.parent_path());
+            std::filesystem::rename(temporary, path);
+        }
+    }
+
+    backup_engine::backup_engine(std::filesystem::path world_directory, std::filesystem::path backup_directory,
+        region_storage& storage, chunk_saver& saver, std::uint64_t rate) :
+        world_directory_{ std::move(world_directory) }, backup_directory_{ std::move(backup_directory) },
+        storage_{ storage }, saver_{ saver }, rate_{ rate }, running_{}, cancelled_{}, chunks_total_{},
+        chunks_done_{}, objects_written_{}, objects_reused_{}, bytes_copied_{}, bytes_cloned_{}, throttled_bytes_{}
+    {
+    }
+
+    backup_engine::~backup_engine()
+    {
+        cancel();
+        if (worker_.joinable())
+        {
+            worker_.join();
+        }
+    }
+
+    void backup_engine::throttle(std::uint64_t bytes)
+    {
+        // Pending chunk saves go first, for up to a second at a time.
+        for (int i{}; i < 100 && !cancelled_.load(std::memory_order_relaxed)
+            && saver_.get_statistics().backlog_chunks; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+        }
+        if (!rate_)
+        {
+            return;
+        }
+        throttled_bytes_ += bytes;
+        auto due{ throttle_start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>{ static_cast<double>(throttled_bytes_) / static_cast<double>(rate_) }) };
+        if (due > std::chrono::steady_clock::now())
+        {
+            std::this_thread::sleep_until(due);
+        }
+    }
+
+    std::string backup_engine::start()
+    {
+        std::lock_guard lock{ mutex_ };
+        if (running_.load(std::memory_order_acquire))
+        {
+            throw std::logic_error{ fmt::format("Backup {} is still running", name_) };
+        }
+        if (worker_.joinable())
+        {
+            worker_.join();
+        }
+
+        std::vector<region_entry> regions{};
+        for (auto [x, z] : storage_.list_regions())
+        {
+            if (auto region{ storage_.get_region(x * 32, z * 32) })
+            {
+                regions.push_back({ .x = x, .z = z, .path = region->get_path(), .region = region, .snapshot = {},
+                    .externals = {} });
+            }
+        }
+        saver_.pause_writes([&regions]
+        {
+            for (auto& entry : regions)
+            {
+                entry.snapshot = entry.region->snapshot();
+                if (!entry.snapshot.mapping)
+                {
+                    continue;
+                }
+                auto bytes{ entry.snapshot.mapping->get_bytes() };
+                for (std::size_t index{}; index < region_file::chunk_count; ++index)
+                {
+                    std::size_t start{ (entry.snapshot.locations[index] >> 8) * region_file::sector_size };
+                    if (!entry.snapshot.locations[index] || start + chunk_header_size > bytes.size()
+                        || !(static_cast<std::uint8_t>(bytes[start + 4]) & external_flag))
+                    {
+                        continue;
+                    }
+                    try
+                    {
+                        entry.externals.emplace(index, read_file(entry.region->get_external_path(
+                            static_cast<std::int32_t>(index % 32), static_cast<std::int32_t>(index / 32))));
+                    }
+                    catch (const std::exception& e)
+                    {
+                        logger lg{};
+                        WRNF(lg, "Leaving chunk {} of {} out of the backup: {}", index, entry.path.string(), e.what());
+                    }
+                }
+            }
+        });
+
+        auto now{ std::chrono::system_clock::now() };
+        auto base_name{ fmt::format("{}-{:%Y%m%d-%H%M%S}", world_directory_.filename().string(),
+            fmt::localtime(std::chrono::system_clock::to_time_t(now))) };
+        auto name{ base_name };
+        for (int i{ 1 }; exists(backup_directory_ / "manifests" / (name + ".txt")); ++i)
+        {
+            name = fmt::format("{}-{}", base_name, i);
+        }
+
+        std::size_t total{};
+        for (const auto& entry : regions)
+        {
+            total += static_cast<std::size_t>(std::count_if(entry.snapshot.locations.begin(),
+                entry.snapshot.locations.end(), [](std::uint32_t location)
+            {
+                return location != 0;
+            }));
+        }
+        name_ = name;
+        chunks_total_ = total;
+        chunks_done_ = 0;
+        objects_written_ = 0;
+        objects_reused_ = 0;
+        bytes_copied_ = 0;
+        bytes_cloned_ = 0;
+        throttle_start_ = std::chrono::steady_clock::now();
+        throttled_bytes_ = 0;
+        cancelled_ = false;
+        running_ = true;
+        worker_ = std::thread{ &backup_engine::run, this, name, std::move(regions),
+            std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count() };
+        return name;
+    }
+
+    void backup_engine::run(std::string name, std::vector<region_entry> regions, std::int64_t created)
+    {
+        logger lg{};
+        auto record{ [this](const store_result& result)
+        {
+            (result.reused ? objects_reused_ : objects_written_).fetch_add(1, std::memory_order_relaxed);
+            bytes_copied_.fetch_add(result.copied, std::memory_order_relaxed);
+            bytes_cloned_.fetch_add(result.cloned, std::memory_order_relaxed);
+        } };
+        try
+        {
+            util::directory_lock store_lock{ backup_directory_ };
+            std::string manifest{ fmt::format("{}\ncreated {}\n", manifest_header, created) };
+
+            // Files other than regions are not written by the server while it runs and are copied whole.
+            for (const auto& entry : std::filesystem::recursive_directory_iterator{ world_directory_ })
+            {
+                auto relative{ entry.path().lexically_relative(world_directory_) };
+                if (!entry.is_regular_file() || *relative.begin() == "region"
+                    || relative == util::directory_lock::directory_lock_name)
+                {
+                    continue;
+                }
+                auto bytes{ read_file(entry.path()) };
+                auto hash{ hash_bytes(bytes) };
+                record(store_object(get_object_path(backup_directory_, hash), bytes, -1, 0));
+                manifest += fmt::format("file {} {} {}\n", hash, bytes.size(), relative.generic_string());
+                throttle(bytes.size());
+            }
+
+            for (const auto& entry : regions)
+            {
+                if (!entry.snapshot.mapping)
+                {
+                    continue;
+                }
+#ifdef __linux__
+                auto source{ ::open(entry.path.c_str(), O_RDONLY | O_CLOEXEC) };
+#else
+                int source{ -1 };
+#endif
+                auto bytes{ entry.snapshot.mapping->get_bytes() };
+                for (std::size_t index{}; index < region_file::chunk_count; ++index)
+                {
+                    auto location{ entry.snapshot.locations[index] };
+                    if (!location)
+                    {
+                        continue;
+                    }
+                    if (cancelled_.load(std::memory_order_relaxed))
+                    {
+                        throw std::runtime_error{ "cancelled" };
+                    }
+                    std::size_t start{ (location >> 8) * region_file::sector_size };
+                    std::size_t size{ (location & 0xff) * region_file::sector_size };
+                    if (start + size > bytes.size() || size < chunk_header_size)
+                    {
+                        WRNF(lg, "Skipping chunk {} of {}, it lies outside the file", index, entry.path.string());
+                        continue;
+                    }
+                    auto length{ read_big_endian(bytes.data() + start) };
+                    if (!length || length + 4 > size)
+                    {
+                        WRNF(lg, "Skipping chunk {} of {}, it has an invalid length", index, entry.path.string());
+                        continue;
+                    }
+
+                    std::string hash{};
+                    auto type{ static_cast<std::uint8_t>(bytes[start + 4]) };
+                    if (type & external_flag)
+                    {
+                        auto external{ entry.externals.find(index) };
+                        if (external == entry.externals.end())
+                        {
+                            continue;
+                        }
+                        const auto& data{ external->second };
+                        std::vector<std::byte> blob(chunk_header_size + data.size());
+                        auto blob_length{ static_cast<std::uint32_t>(data.size() + 1) };
+                        for (std::size_t i{}; i < 4; ++i)
+                        {
+                            blob[i] = static_cast<std::byte>(blob_length >> (24 - i * 8));
+                        }
+                        blob[4] = static_cast<std::byte>(type & ~external_flag);
+                        std::copy(data.begin(), data.end(), blob.begin() + chunk_header_size);
+                        hash = hash_bytes(blob);
+                        record(store_object(get_object_path(backup_directory_, hash), blob, -1, 0));
+                        throttle(blob.size());
+                    }
+                    else
+                    {
+                        // The hash covers the chunk, the object the whole sectors so that they can be cloned.
+                        hash = hash_bytes(bytes.subspan(start, length + 4));
+                        record(store_object(get_object_path(backup_directory_, hash), bytes.subspan(start, size),
+                            source, start));
+                        throttle(size);
+                    }
+                    manifest += fmt::format("chunk {} {} {} {} {}\n", entry.x, entry.z, index,
+                        entry.snapshot.timestamps[index], hash);
+                    chunks_done_.fetch_add(1, std::memory_order_relaxed);
+                }
+#ifdef __linux__
+                if (source >= 0)
+                {
+                    ::close(source);
+                }
+#endif
+            }
+
+            create_directories(backup_directory_ / "manifests");
+            sync_directory(backup_directory_);
+            write_file(backup_directory_ / "manifests" / (name + ".txt"), manifest);
+            INFF(lg, "Backup {} finished: {} chunks, {} new objects, {} reused, {} MiB copied, {} MiB "
+                "cloned", name, chunks_done_.load(), objects_written_.load(), objects_reused_.load(),
+                bytes_copied_.load() / (1024 * 1024), bytes_cloned_.load() / (1024 * 1024));
+        }
+        catch (const std::exception& e)
+        {
+            if (cancelled_.load(std::memory_order_relaxed))
+            {
+                WRNF(lg, "Backup {} cancelled", name);
+            }
+            else
+            {
+                ERRF(lg, "Backup {} failed: {}", name, e.what());
+            }
+        }
+        running_.store(false, std::memory_order_release);
+    }
+
+    void backup_engine::cancel()
+    {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    backup_progress backup_engine::get_progress()
+    {
+        std::lock_guard lock{ mutex_ };
+        return {
+            .running = running_.load(std::memory_order_acquire),
+            .name = name_,
+            .chunks_total = chunks_total_.load(std::memory_order_relaxed),
+            .chunks_done = chunks_done_.load(std::memory_order_relaxed),
+            .objects_written = objects_written_.load(std::memory_order_relaxed),
+            .objects_reused = objects_reused_.load(std::memory_order_relaxed),
+            .bytes_copied = bytes_copied_.load(std::memory_order_relaxed),
+            .bytes_cloned = bytes_cloned_.load(std::memory_order_relaxed)
+        };
+    }
+
+    std::vector<std::string> list_backups(const std::filesystem::path& backup_directory)
+    {
+        std::vector<std::pair<std::filesystem::file_time_type, std::string>> found{};
+        auto directory{ backup_directory / "manifests" };
+        if (exists(directory))
+        {
+            for (const auto& entry : std::filesystem::directory_iterator{ directory })
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".txt")
+                {
+                    found.emplace_back(entry.last_write_time(), entry.path().stem().string());
+                }
+            }
+        }
+        std::sort(found.begin(), found.end());
+        std::vector<std::string> names{};
+        for (auto& [time, name] : found)
+        {
+            names.push_back(std::move(name));
+        }
+        return names;
+    }
+
+    void restore_backup(const std::filesystem::path& world_directory, const std::filesystem::path& backup_directory,
+        const std::string& name)
+    {
+        logger lg{};
+        util::directory_lock store_lock{ backup_directory };
+        auto manifest_path{ backup_directory / "manifests" / (name + ".txt") };
+        std::ifstream manifest{ manifest_path };
+        std::string line{};
+        if (!manifest || !std::getline(manifest, line) || line != manifest_header)
+        {
+            throw std::runtime_error{ fmt::format("{} is not a backup manifest", manifest_path.string()) };
+        }
+
+        auto world_name{ world_directory.filename().string() };
+        auto staging{ world_directory.parent_path() / (world_name + ".restore") };
+        std::filesystem::remove_all(staging);
+        create_directories(staging);
+
+        class chunk_entry
+        {
+        public:
+            std::size_t index;
+            std::uint32_t timestamp;
+            std::string hash;
+        };
+
+        std::map<std::pair<std::int32_t, std::int32_t>, std::vector<chunk_entry>> regions{};
+        std::size_t files{};
+        while (std::getline(manifest, line))
+        {
+            std::istringstream stream{ line };
+            std::string kind{};
+            stream >> kind;
+            if (kind == "file")
+            {
+                std::string hash{};
+                std::uintmax_t size{};
+                std::string path{};
+                stream >> hash >> size;
+                std::getline(stream >> std::ws, path);
+                auto target{ staging / std::filesystem::path{ path }.lexically_normal() };
+                if (std::filesystem::path{ path }.is_absolute() || *target.lexically_relative(staging).begin() == "..")
+                {
+                    throw std::runtime_error{ fmt::format("Backup {} names a file outside the world: {}", name, path) };
+                }
+                create_directories(target.parent_path());
+                std::filesystem::copy_file(get_object_path(backup_directory, hash), target);
+                if (std::filesystem::file_size(target) != size)
+                {
+                    throw std::runtime_error{ fmt::format("Object {} for {} is damaged", hash, path) };
+                }
+                ++files;
+            }
+            else if (kind == "chunk")
+            {
+                std::int32_t x{}, z{};
+                chunk_entry chunk{};
+                stream >> x >> z >> chunk.index >> chunk.timestamp >> chunk.hash;
+                if (!stream || chunk.index >= region_file::chunk_count)
+                {
+                    throw std::runtime_error{ fmt::format("Malformed line in backup {}: {}", name, line) };
+                }
+                regions[{ x, z }].push_back(std::move(chunk));
+            }
+        }
+
+        std::size_t chunks{};
+        for (const auto& [position, entries] : regions)
+        {
+            region_file region{ staging / "region" / fmt::format("r.{}.{}.mca", position.first, position.second), true };
+            std::vector<std::vector<std::byte>> blobs{};
+            std::vector<chunk_write> writes{};
+            blobs.reserve(entries.size());
+            for (const auto& entry : entries)
+            {
+                const auto& blob{ blobs.emplace_back(read_file(get_object_path(backup_directory, entry.hash))) };
+                auto length{ blob.size() >= chunk_header_size ? read_big_endian(blob.data()) : 0 };
+                if (!length || length + 4 > blob.size())
+                {
+                    throw std::runtime_error{ fmt::format("Object {} is not a chunk", entry.hash) };
+                }
+                writes.push_back({
+                    .x = position.first * 32 + static_cast<std::int32_t>(entry.index % 32),
+                    .z = position.second * 32 + static_cast<std::int32_t>(entry.index / 32),
+                    .data = std::span{ blob }.subspan(chunk_header_size, length - 1),
+                    .compression = static_cast<chunk_compression>(blob[4]),
+                    .timestamp = entry.timestamp
+                });
+            }
+            region.write_batch(writes);
+            chunks += writes.size();
+        }
+
+        // Keep whatever was there before, in case the wrong backup was picked.
+        auto previous{ world_directory.parent_path() / (world_name + ".pre-restore") };
+        std::filesystem::remove_all(previous);
+        create_directories(previous);
+        for (const auto& entry : std::filesystem::directory_iterator{ world_directory })
+        {
+            if (entry.path().filename() != util::directory_lock::directory_lock_name)
+            {
+                std::filesystem::rename(entry.path(), previous / entry.path().filename());
+            }
+        }
+        for (const auto& entry : std::filesystem::directory_iterator{ staging })
+        {
+            std::filesystem::rename(entry.path(), world_directory / entry.path().filename());
+        }
+        std::filesystem::remove_all(staging);
+        INFF(lg, "Restored {} files and {} chunks from backup {}, the previous world was moved to {}", files, chunks,
+            name, previous.string());
+    }
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <plasma/nbt/view.h>
+#include <plasma/nbt/writer.h>
+#include <plasma/world/chunk.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        std::shared_ptr<const nibble_array> load_light(const nbt::view& tag)
+        {
+            if (!tag)
+            {
+                return nullptr;
+            }
+            auto bytes{ tag.as_byte_array().bytes() };
+            if (bytes.size() != nibble_array::size)
+            {
+                throw nbt::parse_error{ fmt::format("Light array of {} bytes", bytes.size()) };
+            }
+            auto light{ std::make_shared<const nibble_array>(bytes.first<nibble_array::size>()) };
+            return light->is_uniform(15) ? nibble_array::get_full() : light;
+        }
+
+        std::span<const std::int8_t> get_signed(const nibble_array& light) noexcept
+        {
+            return { reinterpret_cast<const std::int8_t*>(light.get_bytes().data()), nibble_array::size };
+        }
+    }
+
+    std::uint64_t next_chunk_revision() noexcept
+    {
+        static std::atomic<std::uint64_t> revision{};
+        return revision.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    chunk::chunk(std::int32_t x, std::int32_t z) :
+        x_{ x }, z_{ z }, revision_{ next_chunk_revision() }, dirty_{}, lit_{}
+    {
+    }
+
+    std::uint32_t chunk::set_block(std::uint32_t x, std::uint32_t y, std::uint32_t z, std::uint32_t state)
+    {
+        auto previous{ sections_[y >> 4].set(x, y & 15, z, state) };
+        if (previous != state)
+        {
+            dirty_ = true;
+            revision_ = next_chunk_revision();
+        }
+        return previous;
+    }
+
+    std::size_t chunk::get_memory_usage() const noexcept
+    {
+        auto usage{ sizeof(chunk) };
+        for (std::size_t i{}; i < section_count; ++i)
+        {
+            usage += sections_[i].get_palette().size_bytes() + sections_[i].get_data().size();
+            usage += block_light_[i] ? nibble_array::size : 0;
+            usage += sky_light_[i] && sky_light_[i] != nibble_array::get_full() ? nibble_array::size : 0;
+        }
+        return usage;
+    }
+
+    void chunk::serialize(std::vector<std::byte>& nbt) const
+    {
+        nbt::writer writer{ nbt };
+        writer.begin_compound();
+        writer.write_int("DataVersion", data_version);
+        writer.begin_compound("Level");
+        writer.write_int("xPos", x_);
+        writer.write_int("zPos", z_);
+        writer.write_string("Status", "full");
+        writer.write_byte("isLightOn", lit_);
+        writer.begin_list("Sections", nbt::tag_type::tag_compound);
+        for (std::size_t i{}; i < section_count; ++i)
+        {
+            const auto& section{ sections_[i] };
+            auto palette{ section.get_palette() };
+            auto air{ !section.get_bits() && palette[0] == chunk_section::air };
+            if (air && !block_light_[i] && !sky_light_[i])
+            {
+                continue;
+            }
+            writer.begin_compound();
+            writer.write_byte("Y", static_cast<std::int8_t>(i));
+            if (block_light_[i])
+            {
+                writer.write_byte_array("BlockLight", get_signed(*block_light_[i]));
+            }
+            if (sky_light_[i])
+            {
+                writer.write_byte_array("SkyLight", get_signed(*sky_light_[i]));
+            }
+            if (air)
+            {
+                writer.end_compound();
+                continue;
+            }
+            auto data{ section.get_data() };
+            writer.write_long_array("BlockStates", nbt::big_endian_array<std::int64_t>{ data.data(),
+                data.size() / sizeof(std::int64_t) });
+            if (section.get_bits() != chunk_section::global_bits)
+            {
+                writer.write_int_array("StatePalette", std::span{ reinterpret_cast<const std::int32_t*>(palette.data()),
+                    palette.size() });
+            }
+            writer.end_compound();
+        }
+        writer.end_list();
+        writer.end_compound();
+        writer.end_compound();
+    }
+
+    std::shared_ptr<chunk> chunk::deserialize(std::int32_t x, std::int32_t z, std::span<const std::byte> nbt)
+    {
+        auto loaded{ std::make_shared<chunk>(x, z) };
+        auto level{ nbt::view{ nbt }.find("Level") };
+        if (!level)
+        {
+            throw nbt::parse_error{ fmt::format("Chunk {} {} has no Level", x, z) };
+        }
+        if (auto lit{ level.find("isLightOn") })
+        {
+            loaded->lit_ = lit.as_integer() != 0;
+        }
+        auto sections{ level.find("Sections") };
+        if (!sections)
+        {
+            return loaded;
+        }
+        std::vector<std::uint32_t> palette{};
+        sections.for_each([&](const nbt::view& section)
+        {
+            auto y{ section.find("Y").as_integer() };
+            if (y < 0 || y >= static_cast<std::int64_t>(section_count))
+            {
+                return;
+            }
+            auto index{ static_cast<std::size_t>(y) };
+            loaded->block_light_[index] = load_light(section.find("BlockLight"));
+            loaded->sky_light_[index] = load_light(section.find("SkyLight"));
+            auto states{ section.find("BlockStates") };
+            auto state_palette{ section.find("StatePalette") };
+            if (!states)
+            {
+                return;
+            }
+            auto data{ states.as_long_array().bytes() };
+            auto& target{ loaded->sections_[static_cast<std::size_t>(y)] };
+            if (!state_palette)
+            {
+                // Without a palette the entries are global ids.
+                std::array<std::uint32_t, chunk_section::volume> values{};
+                if (data.size() != (chunk_section::volume + 3) / 4 * sizeof(std::uint64_t))
+                {
+                    throw nbt::parse_error{ fmt::format("Section {} of chunk {} {} has no palette", y, x, z) };
+                }
+                for (std::size_t i{}; i < chunk_section::volume; ++i)
+                {
+                    auto word{ nbt::load_big_endian<std::uint64_t>(data.data() + i / 4 * sizeof(std::uint64_t)) };
+                    values[i] = static_cast<std::uint32_t>(word >> (i % 4 * chunk_section::global_bits))
+                        & ((1u << chunk_section::global_bits) - 1);
+                }
+                target.pack(values);
+                return;
+            }
+            auto entries{ state_palette.as_int_array() };
+            palette.resize(entries.size());
+            for (std::size_t i{}; i < entries.size(); ++i)
+            {
+                palette[i] = static_cast<std::uint32_t>(entries[i]);
+            }
+            target.load(palette, data);
+        });
+        return loaded;
+    }
+}
@@ -0,0 +1,546 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/util/startup_trace.h>
+#include <plasma/world/chunk_cache.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        // Blocks per second below which a viewer is treated as standing still.
+        constexpr double min_prefetch_speed{ 2.0 };
+        constexpr double max_prefetch_distance{ 256.0 };
+        // Moving further than this between two updates is a teleport, not a velocity.
+        constexpr double teleport_distance{ 64.0 };
+        constexpr std::size_t default_chunk_bytes{ 16 * 1024 };
+        constexpr std::chrono::seconds max_retry_delay{ 30 };
+
+        std::chrono::seconds get_retry_delay(std::uint32_t failures) noexcept
+        {
+            return std::min(std::chrono::seconds{ 1 << std::min(failures, 5u) }, max_retry_delay);
+        }
+    }
+
+    chunk_cache::chunk_cache(region_storage& storage, chunk_saver& saver, job::job_system& jobs, generator generate,
+        std::size_t memory_budget, double prefetch_seconds, std::size_t max_prefetch_per_tick) :
+        storage_{ storage }, saver_{ saver }, jobs_{ jobs }, generator_{ std::move(generate) },
+        memory_budget_{ memory_budget },
+        prefetch_seconds_{ prefetch_seconds }, max_prefetch_per_tick_{ max_prefetch_per_tick }, hand_{},
+        resident_bytes_{}, saving_bytes_{}, loading_{}, ticketed_{}, prefetch_allowance_{ max_prefetch_per_tick },
+        hits_{}, misses_{}, loads_{}, failed_loads_{}, evictions_{}, prefetches_{}, prefetch_hits_{}
+    {
+    }
+
+    chunk_cache::~chunk_cache()
+    {
+        for (auto& [key, target] : entries_)
+        {
+            if (target.job)
+            {
+                jobs_.wait(target.job);
+            }
+        }
+    }
+
+    chunk_cache::entry& chunk_cache::request(std::int32_t x, std::int32_t z, bool prefetch)
+    {
+        auto key{ get_key(x, z) };
+        auto [found, inserted]{ entries_.try_emplace(key) };
+        auto& target{ found->second };
+        if (!inserted)
+        {
+            return target;
+        }
+        target.x = x;
+        target.z = z;
+        target.state = entry_state::loading;
+        target.referenced = !prefetch;
+        target.prefetched = prefetch;
+        target.clock_index = clock_.size();
+        clock_.push_back(key);
+        if (prefetch)
+        {
+            ++prefetches_;
+        }
+
+        // Evicted but not yet written, so the copy in memory is the newest one.
+        if (auto saved{ saving_.find(key) }; saved != saving_.end())
+        {
+            auto bytes{ saved->second->get_memory_usage() };
+            saving_bytes_ -= bytes;
+            target.state = entry_state::loaded;
+            target.bytes = bytes;
+            resident_bytes_ += bytes;
+            // The saver may still be serializing it.
+            target.loaded = std::make_shared<chunk>(*saved->second);
+            saving_.erase(saved);
+            return target;
+        }
+        load(target);
+        return target;
+    }
+
+    void chunk_cache::load(entry& target)
+    {
+        ++loading_;
+        ++loads_;
+        target.job = jobs_.submit([this, key = get_key(target.x, target.z), x = target.x, z = target.z,
+            requested = std::chrono::steady_clock::now()]
+        {
+            auto span{ util::get_startup_trace().span("load chunk", "world") };
+            std::shared_ptr<chunk> loaded{};
+            try
+            {
+                std::vector<std::byte> nbt{};
+                loaded = storage_.read_chunk(x, z, nbt) ? chunk::deserialize(x, z, nbt) : generator_(x, z);
+            }
+            catch (const std::exception& e)
+            {
+                logger lg{};
+                ERRF(lg, "Failed to load chunk {} {}: {}", x, z, e.what());
+            }
+            auto latency{ std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - requested) };
+            std::lock_guard lock{ completed_mutex_ };
+            completed_.push_back({ .key = key, .loaded = std::move(loaded), .latency = latency });
+        });
+    }
+
+    void chunk_cache::integrate()
+    {
+        std::vector<completion> completed{};
+        {
+            std::lock_guard lock{ completed_mutex_ };
+            std::swap(completed, completed_);
+        }
+        for (auto& done : completed)
+        {
+            auto& target{ entries_.at(done.key) };
+            target.job.reset();
+            --loading_;
+            load_latency_.record(static_cast<std::uint64_t>(done.latency.count()));
+            if (!done.loaded)
+            {
+                ++failed_loads_;
+                target.state = entry_state::failed;
+                if (!target.tickets)
+                {
+                    erase(done.key);
+                    continue;
+                }
+                ++target.failures;
+                target.retry_at = std::chrono::steady_clock::now() + get_retry_delay(target.failures);
+                failed_.push_back(done.key);
+                continue;
+            }
+            target.state = entry_state::loaded;
+            target.failures = 0;
+            target.bytes = done.loaded->get_memory_usage();
+            target.loaded = std::move(done.loaded);
+            resident_bytes_ += target.bytes;
+            if (listener_)
+            {
+                listener_(target.loaded);
+            }
+        }
+    }
+
+    void chunk_cache::retry_failed()
+    {
+        auto now{ std::chrono::steady_clock::now() };
+        std::erase_if(failed_, [this, now](std::uint64_t key)
+        {
+            auto found{ entries_.find(key) };
+            if (found == entries_.end() || found->second.state != entry_state::failed)
+            {
+                return true;
+            }
+            auto& target{ found->second };
+            if (now < target.retry_at)
+            {
+                return false;
+            }
+            logger lg{};
+            WRNF(lg, "Retrying chunk {} {} after {} failed loads", target.x, target.z, target.failures);
+            target.state = entry_state::loading;
+            load(target);
+            return true;
+        });
+    }
+
+    void chunk_cache::release_saved()
+    {
+        std::erase_if(saving_, [this](const auto& saved)
+        {
+            if (saver_.is_saving(saved.second->get_x(), saved.second->get_z()))
+            {
+                return false;
+            }
+            saving_bytes_ -= saved.second->get_memory_usage();
+            return true;
+        });
+    }
+
+    bool chunk_cache::offer_save(std::shared_ptr<const chunk> snapshot, std::size_t estimated_size)
+    {
+        auto x{ snapshot->get_x() };
+        auto z{ snapshot->get_z() };
+        return saver_.save(x, z, estimated_size, [snapshot = std::move(snapshot)](std::vector<std::byte>& nbt)
+        {
+            snapshot->serialize(nbt);
+        });
+    }
+
+    void chunk_cache::erase(std::uint64_t key)
+    {
+        auto found{ entries_.find(key) };
+        auto index{ found->second.clock_index };
+        if (found->second.state == entry_state::loaded)
+        {
+            resident_bytes_ -= found->second.bytes;
+        }
+        clock_[index] = clock_.back();
+        entries_.at(clock_[index]).clock_index = index;
+        clock_.pop_back();
+        entries_.erase(found);
+    }
+
+    void chunk_cache::evict()
+    {
+        // Two sweeps clear every reference bit, so anything still resident after that is ticketed or loading.
+        for (auto steps{ 2 * clock_.size() }; steps && resident_bytes_ + saving_bytes_ > memory_budget_; --steps)
+        {
+            if (hand_ >= clock_.size())
+            {
+                hand_ = 0;
+            }
+            auto key{ clock_[hand_] };
+            auto& target{ entries_.at(key) };
+            if (target.tickets || target.state == entry_state::loading)
+            {
+                ++hand_;
+                continue;
+            }
+            if (target.referenced)
+            {
+                target.referenced = false;
+                ++hand_;
+                continue;
+            }
+            if (target.state == entry_state::loaded && target.loaded->is_dirty())
+            {
+                // Nothing else holds on to an unticketed chunk, so the saver can serialize it without a copy.
+                if (!offer_save(target.loaded, target.bytes))
+                {
+                    ++hand_;
+                    continue;
+                }
+                target.loaded->set_dirty(false);
+                if (auto saved{ saving_.find(key) }; saved != saving_.end())
+                {
+                    saving_bytes_ -= saved->second->get_memory_usage();
+                }
+                saving_bytes_ += target.bytes;
+                saving_.insert_or_assign(key, target.loaded);
+            }
+            ++evictions_;
+            // The last entry takes this slot, so the hand stays put.
+            erase(key);
+        }
+    }
+
+    void chunk_cache::prefetch(viewer& moving)
+    {
+        auto speed{ std::hypot(moving.velocity_x, moving.velocity_z) };
+        if (speed < min_prefetch_speed)
+        {
+            moving.predicted = false;
+            return;
+        }
+        auto distance{ std::min(speed * prefetch_seconds_, max_prefetch_distance) };
+        auto from_x{ static_cast<std::int32_t>(std::floor(moving.x / 16.0)) };
+        auto from_z{ static_cast<std::int32_t>(std::floor(moving.z / 16.0)) };
+        auto to_x{ static_cast<std::int32_t>(std::floor((moving.x + moving.velocity_x / speed * distance) / 16.0)) };
+        auto to_z{ static_cast<std::int32_t>(std::floor((moving.z + moving.velocity_z / speed * distance) / 16.0)) };
+        if (moving.predicted && moving.predicted_x == to_x && moving.predicted_z == to_z)
+        {
+            return;
+        }
+
+        // Prefetched chunks may push out unticketed ones, but never crowd the ticketed ones past the budget.
+        auto resident{ entries_.size() - loading_ };
+        auto average{ resident ? resident_bytes_ / resident : default_chunk_bytes };
+        if ((ticketed_ + loading_) * average + saving_bytes_ > memory_budget_ / 10 * 9)
+        {
+            return;
+        }
+
+        // Walk the predicted path a chunk at a time, nearest first, loading the view around each step.
+        auto steps{ std::max(std::abs(to_x - from_x), std::abs(to_z - from_z)) };
+        for (std::int32_t step{ 1 }; step <= steps; ++step)
+        {
+            auto center_x{ from_x + static_cast<std::int32_t>(std::lround(static_cast<double>(to_x - from_x) * step
+                / steps)) };
+            auto center_z{ from_z + static_cast<std::int32_t>(std::lround(static_cast<double>(to_z - from_z) * step
+                / steps)) };
+            for (auto z{ center_z - moving.radius }; z <= center_z + moving.radius; ++z)
+            {
+                for (auto x{ center_x - moving.radius }; x <= center_x + moving.radius; ++x)
+                {
+                    if (entries_.contains(get_key(x, z)))
+                    {
+                        continue;
+                    }
+                    if (!prefetch_allowance_)
+                    {
+                        // Carry on from here on a later update.
+                        return;
+                    }
+                    --prefetch_allowance_;
+                    request(x, z, true);
+                }
+            }
+        }
+        moving.predicted = true;
+        moving.predicted_x = to_x;
+        moving.predicted_z = to_z;
+    }
+
+    void chunk_cache::add_ticket(std::int32_t x, std::int32_t z)
+    {
+        auto& target{ request(x, z, false) };
+        if (!target.tickets++)
+        {
+            ++ticketed_;
+        }
+        if (target.prefetched)
+        {
+            ++prefetch_hits_;
+            target.prefetched = false;
+        }
+    }
+
+    void chunk_cache::remove_ticket(std::int32_t x, std::int32_t z)
+    {
+        auto key{ get_key(x, z) };
+        auto found{ entries_.find(key) };
+        if (found == entries_.end() || !found->second.tickets)
+        {
+            return;
+        }
+        auto& target{ found->second };
+        if (--target.tickets)
+        {
+            return;
+        }
+        --ticketed_;
+        target.referenced = true;
+        if (target.state == entry_state::failed)
+        {
+            erase(key);
+        }
+    }
+
+    std::shared_ptr<chunk> chunk_cache::get(std::int32_t x, std::int32_t z)
+    {
+        auto key{ get_key(x, z) };
+        auto found{ entries_.find(key) };
+        if (found == entries_.end() || found->second.state != entry_state::loaded)
+        {
+            ++misses_;
+            return found == entries_.end() ? request(x, z, false).loaded : nullptr;
+        }
+        ++hits_;
+        auto& target{ found->second };
+        target.referenced = true;
+        if (target.prefetched)
+        {
+            ++prefetch_hits_;
+            target.prefetched = false;
+        }
+        if (!target.touched)
+        {
+            // The caller may change it, so its size is measured again next tick.
+            target.touched = true;
+            touched_.push_back(key);
+        }
+        return target.loaded;
+    }
+
+    std::shared_ptr<chunk> chunk_cache::find(std::int32_t x, std::int32_t z)
+    {
+        auto key{ get_key(x, z) };
+        auto found{ entries_.find(key) };
+        if (found == entries_.end() || found->second.state != entry_state::loaded)
+        {
+            return nullptr;
+        }
+        if (!found->second.touched)
+        {
+            found->second.touched = true;
+            touched_.push_back(key);
+        }
+        return found->second.loaded;
+    }
+
+    void chunk_cache::set_load_listener(load_listener listener)
+    {
+        listener_ = std::move(listener);
+    }
+
+    void chunk_cache::preload(std::int32_t x, std::int32_t z)
+    {
+        request(x, z, false);
+    }
+
+    void chunk_cache::update_viewer(std::uint64_t id, double x, double z, std::int32_t radius)
+    {
+        auto now{ std::chrono::steady_clock::now() };
+        auto [found, inserted]{ viewers_.try_emplace(id) };
+        auto& moving{ found->second };
+        if (!inserted)
+        {
+            auto elapsed{ std::chrono::duration<double>(now - moving.updated).count() };
+            if (elapsed <= 0.0)
+            {
+                return;
+            }
+            auto delta_x{ x - moving.x };
+            auto delta_z{ z - moving.z };
+            if (std::hypot(delta_x, delta_z) > teleport_distance)
+            {
+                moving.velocity_x = 0.0;
+                moving.velocity_z = 0.0;
+            }
+            else
+            {
+                // Smoothed so a single stutter in the updates does not swing the prediction around.
+                auto weight{ std::min(elapsed, 0.5) / 0.5 };
+                moving.velocity_x += (delta_x / elapsed - moving.velocity_x) * weight;
+                moving.velocity_z += (delta_z / elapsed - moving.velocity_z) * weight;
+            }
+        }
+        else
+        {
+            moving.velocity_x = 0.0;
+            moving.velocity_z = 0.0;
+            moving.predicted = false;
+        }
+        moving.x = x;
+        moving.z = z;
+        moving.radius = radius;
+        moving.updated = now;
+        prefetch(moving);
+    }
+
+    void chunk_cache::remove_viewer(std::uint64_t id)
+    {
+        viewers_.erase(id);
+    }
+
+    void chunk_cache::tick()
+    {
+        prefetch_allowance_ = max_prefetch_per_tick_;
+        integrate();
+        if (!failed_.empty())
+        {
+            retry_failed();
+        }
+        for (auto key : touched_)
+        {
+            if (auto found{ entries_.find(key) }; found != entries_.end() && found->second.touched)
+            {
+                auto& target{ found->second };
+                target.touched = false;
+                if (target.state == entry_state::loaded)
+                {
+                    auto bytes{ target.loaded->get_memory_usage() };
+                    resident_bytes_ = resident_bytes_ - target.bytes + bytes;
+                    target.bytes = bytes;
+                }
+            }
+        }
+        touched_.clear();
+        if (!saving_.empty())
+        {
+            release_saved();
+        }
+        evict();
+    }
+
+    void chunk_cache::save_all()
+    {
+        for (auto& [key, target] : entries_)
+        {
+            if (target.state != entry_state::loaded || !target.loaded->is_dirty())
+            {
+                continue;
+            }
+            auto snapshot{ std::make_shared<const chunk>(*target.loaded) };
+            for (std::size_t failing{}; !offer_save(snapshot, target.bytes);)
+            {
+                // The saver has no room because of chunks that keep failing, waiting for them would never end.
+                if (failing)
+                {
+                    throw std::runtime_error{ fmt::format("{} chunks keep failing to save", failing) };
+                }
+                failing = saver_.flush();
+            }
+            target.loaded->set_dirty(false);
+        }
+    }
+
+    cache_statistics chunk_cache::get_statistics() const
+    {
+        util::histogram_snapshot latency{};
+        load_latency_.add_to(latency);
+        return {
+            .hits = hits_,
+            .misses = misses_,
+            .loads = loads_,
+            .failed_loads = failed_loads_,
+            .evictions = evictions_,
+            .prefetches = prefetches_,
+            .prefetch_hits = prefetch_hits_,
+            .resident_chunks = entries_.size() - loading_,
+            .resident_bytes = resident_bytes_,
+            .saving_chunks = saving_.size(),
+            .saving_bytes = saving_bytes_,
+            .loading = loading_,
+            .ticketed = ticketed_,
+            .load_p50 = latency.get_percentile(0.5),
+            .load_p99 = latency.get_percentile(0.99),
+            .load_max = latency.get_max()
+        };
+    }
+}
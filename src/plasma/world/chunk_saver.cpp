@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include <plasma/log.hpp>
+#include <plasma/log/binary_log.h>
+#include <plasma/world/chunk_saver.h>
+
+namespace plasma::world
+{
+    chunk_saver::chunk_saver(region_storage& storage, job::job_system& jobs, std::size_t max_in_flight) :
+        storage_{ storage }, jobs_{ jobs }, max_in_flight_{ max_in_flight }, sequence_{}, in_flight_chunks_{},
+        in_flight_bytes_{}, flushing_{}, running_{ true }, stopping_{}, saved_{}, superseded_{}, failed_{}, lost_{}, batches_{},
+        bytes_written_{}
+    {
+        writer_ = std::thread{ &chunk_saver::run, this };
+    }
+
+    chunk_saver::~chunk_saver()
+    {
+        stop();
+    }
+
+    bool chunk_saver::save(std::int32_t x, std::int32_t z, std::size_t estimated_size, serializer snapshot)
+    {
+        std::uint64_t sequence{};
+        {
+            std::lock_guard lock{ mutex_ };
+            if (!running_)
+            {
+                throw std::logic_error{ "Chunk saver is stopped" };
+            }
+            // A single chunk larger than the budget still goes through on its own.
+            if (in_flight_chunks_ && in_flight_bytes_ + estimated_size > max_in_flight_)
+            {
+                return false;
+            }
+            ++in_flight_chunks_;
+            in_flight_bytes_ += estimated_size;
+            ++tracking_[get_key(x, z)].pending;
+            sequence = ++sequence_;
+        }
+
+        auto timestamp{ static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()) };
+        serialize({
+            .x = x,
+            .z = z,
+            .sequence = sequence,
+            .timestamp = timestamp,
+            .reserved = estimated_size,
+            .attempts = 0,
+            .data = {}
+        }, std::move(snapshot));
+        return true;
+    }
+
+    void chunk_saver::serialize(pending_chunk chunk, serializer snapshot)
+    {
+        jobs_.submit([this, chunk = std::move(chunk), snapshot = std::move(snapshot)]() mutable
+        {
+            try
+            {
+                thread_local std::vector<std::byte> nbt{};
+                nbt.clear();
+                snapshot(nbt);
+                compress_chunk(nbt, chunk.data);
+            }
+            catch (const std::exception& e)
+            {
+                logger lg{};
+                ERRF(lg, "Failed to serialize chunk {} {}, will retry: {}", chunk.x, chunk.z, e.what());
+                failed_.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard lock{ mutex_ };
+                retry(std::move(chunk), std::move(snapshot));
+                return;
+            }
+            enqueue(std::move(chunk));
+        });
+    }
+
+    void chunk_saver::enqueue(pending_chunk chunk)
+    {
+        std::lock_guard lock{ mutex_ };
+        queues_[{ chunk.x >> 5, chunk.z >> 5 }].push_back(std::move(chunk));
+        work_condition_.notify_one();
+    }
+
+    void chunk_saver::finish(const pending_chunk& chunk, bool written)
+    {
+        auto tracking{ tracking_.find(get_key(chunk.x, chunk.z)) };
+        if (written)
+        {
+            tracking->second.written = std::max(tracking->second.written, chunk.sequence);
+        }
+        if (!--tracking->second.pending)
+        {
+            tracking_.erase(tracking);
+        }
+        in_flight_bytes_ -= chunk.reserved;
+        if (!--in_flight_chunks_ || flushing_)
+        {
+            idle_condition_.notify_all();
+        }
+    }
+
+    void chunk_saver::retry(pending_chunk chunk, serializer snapshot)
+    {
+        if (++chunk.attempts >= max_attempts_when_stopping && stopping_)
+        {
+            logger lg{};
+            ERRF(lg, "Giving up on saving chunk {} {}, its latest changes are lost", chunk.x, chunk.z);
+            lost_.fetch_add(1, std::memory_order_relaxed);
+            finish(chunk, false);
+            return;
+        }
+        if (chunk.attempts >= max_attempts_when_stopping)
+        {
+            idle_condition_.notify_all();
+        }
+        auto delay{ std::chrono::seconds{ std::min<std::uint32_t>(1u << std::min(chunk.attempts, 5u), 30) } };
+        retries_.push_back({
+            .due = std::chrono::steady_clock::now() + delay,
+            .chunk = std::move(chunk),
+            .snapshot = std::move(snapshot)
+        });
+        work_condition_.notify_one();
+    }
+
+    std::size_t chunk_saver::count_failing() const
+    {
+        return static_cast<std::size_t>(std::ranges::count_if(retries_, [](const retry_entry& entry)
+        {
+            return entry.chunk.attempts >= max_attempts_when_stopping;
+        }));
+    }
+
+    std::vector<chunk_saver::retry_entry> chunk_saver::take_due_retries()
+    {
+        auto now{ std::chrono::steady_clock::now() };
+        std::vector<retry_entry> reserialize{};
+        std::erase_if(retries_, [this, now, &reserialize](retry_entry& entry)
+        {
+            // Stopping retries right away instead of waiting out the backoff, and so does flushing until the chunk
+            // has failed too often.
+            auto urgent{ stopping_ || (flushing_ && entry.chunk.attempts < max_attempts_when_stopping) };
+            if (entry.due > now && !urgent)
+            {
+                return false;
+            }
+            if (entry.snapshot)
+            {
+                reserialize.push_back(std::move(entry));
+            }
+            else
+            {
+                queues_[{ entry.chunk.x >> 5, entry.chunk.z >> 5 }].push_back(std::move(entry.chunk));
+            }
+            return true;
+        });
+        return reserialize;
+    }
+
+    void chunk_saver::write_region(std::pair<std::int32_t, std::int32_t> region,
+        const std::vector<pending_chunk>& chunks)
+    {
+        std::vector<chunk_write> writes{};
+        writes.reserve(chunks.size());
+        std::size_t bytes{};
+        for (const auto& chunk : chunks)
+        {
+            writes.push_back({
+                .x = chunk.x,
+                .z = chunk.z,
+                .data = chunk.data,
+                .compression = chunk_compression::zlib,
+                .timestamp = chunk.timestamp
+            });
+            bytes += chunk.data.size();
+        }
+        storage_.get_region(region.first * 32, region.second * 32, true)->write_batch(writes);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        saved_.fetch_add(chunks.size(), std::memory_order_relaxed);
+        bytes_written_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void chunk_saver::run()
+    {
+        std::unique_lock lock{ mutex_ };
+        while (true)
+        {
+            auto ready{ [this]
+            {
+                return !queues_.empty() || !running_ || (stopping_ && !retries_.empty())
+                    || (flushing_ && count_failing() < retries_.size());
+            } };
+            if (retries_.empty())
+            {
+                work_condition_.wait(lock, ready);
+            }
+            else
+            {
+                auto due{ std::min_element(retries_.begin(), retries_.end(), [](const auto& a, const auto& b)
+                {
+                    return a.due < b.due;
+                })->due };
+                work_condition_.wait_until(lock, due, ready);
+            }
+            auto reserialize{ take_due_retries() };
+            if (!reserialize.empty())
+            {
+                lock.unlock();
+                for (auto& entry : reserialize)
+                {
+                    serialize(std::move(entry.chunk), std::move(entry.snapshot));
+                }
+                lock.lock();
+            }
+            if (queues_.empty())
+            {
+                if (!running_)
+                {
+                    return;
+                }
+                continue;
+            }
+            auto queues{ std::move(queues_) };
+            queues_.clear();
+
+            std::vector<std::pair<std::pair<std::int32_t, std::int32_t>, std::vector<pending_chunk>>> batches{};
+            for (auto& [region, chunks] : queues)
+            {
+                // Only the newest snapshot of a chunk is written, and never one older than what is on disk already.
+                std::unordered_map<std::uint64_t, std::size_t> newest{};
+                for (std::size_t i{}; i < chunks.size(); ++i)
+                {
+                    auto key{ get_key(chunks[i].x, chunks[i].z) };
+                    if (chunks[i].sequence <= tracking_[key].written)
+                    {
+                        superseded_.fetch_add(1, std::memory_order_relaxed);
+                        finish(chunks[i], false);
+                        continue;
+                    }
+                    auto [found, inserted]{ newest.try_emplace(key, i) };
+                    if (!inserted)
+                    {
+                        auto older{ i };
+                        if (chunks[found->second].sequence < chunks[i].sequence)
+                        {
+                            older = std::exchange(found->second, i);
+                        }
+                        superseded_.fetch_add(1, std::memory_order_relaxed);
+                        finish(chunks[older], false);
+                    }
+                }
+                auto& batch{ batches.emplace_back(region, std::vector<pending_chunk>{}).second };
+                batch.reserve(newest.size());
+                for (auto [key, index] : newest)
+                {
+                    batch.push_back(std::move(chunks[index]));
+                }
+            }
+
+            lock.unlock();
+            std::vector<bool> written(batches.size(), true);
+            {
+                std::lock_guard gate{ write_gate_ };
+                for (std::size_t i{}; i < batches.size(); ++i)
+                {
+                    const auto& [region, batch]{ batches[i] };
+                    try
+                    {
+                        write_region(region, batch);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        logger lg{};
+                        ERRF(lg, "Failed to save {} chunks of region {} {}, will retry: {}", batch.size(), region.first,
+                            region.second, e.what());
+                        failed_.fetch_add(batch.size(), std::memory_order_relaxed);
+                        written[i] = false;
+                    }
+                }
+            }
+            lock.lock();
+            for (std::size_t i{}; i < batches.size(); ++i)
+            {
+                for (auto& chunk : batches[i].second)
+                {
+                    if (written[i])
+                    {
+                        finish(chunk, true);
+                    }
+                    else
+                    {
+                        retry(std::move(chunk), {});
+                    }
+                }
+            }
+        }
+    }
+
+    std::size_t chunk_saver::flush()
+    {
+        std::unique_lock lock{ mutex_ };
+        ++flushing_;
+        work_condition_.notify_one();
+        std::size_t failing{};
+        idle_condition_.wait(lock, [this, &failing]
+        {
+            failing = count_failing();
+            return in_flight_chunks_ == failing;
+        });
+        --flushing_;
+        return failing;
+    }
+
+    void chunk_saver::stop()
+    {
+        {
+            std::unique_lock lock{ mutex_ };
+            if (!running_)
+            {
+                return;
+            }
+            stopping_ = true;
+            work_condition_.notify_one();
+            idle_condition_.wait(lock, [this]
+            {
+                return !in_flight_chunks_;
+            });
+            running_ = false;
+            work_condition_.notify_one();
+        }
+        writer_.join();
+    }
+
+    bool chunk_saver::is_saving(std::int32_t x, std::int32_t z)
+    {
+        std::lock_guard lock{ mutex_ };
+        return tracking_.contains(get_key(x, z));
+    }
+
+    save_statistics chunk_saver::get_statistics()
+    {
+        std::lock_guard lock{ mutex_ };
+        return {
+            .backlog_chunks = in_flight_chunks_,
+            .backlog_bytes = in_flight_bytes_,
+            .saved = saved_.load(std::memory_order_relaxed),
+            .superseded = superseded_.load(std::memory_order_relaxed),
+            .failed = failed_.load(std::memory_order_relaxed),
+            .lost = lost_.load(std::memory_order_relaxed),
+            .batches = batches_.load(std::memory_order_relaxed),
+            .bytes_written = bytes_written_.load(std::memory_order_relaxed)
+        };
+    }
+}
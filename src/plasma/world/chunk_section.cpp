@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include <fmt/format.h>
+
+#include <plasma/network/varint.h>
+#include <plasma/world/chunk_section.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        constexpr std::uint64_t swap_big_endian(std::uint64_t word) noexcept
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                return std::byteswap(word);
+            }
+            else
+            {
+                return word;
+            }
+        }
+
+        constexpr std::size_t get_word_count(std::size_t bits) noexcept
+        {
+            auto per_word{ 64 / bits };
+            return (chunk_section::volume + per_word - 1) / per_word;
+        }
+
+        // Entries are read from the given word onwards. Without a palette the raw entries are returned.
+        void unpack_scalar(const std::uint64_t* words, std::size_t bits, const std::uint32_t* palette,
+            std::uint32_t* out, std::size_t word) noexcept
+        {
+            auto per_word{ 64 / bits };
+            auto mask{ (std::uint64_t{ 1 } << bits) - 1 };
+            for (auto index{ word * per_word }; index < chunk_section::volume; ++word)
+            {
+                auto value{ swap_big_endian(words[word]) };
+                auto count{ std::min(per_word, chunk_section::volume - index) };
+                for (std::size_t i{}; i < count; ++i, value >>= bits)
+                {
+                    auto entry{ static_cast<std::uint32_t>(value & mask) };
+                    out[index++] = palette ? palette[entry] : entry;
+                }
+            }
+        }
+
+        void unpack_section_scalar(const std::uint64_t* words, std::size_t bits, const std::uint32_t* palette,
+            std::uint32_t* out) noexcept
+        {
+            unpack_scalar(words, bits, palette, out, 0);
+        }
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define PLASMA_SECTION_AVX2
+        // Broadcasts each long and extracts eight entries per step with variable shifts, then resolves them through
+        // the palette with a gather. Lanes past the end of a long shift by 64 and read entry 0; whatever they store
+        // is overwritten by the next long, and the last longs are left to the scalar loop.
+        __attribute__((target("avx2"))) void unpack_section_avx2(const std::uint64_t* words, std::size_t bits,
+            const std::uint32_t* palette, std::uint32_t* out) noexcept
+        {
+            auto per_word{ 64 / bits };
+            auto groups{ (per_word + 7) / 8 };
+            alignas(32) std::array<std::int64_t, 64> low_shifts{};
+            alignas(32) std::array<std::int64_t, 64> high_shifts{};
+            for (std::size_t group{}; group < groups; ++group)
+            {
+                for (std::size_t lane{}; lane < 4; ++lane)
+                {
+                    auto entry{ group * 8 + lane * 2 };
+                    low_shifts[group * 4 + lane] = entry < per_word ? static_cast<std::int64_t>(entry * bits) : 64;
+                    high_shifts[group * 4 + lane] = entry + 1 < per_word
+                        ? static_cast<std::int64_t>((entry + 1) * bits) : 64;
+                }
+            }
+
+            auto mask{ _mm256_set1_epi64x(static_cast<std::int64_t>((std::uint64_t{ 1 } << bits) - 1)) };
+            std::size_t word{};
+            std::size_t index{};
+            for (; index + groups * 8 <= chunk_section::volume; ++word, index += per_word)
+            {
+                auto value{ _mm256_set1_epi64x(static_cast<std::int64_t>(swap_big_endian(words[word]))) };
+                for (std::size_t group{}; group < groups; ++group)
+                {
+                    auto low_shift{ _mm256_load_si256(reinterpret_cast<const __m256i*>(&low_shifts[group * 4])) };
+                    auto high_shift{ _mm256_load_si256(reinterpret_cast<const __m256i*>(&high_shifts[group * 4])) };
+                    auto low{ _mm256_and_si256(_mm256_srlv_epi64(value, low_shift), mask) };
+                    auto high{ _mm256_and_si256(_mm256_srlv_epi64(value, high_shift), mask) };
+                    auto entries{ _mm256_or_si256(low, _mm256_slli_epi64(high, 32)) };
+                    if (palette)
+                    {
+                        entries = _mm256_i32gather_epi32(reinterpret_cast<const int*>(palette), entries, 4);
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + index + group * 8), entries);
+                }
+            }
+            unpack_scalar(words, bits, palette, out, word);
+        }
+#endif
+
+        class codec
+        {
+        public:
+            const char* name;
+            void (*unpack)(const std::uint64_t*, std::size_t, const std::uint32_t*, std::uint32_t*) noexcept;
+        };
+
+        codec select_codec() noexcept
+        {
+#ifdef PLASMA_SECTION_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return { .name = "avx2", .unpack = &unpack_section_avx2 };
+            }
+#endif
+            return { .name = "scalar", .unpack = &unpack_section_scalar };
+        }
+
+        const codec selected_codec{ select_codec() };
+
+        std::uint16_t count_non_air(const std::uint32_t* states) noexcept
+        {
+            std::uint16_t count{};
+            for (std::size_t i{}; i < chunk_section::volume; ++i)
+            {
+                count += !chunk_section::is_air(states[i]);
+            }
+            return count;
+        }
+
+        void check_state(std::uint32_t state)
+        {
+            if (state >> chunk_section::global_bits)
+            {
+                throw std::out_of_range{ fmt::format("Block state {} is out of range", state) };
+            }
+        }
+
+        constexpr std::uint8_t get_palette_bits(std::size_t size) noexcept
+        {
+            return std::max(chunk_section::min_bits, static_cast<std::uint8_t>(std::bit_width(size - 1)));
+        }
+
+        constexpr std::array<std::uint64_t, get_word_count(chunk_section::min_bits)> empty_words{};
+    }
+
+    chunk_section::chunk_section(std::uint32_t state) :
+        bits_{}, per_word_{}, non_air_{}
+    {
+        fill(state);
+    }
+
+    std::uint32_t chunk_section::get_entry(std::size_t index) const noexcept
+    {
+        auto word{ swap_big_endian(data_[index / per_word_]) };
+        auto shift{ index % per_word_ * bits_ };
+        return static_cast<std::uint32_t>((word >> shift) & ((std::uint64_t{ 1 } << bits_) - 1));
+    }
+
+    void chunk_section::set_entry(std::size_t index, std::uint32_t value) noexcept
+    {
+        auto& word{ data_[index / per_word_] };
+        auto shift{ index % per_word_ * bits_ };
+        auto mask{ ((std::uint64_t{ 1 } << bits_) - 1) << shift };
+        word = swap_big_endian((swap_big_endian(word) & ~mask) | (std::uint64_t{ value } << shift));
+    }
+
+    void chunk_section::encode(const std::uint32_t* values, std::uint8_t bits)
+    {
+        bits_ = bits;
+        per_word_ = static_cast<std::uint8_t>(64 / bits);
+        data_.resize(get_word_count(bits));
+        std::size_t index{};
+        for (auto& word : data_)
+        {
+            std::uint64_t value{};
+            auto count{ std::min<std::size_t>(per_word_, volume - index) };
+            for (std::size_t i{}; i < count; ++i)
+            {
+                value |= std::uint64_t{ values[index++] } << (i * bits);
+            }
+            word = swap_big_endian(value);
+        }
+    }
+
+    void chunk_section::resize(std::uint8_t bits)
+    {
+        std::array<std::uint32_t, volume> values;
+        if (bits_)
+        {
+            selected_codec.unpack(data_.data(), bits_, nullptr, values.data());
+        }
+        else
+        {
+            values.fill(0);
+        }
+        if (bits == global_bits)
+        {
+            for (auto& value : values)
+            {
+                value = palette_[value];
+            }
+            palette_.clear();
+        }
+        encode(values.data(), bits);
+    }
+
+    std::uint32_t chunk_section::get(std::size_t index) const noexcept
+    {
+        if (!bits_)
+        {
+            return palette_[0];
+        }
+        auto entry{ get_entry(index) };
+        return bits_ == global_bits ? entry : palette_[entry];
+    }
+
+    std::uint32_t chunk_section::set(std::size_t index, std::uint32_t state)
+    {
+        check_state(state);
+        auto previous{ get(index) };
+        if (previous == state)
+        {
+            return previous;
+        }
+
+        auto entry{ state };
+        if (bits_ != global_bits)
+        {
+            auto found{ std::find(palette_.begin(), palette_.end(), state) };
+            if (found != palette_.end())
+            {
+                entry = static_cast<std::uint32_t>(found - palette_.begin());
+            }
+            else
+            {
+                if (!bits_)
+                {
+                    resize(min_bits);
+                }
+                else if (palette_.size() == std::size_t{ 1 } << bits_)
+                {
+                    resize(bits_ < max_palette_bits ? bits_ + 1 : global_bits);
+                }
+                if (bits_ != global_bits)
+                {
+                    entry = static_cast<std::uint32_t>(palette_.size());
+                    palette_.push_back(state);
+                }
+            }
+        }
+        set_entry(index, entry);
+        non_air_ += is_air(previous) - is_air(state);
+        return previous;
+    }
+
+    void chunk_section::fill(std::uint32_t state)
+    {
+        check_state(state);
+        bits_ = 0;
+        per_word_ = 0;
+        palette_.assign(1, state);
+        data_.clear();
+        non_air_ = is_air(state) ? 0 : volume;
+    }
+
+    void chunk_section::unpack(std::span<std::uint32_t, volume> states) const noexcept
+    {
+        if (!bits_)
+        {
+            std::fill(states.begin(), states.end(), palette_[0]);
+            return;
+        }
+        selected_codec.unpack(data_.data(), bits_, bits_ == global_bits ? nullptr : palette_.data(), states.data());
+    }
+
+    void chunk_section::pack(std::span<const std::uint32_t, volume> states)
+    {
+        static constexpr auto no_entry{ std::numeric_limits<std::uint16_t>::max() };
+        thread_local std::vector<std::uint16_t> lookup(std::size_t{ 1 } << global_bits, no_entry);
+
+        std::uint32_t combined{};
+        for (auto state : states)
+        {
+            combined |= state;
+        }
+        check_state(combined);
+
+        std::vector<std::uint32_t> palette{};
+        std::array<std::uint32_t, volume> entries;
+        auto global{ false };
+        for (std::size_t i{}; i < volume; ++i)
+        {
+            auto& entry{ lookup[states[i]] };
+            if (entry == no_entry)
+            {
+                if (palette.size() == std::size_t{ 1 } << max_palette_bits)
+                {
+                    global = true;
+                    break;
+                }
+                entry = static_cast<std::uint16_t>(palette.size());
+                palette.push_back(states[i]);
+            }
+            entries[i] = entry;
+        }
+        for (auto state : palette)
+        {
+            lookup[state] = no_entry;
+        }
+
+        if (palette.size() == 1 && !global)
+        {
+            fill(palette[0]);
+            return;
+        }
+        if (global)
+        {
+            palette_.clear();
+            encode(states.data(), global_bits);
+        }
+        else
+        {
+            palette_ = std::move(palette);
+            encode(entries.data(), get_palette_bits(palette_.size()));
+        }
+        non_air_ = count_non_air(states.data());
+    }
+
+    void chunk_section::compact()
+    {
+        if (!bits_)
+        {
+            return;
+        }
+        std::array<std::uint32_t, volume> states;
+        unpack(states);
+        pack(states);
+    }
+
+    void chunk_section::load(std::span<const std::uint32_t> palette, std::span<const std::byte> data)
+    {
+        if (palette.empty() || palette.size() > std::size_t{ 1 } << global_bits)
+        {
+            throw std::runtime_error{ fmt::format("Invalid section palette size {}", palette.size()) };
+        }
+        for (auto state : palette)
+        {
+            check_state(state);
+        }
+        if (palette.size() == 1)
+        {
+            fill(palette[0]);
+            return;
+        }
+
+        auto bits{ get_palette_bits(palette.size()) };
+        auto words{ get_word_count(bits) };
+        if (data.size() != words * sizeof(std::uint64_t))
+        {
+            throw std::runtime_error{ fmt::format("Section data is {} bytes, expected {} for {} bits per entry",
+                data.size(), words * sizeof(std::uint64_t), bits) };
+        }
+
+        std::vector<std::uint64_t> loaded(words);
+        std::memcpy(loaded.data(), data.data(), data.size());
+        std::array<std::uint32_t, volume> entries;
+        selected_codec.unpack(loaded.data(), bits, nullptr, entries.data());
+        if (*std::max_element(entries.begin(), entries.end()) >= palette.size())
+        {
+            throw std::runtime_error{ "Section data refers past the end of its palette" };
+        }
+
+        if (bits > max_palette_bits)
+        {
+            for (auto& entry : entries)
+            {
+                entry = palette[entry];
+            }
+            pack(entries);
+            return;
+        }
+        bits_ = bits;
+        per_word_ = static_cast<std::uint8_t>(64 / bits);
+        palette_.assign(palette.begin(), palette.end());
+        data_ = std::move(loaded);
+        std::uint16_t non_air{};
+        for (auto entry : entries)
+        {
+            non_air += !is_air(palette_[entry]);
+        }
+        non_air_ = non_air;
+    }
+
+    std::size_t chunk_section::get_network_size() const noexcept
+    {
+        auto bits{ bits_ ? bits_ : min_bits };
+        auto words{ bits_ ? data_.size() : empty_words.size() };
+        std::size_t size{ 3 + network::varint_size(static_cast<std::uint32_t>(words)) + words * 8 };
+        if (bits != global_bits)
+        {
+            size += network::varint_size(static_cast<std::uint32_t>(palette_.size()));
+            for (auto state : palette_)
+            {
+                size += network::varint_size(state);
+            }
+        }
+        return size;
+    }
+
+    void chunk_section::write(std::vector<std::byte>& out) const
+    {
+        auto bits{ bits_ ? bits_ : min_bits };
+        auto words{ bits_ ? std::span<const std::uint64_t>{ data_ } : std::span<const std::uint64_t>{ empty_words } };
+        auto offset{ out.size() };
+        out.resize(offset + get_network_size());
+        auto bytes{ out.data() + offset };
+        bytes[0] = static_cast<std::byte>(non_air_ >> 8);
+        bytes[1] = static_cast<std::byte>(non_air_);
+        bytes[2] = static_cast<std::byte>(bits);
+        bytes += 3;
+        if (bits != global_bits)
+        {
+            bytes += network::write_varint(bytes, static_cast<std::uint32_t>(palette_.size()));
+            for (auto state : palette_)
+            {
+                bytes += network::write_varint(bytes, state);
+            }
+        }
+        bytes += network::write_varint(bytes, static_cast<std::uint32_t>(words.size()));
+        std::memcpy(bytes, words.data(), words.size_bytes());
+    }
+
+    const char* get_section_codec_name() noexcept
+    {
+        return selected_codec.name;
+    }
+}
@@ -0,0 +1,681 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <initializer_list>
+#include <utility>
+
+#include <plasma/world/light_engine.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        constexpr auto state_count{ std::size_t{ 1 } << chunk_section::global_bits };
+
+        // Missing light is darkness.
+        bool is_same_light(const nibble_array* first, const nibble_array* second) noexcept
+        {
+            if (first == second)
+            {
+                return true;
+            }
+            if (!first || !second)
+            {
+                return (first ? first : second)->is_uniform(0);
+            }
+            return std::ranges::equal(first->get_bytes(), second->get_bytes());
+        }
+
+        class light_properties
+        {
+        public:
+            std::array<std::uint8_t, state_count> opacity;
+            std::array<std::uint8_t, state_count> emission;
+        };
+
+        // Without a block registry only the states the generator uses are told apart: air lets light through, water
+        // and lava dim it by one and lava glows, and every other state is treated as a full block.
+        light_properties make_properties() noexcept
+        {
+            light_properties properties{};
+            properties.opacity.fill(15);
+            for (auto state : { chunk_section::air, chunk_section::void_air, chunk_section::cave_air })
+            {
+                properties.opacity[state] = 0;
+            }
+            for (std::uint32_t state{ 34 }; state < 66; ++state)
+            {
+                properties.opacity[state] = 1;
+            }
+            for (std::uint32_t state{ 50 }; state < 66; ++state)
+            {
+                properties.emission[state] = 15;
+            }
+            return properties;
+        }
+
+        const light_properties properties{ make_properties() };
+
+        enum light_kind : std::size_t
+        {
+            block_light,
+            sky_light
+        };
+
+        constexpr std::int32_t area_width{ 48 };
+        constexpr std::int32_t area_height{ 256 };
+        constexpr std::size_t area_sections{ 9 * chunk::section_count };
+        constexpr std::size_t down{ 3 };
+        constexpr std::array<std::int32_t, 6> step_x{ 1, -1, 0, 0, 0, 0 };
+        constexpr std::array<std::int32_t, 6> step_y{ 0, 0, 1, -1, 0, 0 };
+        constexpr std::array<std::int32_t, 6> step_z{ 0, 0, 0, 0, 1, -1 };
+
+        class light_update
+        {
+        public:
+            std::shared_ptr<chunk> target;
+            std::size_t section;
+            light_kind kind;
+            std::shared_ptr<const nibble_array> light;
+        };
+
+        // The light of a 3x3 chunk neighbourhood. Sections are copied the first time they are written; everything
+        // else is read from the chunks in place. Positions are relative to the corner of the neighbourhood.
+        // Neighbours that have not been lit yet are left out, they take in the light at their border once they are.
+        class light_area
+        {
+        private:
+            std::array<std::shared_ptr<chunk>, 9> chunks_;
+            std::array<const chunk_section*, area_sections> sections_;
+            std::array<std::array<const nibble_array*, area_sections>, 2> current_;
+            std::array<std::array<std::shared_ptr<const nibble_array>, area_sections>, 2> results_;
+            std::array<std::array<nibble_array*, area_sections>, 2> owned_;
+            std::array<std::array<bool, area_sections>, 2> changed_;
+            std::vector<std::uint32_t> increase_;
+            std::vector<std::uint32_t> decrease_;
+            std::vector<std::uint32_t> block_sources_;
+
+            static constexpr std::uint32_t pack(std::int32_t x, std::int32_t y, std::int32_t z,
+                std::uint32_t level) noexcept
+            {
+                return static_cast<std::uint32_t>(x) | static_cast<std::uint32_t>(z) << 6
+                    | static_cast<std::uint32_t>(y) << 12 | level << 20;
+            }
+
+            static constexpr std::size_t get_section(std::int32_t x, std::int32_t y, std::int32_t z) noexcept
+            {
+                return static_cast<std::size_t>(((z >> 4) * 3 + (x >> 4)) * 16 + (y >> 4));
+            }
+
+            static constexpr std::size_t get_index(std::int32_t x, std::int32_t y, std::int32_t z) noexcept
+            {
+                return chunk_section::get_index(static_cast<std::uint32_t>(x & 15), static_cast<std::uint32_t>(y & 15),
+                    static_cast<std::uint32_t>(z & 15));
+            }
+
+            static constexpr bool is_edge(std::int32_t x, std::int32_t z) noexcept
+            {
+                return !x || !z || x == area_width - 1 || z == area_width - 1;
+            }
+
+            [[nodiscard]] bool is_available(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+            {
+                return x >= 0 && z >= 0 && y >= 0 && x < area_width && z < area_width && y < area_height
+                    && sections_[get_section(x, y, z)];
+            }
+
+            [[nodiscard]] std::uint32_t get_state(std::int32_t x, std::int32_t y, std::int32_t z) const noexcept
+            {
+                return sections_[get_section(x, y, z)]->get(get_index(x, y, z));
+            }
+
+            [[nodiscard]] std::uint8_t get(light_kind kind, std::int32_t x, std::int32_t y,
+                std::int32_t z) const noexcept
+            {
+                auto light{ current_[kind][get_section(x, y, z)] };
+                return light ? light->get(get_index(x, y, z)) : 0;
+            }
+
+            void set(light_kind kind, std::int32_t x, std::int32_t y, std::int32_t z, std::uint8_t level)
+            {
+                auto section{ get_section(x, y, z) };
+                auto& owned{ owned_[kind][section] };
+                if (!owned)
+                {
+                    auto copy{ current_[kind][section] ? std::make_shared<nibble_array>(*current_[kind][section])
+                        : std::make_shared<nibble_array>() };
+                    owned = copy.get();
+                    current_[kind][section] = copy.get();
+                    results_[kind][section] = std::move(copy);
+                    changed_[kind][section] = true;
+                }
+                owned->set(get_index(x, y, z), level);
+            }
+
+            void replace(light_kind kind, std::size_t section, std::shared_ptr<const nibble_array> light)
+            {
+                owned_[kind][section] = nullptr;
+                current_[kind][section] = light.get();
+                results_[kind][section] = std::move(light);
+                changed_[kind][section] = true;
+            }
+
+            // Sky light comes down undimmed through clear blocks; everything else loses at least a level per block.
+            void increase(light_kind kind)
+            {
+                for (std::size_t head{}; head < increase_.size(); ++head)
+                {
+                    auto entry{ increase_[head] };
+                    auto x{ static_cast<std::int32_t>(entry & 63) };
+                    auto z{ static_cast<std::int32_t>((entry >> 6) & 63) };
+                    auto y{ static_cast<std::int32_t>((entry >> 12) & 255) };
+                    auto level{ static_cast<std::int32_t>(entry >> 20) };
+                    if (get(kind, x, y, z) != level)
+                    {
+                        continue;
+                    }
+                    for (std::size_t direction{}; direction < 6; ++direction)
+                    {
+                        auto nx{ x + step_x[direction] };
+                        auto ny{ y + step_y[direction] };
+                        auto nz{ z + step_z[direction] };
+                        if (!is_available(nx, ny, nz))
+                        {
+                            continue;
+                        }
+                        auto falling{ kind == sky_light && direction == down && level == 15 };
+                        auto current{ static_cast<std::int32_t>(get(kind, nx, ny, nz)) };
+                        if (current >= (falling ? 15 : level - 1))
+                        {
+                            continue;
+                        }
+                        auto opacity{ static_cast<std::int32_t>(properties.opacity[get_state(nx, ny, nz)]) };
+                        auto next{ falling && !opacity ? 15 : level - std::max(1, opacity) };
+                        if (next > current)
+                        {
+                            set(kind, nx, ny, nz, static_cast<std::uint8_t>(next));
+                            increase_.push_back(pack(nx, ny, nz, static_cast<std::uint32_t>(next)));
+                        }
+                    }
+                }
+                increase_.clear();
+            }
+
+            // Removes the light that came from the queued positions and queues whatever light borders the darkened
+            // region for increase() to flood back in. Edge cells and the top layer of sky may be lit from outside the
+            // neighbourhood, so they are only ever sources.
+            void decrease(light_kind kind)
+            {
+                for (std::size_t head{}; head < decrease_.size(); ++head)
+                {
+                    auto entry{ decrease_[head] };
+                    auto x{ static_cast<std::int32_t>(entry & 63) };
+                    auto z{ static_cast<std::int32_t>((entry >> 6) & 63) };
+                    auto y{ static_cast<std::int32_t>((entry >> 12) & 255) };
+                    auto level{ static_cast<std::int32_t>(entry >> 20) };
+                    for (std::size_t direction{}; direction < 6; ++direction)
+                    {
+                        auto nx{ x + step_x[direction] };
+                        auto ny{ y + step_y[direction] };
+                        auto nz{ z + step_z[direction] };
+                        if (!is_available(nx, ny, nz))
+                        {
+                            continue;
+                        }
+                        auto current{ static_cast<std::int32_t>(get(kind, nx, ny, nz)) };
+                        if (!current)
+                        {
+                            continue;
+                        }
+                        auto fed{ current < level || (kind == sky_light && direction == down && level == 15) };
+                        if (!fed || is_edge(nx, nz) || (kind == sky_light && ny == area_height - 1))
+                        {
+                            increase_.push_back(pack(nx, ny, nz, static_cast<std::uint32_t>(current)));
+                            continue;
+                        }
+                        std::uint8_t emitted{ kind == block_light ? properties.emission[get_state(nx, ny, nz)]
+                            : std::uint8_t{} };
+                        set(kind, nx, ny, nz, emitted);
+                        decrease_.push_back(pack(nx, ny, nz, static_cast<std::uint32_t>(current)));
+                        if (emitted)
+                        {
+                            increase_.push_back(pack(nx, ny, nz, emitted));
+                        }
+                    }
+                }
+                decrease_.clear();
+            }
+
+            // The light a block in the top layer gets straight from the sky.
+            [[nodiscard]] std::uint8_t get_top_light(std::int32_t x, std::int32_t z) const noexcept
+            {
+                auto opacity{ static_cast<std::int32_t>(properties.opacity[get_state(x, area_height - 1, z)]) };
+                return static_cast<std::uint8_t>(opacity ? std::max(0, 15 - std::max(1, opacity)) : 15);
+            }
+
+            // The highest block that dims light in a column, or -1.
+            [[nodiscard]] std::int32_t get_height(std::int32_t x, std::int32_t z) const noexcept
+            {
+                if (!is_available(x, 0, z))
+                {
+                    return -1;
+                }
+                for (auto section_y{ static_cast<std::int32_t>(chunk::section_count) - 1 }; section_y >= 0; --section_y)
+                {
+                    if (sections_[get_section(x, section_y * 16, z)]->empty())
+                    {
+                        continue;
+                    }
+                    for (auto y{ section_y * 16 + 15 }; y >= section_y * 16; --y)
+                    {
+                        if (properties.opacity[get_state(x, y, z)])
+                        {
+                            return y;
+                        }
+                    }
+                }
+                return -1;
+            }
+
+            // Queues the light of the neighbours' cells next to the centre wherever it could brighten the centre.
+            void queue_border()
+            {
+                for (std::int32_t i{ 16 }; i < 32; ++i)
+                {
+                    for (std::int32_t y{}; y < area_height; ++y)
+                    {
+                        for (auto [x, z, inner_x, inner_z] : { std::array{ 15, i, 16, i }, std::array{ 32, i, 31, i },
+                            std::array{ i, 15, i, 16 }, std::array{ i, 32, i, 31 } })
+                        {
+                            if (!is_available(x, y, z))
+                            {
+                                continue;
+                            }
+                            for (auto kind : { block_light, sky_light })
+                            {
+                                auto level{ get(kind, x, y, z) };
+                                if (level > 1 && get(kind, inner_x, y, inner_z) < level - 1)
+                                {
+                                    (kind == block_light ? block_sources_ : increase_).push_back(pack(x, y, z, level));
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        public:
+            void reset(const std::array<std::shared_ptr<chunk>, 9>& chunks)
+            {
+                chunks_ = chunks;
+                for (std::size_t i{}; i < area_sections; ++i)
+                {
+                    auto& source{ chunks_[i / chunk::section_count] };
+                    if (source && i / chunk::section_count != 4 && !source->is_lit())
+                    {
+                        source = nullptr;
+                    }
+                    auto section{ i % chunk::section_count };
+                    // The const overload, since taking a mutable section would mark the chunk dirty.
+                    sections_[i] = source ? &std::as_const(*source).get_section(section) : nullptr;
+                    current_[block_light][i] = source ? source->get_block_light(section).get() : nullptr;
+                    current_[sky_light][i] = source ? source->get_sky_light(section).get() : nullptr;
+                }
+                for (auto kind : { block_light, sky_light })
+                {
+                    results_[kind].fill(nullptr);
+                    owned_[kind].fill(nullptr);
+                    changed_[kind].fill(false);
+                }
+            }
+
+            void update(std::span<const std::uint16_t> changes)
+            {
+                for (auto kind : { block_light, sky_light })
+                {
+                    for (auto change : changes)
+                    {
+                        auto x{ 16 + (change & 15) };
+                        auto z{ 16 + ((change >> 4) & 15) };
+                        auto y{ change >> 8 };
+                        if (auto old{ get(kind, x, y, z) })
+                        {
+                            set(kind, x, y, z, 0);
+                            decrease_.push_back(pack(x, y, z, old));
+                        }
+                    }
+                    decrease(kind);
+                    for (auto change : changes)
+                    {
+                        auto x{ 16 + (change & 15) };
+                        auto z{ 16 + ((change >> 4) & 15) };
+                        auto y{ change >> 8 };
+                        std::uint8_t source{};
+                        if (kind == block_light)
+                        {
+                            source = properties.emission[get_state(x, y, z)];
+                        }
+                        else if (y == area_height - 1)
+                        {
+                            source = get_top_light(x, z);
+                        }
+                        if (source > get(kind, x, y, z))
+                        {
+                            set(kind, x, y, z, source);
+                            increase_.push_back(pack(x, y, z, source));
+                        }
+                        for (std::size_t direction{}; direction < 6; ++direction)
+                        {
+                            auto nx{ x + step_x[direction] };
+                            auto ny{ y + step_y[direction] };
+                            auto nz{ z + step_z[direction] };
+                            if (!is_available(nx, ny, nz))
+                            {
+                                continue;
+                            }
+                            if (auto level{ get(kind, nx, ny, nz) })
+                            {
+                                increase_.push_back(pack(nx, ny, nz, level));
+                            }
+                        }
+                    }
+                    increase(kind);
+                }
+            }
+
+            // Starts the centre chunk from darkness and lights it from the sky, its own emitters and whatever light
+            // the neighbouring chunks have at its border.
+            void relight()
+            {
+                constexpr std::size_t first{ 4 * chunk::section_count };
+                for (std::size_t i{}; i < chunk::section_count; ++i)
+                {
+                    replace(block_light, first + i, nullptr);
+                    replace(sky_light, first + i, nullptr);
+                }
+
+                std::array<std::int32_t, 18 * 18> heights{};
+                for (std::int32_t z{}; z < 18; ++z)
+                {
+                    for (std::int32_t x{}; x < 18; ++x)
+                    {
+                        heights[static_cast<std::size_t>(z * 18 + x)] = get_height(15 + x, 15 + z);
+                    }
+                }
+                auto height_at{ [&heights](std::int32_t x, std::int32_t z)
+                {
+                    return heights[static_cast<std::size_t>((z - 15) * 18 + x - 15)];
+                } };
+                std::int32_t highest{ -1 };
+                for (std::int32_t z{ 16 }; z < 32; ++z)
+                {
+                    for (std::int32_t x{ 16 }; x < 32; ++x)
+                    {
+                        highest = std::max(highest, height_at(x, z));
+                    }
+                }
+                // Sections above every column are open sky.
+                auto open_from{ (highest + 16) / 16 };
+                for (auto i{ static_cast<std::size_t>(open_from) }; i < chunk::section_count; ++i)
+                {
+                    replace(sky_light, first + i, nibble_array::get_full());
+                }
+                for (std::int32_t z{ 16 }; z < 32; ++z)
+                {
+                    for (std::int32_t x{ 16 }; x < 32; ++x)
+                    {
+                        auto height{ height_at(x, z) };
+                        if (height == area_height - 1)
+                        {
+                            if (auto top{ get_top_light(x, z) })
+                            {
+                                set(sky_light, x, height, z, top);
+                                increase_.push_back(pack(x, height, z, top));
+                            }
+                            continue;
+                        }
+                        for (auto y{ height + 1 }; y < open_from * 16; ++y)
+                        {
+                            set(sky_light, x, y, z, 15);
+                        }
+                        // Only where a neighbouring column is taller can the light spread sideways.
+                        auto spread{ std::max({ height + 1, height_at(x - 1, z), height_at(x + 1, z),
+                            height_at(x, z - 1), height_at(x, z + 1) }) };
+                        for (auto y{ height + 1 }; y <= std::min(spread, area_height - 1); ++y)
+                        {
+                            increase_.push_back(pack(x, y, z, 15));
+                        }
+                    }
+                }
+
+                for (std::size_t i{}; i < chunk::section_count; ++i)
+                {
+                    const auto& section{ *sections_[first + i] };
+                    auto palette{ section.get_palette() };
+                    if (section.empty() || (section.get_bits() != chunk_section::global_bits
+                        && std::none_of(palette.begin(), palette.end(), [](std::uint32_t state)
+                        {
+                            return properties.emission[state] != 0;
+                        })))
+                    {
+                        continue;
+                    }
+                    for (std::int32_t index{}; index < static_cast<std::int32_t>(chunk_section::volume); ++index)
+                    {
+                        auto x{ 16 + (index & 15) };
+                        auto z{ 16 + ((index >> 4) & 15) };
+                        auto y{ static_cast<std::int32_t>(i) * 16 + (index >> 8) };
+                        if (auto emitted{ properties.emission[get_state(x, y, z)] })
+                        {
+                            set(block_light, x, y, z, emitted);
+                            block_sources_.push_back(pack(x, y, z, emitted));
+                        }
+                    }
+                }
+                queue_border();
+                increase(sky_light);
+                std::swap(increase_, block_sources_);
+                increase(block_light);
+            }
+
+            // Hands over the sections whose light ended up different and lets go of the chunks. Publishing a section
+            // dirties its chunk, so one that went dark and came back as it was is left alone.
+            void collect(std::vector<light_update>& updates)
+            {
+                for (auto kind : { block_light, sky_light })
+                {
+                    for (std::size_t i{}; i < area_sections; ++i)
+                    {
+                        if (!changed_[kind][i])
+                        {
+                            continue;
+                        }
+                        const auto& target{ chunks_[i / chunk::section_count] };
+                        auto section{ i % chunk::section_count };
+                        const auto& previous{ kind == block_light ? target->get_block_light(section)
+                            : target->get_sky_light(section) };
+                        if (!is_same_light(results_[kind][i].get(), previous.get()))
+                        {
+                            updates.push_back({ .target = target, .section = section, .kind = kind,
+                                .light = std::move(results_[kind][i]) });
+                        }
+                    }
+                    results_[kind].fill(nullptr);
+                }
+                chunks_.fill(nullptr);
+            }
+        };
+    }
+
+    light_engine::light_engine(job::job_system& jobs, chunk_lookup lookup) :
+        jobs_{ jobs }, lookup_{ std::move(lookup) }, processed_chunks_{}, changes_{}, relights_{}, batches_{},
+        sections_published_{}, last_batch_nanoseconds_{}
+    {
+    }
+
+    void light_engine::queue_change(std::int32_t x, std::int32_t y, std::int32_t z)
+    {
+        if (y < 0 || y > 255)
+        {
+            return;
+        }
+        auto& target{ pending_[get_key(x >> 4, z >> 4)] };
+        target.x = x >> 4;
+        target.z = z >> 4;
+        if (!target.relight)
+        {
+            target.changes.push_back(static_cast<std::uint16_t>(y << 8 | (z & 15) << 4 | (x & 15)));
+        }
+    }
+
+    void light_engine::queue_relight(std::int32_t chunk_x, std::int32_t chunk_z)
+    {
+        auto& target{ pending_[get_key(chunk_x, chunk_z)] };
+        target.x = chunk_x;
+        target.z = chunk_z;
+        target.relight = true;
+        target.changes.clear();
+        target.changes.shrink_to_fit();
+    }
+
+    std::size_t light_engine::process(std::size_t max_chunks, bool parallel)
+    {
+        if (pending_.empty())
+        {
+            return 0;
+        }
+        auto started{ std::chrono::steady_clock::now() };
+        std::array<std::vector<pending_chunk>, 9> groups{};
+        for (auto it{ pending_.begin() }; it != pending_.end() && max_chunks; --max_chunks)
+        {
+            auto& work{ it->second };
+            auto group{ (work.x % 3 + 3) % 3 * 3 + (work.z % 3 + 3) % 3 };
+            groups[static_cast<std::size_t>(group)].push_back(std::move(work));
+            it = pending_.erase(it);
+        }
+
+        std::size_t processed{};
+        std::vector<std::array<std::shared_ptr<chunk>, 9>> neighbourhoods{};
+        std::vector<std::vector<light_update>> updates{};
+        for (auto& group : groups)
+        {
+            // Chunks are looked up here, on the tick thread, and not changed by anything else until published.
+            neighbourhoods.clear();
+            for (const auto& work : group)
+            {
+                auto& neighbourhood{ neighbourhoods.emplace_back() };
+                for (std::int32_t i{}; i < 9; ++i)
+                {
+                    neighbourhood[static_cast<std::size_t>(i)] = lookup_(work.x + i % 3 - 1, work.z + i / 3 - 1);
+                }
+            }
+            updates.resize(group.size());
+            auto light{ [&group, &neighbourhoods, &updates](std::size_t i)
+            {
+                updates[i].clear();
+                if (!neighbourhoods[i][4])
+                {
+                    return;
+                }
+                thread_local light_area area{};
+                area.reset(neighbourhoods[i]);
+                if (group[i].relight)
+                {
+                    area.relight();
+                }
+                else
+                {
+                    area.update(group[i].changes);
+                }
+                area.collect(updates[i]);
+            } };
+            if (parallel)
+            {
+                jobs_.parallel_for(0, group.size(), 1, light);
+            }
+            else
+            {
+                for (std::size_t i{}; i < group.size(); ++i)
+                {
+                    light(i);
+                }
+            }
+
+            for (std::size_t i{}; i < group.size(); ++i)
+            {
+                if (!neighbourhoods[i][4])
+                {
+                    continue;
+                }
+                for (auto& update : updates[i])
+                {
+                    if (update.kind == block_light)
+                    {
+                        update.target->set_block_light(update.section, std::move(update.light));
+                    }
+                    else
+                    {
+                        update.target->set_sky_light(update.section, std::move(update.light));
+                    }
+                    ++sections_published_;
+                }
+                if (group[i].relight)
+                {
+                    neighbourhoods[i][4]->set_lit(true);
+                    ++relights_;
+                }
+                changes_ += group[i].changes.size();
+                ++processed;
+            }
+        }
+        processed_chunks_ += processed;
+        ++batches_;
+        last_batch_nanoseconds_ = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count());
+        return processed;
+    }
+
+    light_statistics light_engine::get_statistics() const noexcept
+    {
+        return {
+            .pending_chunks = pending_.size(),
+            .processed_chunks = processed_chunks_,
+            .changes = changes_,
+            .relights = relights_,
+            .batches = batches_,
+            .sections_published = sections_published_,
+            .last_batch_nanoseconds = last_batch_nanoseconds_
+        };
+    }
+
+    std::uint8_t light_engine::get_opacity(std::uint32_t state) noexcept
+    {
+        return properties.opacity[state];
+    }
+
+    std::uint8_t light_engine::get_emission(std::uint32_t state) noexcept
+    {
+        return properties.emission[state];
+    }
+}
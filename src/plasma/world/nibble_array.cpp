@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <plasma/world/nibble_array.h>
+
+namespace plasma::world
+{
+    nibble_array::nibble_array(std::uint8_t value) noexcept
+    {
+        data_.fill(static_cast<std::uint8_t>(value * 0x11));
+    }
+
+    nibble_array::nibble_array(std::span<const std::byte, size> bytes) noexcept
+    {
+        std::memcpy(data_.data(), bytes.data(), size);
+    }
+
+    bool nibble_array::is_uniform(std::uint8_t value) const noexcept
+    {
+        auto packed{ static_cast<std::uint8_t>(value * 0x11) };
+        return std::all_of(data_.begin(), data_.end(), [packed](std::uint8_t byte)
+        {
+            return byte == packed;
+        });
+    }
+
+    const std::shared_ptr<const nibble_array>& nibble_array::get_full() noexcept
+    {
+        static const std::shared_ptr<const nibble_array> full{ std::make_shared<const nibble_array>(15) };
+        return full;
+    }
+}
@@ -0,0 +1,603 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <plasma/world/region_file.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        constexpr std::size_t header_size{ region_file::sector_size * 2 };
+        constexpr std::size_t chunk_header_size{ 5 };
+        constexpr std::uint8_t external_flag{ 0x80 };
+
+        std::uint32_t read_big_endian(const std::byte* data) noexcept
+        {
+            return static_cast<std::uint32_t>(data[0]) << 24 | static_cast<std::uint32_t>(data[1]) << 16
+                | static_cast<std::uint32_t>(data[2]) << 8 | static_cast<std::uint32_t>(data[3]);
+        }
+
+        void write_big_endian(std::byte* data, std::uint32_t value) noexcept
+        {
+            data[0] = static_cast<std::byte>(value >> 24);
+            data[1] = static_cast<std::byte>(value >> 16);
+            data[2] = static_cast<std::byte>(value >> 8);
+            data[3] = static_cast<std::byte>(value);
+        }
+
+        // Region files grow to 64 GiB, past what the long offset of std::fseek holds on Windows.
+        void seek_file(std::FILE* file, std::uint64_t offset, const std::filesystem::path& path)
+        {
+#ifdef _WIN32
+            auto result{ _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) };
+#else
+            static_assert(sizeof(off_t) >= sizeof(std::uint64_t), "Region files need 64-bit file offsets");
+            auto result{ fseeko(file, static_cast<off_t>(offset), SEEK_SET) };
+#endif
+            if (result)
+            {
+                throw std::runtime_error{ fmt::format("Failed to seek in {}", path.string()) };
+            }
+        }
+
+        void sync_file(std::FILE* file, const std::filesystem::path& path)
+        {
+            if (std::fflush(file))
+            {
+                throw std::runtime_error{ fmt::format("Failed to write {}", path.string()) };
+            }
+#if defined(_WIN32)
+            auto result{ _commit(_fileno(file)) };
+#elif defined(__APPLE__)
+            auto result{ fsync(fileno(file)) };
+#else
+            auto result{ fdatasync(fileno(file)) };
+#endif
+            if (result)
+            {
+                throw std::runtime_error{ fmt::format("Failed to sync {}", path.string()) };
+            }
+        }
+
+        // Makes a rename in the directory durable.
+        void sync_directory([[maybe_unused]] const std::filesystem::path& directory)
+        {
+#ifndef _WIN32
+            auto descriptor{ ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC) };
+            if (descriptor < 0)
+            {
+                throw std::runtime_error{ fmt::format("Failed to open {}", directory.string()) };
+            }
+            auto result{ ::fsync(descriptor) };
+            ::close(descriptor);
+            if (result)
+            {
+                throw std::runtime_error{ fmt::format("Failed to sync {}", directory.string()) };
+            }
+#endif
+        }
+
+        class inflater
+        {
+        public:
+            z_stream stream;
+
+            inflater() :
+                stream{}
+            {
+                // Adding 32 to the window bits makes zlib detect gzip and zlib headers by itself.
+                if (inflateInit2(&stream, 15 + 32) != Z_OK)
+                {
+                    throw std::runtime_error{ "Failed to initialize inflate" };
+                }
+            }
+
+            ~inflater()
+            {
+                inflateEnd(&stream);
+            }
+        };
+
+        class deflater
+        {
+        public:
+            z_stream stream;
+
+            deflater() :
+                stream{}
+            {
+                if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+                {
+                    throw std::runtime_error{ "Failed to initialize deflate" };
+                }
+            }
+
+            ~deflater()
+            {
+                deflateEnd(&stream);
+            }
+        };
+    }
+
+    region_mapping::region_mapping(const std::filesystem::path& path) :
+        region_{ std::make_shared<const boost::interprocess::mapped_region>(
+            boost::interprocess::file_mapping{ path.string().c_str(), boost::interprocess::read_only },
+            boost::interprocess::read_only) }
+    {
+    }
+
+    region_mapping::region_mapping(std::shared_ptr<const boost::interprocess::mapped_region> region) noexcept :
+        region_{ std::move(region) }
+    {
+    }
+
+    void decompress_chunk(std::span<const std::byte> data, chunk_compression compression, std::vector<std::byte>& out)
+    {
+        out.clear();
+        if (compression == chunk_compression::none)
+        {
+            out.assign(data.begin(), data.end());
+            return;
+        }
+        if (compression != chunk_compression::gzip && compression != chunk_compression::zlib)
+        {
+            throw std::runtime_error{ fmt::format("Unknown chunk compression {}", static_cast<int>(compression)) };
+        }
+        thread_local inflater local{};
+        auto& stream{ local.stream };
+        inflateReset(&stream);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        out.resize(std::max<std::size_t>(data.size() * 4, 4096));
+        while (true)
+        {
+            stream.next_out = reinterpret_cast<Bytef*>(out.data() + stream.total_out);
+            stream.avail_out = static_cast<uInt>(out.size() - stream.total_out);
+            auto result{ inflate(&stream, Z_NO_FLUSH) };
+            if (result == Z_STREAM_END)
+            {
+                break;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                throw std::runtime_error{ "Corrupt chunk data" };
+            }
+            if (stream.avail_out)
+            {
+                throw std::runtime_error{ "Truncated chunk data" };
+            }
+            out.resize(out.size() * 2);
+        }
+        out.resize(stream.total_out);
+    }
+
+    void compress_chunk(std::span<const std::byte> nbt, std::vector<std::byte>& out)
+    {
+        thread_local deflater local{};
+        auto& stream{ local.stream };
+        deflateReset(&stream);
+        out.resize(deflateBound(&stream, static_cast<uLong>(nbt.size())));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<std::byte*>(nbt.data()));
+        stream.avail_in = static_cast<uInt>(nbt.size());
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+        if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+        {
+            throw std::runtime_error{ "Failed to deflate chunk" };
+        }
+        out.resize(stream.total_out);
+    }
+
+    region_file::region_file(std::filesystem::path path, bool writable) :
+        path_{ std::move(path) }, locations_{}, timestamps_{}, file_{}, used_sectors_(2, true)
+    {
+        auto exists{ std::filesystem::exists(path_) };
+        if (writable)
+        {
+            if (!exists)
+            {
+                create_directories(path_.parent_path());
+            }
+            file_ = std::fopen(path_.string().c_str(), exists ? "r+b" : "w+b");
+            if (!file_)
+            {
+                throw std::runtime_error{ fmt::format("Failed to open region file {}", path_.string()) };
+            }
+        }
+        else if (!exists)
+        {
+            return;
+        }
+        if (std::filesystem::file_size(path_) < header_size)
+        {
+            if (!file_)
+            {
+                throw std::runtime_error{ fmt::format("Region file {} is truncated", path_.string()) };
+            }
+            std::array<std::byte, header_size> empty{};
+            seek_file(file_, 0, path_);
+            std::fwrite(empty.data(), 1, empty.size(), file_);
+            std::fflush(file_);
+        }
+
+        auto mapping{ std::make_shared<region_mapping>(path_) };
+        auto bytes{ mapping->get_bytes() };
+        std::size_t end{ 2 };
+        for (std::size_t i{}; i < chunk_count; ++i)
+        {
+            auto location{ read_big_endian(bytes.data() + i * 4) };
+            locations_[i].store(location, std::memory_order_relaxed);
+            timestamps_[i].store(read_big_endian(bytes.data() + sector_size + i * 4), std::memory_order_relaxed);
+            if (location)
+            {
+                end = std::max<std::size_t>(end, (location >> 8) + (location & 0xff));
+            }
+        }
+        if (file_ && bytes.size() > end * sector_size)
+        {
+            // Sectors past the last chunk were freed and never reused, nobody can be reading them yet.
+            mapping.reset();
+            std::filesystem::resize_file(path_, end * sector_size);
+            mapping = std::make_shared<region_mapping>(path_);
+        }
+        used_sectors_.resize(std::max(end, (mapping->get_bytes().size() + sector_size - 1) / sector_size), false);
+        for (const auto& location : locations_)
+        {
+            mark_sectors(location.load(std::memory_order_relaxed), true);
+        }
+        latest_ = mapping;
+        mapping_.store(std::move(mapping), std::memory_order_release);
+    }
+
+    region_file::~region_file()
+    {
+        if (file_)
+        {
+            std::fclose(file_);
+        }
+    }
+
+    void region_file::mark_sectors(std::uint32_t location, bool used)
+    {
+        auto first{ std::min<std::size_t>(location >> 8, used_sectors_.size()) };
+        auto last{ std::min<std::size_t>(first + (location & 0xff), used_sectors_.size()) };
+        std::fill(used_sectors_.begin() + static_cast<std::ptrdiff_t>(first),
+            used_sectors_.begin() + static_cast<std::ptrdiff_t>(last), used);
+    }
+
+    std::uint32_t region_file::allocate_sectors(std::uint32_t count)
+    {
+        std::size_t run{};
+        for (std::size_t i{ 2 }; i < used_sectors_.size(); ++i)
+        {
+            run = used_sectors_[i] ? 0 : run + 1;
+            if (run == count)
+            {
+                auto first{ static_cast<std::uint32_t>(i + 1 - count) };
+                mark_sectors(first << 8 | count, true);
+                return first;
+            }
+        }
+        // A free run at the end of the file is extended.
+        auto first{ used_sectors_.size() - run };
+        if (first + count > max_file_sectors)
+        {
+            throw std::length_error{ fmt::format("Region file {} is full", path_.string()) };
+        }
+        used_sectors_.resize(first + count, true);
+        mark_sectors(static_cast<std::uint32_t>(first) << 8 | count, true);
+        return static_cast<std::uint32_t>(first);
+    }
+
+    void region_file::reclaim_sectors()
+    {
+        std::erase_if(freed_, [this](const freed_sectors& freed)
+        {
+            if (!freed.view.expired())
+            {
+                return false;
+            }
+            for (auto location : freed.locations)
+            {
+                mark_sectors(location, false);
+            }
+            return true;
+        });
+    }
+
+    std::filesystem::path region_file::get_external_path(std::int32_t x, std::int32_t z) const
+    {
+        // External chunks use absolute chunk coordinates, which follow from the region name.
+        int region_x{}, region_z{};
+        std::sscanf(path_.filename().string().c_str(), "r.%d.%d.mca", &region_x, &region_z);
+        return path_.parent_path() / fmt::format("c.{}.{}.mcc", region_x * 32 + (x & 31), region_z * 32 + (z & 31));
+    }
+
+    bool region_file::contains(std::int32_t x, std::int32_t z) const noexcept
+    {
+        return locations_[get_index(x, z)].load(std::memory_order_acquire) != 0;
+    }
+
+    std::uint32_t region_file::get_timestamp(std::int32_t x, std::int32_t z) const noexcept
+    {
+        return timestamps_[get_index(x, z)].load(std::memory_order_relaxed);
+    }
+
+    std::optional<raw_chunk> region_file::read_raw(std::int32_t x, std::int32_t z) const
+    {
+        // The view is loaded before the location, so the sectors cannot be reused while it is held.
+        auto index{ get_index(x, z) };
+        auto mapping{ mapping_.load(std::memory_order_acquire) };
+        auto location{ locations_[index].load(std::memory_order_acquire) };
+        if (location && (location >> 8) * sector_size + chunk_header_size > mapping->get_bytes().size())
+        {
+            // A batch that grew the file publishes the view covering it right after the location, under the lock.
+            std::lock_guard lock{ write_mutex_ };
+            mapping = mapping_.load(std::memory_order_acquire);
+            location = locations_[index].load(std::memory_order_acquire);
+        }
+        if (!location)
+        {
+            return std::nullopt;
+        }
+        auto bytes{ mapping->get_bytes() };
+        std::size_t start{ (location >> 8) * sector_size };
+        if (start + chunk_header_size > bytes.size())
+        {
+            throw std::runtime_error{ fmt::format("Chunk {} {} lies outside of {}", x, z, path_.string()) };
+        }
+        auto length{ read_big_endian(bytes.data() + start) };
+        if (!length || length > (location & 0xff) * sector_size - 4 || start + 4 + length > bytes.size())
+        {
+            throw std::runtime_error{ fmt::format("Chunk {} {} in {} has an invalid length", x, z, path_.string()) };
+        }
+        auto type{ static_cast<std::uint8_t>(bytes[start + 4]) };
+        raw_chunk chunk{
+            .owner = std::move(mapping),
+            .external = {},
+            .data = bytes.subspan(start + chunk_header_size, length - 1),
+            .compression = static_cast<chunk_compression>(type & ~external_flag)
+        };
+        if (type & external_flag)
+        {
+            std::ifstream stream{ get_external_path(x, z), std::ios::binary };
+            if (!stream)
+            {
+                throw std::runtime_error{ fmt::format("Missing external chunk {} {} of {}", x, z, path_.string()) };
+            }
+            std::vector<char> data{ std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{} };
+            chunk.external.resize(data.size());
+            std::memcpy(chunk.external.data(), data.data(), data.size());
+            chunk.data = chunk.external;
+        }
+        return chunk;
+    }
+
+    bool region_file::read(std::int32_t x, std::int32_t z, std::vector<std::byte>& out) const
+    {
+        auto chunk{ read_raw(x, z) };
+        if (!chunk)
+        {
+            return false;
+        }
+        decompress_chunk(chunk->data, chunk->compression, out);
+        return true;
+    }
+
+    region_snapshot region_file::snapshot()
+    {
+        std::lock_guard lock{ write_mutex_ };
+        region_snapshot snapshot{ .mapping = mapping_.load(std::memory_order_acquire), .locations = {}, .timestamps = {} };
+        if (!snapshot.mapping)
+        {
+            return snapshot;
+        }
+        for (std::size_t i{}; i < chunk_count; ++i)
+        {
+            snapshot.locations[i] = locations_[i].load(std::memory_order_relaxed);
+            snapshot.timestamps[i] = timestamps_[i].load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    void region_file::write_raw(std::int32_t x, std::int32_t z, std::span<const std::byte> data,
+        chunk_compression compression, std::uint32_t timestamp)
+    {
+        chunk_write chunk{ .x = x, .z = z, .data = data, .compression = compression, .timestamp = timestamp };
+        write_batch({ &chunk, 1 });
+    }
+
+    void region_file::write_batch(std::span<const chunk_write> chunks)
+    {
+        if (!file_)
+        {
+            throw std::logic_error{ fmt::format("Region file {} is read-only", path_.string()) };
+        }
+        std::lock_guard lock{ write_mutex_ };
+        reclaim_sectors();
+
+        // Chunks only go to sectors no view can read, so concurrent readers of the old location are never disturbed,
+        // and until the header is rewritten the file on disk stays consistent.
+        std::vector<std::byte> buffer{};
+        std::vector<std::uint32_t> locations(chunks.size());
+        std::vector<std::filesystem::path> stale_externals{};
+        try
+        {
+            for (std::size_t i{}; i < chunks.size(); ++i)
+            {
+                const auto& chunk{ chunks[i] };
+                auto data{ chunk.data };
+                auto type{ static_cast<std::uint8_t>(chunk.compression) };
+                auto sectors{ (data.size() + chunk_header_size + sector_size - 1) / sector_size };
+                auto external_path{ get_external_path(chunk.x, chunk.z) };
+                if (sectors > max_sectors)
+                {
+                    // Replaced whole by a rename, so the header, old or new, never points at a partial file.
+                    auto temporary{ external_path };
+                    temporary += ".tmp";
+                    auto external{ std::fopen(temporary.string().c_str(), "wb") };
+                    if (!external)
+                    {
+                        throw std::runtime_error{ fmt::format("Failed to open {}", temporary.string()) };
+                    }
+                    auto written{ std::fwrite(data.data(), 1, data.size(), external) };
+                    try
+                    {
+                        if (written != data.size())
+                        {
+                            throw std::runtime_error{ fmt::format("Failed to write {}", temporary.string()) };
+                        }
+                        sync_file(external, temporary);
+                    }
+                    catch (...)
+                    {
+                        std::fclose(external);
+                        std::error_code ignored{};
+                        std::filesystem::remove(temporary, ignored);
+                        throw;
+                    }
+                    std::fclose(external);
+                    std::filesystem::rename(temporary, external_path);
+                    sync_directory(external_path.parent_path());
+                    data = {};
+                    type |= external_flag;
+                    sectors = 1;
+                }
+                else if (std::filesystem::exists(external_path))
+                {
+                    stale_externals.push_back(std::move(external_path));
+                }
+
+                auto sector{ allocate_sectors(static_cast<std::uint32_t>(sectors)) };
+                locations[i] = sector << 8 | static_cast<std::uint32_t>(sectors);
+                buffer.assign(sectors * sector_size, std::byte{});
+                write_big_endian(buffer.data(), static_cast<std::uint32_t>(data.size() + 1));
+                buffer[4] = static_cast<std::byte>(type);
+                std::copy(data.begin(), data.end(), buffer.begin() + chunk_header_size);
+                seek_file(file_, static_cast<std::uint64_t>(sector) * sector_size, path_);
+                if (std::fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size())
+                {
+                    throw std::runtime_error{ fmt::format("Failed to write chunk {} {} to {}", chunk.x, chunk.z,
+                        path_.string()) };
+                }
+            }
+            sync_file(file_, path_);
+        }
+        catch (...)
+        {
+            for (auto location : locations)
+            {
+                if (location)
+                {
+                    mark_sectors(location, false);
+                }
+            }
+            throw;
+        }
+        auto region{ latest_->get_region() };
+        if (region->get_size() < used_sectors_.size() * sector_size)
+        {
+            region = region_mapping{ path_ }.get_region();
+        }
+
+        // Each four byte entry lies within one disk sector, so a crash while the header is rewritten leaves every
+        // entry either old or new, and both point at complete data.
+        std::array<std::byte, header_size> header{};
+        for (std::size_t i{}; i < chunk_count; ++i)
+        {
+            write_big_endian(header.data() + i * 4, locations_[i].load(std::memory_order_relaxed));
+            write_big_endian(header.data() + sector_size + i * 4, timestamps_[i].load(std::memory_order_relaxed));
+        }
+        for (std::size_t i{}; i < chunks.size(); ++i)
+        {
+            auto index{ get_index(chunks[i].x, chunks[i].z) };
+            write_big_endian(header.data() + index * 4, locations[i]);
+            write_big_endian(header.data() + sector_size + index * 4, chunks[i].timestamp);
+        }
+        seek_file(file_, 0, path_);
+        if (std::fwrite(header.data(), 1, header.size(), file_) != header.size())
+        {
+            throw std::runtime_error{ fmt::format("Failed to write the header of {}", path_.string()) };
+        }
+        sync_file(file_, path_);
+
+        // Superseded sectors, including those of a chunk written twice in the batch, are freed once the views
+        // that might still point at them are gone.
+        std::bitset<chunk_count> written{};
+        std::vector<std::uint32_t> freed{};
+        for (auto i{ chunks.size() }; i-- > 0;)
+        {
+            auto index{ get_index(chunks[i].x, chunks[i].z) };
+            if (written[index])
+            {
+                freed.push_back(locations[i]);
+                continue;
+            }
+            written[index] = true;
+            if (auto previous{ locations_[index].load(std::memory_order_relaxed) })
+            {
+                freed.push_back(previous);
+            }
+        }
+        for (std::size_t i{}; i < chunks.size(); ++i)
+        {
+            auto index{ get_index(chunks[i].x, chunks[i].z) };
+            timestamps_[index].store(chunks[i].timestamp, std::memory_order_relaxed);
+            locations_[index].store(locations[i], std::memory_order_release);
+        }
+        auto view{ std::make_shared<region_mapping>(std::move(region)) };
+        latest_->set_successor(view);
+        mapping_.store(view, std::memory_order_release);
+        freed_.push_back({ .view = latest_, .locations = std::move(freed) });
+        latest_ = std::move(view);
+
+        for (const auto& path : stale_externals)
+        {
+            std::error_code error{};
+            std::filesystem::remove(path, error);
+        }
+    }
+
+    void region_file::write(std::int32_t x, std::int32_t z, std::span<const std::byte> nbt, std::uint32_t timestamp)
+    {
+        std::vector<std::byte> compressed{};
+        compress_chunk(nbt, compressed);
+        write_raw(x, z, compressed, chunk_compression::zlib, timestamp);
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstdio>
+
+#include <fmt/format.h>
+
+#include <plasma/world/region_storage.h>
+
+namespace plasma::world
+{
+    region_storage::region_storage(std::filesystem::path directory, bool writable) :
+        directory_{ std::move(directory) }, writable_{ writable }
+    {
+    }
+
+    std::shared_ptr<region_file> region_storage::get_region(std::int32_t chunk_x, std::int32_t chunk_z, bool create)
+    {
+        std::pair key{ chunk_x >> 5, chunk_z >> 5 };
+        std::lock_guard lock{ mutex_ };
+        if (auto found{ regions_.find(key) }; found != regions_.end())
+        {
+            return found->second;
+        }
+        auto path{ directory_ / fmt::format("r.{}.{}.mca", key.first, key.second) };
+        if (!create && !exists(path))
+        {
+            return nullptr;
+        }
+        auto region{ std::make_shared<region_file>(std::move(path), writable_) };
+        regions_.emplace(key, region);
+        return region;
+    }
+
+    bool region_storage::read_chunk(std::int32_t chunk_x, std::int32_t chunk_z, std::vector<std::byte>& out)
+    {
+        auto region{ get_region(chunk_x, chunk_z) };
+        return region && region->read(chunk_x, chunk_z, out);
+    }
+
+    void region_storage::write_chunk(std::int32_t chunk_x, std::int32_t chunk_z, std::span<const std::byte> nbt,
+        std::uint32_t timestamp)
+    {
+        get_region(chunk_x, chunk_z, true)->write(chunk_x, chunk_z, nbt, timestamp);
+    }
+
+    std::vector<std::pair<std::int32_t, std::int32_t>> region_storage::list_regions() const
+    {
+        std::vector<std::pair<std::int32_t, std::int32_t>> regions{};
+        if (!exists(directory_))
+        {
+            return regions;
+        }
+        for (const auto& entry : std::filesystem::directory_iterator{ directory_ })
+        {
+            std::int32_t x{}, z{};
+            char tail{};
+            if (entry.is_regular_file()
+                && std::sscanf(entry.path().filename().string().c_str(), "r.%d.%d.mc%c", &x, &z, &tail) == 3
+                && tail == 'a')
+            {
+                regions.emplace_back(x, z);
+            }
+        }
+        return regions;
+    }
+}
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include <plasma/world/terrain_generator.h>
+
+namespace plasma::world
+{
+    namespace
+    {
+        // Noise runs in Q12: lattice offsets lie in [0, 4096] and every product below stays within 32 bits.
+        constexpr std::int32_t fraction_bits{ 12 };
+        constexpr std::int32_t one{ 1 << fraction_bits };
+
+        constexpr std::uint32_t prime_x{ 0x9E3779B1u };
+        constexpr std::uint32_t prime_z{ 0x85EBCA77u };
+        constexpr std::uint32_t mix_a{ 0x2C1B3C6Du };
+        constexpr std::uint32_t mix_b{ 0x297A2D39u };
+
+        constexpr std::uint64_t split_mix(std::uint64_t& state) noexcept
+        {
+            auto value{ state += 0x9E3779B97F4A7C15ull };
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            return value ^ (value >> 31);
+        }
+
+        std::uint32_t hash(std::int32_t x, std::int32_t z, std::uint32_t salt) noexcept
+        {
+            auto h{ (static_cast<std::uint32_t>(x) * prime_x) ^ (static_cast<std::uint32_t>(z) * prime_z) ^ salt };
+            h ^= h >> 15;
+            h *= mix_a;
+            h ^= h >> 12;
+            h *= mix_b;
+            return h ^ (h >> 15);
+        }
+
+        // Picks one of eight gradients from the low three bits without branching: the diagonals when bit 2 is clear,
+        // otherwise an axis chosen by bit 1, with the signs taken from bits 0 and 1.
+        std::int32_t gradient(std::uint32_t h, std::int32_t dx, std::int32_t dz) noexcept
+        {
+            auto m0{ -static_cast<std::int32_t>(h & 1) };
+            auto m1{ -static_cast<std::int32_t>((h >> 1) & 1) };
+            auto m2{ -static_cast<std::int32_t>((h >> 2) & 1) };
+            auto sign_z{ (m2 & m0) | (~m2 & m1) };
+            auto x_term{ ((dx ^ m0) - m0) & ~(m2 & m1) };
+            auto z_term{ ((dz ^ sign_z) - sign_z) & ~(m2 & ~m1) };
+            return x_term + z_term;
+        }
+
+        // 6t^5 - 15t^4 + 10t^3
+        std::int32_t fade(std::int32_t t) noexcept
+        {
+            auto inner{ ((t * (t * 6 - 15 * one)) >> fraction_bits) + 10 * one };
+            auto cube{ (((t * t) >> fraction_bits) * t) >> fraction_bits };
+            return (cube * inner) >> fraction_bits;
+        }
+
+        std::int32_t lerp(std::int32_t a, std::int32_t b, std::int32_t t) noexcept
+        {
+            return a + (((b - a) * t) >> fraction_bits);
+        }
+
+        std::int32_t sample_scalar(const terrain_generator::octave& octave, std::int32_t x, std::int32_t z) noexcept
+        {
+            x += octave.offset_x;
+            z += octave.offset_z;
+            auto cell_x{ x >> octave.shift };
+            auto cell_z{ z >> octave.shift };
+            auto mask{ (1 << octave.shift) - 1 };
+            auto fx{ (x & mask) << (fraction_bits - octave.shift) };
+            auto fz{ (z & mask) << (fraction_bits - octave.shift) };
+            auto d00{ gradient(hash(cell_x, cell_z, octave.salt), fx, fz) };
+            auto d10{ gradient(hash(cell_x + 1, cell_z, octave.salt), fx - one, fz) };
+            auto d01{ gradient(hash(cell_x, cell_z + 1, octave.salt), fx, fz - one) };
+            auto d11{ gradient(hash(cell_x + 1, cell_z + 1, octave.salt), fx - one, fz - one) };
+            auto u{ fade(fx) };
+            return lerp(lerp(d00, d10, u), lerp(d01, d11, u), fade(fz));
+        }
+
+        // Fills the weighted octave sums of the 256 columns of a chunk, indexed by z * 16 + x.
+        void sample_chunk_scalar(const terrain_generator::octave* octaves, std::size_t count, std::int32_t base_x,
+            std::int32_t base_z, std::int32_t* out) noexcept
+        {
+            for (std::int32_t z{}; z < 16; ++z)
+            {
+                for (std::int32_t x{}; x < 16; ++x)
+                {
+                    std::int32_t sum{};
+                    for (std::size_t i{}; i < count; ++i)
+                    {
+                        sum += sample_scalar(octaves[i], base_x + x, base_z + z) * octaves[i].amplitude;
+                    }
+                    out[z * 16 + x] = sum;
+                }
+            }
+        }
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define PLASMA_NOISE_SIMD
+        // The kernels below are the scalar code above lane for lane; integer arithmetic keeps them identical.
+        __attribute__((target("avx2"))) __m256i hash_avx2(__m256i x, __m256i z, __m256i salt) noexcept
+        {
+            auto h{ _mm256_xor_si256(_mm256_xor_si256(
+                _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<std::int32_t>(prime_x))),
+                _mm256_mullo_epi32(z, _mm256_set1_epi32(static_cast<std::int32_t>(prime_z)))), salt) };
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+            h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<std::int32_t>(mix_a)));
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+            h = _mm256_mullo_epi32(h, _mm256_set1_epi32(static_cast<std::int32_t>(mix_b)));
+            return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+        }
+
+        __attribute__((target("avx2"))) __m256i gradient_avx2(__m256i h, __m256i dx, __m256i dz) noexcept
+        {
+            auto bit{ _mm256_set1_epi32(1) };
+            auto zero{ _mm256_setzero_si256() };
+            auto m0{ _mm256_sub_epi32(zero, _mm256_and_si256(h, bit)) };
+            auto m1{ _mm256_sub_epi32(zero, _mm256_and_si256(_mm256_srli_epi32(h, 1), bit)) };
+            auto m2{ _mm256_sub_epi32(zero, _mm256_and_si256(_mm256_srli_epi32(h, 2), bit)) };
+            auto sign_z{ _mm256_or_si256(_mm256_and_si256(m2, m0), _mm256_andnot_si256(m2, m1)) };
+            auto x_term{ _mm256_andnot_si256(_mm256_and_si256(m2, m1),
+                _mm256_sub_epi32(_mm256_xor_si256(dx, m0), m0)) };
+            auto z_term{ _mm256_andnot_si256(_mm256_andnot_si256(m1, m2),
+                _mm256_sub_epi32(_mm256_xor_si256(dz, sign_z), sign_z)) };
+            return _mm256_add_epi32(x_term, z_term);
+        }
+
+        __attribute__((target("avx2"))) __m256i multiply_avx2(__m256i a, __m256i b) noexcept
+        {
+            return _mm256_srai_epi32(_mm256_mullo_epi32(a, b), fraction_bits);
+        }
+
+        __attribute__((target("avx2"))) __m256i fade_avx2(__m256i t) noexcept
+        {
+            auto inner{ _mm256_add_epi32(multiply_avx2(t, _mm256_sub_epi32(_mm256_mullo_epi32(t, _mm256_set1_epi32(6)),
+                _mm256_set1_epi32(15 * one))), _mm256_set1_epi32(10 * one)) };
+            return multiply_avx2(multiply_avx2(multiply_avx2(t, t), t), inner);
+        }
+
+        __attribute__((target("avx2"))) __m256i lerp_avx2(__m256i a, __m256i b, __m256i t) noexcept
+        {
+            return _mm256_add_epi32(a, multiply_avx2(_mm256_sub_epi32(b, a), t));
+        }
+
+        __attribute__((target("avx2"))) void sample_chunk_avx2(const terrain_generator::octave* octaves,
+            std::size_t count, std::int32_t base_x, std::int32_t base_z, std::int32_t* out) noexcept
+        {
+            auto lanes{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+            auto unit{ _mm256_set1_epi32(1) };
+            auto whole{ _mm256_set1_epi32(one) };
+            for (std::int32_t z{}; z < 16; ++z)
+            {
+                for (std::int32_t x{}; x < 16; x += 8)
+                {
+                    auto sum{ _mm256_setzero_si256() };
+                    for (std::size_t i{}; i < count; ++i)
+                    {
+                        const auto& octave{ octaves[i] };
+                        auto shift{ _mm_cvtsi32_si128(octave.shift) };
+                        auto scale{ _mm_cvtsi32_si128(fraction_bits - octave.shift) };
+                        auto mask{ _mm256_set1_epi32((1 << octave.shift) - 1) };
+                        auto salt{ _mm256_set1_epi32(static_cast<std::int32_t>(octave.salt)) };
+                        auto px{ _mm256_add_epi32(_mm256_set1_epi32(base_x + x + octave.offset_x), lanes) };
+                        auto pz{ _mm256_set1_epi32(base_z + z + octave.offset_z) };
+                        auto cell_x{ _mm256_sra_epi32(px, shift) };
+                        auto cell_z{ _mm256_sra_epi32(pz, shift) };
+                        auto next_x{ _mm256_add_epi32(cell_x, unit) };
+                        auto next_z{ _mm256_add_epi32(cell_z, unit) };
+                        auto fx{ _mm256_sll_epi32(_mm256_and_si256(px, mask), scale) };
+                        auto fz{ _mm256_sll_epi32(_mm256_and_si256(pz, mask), scale) };
+                        auto gx{ _mm256_sub_epi32(fx, whole) };
+                        auto gz{ _mm256_sub_epi32(fz, whole) };
+                        auto d00{ gradient_avx2(hash_avx2(cell_x, cell_z, salt), fx, fz) };
+                        auto d10{ gradient_avx2(hash_avx2(next_x, cell_z, salt), gx, fz) };
+                        auto d01{ gradient_avx2(hash_avx2(cell_x, next_z, salt), fx, gz) };
+                        auto d11{ gradient_avx2(hash_avx2(next_x, next_z, salt), gx, gz) };
+                        auto u{ fade_avx2(fx) };
+                        auto noise{ lerp_avx2(lerp_avx2(d00, d10, u), lerp_avx2(d01, d11, u), fade_avx2(fz)) };
+                        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(noise, _mm256_set1_epi32(octave.amplitude)));
+                    }
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + z * 16 + x), sum);
+                }
+            }
+        }
+
+        __attribute__((target("sse4.1"))) __m128i hash_sse41(__m128i x, __m128i z, __m128i salt) noexcept
+        {
+            auto h{ _mm_xor_si128(_mm_xor_si128(
+                _mm_mullo_epi32(x, _mm_set1_epi32(static_cast<std::int32_t>(prime_x))),
+                _mm_mullo_epi32(z, _mm_set1_epi32(static_cast<std::int32_t>(prime_z)))), salt) };
+            h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+            h = _mm_mullo_epi32(h, _mm_set1_epi32(static_cast<std::int32_t>(mix_a)));
+            h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+            h = _mm_mullo_epi32(h, _mm_set1_epi32(static_cast<std::int32_t>(mix_b)));
+            return _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+        }
+
+        __attribute__((target("sse4.1"))) __m128i gradient_sse41(__m128i h, __m128i dx, __m128i dz) noexcept
+        {
+            auto bit{ _mm_set1_epi32(1) };
+            auto zero{ _mm_setzero_si128() };
+            auto m0{ _mm_sub_epi32(zero, _mm_and_si128(h, bit)) };
+            auto m1{ _mm_sub_epi32(zero, _mm_and_si128(_mm_srli_epi32(h, 1), bit)) };
+            auto m2{ _mm_sub_epi32(zero, _mm_and_si128(_mm_srli_epi32(h, 2), bit)) };
+            auto sign_z{ _mm_or_si128(_mm_and_si128(m2, m0), _mm_andnot_si128(m2, m1)) };
+            auto x_term{ _mm_andnot_si128(_mm_and_si128(m2, m1), _mm_sub_epi32(_mm_xor_si128(dx, m0), m0)) };
+            auto z_term{ _mm_andnot_si128(_mm_andnot_si128(m1, m2),
+                _mm_sub_epi32(_mm_xor_si128(dz, sign_z), sign_z)) };
+            return _mm_add_epi32(x_term, z_term);
+        }
+
+        __attribute__((target("sse4.1"))) __m128i multiply_sse41(__m128i a, __m128i b) noexcept
+        {
+            return _mm_srai_epi32(_mm_mullo_epi32(a, b), fraction_bits);
+        }
+
+        __attribute__((target("sse4.1"))) __m128i fade_sse41(__m128i t) noexcept
+        {
+            auto inner{ _mm_add_epi32(multiply_sse41(t, _mm_sub_epi32(_mm_mullo_epi32(t, _mm_set1_epi32(6)),
+                _mm_set1_epi32(15 * one))), _mm_set1_epi32(10 * one)) };
+            return multiply_sse41(multiply_sse41(multiply_sse41(t, t), t), inner);
+        }
+
+        __attribute__((target("sse4.1"))) __m128i lerp_sse41(__m128i a, __m128i b, __m128i t) noexcept
+        {
+            return _mm_add_epi32(a, multiply_sse41(_mm_sub_epi32(b, a), t));
+        }
+
+        __attribute__((target("sse4.1"))) void sample_chunk_sse41(const terrain_generator::octave* octaves,
+            std::size_t count, std::int32_t base_x, std::int32_t base_z, std::int32_t* out) noexcept
+        {
+            auto lanes{ _mm_setr_epi32(0, 1, 2, 3) };
+            auto unit{ _mm_set1_epi32(1) };
+            auto whole{ _mm_set1_epi32(one) };
+            for (std::int32_t z{}; z < 16; ++z)
+            {
+                for (std::int32_t x{}; x < 16; x += 4)
+                {
+                    auto sum{ _mm_setzero_si128() };
+                    for (std::size_t i{}; i < count; ++i)
+                    {
+                        const auto& octave{ octaves[i] };
+                        auto shift{ _mm_cvtsi32_si128(octave.shift) };
+                        auto scale{ _mm_cvtsi32_si128(fraction_bits - octave.shift) };
+                        auto mask{ _mm_set1_epi32((1 << octave.shift) - 1) };
+                        auto salt{ _mm_set1_epi32(static_cast<std::int32_t>(octave.salt)) };
+                        auto px{ _mm_add_epi32(_mm_set1_epi32(base_x + x + octave.offset_x), lanes) };
+                        auto pz{ _mm_set1_epi32(base_z + z + octave.offset_z) };
+                        auto cell_x{ _mm_sra_epi32(px, shift) };
+                        auto cell_z{ _mm_sra_epi32(pz, shift) };
+                        auto next_x{ _mm_add_epi32(cell_x, unit) };
+                        auto next_z{ _mm_add_epi32(cell_z, unit) };
+                        auto fx{ _mm_sll_epi32(_mm_and_si128(px, mask), scale) };
+                        auto fz{ _mm_sll_epi32(_mm_and_si128(pz, mask), scale) };
+                        auto gx{ _mm_sub_epi32(fx, whole) };
+                        auto gz{ _mm_sub_epi32(fz, whole) };
+                        auto d00{ gradient_sse41(hash_sse41(cell_x, cell_z, salt), fx, fz) };
+                        auto d10{ gradient_sse41(hash_sse41(next_x, cell_z, salt), gx, fz) };
+                        auto d01{ gradient_sse41(hash_sse41(cell_x, next_z, salt), fx, gz) };
+                        auto d11{ gradient_sse41(hash_sse41(next_x, next_z, salt), gx, gz) };
+                        auto u{ fade_sse41(fx) };
+                        auto noise{ lerp_sse41(lerp_sse41(d00, d10, u), lerp_sse41(d01, d11, u), fade_sse41(fz)) };
+                        sum = _mm_add_epi32(sum, _mm_mullo_epi32(noise, _mm_set1_epi32(octave.amplitude)));
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + z * 16 + x), sum);
+                }
+            }
+        }
+#endif
+
+        class codec
+        {
+        public:
+            const char* name;
+            void (*sample)(const terrain_generator::octave*, std::size_t, std::int32_t, std::int32_t,
+                std::int32_t*) noexcept;
+        };
+
+        codec select_codec() noexcept
+        {
+#ifdef PLASMA_NOISE_SIMD
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return { .name = "avx2", .sample = &sample_chunk_avx2 };
+            }
+            if (__builtin_cpu_supports("sse4.1"))
+            {
+                return { .name = "sse4.1", .sample = &sample_chunk_sse41 };
+            }
+#endif
+            return { .name = "scalar", .sample = &sample_chunk_scalar };
+        }
+
+        const codec selected_codec{ select_codec() };
+
+        // Bedrock thins out over the bottom four layers like the vanilla floor, deterministically per block.
+        bool is_bedrock(std::int32_t x, std::int32_t y, std::int32_t z, std::uint32_t salt) noexcept
+        {
+            auto roll{ hash(x, z, salt + static_cast<std::uint32_t>(y)) % 5 };
+            return !y || (y < 5 && static_cast<std::int32_t>(roll) >= y);
+        }
+    }
+
+    terrain_generator::terrain_generator(std::uint64_t seed) noexcept :
+        seed_{ seed }, octaves_{}
+    {
+        // From continents 512 blocks across down to 16 block bumps, each half as strong as the one before.
+        auto state{ seed };
+        for (std::size_t i{}; i < octave_count; ++i)
+        {
+            auto bits{ split_mix(state) };
+            auto shift{ static_cast<std::int32_t>(9 - i) };
+            auto mask{ (std::uint64_t{ 1 } << shift) - 1 };
+            octaves_[i] = {
+                .salt = static_cast<std::uint32_t>(bits),
+                .shift = shift,
+                .offset_x = static_cast<std::int32_t>((bits >> 32) & mask),
+                .offset_z = static_cast<std::int32_t>((bits >> 48) & mask),
+                .amplitude = 32 >> i
+            };
+        }
+    }
+
+    void terrain_generator::get_heights(std::int32_t chunk_x, std::int32_t chunk_z,
+        std::span<std::int32_t, 256> heights) const noexcept
+    {
+        selected_codec.sample(octaves_.data(), octaves_.size(), chunk_x * 16, chunk_z * 16, heights.data());
+        for (auto& height : heights)
+        {
+            // Octave sums stay within about 2^18, so the surface keeps to some 40 blocks either side of sea level.
+            height = std::clamp(sea_level + 4 + (height >> fraction_bits), 1, 250);
+        }
+    }
+
+    std::shared_ptr<chunk> terrain_generator::generate(std::int32_t chunk_x, std::int32_t chunk_z) const
+    {
+        std::array<std::int32_t, 256> heights{};
+        get_heights(chunk_x, chunk_z, heights);
+        auto [lowest, highest]{ std::minmax_element(heights.begin(), heights.end()) };
+        auto top{ std::max(*highest, sea_level) };
+        auto bedrock_salt{ static_cast<std::uint32_t>(seed_ >> 32) ^ 0xB5297A4Du };
+
+        auto generated{ std::make_shared<chunk>(chunk_x, chunk_z) };
+        std::array<std::uint32_t, chunk_section::volume> states{};
+        for (std::int32_t section_y{}; section_y * 16 <= top; ++section_y)
+        {
+            auto& section{ generated->get_section(static_cast<std::size_t>(section_y)) };
+            auto base_y{ section_y * 16 };
+            // Deep sections are solid stone and need no column pass.
+            if (base_y >= 5 && base_y + 15 < *lowest - 4)
+            {
+                section.fill(stone);
+                continue;
+            }
+            for (std::int32_t z{}; z < 16; ++z)
+            {
+                for (std::int32_t x{}; x < 16; ++x)
+                {
+                    auto height{ heights[static_cast<std::size_t>(z * 16 + x)] };
+                    auto beach{ height <= sea_level + 1 };
+                    for (std::int32_t y{}; y < 16; ++y)
+                    {
+                        auto world_y{ base_y + y };
+                        std::uint32_t state{ chunk_section::air };
+                        if (world_y < 5 && is_bedrock(chunk_x * 16 + x, world_y, chunk_z * 16 + z, bedrock_salt))
+                        {
+                            state = bedrock;
+                        }
+                        else if (world_y < height - 3)
+                        {
+                            state = stone;
+                        }
+                        else if (world_y < height)
+                        {
+                            state = beach ? (height < sea_level - 8 ? gravel : sand) : dirt;
+                        }
+                        else if (world_y == height)
+                        {
+                            state = beach ? (height < sea_level - 8 ? gravel : sand) : grass_block;
+                        }
+                        else if (world_y <= sea_level)
+                        {
+                            state = water;
+                        }
+                        states[chunk_section::get_index(static_cast<std::uint32_t>(x), static_cast<std::uint32_t>(y),
+                            static_cast<std::uint32_t>(z))] = state;
+                    }
+                }
+            }
+            section.pack(states);
+        }
+        generated->set_dirty(true);
+        return generated;
+    }
+
+    const char* get_noise_codec_name() noexcept
+    {
+        return selected_codec.name;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#include <plasma/job/job_system.h>
+#include <plasma/world/chunk_saver.h>
+#include <plasma/world/region_storage.h>
+
+#include "test.h"
+
+namespace plasma::test
+{
+    using namespace plasma::world;
+
+    namespace
+    {
+        void write_chunk(std::vector<std::byte>& nbt)
+        {
+            nbt.assign(64, std::byte{ 0x0a });
+        }
+
+        void fail_chunk(std::vector<std::byte>&)
+        {
+            throw std::runtime_error{ "Failed on purpose" };
+        }
+
+        // A chunk that never saves must not keep flush() waiting, only stop() gives up on it.
+        void test_flush(const std::filesystem::path& directory)
+        {
+            region_storage storage{ directory / "region", true };
+            job::job_system jobs{ 1, false };
+            chunk_saver saver{ storage, jobs, 1024 * 1024 };
+            PLASMA_CHECK(saver.save(0, 0, 64, &write_chunk));
+            PLASMA_CHECK(saver.flush() == 0);
+            PLASMA_CHECK(!saver.is_saving(0, 0));
+            PLASMA_CHECK(storage.get_region(0, 0, false)->contains(0, 0));
+
+            PLASMA_CHECK(saver.save(1, 0, 64, &fail_chunk));
+            PLASMA_CHECK(saver.save(2, 0, 64, &write_chunk));
+            PLASMA_CHECK(saver.flush() == 1);
+            PLASMA_CHECK(saver.is_saving(1, 0));
+            PLASMA_CHECK(!saver.is_saving(2, 0));
+            PLASMA_CHECK(saver.get_statistics().failed >= chunk_saver::max_attempts_when_stopping);
+            saver.stop();
+            PLASMA_CHECK(saver.get_statistics().lost == 1);
+        }
+    }
+
+    void run_chunk_saver_tests()
+    {
+        auto directory{ std::filesystem::temp_directory_path() / "plasma-chunk-saver-test" };
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        try
+        {
+            test_flush(directory);
+        }
+        catch (...)
+        {
+            std::filesystem::remove_all(directory);
+            throw;
+        }
+        std::filesystem::remove_all(directory);
+    }
+}
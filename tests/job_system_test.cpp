@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+
+#include <plasma/job/job_system.h>
+
+#include "test.h"
+
+namespace plasma::test
+{
+    using namespace plasma::job;
+
+    namespace
+    {
+        void test_parallel_for()
+        {
+            job_system jobs{ 2, false };
+            std::atomic<std::size_t> sum{};
+            jobs.parallel_for(0, 1000, 7, [&sum](std::size_t i)
+            {
+                sum.fetch_add(i, std::memory_order_relaxed);
+            });
+            PLASMA_CHECK(sum.load() == 999 * 1000 / 2);
+            jobs.parallel_for(5, 5, 1, [](std::size_t)
+            {
+                throw std::logic_error{ "Called for an empty range" };
+            });
+        }
+
+        // Whichever chunk throws, every other chunk must have finished by the time the exception arrives, since they
+        // refer to the caller's function.
+        void test_parallel_for_exception(std::size_t throwing)
+        {
+            job_system jobs{ 2, false };
+            std::atomic<std::size_t> finished{};
+            PLASMA_CHECK_THROWS(std::runtime_error, jobs.parallel_for(0, 64, 1, [&finished, throwing](std::size_t i)
+            {
+                if (i == throwing)
+                {
+                    throw std::runtime_error{ "Failed on purpose" };
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds{ 200 });
+                finished.fetch_add(1, std::memory_order_relaxed);
+            }));
+            PLASMA_CHECK(finished.load() == 63);
+        }
+    }
+
+    void run_job_system_tests()
+    {
+        test_parallel_for();
+        // The first chunk runs on the calling thread, the others are queued.
+        test_parallel_for_exception(0);
+        test_parallel_for_exception(40);
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <set>
+#include <string_view>
+#include <vector>
+
+#include "test.h"
+
+std::atomic<bool> g_color_enabled{ true };
+
+namespace
+{
+    class suite
+    {
+    public:
+        std::string_view name;
+        void (*run)();
+    };
+
+    const std::vector<suite> suites{
+        { "varint", &plasma::test::run_varint_tests },
+        { "nbt", &plasma::test::run_nbt_tests },
+        { "job_system", &plasma::test::run_job_system_tests },
+        { "rate_limiter", &plasma::test::run_rate_limiter_tests },
+        { "chunk_saver", &plasma::test::run_chunk_saver_tests }
+    };
+}
+
+// Runs the named suites, or all of them, and fails if any check does.
+int main(const int argc, const char* argv[])
+{
+    std::vector<std::string_view> selected(argv + 1, argv + argc);
+    std::set<std::string_view> matched{};
+    int result{};
+    for (const auto& [name, run] : suites)
+    {
+        if (!selected.empty() && std::ranges::find(selected, name) == selected.end())
+        {
+            continue;
+        }
+        matched.insert(name);
+        try
+        {
+            run();
+            std::cout << name << ": passed" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << name << ": " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+    for (auto name : selected)
+    {
+        if (matched.contains(name))
+        {
+            continue;
+        }
+        std::cerr << "Unknown test suite " << name << std::endl;
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <plasma/nbt/document.h>
+#include <plasma/nbt/reader.hpp>
+#include <plasma/nbt/view.h>
+#include <plasma/nbt/writer.h>
+#include <plasma/world/chunk.h>
+#include <plasma/world/terrain_generator.h>
+
+#include "test.h"
+
+namespace plasma::test
+{
+    using namespace plasma::nbt;
+
+    namespace
+    {
+        // Every tag type, empty and nested containers, and the extremes of each number.
+        std::vector<std::byte> write_sample()
+        {
+            std::vector<std::byte> out{};
+            writer output{ out };
+            output.begin_compound("root");
+            output.write_byte("byte", std::numeric_limits<std::int8_t>::min());
+            output.write_short("short", std::numeric_limits<std::int16_t>::max());
+            output.write_int("int", std::numeric_limits<std::int32_t>::min());
+            output.write_long("long", std::numeric_limits<std::int64_t>::max());
+            output.write_float("float", 1.5f);
+            output.write_double("double", -0.25);
+            output.write_string("string", "h\xc3\xa9llo");
+            output.write_string("empty string", {});
+            const std::array<std::int8_t, 3> bytes{ -1, 0, 1 };
+            output.write_byte_array("bytes", bytes);
+            const std::array<std::int32_t, 3> ints{ 1, -2, 0x12345678 };
+            output.write_int_array("ints", ints);
+            const std::array<std::int64_t, 2> longs{ std::numeric_limits<std::int64_t>::min(), 0x0102030405060708 };
+            output.write_long_array("longs", longs);
+            output.write_int_array("empty ints", std::span<const std::int32_t>{});
+            output.begin_list("compounds", tag_type::tag_compound);
+            for (std::int32_t i{}; i < 3; ++i)
+            {
+                output.begin_compound();
+                output.write_int("index", i);
+                output.end_compound();
+            }
+            output.end_list();
+            output.begin_list("lists", tag_type::tag_list);
+            output.begin_list({}, tag_type::tag_int);
+            output.write_int({}, 7);
+            output.end_list();
+            output.begin_list({}, tag_type::tag_string);
+            output.end_list();
+            output.end_list();
+            output.begin_list("empty list", tag_type::tag_end);
+            output.end_list();
+            output.begin_compound("nested");
+            output.begin_compound("deeper");
+            output.end_compound();
+            output.end_compound();
+            output.end_compound();
+            PLASMA_CHECK(output.is_complete());
+            return out;
+        }
+
+        // Touches every value, so that a fuzzed length or type reaches whatever reads it.
+        void walk(const view& tag)
+        {
+            switch (tag.get_type())
+            {
+            case tag_type::tag_compound:
+            case tag_type::tag_list:
+                static_cast<void>(tag.get_size());
+                tag.for_each([](const view& child)
+                {
+                    walk(child);
+                });
+                break;
+            case tag_type::tag_string:
+                static_cast<void>(tag.as_string());
+                break;
+            case tag_type::tag_byte_array:
+                static_cast<void>(tag.as_byte_array().to_vector());
+                break;
+            case tag_type::tag_int_array:
+                static_cast<void>(tag.as_int_array().to_vector());
+                break;
+            case tag_type::tag_long_array:
+                static_cast<void>(tag.as_long_array().to_vector());
+                break;
+            case tag_type::tag_float:
+            case tag_type::tag_double:
+                break;
+            default:
+                static_cast<void>(tag.as_integer());
+                break;
+            }
+        }
+
+        // Feeds the input to the document, the view and a bare parse. Rejecting it is fine, any other exception is
+        // not.
+        void parse_everywhere(std::span<const std::byte> data)
+        {
+            try
+            {
+                document parsed{};
+                parsed.parse(data);
+            }
+            catch (const parse_error&)
+            {
+            }
+            try
+            {
+                view root{ data };
+                static_cast<void>(root.get_payload_size());
+                walk(root);
+            }
+            catch (const parse_error&)
+            {
+            }
+            try
+            {
+                null_handler ignore{};
+                static_cast<void>(parse(data, ignore));
+            }
+            catch (const parse_error&)
+            {
+            }
+        }
+
+        void test_document_round_trip()
+        {
+            auto sample{ write_sample() };
+            document parsed{};
+            PLASMA_CHECK(parsed.parse(sample) == sample.size());
+            std::vector<std::byte> rewritten{};
+            writer output{ rewritten };
+            output.write(*parsed.get_root());
+            PLASMA_CHECK(rewritten == sample);
+
+            const auto& root{ *parsed.get_root() };
+            PLASMA_CHECK(root.name == "root");
+            PLASMA_CHECK(root.find("byte")->integer == std::numeric_limits<std::int8_t>::min());
+            PLASMA_CHECK(root.find("long")->integer == std::numeric_limits<std::int64_t>::max());
+            PLASMA_CHECK(root.find("float")->floating == 1.5);
+            PLASMA_CHECK(root.find("string")->as_string() == "h\xc3\xa9llo");
+            PLASMA_CHECK(root.find("ints")->as_int_array()[2] == 0x12345678);
+            PLASMA_CHECK(root.find("longs")->as_long_array()[1] == 0x0102030405060708);
+            PLASMA_CHECK(root.find("compounds")->size == 3);
+            PLASMA_CHECK(root.find("compounds")->last->find("index")->integer == 2);
+            PLASMA_CHECK(root.find("empty list")->size == 0);
+            PLASMA_CHECK(!root.find("missing"));
+        }
+
+        void test_view_round_trip()
+        {
+            auto sample{ write_sample() };
+            view root{ sample };
+            PLASMA_CHECK(root.get_name() == "root");
+            PLASMA_CHECK(root.get_type() == tag_type::tag_compound);
+            PLASMA_CHECK(root.find("short").as_short() == std::numeric_limits<std::int16_t>::max());
+            PLASMA_CHECK(root.find("int").as_int() == std::numeric_limits<std::int32_t>::min());
+            PLASMA_CHECK(root.find("double").as_double() == -0.25);
+            PLASMA_CHECK(root.find("bytes").as_byte_array()[0] == -1);
+            PLASMA_CHECK(root.find("longs").as_long_array()[0] == std::numeric_limits<std::int64_t>::min());
+            PLASMA_CHECK(root.find("lists").get_element() == tag_type::tag_list);
+            PLASMA_CHECK(root.find("lists").get_size() == 2);
+            PLASMA_CHECK(!root.find("missing"));
+            PLASMA_CHECK_THROWS(parse_error, root.find("int").as_long());
+
+            // Copying the payload through unchanged must give back the same bytes.
+            std::vector<std::byte> copied{};
+            writer output{ copied };
+            output.write(root.get_name(), root);
+            PLASMA_CHECK(copied == sample);
+            PLASMA_CHECK(root.get_payload().size() + 1 + 2 + root.get_name().size() == sample.size());
+        }
+
+        void test_chunk_round_trip()
+        {
+            world::terrain_generator generator{ 1 };
+            for (auto [x, z] : { std::array{ 0, 0 }, std::array{ -3, 7 } })
+            {
+                auto generated{ generator.generate(x, z) };
+                std::vector<std::byte> saved{};
+                generated->serialize(saved);
+                auto loaded{ world::chunk::deserialize(x, z, saved) };
+                std::vector<std::byte> resaved{};
+                loaded->serialize(resaved);
+                PLASMA_CHECK(resaved == saved);
+            }
+        }
+
+        void test_malformed()
+        {
+            auto sample{ write_sample() };
+            for (std::size_t size{}; size < sample.size(); ++size)
+            {
+                document parsed{};
+                PLASMA_CHECK_THROWS(parse_error, parsed.parse(std::span{ sample }.first(size)));
+                PLASMA_CHECK(!parsed.get_root());
+            }
+
+            // Lists nested one level past the limit.
+            std::vector<std::byte> deep{ std::byte{ 9 }, std::byte{ 0 }, std::byte{ 0 } };
+            for (std::size_t i{}; i <= max_depth; ++i)
+            {
+                deep.insert(deep.end(), { std::byte{ 9 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0 },
+                    std::byte{ 1 } });
+            }
+            document parsed{};
+            PLASMA_CHECK_THROWS(parse_error, parsed.parse(deep));
+
+            // An int array claiming two billion elements with none following.
+            const std::vector<std::byte> huge{ std::byte{ 11 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0x7f },
+                std::byte{ 0xff }, std::byte{ 0xff }, std::byte{ 0xff } };
+            PLASMA_CHECK_THROWS(parse_error, parsed.parse(huge));
+            const std::vector<std::byte> negative{ std::byte{ 7 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0xff },
+                std::byte{ 0xff }, std::byte{ 0xff }, std::byte{ 0xff } };
+            PLASMA_CHECK_THROWS(parse_error, parsed.parse(negative));
+            const std::vector<std::byte> unknown{ std::byte{ 13 }, std::byte{ 0 }, std::byte{ 0 } };
+            PLASMA_CHECK_THROWS(parse_error, parsed.parse(unknown));
+            const std::vector<std::byte> end_list{ std::byte{ 9 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0 },
+                std::byte{ 0 }, std::byte{ 0 }, std::byte{ 0 }, std::byte{ 1 } };
+            PLASMA_CHECK_THROWS(parse_error, parsed.parse(end_list));
+        }
+
+        // Flips, overwrites, truncates and splices the sample and a real chunk at random.
+        void test_fuzz()
+        {
+            std::vector<std::vector<std::byte>> seeds{ write_sample() };
+            seeds.emplace_back();
+            world::terrain_generator{ 2 }.generate(0, 0)->serialize(seeds.back());
+            std::mt19937_64 random{ 1 };
+            std::vector<std::byte> input{};
+            for (std::size_t i{}; i < 20000; ++i)
+            {
+                const auto& seed{ seeds[i % seeds.size()] };
+                input = seed;
+                std::uniform_int_distribution<std::size_t> position{ 0, input.size() - 1 };
+                auto mutations{ random() % 4 + 1 };
+                for (std::size_t j{}; j < mutations; ++j)
+                {
+                    switch (random() % 4)
+                    {
+                    case 0:
+                        input[position(random) % input.size()] ^= static_cast<std::byte>(1 << (random() % 8));
+                        break;
+                    case 1:
+                        input[position(random) % input.size()] = static_cast<std::byte>(random());
+                        break;
+                    case 2:
+                        input.resize(position(random) % input.size() + 1);
+                        break;
+                    default:
+                    {
+                        auto from{ position(random) % seed.size() };
+                        auto size{ std::min<std::size_t>(random() % 64, seed.size() - from) };
+                        auto at{ input.begin() + static_cast<std::ptrdiff_t>(position(random) % input.size()) };
+                        input.insert(at, seed.begin() + static_cast<std::ptrdiff_t>(from),
+                            seed.begin() + static_cast<std::ptrdiff_t>(from + size));
+                        break;
+                    }
+                    }
+                }
+                try
+                {
+                    parse_everywhere(input);
+                }
+                catch (const std::exception& e)
+                {
+                    throw check_failure{ fmt::format("Mutation {} escaped with {}", i, e.what()) };
+                }
+            }
+        }
+    }
+
+    void run_nbt_tests()
+    {
+        test_document_round_trip();
+        test_view_round_trip();
+        test_chunk_round_trip();
+        test_malformed();
+        test_fuzz();
+    }
+}
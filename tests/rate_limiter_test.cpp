@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/asio/ip/address.hpp>
+
+#include <plasma/network/rate_limiter.h>
+
+#include "test.h"
+
+namespace plasma::test
+{
+    using namespace plasma::network;
+
+    namespace
+    {
+        boost::asio::ip::address make_address(const char* text)
+        {
+            return boost::asio::ip::make_address(text);
+        }
+
+        void test_burst()
+        {
+            // Slow enough that nothing refills while the test runs.
+            rate_limiter limiter{ 0.001, 3.0 };
+            auto address{ make_address("192.0.2.1") };
+            for (int i{}; i < 3; ++i)
+            {
+                PLASMA_CHECK(limiter.try_acquire(address));
+            }
+            PLASMA_CHECK(!limiter.try_acquire(address));
+            PLASMA_CHECK(limiter.try_acquire(make_address("192.0.2.2")));
+            // A dual-stack socket reports IPv4 clients in their mapped form.
+            PLASMA_CHECK(!limiter.try_acquire(make_address("::ffff:192.0.2.1")));
+
+            rate_limiter unlimited{ 0.0, 1.0 };
+            for (int i{}; i < 100; ++i)
+            {
+                PLASMA_CHECK(unlimited.try_acquire(address));
+            }
+        }
+
+        void test_ipv6_prefix()
+        {
+            rate_limiter limiter{ 0.001, 2.0 };
+            PLASMA_CHECK(limiter.try_acquire(make_address("2001:db8:0:1::1")));
+            PLASMA_CHECK(limiter.try_acquire(make_address("2001:db8:0:1:ffff:ffff:ffff:ffff")));
+            PLASMA_CHECK(!limiter.try_acquire(make_address("2001:db8:0:1::2")));
+            PLASMA_CHECK(limiter.try_acquire(make_address("2001:db8:0:2::1")));
+        }
+
+        // A flood of distinct sources evicts the least recently used buckets instead of growing without bound, so
+        // an address it pushed out starts over with a full burst.
+        void test_flood()
+        {
+            rate_limiter limiter{ 0.001, 1.0 };
+            auto first{ make_address("2001:db8::1") };
+            PLASMA_CHECK(limiter.try_acquire(first));
+            PLASMA_CHECK(!limiter.try_acquire(first));
+            for (std::uint32_t i{}; i < 200000; ++i)
+            {
+                boost::asio::ip::address_v6::bytes_type bytes{ 0x20, 0x01, 0x0d, 0xb9 };
+                bytes[4] = static_cast<std::uint8_t>(i >> 16);
+                bytes[5] = static_cast<std::uint8_t>(i >> 8);
+                bytes[6] = static_cast<std::uint8_t>(i);
+                PLASMA_CHECK(limiter.try_acquire(boost::asio::ip::address_v6{ bytes }));
+            }
+            PLASMA_CHECK(limiter.try_acquire(first));
+        }
+    }
+
+    void run_rate_limiter_tests()
+    {
+        test_burst();
+        test_ipv6_prefix();
+        test_flood();
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <source_location>
+#include <stdexcept>
+#include <string_view>
+
+#include <fmt/format.h>
+
+namespace plasma::test
+{
+    class check_failure : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    inline void check(bool condition, std::string_view expression,
+        std::source_location location = std::source_location::current())
+    {
+        if (!condition)
+        {
+            throw check_failure{ fmt::format("{}:{}: {} is false", location.file_name(), location.line(),
+                expression) };
+        }
+    }
+
+    template<typename TException, typename TFunction>
+    void check_throws(TFunction&& function, std::string_view expression,
+        std::source_location location = std::source_location::current())
+    {
+        try
+        {
+            function();
+        }
+        catch (const TException&)
+        {
+            return;
+        }
+        throw check_failure{ fmt::format("{}:{}: {} did not throw", location.file_name(), location.line(),
+            expression) };
+    }
+
+    // One per file in tests/, run by name from plasma-tests.
+    void run_varint_tests();
+
+    void run_nbt_tests();
+
+    void run_job_system_tests();
+
+    void run_rate_limiter_tests();
+
+    void run_chunk_saver_tests();
+}
+
+#define PLASMA_CHECK(condition) ::plasma::test::check(static_cast<bool>(condition), #condition)
+
+#define PLASMA_CHECK_THROWS(exception, expression) \
+    ::plasma::test::check_throws<exception>([&] { static_cast<void>(expression); }, #expression)
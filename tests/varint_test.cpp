@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <plasma/network/varint.h>
+
+#include "test.h"
+
+namespace plasma::test
+{
+    using namespace plasma::network;
+
+    namespace
+    {
+        // Byte at a time, as the protocol describes it. Returns std::nullopt when more bytes are needed and throws
+        // past the maximum length, like the codec under test.
+        template<typename TResult, std::size_t MaxSize>
+        std::optional<TResult> read_reference(std::span<const std::byte> data)
+        {
+            std::uint64_t value{};
+            for (std::size_t i{}; i < MaxSize; ++i)
+            {
+                if (i == data.size())
+                {
+                    return std::nullopt;
+                }
+                auto byte{ std::to_integer<std::uint64_t>(data[i]) };
+                value |= (byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80))
+                {
+                    return TResult{ .value = static_cast<decltype(TResult::value)>(value), .size = i + 1 };
+                }
+            }
+            throw std::runtime_error{ "Too big" };
+        }
+
+        // Padded so the whole-word paths are taken, not only the short-buffer fallback.
+        std::vector<std::byte> encode_varint(std::uint32_t value, std::size_t padding)
+        {
+            std::vector<std::byte> out(5 + padding, std::byte{ 0xff });
+            out.resize(write_varint(out.data(), value) + padding);
+            return out;
+        }
+
+        std::vector<std::byte> encode_varlong(std::uint64_t value, std::size_t padding)
+        {
+            std::vector<std::byte> out(10 + padding, std::byte{ 0xff });
+            out.resize(write_varlong(out.data(), value) + padding);
+            return out;
+        }
+
+        void test_round_trip()
+        {
+            const std::array<std::int32_t, 13> values{ 0, 1, 127, 128, 255, 16383, 16384, 2097151, 2097152, 268435455,
+                268435456, std::numeric_limits<std::int32_t>::max(), std::numeric_limits<std::int32_t>::min() };
+            for (auto value : values)
+            {
+                auto bits{ static_cast<std::uint32_t>(value) };
+                for (std::size_t padding : { 0, 8 })
+                {
+                    auto encoded{ encode_varint(bits, padding) };
+                    auto decoded{ read_varint(encoded) };
+                    PLASMA_CHECK(decoded);
+                    PLASMA_CHECK(decoded->value == value);
+                    PLASMA_CHECK(decoded->size == varint_size(bits));
+                    PLASMA_CHECK(decoded->size == encoded.size() - padding);
+                }
+            }
+            PLASMA_CHECK(varint_size(static_cast<std::uint32_t>(-1)) == 5);
+
+            const std::array<std::int64_t, 6> longs{ 0, 1, 128, std::numeric_limits<std::int32_t>::max() + 1LL,
+                std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min() };
+            for (auto value : longs)
+            {
+                for (std::size_t padding : { 0, 8 })
+                {
+                    auto encoded{ encode_varlong(static_cast<std::uint64_t>(value), padding) };
+                    auto decoded{ read_varlong(encoded) };
+                    PLASMA_CHECK(decoded);
+                    PLASMA_CHECK(decoded->value == value);
+                    PLASMA_CHECK(decoded->size == encoded.size() - padding);
+                }
+            }
+        }
+
+        void test_truncated()
+        {
+            auto encoded{ encode_varint(static_cast<std::uint32_t>(-1), 0) };
+            for (std::size_t size{}; size < encoded.size(); ++size)
+            {
+                PLASMA_CHECK(!read_varint(std::span{ encoded }.first(size)));
+            }
+            auto encoded_long{ encode_varlong(static_cast<std::uint64_t>(-1), 0) };
+            for (std::size_t size{}; size < encoded_long.size(); ++size)
+            {
+                PLASMA_CHECK(!read_varlong(std::span{ encoded_long }.first(size)));
+            }
+        }
+
+        void test_oversized()
+        {
+            // Six bytes where a VarInt may take five, short enough for the byte loop and long enough for the word.
+            for (std::size_t padding : { 0, 8 })
+            {
+                std::vector<std::byte> varint(5, std::byte{ 0x80 });
+                varint.push_back(std::byte{ 0x01 });
+                varint.resize(varint.size() + padding);
+                PLASMA_CHECK_THROWS(std::runtime_error, read_varint(varint));
+
+                std::vector<std::byte> varlong(10, std::byte{ 0x80 });
+                varlong.push_back(std::byte{ 0x01 });
+                varlong.resize(varlong.size() + padding);
+                PLASMA_CHECK_THROWS(std::runtime_error, read_varlong(varlong));
+            }
+            const std::vector<std::byte> endless(16, std::byte{ 0xff });
+            PLASMA_CHECK_THROWS(std::runtime_error, read_varint(endless));
+            PLASMA_CHECK_THROWS(std::runtime_error, read_varlong(endless));
+        }
+
+        // Random bytes, mostly with the continuation bit set, must decode exactly as the reference does.
+        void test_random()
+        {
+            std::mt19937_64 random{ 1 };
+            std::uniform_int_distribution<std::size_t> size{ 0, 16 };
+            std::bernoulli_distribution continued{ 0.7 };
+            std::uniform_int_distribution<std::uint32_t> payload{ 0, 0x7f };
+            std::vector<std::byte> data{};
+            for (std::size_t i{}; i < 200000; ++i)
+            {
+                data.resize(size(random));
+                for (auto& byte : data)
+                {
+                    byte = static_cast<std::byte>(payload(random) | (continued(random) ? 0x80 : 0x00));
+                }
+                auto check_same{ [&data](auto read, auto reference)
+                {
+                    std::optional<decltype(read(data))> actual{};
+                    std::optional<decltype(reference(data))> expected{};
+                    try
+                    {
+                        actual = read(data);
+                    }
+                    catch (const std::runtime_error&)
+                    {
+                    }
+                    try
+                    {
+                        expected = reference(data);
+                    }
+                    catch (const std::runtime_error&)
+                    {
+                    }
+                    PLASMA_CHECK(actual.has_value() == expected.has_value());
+                    if (actual && expected)
+                    {
+                        PLASMA_CHECK(actual->has_value() == expected->has_value());
+                        if (actual->has_value())
+                        {
+                            PLASMA_CHECK((*actual)->value == (*expected)->value);
+                            PLASMA_CHECK((*actual)->size == (*expected)->size);
+                        }
+                    }
+                } };
+                check_same(&read_varint, &read_reference<varint_result, 5>);
+                check_same(&read_varlong, &read_reference<varlong_result, 10>);
+            }
+        }
+    }
+
+    void run_varint_tests()
+    {
+        test_round_trip();
+        test_truncated();
+        test_oversized();
+        test_random();
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include <plasma/log/binary_format.h>
+
+int main(const int argc, const char* argv[])
+{
+    boost::program_options::options_description desc{ "plasma-logcat: Usage" };
+    desc.add_options()
+        ("help", "Show the help")
+        ("no-location", "Omit the source location of every record")
+        ("file", boost::program_options::value<std::vector<std::string>>(), "Binary log file to expand");
+    boost::program_options::positional_options_description positional{};
+    positional.add("file", -1);
+    boost::program_options::variables_map vm{};
+    try
+    {
+        store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+        notify(vm);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to parse command line: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (vm.count("help") || !vm.count("file"))
+    {
+        std::cerr << desc << std::endl;
+        return 1;
+    }
+
+    int result{};
+    for (const auto& path : vm["file"].as<std::vector<std::string>>())
+    {
+        std::ifstream stream{ path, std::ios::binary };
+        if (!stream)
+        {
+            std::cerr << "Failed to open " << path << std::endl;
+            result = 1;
+            continue;
+        }
+        try
+        {
+            plasma::log::binary::decoder decoder{ stream, !vm.count("no-location") };
+            std::string line{};
+            while (decoder.next(line))
+            {
+                std::cout << line << '\n';
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << path << ": " << e.what() << std::endl;
+            result = 1;
+        }
+    }
+    return result;
+}
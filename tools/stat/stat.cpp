@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2023-2024 Mesu Devastator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/program_options.hpp>
+#include <fmt/format.h>
+
+#include <plasma/metrics/metrics_segment.h>
+
+namespace
+{
+    using plasma::metrics::metric_kind;
+
+    class metric_sample
+    {
+    public:
+        std::string name;
+        std::string help;
+        metric_kind kind;
+        double unit;
+        // The total of a counter or the value of a gauge.
+        double value;
+        std::array<std::uint64_t, plasma::metrics::histogram_buckets + 1> buckets;
+        std::uint64_t count;
+        std::uint64_t sum;
+    };
+
+    class snapshot
+    {
+    public:
+        std::uint32_t process_id;
+        std::chrono::milliseconds heartbeat_age;
+        std::chrono::steady_clock::time_point taken;
+        std::vector<metric_sample> metrics;
+    };
+
+    std::string read_string(const auto& characters)
+    {
+        return { characters.data(), strnlen(characters.data(), characters.size()) };
+    }
+
+    // The server recreates the segment when it restarts, so it is mapped again for every snapshot.
+    snapshot take_snapshot(const std::string& name)
+    {
+        boost::interprocess::shared_memory_object memory{ boost::interprocess::open_only, name.c_str(),
+            boost::interprocess::read_only };
+        boost::interprocess::mapped_region region{ memory, boost::interprocess::read_only };
+        if (region.get_size() < sizeof(plasma::metrics::metrics_segment))
+        {
+            throw std::runtime_error{ fmt::format("Segment {} is too small", name) };
+        }
+        const auto& segment{ *static_cast<const plasma::metrics::metrics_segment*>(region.get_address()) };
+        if (segment.magic != plasma::metrics::segment_magic || segment.version != plasma::metrics::segment_version)
+        {
+            throw std::runtime_error{ fmt::format("Segment {} was not written by a compatible server", name) };
+        }
+        auto now{ std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()) };
+        snapshot result{
+            .process_id = segment.process_id,
+            .heartbeat_age = now - std::chrono::milliseconds{ segment.heartbeat.load(std::memory_order_relaxed) },
+            .taken = std::chrono::steady_clock::now(),
+            .metrics = {}
+        };
+        auto count{ std::min<std::size_t>(segment.metric_count.load(std::memory_order_acquire),
+            plasma::metrics::max_metrics) };
+        for (std::size_t i{}; i < count; ++i)
+        {
+            const auto& descriptor{ segment.metrics[i] };
+            metric_sample sample{
+                .name = read_string(descriptor.name),
+                .help = read_string(descriptor.help),
+                .kind = descriptor.kind,
+                .unit = descriptor.unit,
+                .value = 0.0,
+                .buckets = {},
+                .count = 0,
+                .sum = 0
+            };
+            if (descriptor.kind == metric_kind::histogram)
+            {
+                if (descriptor.slot >= plasma::metrics::max_histograms)
+                {
+                    continue;
+                }
+                for (const auto& shard : segment.shards)
+                {
+                    const auto& histogram{ shard.histograms[descriptor.slot] };
+                    for (std::size_t bucket{}; bucket < sample.buckets.size(); ++bucket)
+                    {
+                        auto value{ histogram[bucket].load(std::memory_order_relaxed) };
+                        sample.buckets[bucket] += value;
+                        sample.count += value;
+                    }
+                    sample.sum += histogram[plasma::metrics::histogram_buckets + 1].load(std::memory_order_relaxed);
+                }
+            }
+            else if (descriptor.slot < plasma::metrics::max_values)
+            {
+                if (descriptor.kind == metric_kind::gauge)
+                {
+                    sample.value = plasma::metrics::decode_gauge(
+                        segment.shards[0].values[descriptor.slot].load(std::memory_order_relaxed));
+                }
+                else
+                {
+                    std::uint64_t total{};
+                    for (const auto& shard : segment.shards)
+                    {
+                        total += shard.values[descriptor.slot].load(std::memory_order_relaxed);
+                    }
+                    sample.value = static_cast<double>(total);
+                }
+            }
+            result.metrics.push_back(std::move(sample));
+        }
+        return result;
+    }
+
+    // Upper bound of the bucket holding the given quantile, in the unit of the metric.
+    double get_quantile(const metric_sample& sample, double quantile)
+    {
+        if (!sample.count)
+        {
+            return 0.0;
+        }
+        auto target{ static_cast<std::uint64_t>(quantile * static_cast<double>(sample.count - 1)) + 1 };
+        std::uint64_t seen{};
+        for (std::size_t bucket{}; bucket < plasma::metrics::histogram_buckets; ++bucket)
+        {
+            seen += sample.buckets[bucket];
+            if (seen >= target)
+            {
+                return static_cast<double>(std::uint64_t{ 1 } << bucket) * sample.unit;
+            }
+        }
+        return static_cast<double>(std::uint64_t{ 1 } << plasma::metrics::histogram_buckets) * sample.unit;
+    }
+
+    std::string format_top(const snapshot& current, const std::optional<snapshot>& previous)
+    {
+        auto stale{ current.heartbeat_age > std::chrono::milliseconds{ plasma::metrics::stale_heartbeat_ms } };
+        auto out{ fmt::format("plasma pid {}, last update {:.1f} s ago{}\n\n", current.process_id,
+            static_cast<double>(current.heartbeat_age.count()) / 1000.0,
+            stale ? " (stale, is the server running?)" : "") };
+        auto elapsed{ previous ? std::chrono::duration<double>(current.taken - previous->taken).count() : 0.0 };
+        for (std::size_t i{}; i < current.metrics.size(); ++i)
+        {
+            const auto& sample{ current.metrics[i] };
+            const metric_sample* before{};
+            if (previous && i < previous->metrics.size() && previous->metrics[i].name == sample.name)
+            {
+                before = &previous->metrics[i];
+            }
+            switch (sample.kind)
+            {
+            case metric_kind::counter:
+                out += fmt::format("{:<48} {:>16.0f}", sample.name, sample.value);
+                if (before && elapsed > 0.0)
+                {
+                    out += fmt::format("  {:>12.1f}/s", (sample.value - before->value) / elapsed);
+                }
+                break;
+            case metric_kind::gauge:
+                out += fmt::format("{:<48} {:>16.2f}", sample.name, sample.value);
+                break;
+            case metric_kind::histogram:
+                out += fmt::format("{:<48} {:>16} samples, p50 <= {:g}, p99 <= {:g}, mean {:g}", sample.name,
+                    sample.count, get_quantile(sample, 0.5), get_quantile(sample, 0.99), sample.count
+                    ? static_cast<double>(sample.sum) * sample.unit / static_cast<double>(sample.count) : 0.0);
+                break;
+            }
+            out += '\n';
+        }
+        return out;
+    }
+
+    std::string escape_help(const std::string& help)
+    {
+        std::string escaped{};
+        for (auto c : help)
+        {
+            if (c == '\\')
+            {
+                escaped += "\\\\";
+            }
+            else if (c == '\n')
+            {
+                escaped += "\\n";
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // Text exposition format 0.0.4.
+    std::string format_prometheus(const snapshot& current)
+    {
+        std::string out{};
+        for (const auto& sample : current.metrics)
+        {
+            out += fmt::format("# HELP {} {}\n", sample.name, escape_help(sample.help));
+            switch (sample.kind)
+            {
+            case metric_kind::counter:
+                out += fmt::format("# TYPE {0} counter\n{0} {1}\n", sample.name, sample.value);
+                break;
+            case metric_kind::gauge:
+                out += fmt::format("# TYPE {0} gauge\n{0} {1}\n", sample.name, sample.value);
+                break;
+            case metric_kind::histogram:
+            {
+                out += fmt::format("# TYPE {} histogram\n", sample.name);
+                std::uint64_t cumulative{};
+                for (std::size_t bucket{}; bucket < plasma::metrics::histogram_buckets; ++bucket)
+                {
+                    cumulative += sample.buckets[bucket];
+                    out += fmt::format("{}_bucket{{le=\"{}\"}} {}\n", sample.name,
+                        static_cast<double>(std::uint64_t{ 1 } << bucket) * sample.unit, cumulative);
+                }
+                out += fmt::format("{0}_bucket{{le=\"+Inf\"}} {1}\n{0}_sum {2}\n{0}_count {1}\n", sample.name,
+                    sample.count, static_cast<double>(sample.sum) * sample.unit);
+                break;
+            }
+            }
+        }
+        out += "# HELP plasma_metrics_heartbeat_age_seconds Time since the server last updated its metrics\n"
+            "# TYPE plasma_metrics_heartbeat_age_seconds gauge\n";
+        out += fmt::format("plasma_metrics_heartbeat_age_seconds {}\n",
+            static_cast<double>(current.heartbeat_age.count()) / 1000.0);
+        return out;
+    }
+
+    // Requests are read up to the end of their headers, anything larger or slower is dropped so a single client
+    // cannot stall the exporter.
+    constexpr std::size_t max_request_size{ 8192 };
+    constexpr std::chrono::seconds request_timeout{ 5 };
+
+    std::string format_response(const std::string& segment, bool valid)
+    {
+        std::string status{ "200 OK" };
+        std::string body{};
+        if (!valid)
+        {
+            status = "431 Request Header Fields Too Large";
+        }
+        else
+        {
+            try
+            {
+                body = format_prometheus(take_snapshot(segment));
+            }
+            catch (const std::exception& e)
+            {
+                status = "503 Service Unavailable";
+                body = fmt::format("{}\n", e.what());
+            }
+        }
+        return fmt::format("HTTP/1.0 {}\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: {}\r\nConnection: close\r\n\r\n{}", status, body.size(), body);
+    }
+
+    class metrics_session : public std::enable_shared_from_this<metrics_session>
+    {
+    private:
+        const std::string& segment_;
+        boost::asio::ip::tcp::socket socket_;
+        boost::asio::steady_timer deadline_;
+        boost::asio::streambuf request_;
+        std::string response_;
+
+        void respond(bool valid)
+        {
+            response_ = format_response(segment_, valid);
+            boost::asio::async_write(socket_, boost::asio::buffer(response_),
+                [self = shared_from_this()](boost::system::error_code, std::size_t)
+                {
+                    boost::system::error_code error{};
+                    self->socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, error);
+                    self->deadline_.cancel();
+                });
+        }
+    public:
+        metrics_session(const std::string& segment, boost::asio::ip::tcp::socket socket) :
+            segment_{ segment }, socket_{ std::move(socket) }, deadline_{ socket_.get_executor() },
+            request_{ max_request_size }
+        {
+        }
+
+        void start()
+        {
+            deadline_.expires_after(request_timeout);
+            deadline_.async_wait([self = shared_from_this()](boost::system::error_code error)
+            {
+                if (!error)
+                {
+                    self->socket_.close(error);
+                }
+            });
+            boost::asio::async_read_until(socket_, request_, "\r\n\r\n",
+                [self = shared_from_this()](boost::system::error_code error, std::size_t)
+                {
+                    if (!error || error == boost::asio::error::not_found)
+                    {
+                        self->respond(!error);
+                        return;
+                    }
+                    self->deadline_.cancel();
+                });
+        }
+    };
+
+    void accept(boost::asio::ip::tcp::acceptor& acceptor, const std::string& segment)
+    {
+        acceptor.async_accept([&acceptor, &segment](boost::system::error_code error,
+            boost::asio::ip::tcp::socket socket)
+        {
+            if (!error)
+            {
+                std::make_shared<metrics_session>(segment, std::move(socket))->start();
+            }
+            accept(acceptor, segment);
+        });
+    }
+
+    // Answers every request on the port with the current metrics.
+    int serve(const std::string& segment, std::uint16_t port)
+    {
+        boost::asio::io_context context{};
+        boost::asio::ip::tcp::acceptor acceptor{ context,
+            { boost::asio::ip::make_address("127.0.0.1"), port } };
+        std::cerr << "Serving " << segment << " on http://127.0.0.1:" << port << "/metrics" << std::endl;
+        accept(acceptor, segment);
+        context.run();
+        return 0;
+    }
+}
+
+int main(const int argc, const char* argv[])
+{
+    boost::program_options::options_description desc{ "plasma-stat: Usage" };
+    desc.add_options()
+        ("help", "Show the help")
+        ("segment", boost::program_options::value<std::string>()->default_value("plasma-metrics"),
+            "Shared memory segment named by metrics.segment in plasma.info")
+        ("interval", boost::program_options::value<double>()->default_value(1.0), "Seconds between refreshes")
+        ("once", "Print the metrics once instead of refreshing them")
+        ("prometheus", "Print the metrics once in the Prometheus text format")
+        ("serve", boost::program_options::value<std::uint16_t>(), "Serve the metrics to Prometheus on this port "
+            "of 127.0.0.1");
+    boost::program_options::variables_map vm{};
+    try
+    {
+        store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+        notify(vm);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to parse command line: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (vm.count("help"))
+    {
+        std::cerr << desc << std::endl;
+        return 1;
+    }
+
+    auto segment{ vm["segment"].as<std::string>() };
+    try
+    {
+        if (vm.count("serve"))
+        {
+            return serve(segment, vm["serve"].as<std::uint16_t>());
+        }
+        if (vm.count("prometheus"))
+        {
+            std::cout << format_prometheus(take_snapshot(segment));
+            return 0;
+        }
+        if (vm.count("once"))
+        {
+            std::cout << format_top(take_snapshot(segment), std::nullopt);
+            return 0;
+        }
+        auto interval{ std::chrono::duration<double>(std::max(vm["interval"].as<double>(), 0.1)) };
+        std::optional<snapshot> previous{};
+        while (true)
+        {
+            auto current{ take_snapshot(segment) };
+            std::cout << "\x1b[H\x1b[2J" << format_top(current, previous) << std::flush;
+            previous = std::move(current);
+            std::this_thread::sleep_for(interval);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to read metrics from " << segment << ": " << e.what() << std::endl;
+        return 1;
+    }
+}